@@ -0,0 +1,223 @@
+/*
+ * Benchmark of the per-tick math: exact <cmath> trigonometry against fastMath.hpp and
+ * the cached heading of VehiclePhysics. Also measures the error of the approximations.
+ *
+ * The fixed-point mode (physicsMath.hpp) is compared with doubles: the table-based
+ * trigonometry of fixedPoint.hpp and one tick of the kinematics of VehiclePhysics for
+ * a million vehicles. The hash of the fixed-point results must be the same in every build
+ * (compiler, flags, platform); that's what the mode is for.
+ *
+ * Build and run: make mathbench && ./mathbench
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "fastMath.hpp"
+#include "fixedPoint.hpp"
+
+namespace {
+    const int N = 1 << 20;
+    const int ROUNDS = 20;
+
+    template <typename F>
+    double nsPerCall(F f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < ROUNDS; r++) {
+            f();
+        }
+        std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+        return time.count() / (double(N) * ROUNDS);
+    }
+
+    const double TICK = 1.0 / 120;
+    const double MAX_SPEED = 1300;
+
+    // The state of VehiclePhysics that updatePosition() uses.
+    template <typename Real, typename Vector>
+    struct Body {
+        Vector position0;
+        Vector velocity0;
+        Vector acceleration;
+        Vector position;
+        Vector velocity;
+        Real rotation0;
+        Real angularVelocity;
+        Real time;
+        Real slidingAngle;
+    };
+
+    // One tick of VehiclePhysics::updatePosition(), heading and sliding angle included.
+    template <typename Real, typename Vector>
+    void step(Body<Real, Vector>& b)
+    {
+        b.time += Real(TICK);
+        b.velocity = b.velocity0 + b.acceleration * b.time;
+        b.position = b.position0 + b.velocity0 * b.time + b.acceleration * (Real(0.5) * b.time * b.time);
+        Real rotation = b.rotation0 + b.angularVelocity * b.time;
+        Vector heading = Vector::getUnitVector(rotation);
+        if (b.velocity.getLength() > Real(MAX_SPEED)) {
+            b.velocity = b.velocity * Real(0.98);
+        }
+        b.slidingAngle = Vector::angleBetween(heading, b.velocity);
+    }
+
+    // The calls are in different functions of VehiclePhysics, so the compiler cannot merge them.
+#ifdef _MSC_VER
+    __declspec(noinline)
+#else
+    __attribute__((noinline))
+#endif
+    Vector2D exactUnitVector(double degs)
+    {
+        return Vector2D::getUnitVector(degs);
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> coord(-1000, 1000);
+    std::uniform_real_distribution<double> angle(-720, 720);
+    std::vector<Vector2D> a(N), b(N);
+    std::vector<double> degs(N);
+    for (int i = 0; i < N; i++) {
+        a[i] = Vector2D(coord(rng), coord(rng));
+        b[i] = Vector2D(coord(rng), coord(rng));
+        degs[i] = angle(rng);
+    }
+    std::vector<double> out(N);
+    double sink = 0;
+
+    // Error
+    double atanError = 0, sinError = 0;
+    for (int i = 0; i < N; i++) {
+        atanError = std::max(atanError, std::abs(Vector2D::angleBetween(a[i], b[i]) - fastmath::angleBetween(a[i], b[i])));
+        Vector2D exact = Vector2D::getUnitVector(degs[i]);
+        Vector2D fast = fastmath::unitVector(degs[i]);
+        sinError = std::max(sinError, std::max(std::abs(exact.x - fast.x), std::abs(exact.y - fast.y)));
+    }
+
+    double exactAngle = nsPerCall([&] {
+        for (int i = 0; i < N; i++) out[i] = Vector2D::angleBetween(a[i], b[i]);
+        sink += out[N / 2];
+    });
+    double fastAngle = nsPerCall([&] {
+        for (int i = 0; i < N; i++) out[i] = fastmath::angleBetween(a[i], b[i]);
+        sink += out[N / 2];
+    });
+    double exactUnit = nsPerCall([&] {
+        for (int i = 0; i < N; i++) out[i] = Vector2D::getUnitVector(degs[i]).x;
+        sink += out[N / 2];
+    });
+    double fastUnit = nsPerCall([&] {
+        for (int i = 0; i < N; i++) out[i] = fastmath::unitVector(degs[i]).x;
+        sink += out[N / 2];
+    });
+    // VehiclePhysics needed the nose direction up to 3 times per tick (accelerate, brake/reverse,
+    // fixDirections, getSlidingAngle), each one a separate sin and cos call. The heading is now
+    // computed only when the rotation has changed. Here the rotation changes on every second tick.
+    double uncached = nsPerCall([&] {
+        for (int i = 0; i < N; i++) {
+            double rotation = degs[i / 2];
+            double sum = 0;
+            for (int k = 0; k < 3; k++) sum += exactUnitVector(rotation).x;
+            out[i] = sum;
+        }
+        sink += out[N / 2];
+    });
+    double cached = nsPerCall([&] {
+        double headingRotation = std::nan("");
+        Vector2D heading(1, 0);
+        for (int i = 0; i < N; i++) {
+            double rotation = degs[i / 2];
+            double sum = 0;
+            for (int k = 0; k < 3; k++) {
+                if (rotation != headingRotation) {
+                    headingRotation = rotation;
+                    heading = exactUnitVector(rotation);
+                }
+                sum += heading.x;
+            }
+            out[i] = sum;
+        }
+        sink += out[N / 2];
+    });
+
+    // Fixed point. The inputs come from the raw output of the engine, because the
+    // distributions use floating point and would change the hash with the build.
+    std::mt19937 fixedRng(2);
+    auto fixedCoord = [&fixedRng](int range) {
+        std::int64_t thousandths = static_cast<std::int64_t>(fixedRng() % (2000 * range)) - 1000 * range;
+        return Fixed::fromRaw(thousandths * (Fixed::ONE / 1000));
+    };
+    std::vector<FixedVector> fa(N), fb(N);
+    std::vector<Fixed> fdegs(N), fout(N);
+    for (int i = 0; i < N; i++) {
+        fa[i] = FixedVector(fixedCoord(1000), fixedCoord(1000));
+        fb[i] = FixedVector(fixedCoord(1000), fixedCoord(1000));
+        fdegs[i] = fixedCoord(720);
+    }
+    double fixedAtanError = 0, fixedSinError = 0;
+    for (int i = 0; i < N; i++) {
+        fixedAtanError = std::max(fixedAtanError, std::abs(Vector2D::angleBetween(fa[i].toVector2D(), fb[i].toVector2D())
+                                                           - FixedVector::angleBetween(fa[i], fb[i]).toDouble()));
+        Vector2D exact = Vector2D::getUnitVector(fdegs[i].toDouble());
+        Vector2D table = FixedVector::getUnitVector(fdegs[i]).toVector2D();
+        fixedSinError = std::max(fixedSinError, std::max(std::abs(exact.x - table.x), std::abs(exact.y - table.y)));
+    }
+    Fixed fsink = 0;
+    double fixedAngle = nsPerCall([&] {
+        for (int i = 0; i < N; i++) fout[i] = FixedVector::angleBetween(fa[i], fb[i]);
+        fsink += fout[N / 2];
+    });
+    double fixedUnit = nsPerCall([&] {
+        for (int i = 0; i < N; i++) fout[i] = FixedVector::getUnitVector(fdegs[i]).x;
+        fsink += fout[N / 2];
+    });
+
+    std::vector<Body<double, Vector2D>> bodies(N);
+    std::vector<Body<Fixed, FixedVector>> fixedBodies(N);
+    for (int i = 0; i < N; i++) {
+        FixedVector velocity = FixedVector::getUnitVector(fdegs[i]) * (fixedmath::abs(fixedCoord(1000)) + 100);
+        fixedBodies[i] = {fa[i], velocity, fb[i] / 4, fa[i], velocity, fdegs[i], fixedCoord(100), 0, 0};
+        const Body<Fixed, FixedVector>& f = fixedBodies[i];
+        bodies[i] = {f.position0.toVector2D(), f.velocity0.toVector2D(), f.acceleration.toVector2D(), f.position.toVector2D(),
+                     f.velocity.toVector2D(), f.rotation0.toDouble(), f.angularVelocity.toDouble(), 0, 0};
+    }
+    double doubleStep = nsPerCall([&] {
+        for (int i = 0; i < N; i++) step(bodies[i]);
+        sink += bodies[N / 2].position.x;
+    });
+    double fixedStep = nsPerCall([&] {
+        for (int i = 0; i < N; i++) step(fixedBodies[i]);
+        fsink += fixedBodies[N / 2].position.x;
+    });
+    // Only integer arithmetic: the same bits with any compiler and flags.
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < N; i++) {
+        const Body<Fixed, FixedVector>& f = fixedBodies[i];
+        for (Fixed value : {f.position.x, f.position.y, f.velocity.x, f.velocity.y, f.slidingAngle, fout[i]}) {
+            hash = (hash ^ static_cast<std::uint64_t>(value.getRaw())) * 0x100000001B3ULL;
+        }
+    }
+    double drift = 0;
+    for (int i = 0; i < N; i++) {
+        drift = std::max(drift, (bodies[i].position - fixedBodies[i].position.toVector2D()).getLength());
+    }
+
+    std::printf("angleBetween  exact %6.2f ns  fast %6.2f ns  max error %.6f deg\n", exactAngle, fastAngle, atanError);
+    std::printf("unitVector    exact %6.2f ns  fast %6.2f ns  max error %.6f\n", exactUnit, fastUnit, sinError);
+    std::printf("heading/tick  uncached %6.2f ns  cached %6.2f ns\n", uncached, cached);
+    std::printf("fixed point   angleBetween %6.2f ns (max error %.6f deg)  unitVector %6.2f ns (max error %.7f)\n",
+                fixedAngle, fixedAtanError, fixedUnit, fixedSinError);
+    std::printf("physics tick  double %6.2f ns  fixed %6.2f ns  (%.2fx, %d ticks apart by %.6f px)\n",
+                doubleStep, fixedStep, fixedStep / doubleStep, ROUNDS, drift);
+    std::printf("fixed-point result hash %016llx\n", static_cast<unsigned long long>(hash));
+    std::printf("(%g %g)\n", sink, fsink.toDouble());
+    return 0;
+}
@@ -0,0 +1,293 @@
+/*
+ * Load test of SpectatorRelay on the local machine: a stand-in server streams 16 vehicles
+ * driving around (net::SpectatorStream), a relay forwards the stream and N spectators
+ * receive and decode it over UDP on localhost. Half of the spectators join in the middle
+ * of the stream, at different points between two keyframes.
+ *
+ * For N = 10 to 500, prints the time the relay spends per spectator and message (receiving,
+ * sending and the keep-alives, measured around SpectatorRelay::update()), the bandwidth per
+ * spectator, and how many messages the late joiners wait before the first snapshot they can
+ * decode. Also prints the sizes of keyframes and deltas against a player's acknowledged
+ * deltas. Checks that every spectator decodes every message after joining, within the
+ * quantization error.
+ *
+ * Build and run: make relaybench && ./relaybench
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "race.hpp"
+#include "spectatorRelay.hpp"
+#include "spectatorStream.hpp"
+#include "constants.hpp"
+
+namespace {
+    const int VEHICLES = 16;
+    const int MESSAGES = 1200; // 20 s at 60 Hz
+    const int KEEP_ALIVE_MESSAGES = 60; // a spectator sends SPECTATE once per second
+    const unsigned short SERVER_PORT = 54470;
+    const unsigned short RELAY_PORT = 54471;
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Car {
+        double radius;
+        double angle;  // position on the circle, radians
+        double speed;  // px/s
+    };
+
+    // State of the cars after tick, like Race::writeSnapshot().
+    void writeSnapshot(const std::vector<Car>& cars, unsigned int tick, net::Snapshot& snapshot)
+    {
+        snapshot.tick = tick;
+        snapshot.started = true;
+        snapshot.lapsDriven = 1;
+        snapshot.vehicles.clear();
+        for (std::size_t i = 0; i < cars.size(); i++) {
+            const Car& car = cars[i];
+            net::VehicleState v;
+            v.id = static_cast<sf::Uint8>(i + 1);
+            v.x = static_cast<float>(1500 + car.radius * std::cos(car.angle));
+            v.y = static_cast<float>(1000 + car.radius * std::sin(car.angle));
+            v.vx = static_cast<float>(-car.speed * std::sin(car.angle));
+            v.vy = static_cast<float>(car.speed * std::cos(car.angle));
+            v.rotation = static_cast<float>(car.angle * 180 / PI + 90);
+            v.hp = 100;
+            v.laps = 1;
+            v.checkpoints = static_cast<sf::Uint8>(tick / 600);
+            v.place = static_cast<sf::Uint8>(i + 1);
+            std::fill(v.weapons, v.weapons + net::MAX_WEAPONS, 0);
+            snapshot.vehicles.push_back(v);
+        }
+        snapshot.pickups = {{1, 400, 300}, {2, 1200, 900}, {3, 2000, 400}};
+    }
+
+    struct Spectator {
+        sf::UdpSocket socket;
+        net::SnapshotCodec codec;
+        net::Snapshot snapshot;
+        sf::Packet packet;
+        int joinMessage = 0;
+        int firstDecoded = -1;  // message of the stream when the first snapshot was decoded
+        int decoded = 0;        // messages decoded from joinMessage on
+        int lastDecoded = -1;   // message of the latest decoded snapshot
+        bool welcomed = false;
+
+        void sendSpectate()
+        {
+            net::beginMessage(packet, net::SPECTATE);
+            packet << static_cast<sf::Uint8>(welcomed ? 1 : 0);
+            socket.send(packet, sf::IpAddress::LocalHost, RELAY_PORT);
+        }
+
+        // Handle everything received, like RaceClient::receive().
+        void receive(int message)
+        {
+            sf::IpAddress sender;
+            unsigned short senderPort;
+            while (socket.receive(packet, sender, senderPort) == sf::Socket::Done) {
+                net::MessageType type;
+                if (!net::readHeader(packet, type)) {
+                    continue;
+                }
+                if (type == net::WELCOME && !welcomed) {
+                    welcomed = true;
+                    sendSpectate();
+                }
+                else if ((type == net::KEYFRAME || type == net::SNAPSHOT) && codec.decode(packet, snapshot)) {
+                    // A late joiner first gets the cached keyframe, older than joinMessage.
+                    int decodedMessage = static_cast<int>(snapshot.tick / net::SNAPSHOT_INTERVAL) - 1;
+                    if (decodedMessage > lastDecoded) {
+                        lastDecoded = decodedMessage;
+                        if (decodedMessage >= joinMessage) {
+                            decoded++;
+                        }
+                    }
+                    if (firstDecoded < 0) {
+                        firstDecoded = message;
+                    }
+                }
+            }
+        }
+    };
+
+    struct Result {
+        double relayMicros = 0;   // per spectator and message
+        double sendMicros = 0;    // of which sending
+        double kbitPerSpectator = 0;
+        std::size_t dropped = 0;
+        double meanWait = 0;      // messages from joining to the first decoded one, late joiners
+        int worstWait = 0;
+        int missing = 0;          // messages not decoded after the first one
+        double worstError = 0;    // px
+        double keyframeBytes = 0;
+        double deltaBytes = 0;
+        double playerDeltaBytes = 0;
+    };
+
+    Result run(int spectatorCount)
+    {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<double> unit(0, 1);
+        std::vector<Car> cars;
+        for (int i = 0; i < VEHICLES; i++) {
+            cars.push_back({700.0 + i * 15, i * 0.2, 350 + unit(rng) * 150});
+        }
+
+        // The stand-in server: WELCOME to SPECTATE, then the stream.
+        sf::UdpSocket server;
+        server.bind(SERVER_PORT);
+        server.setBlocking(false);
+        RaceSetup setup;
+        setup.xmlfile = "Map1.xml";
+        net::SpectatorStream stream;
+        net::SnapshotCodec playerCodec; // a player acknowledging every snapshot, for comparison
+        sf::Packet packet;
+        auto answerSubscriptions = [&]() {
+            sf::IpAddress sender;
+            unsigned short senderPort;
+            net::MessageType type;
+            while (server.receive(packet, sender, senderPort) == sf::Socket::Done) {
+                sf::Uint8 welcomed = 0;
+                if (net::readHeader(packet, type) && type == net::SPECTATE && packet >> welcomed && welcomed == 0) {
+                    net::beginMessage(packet, net::WELCOME);
+                    packet << net::SPECTATOR_SLOT << setup;
+                    server.send(packet, sender, senderPort);
+                }
+            }
+        };
+
+        SpectatorRelay relay(sf::IpAddress::LocalHost, SERVER_PORT, RELAY_PORT, spectatorCount);
+        if (!relay.start()) {
+            std::exit(1);
+        }
+        // Subscribe before the stream starts.
+        for (int i = 0; i < 10; i++) {
+            answerSubscriptions();
+            relay.update();
+            sf::sleep(sf::milliseconds(1));
+        }
+
+        std::vector<std::unique_ptr<Spectator>> spectators;
+        for (int i = 0; i < spectatorCount; i++) {
+            std::unique_ptr<Spectator> spectator(new Spectator());
+            spectator->socket.bind(sf::Socket::AnyPort);
+            spectator->socket.setBlocking(false);
+            // Late joiners are spread over the interval between two keyframes.
+            spectator->joinMessage = i % 2 == 0 ? 0 : MESSAGES / 2 + i % net::SpectatorStream::KEYFRAME_INTERVAL;
+            spectators.push_back(std::move(spectator));
+        }
+
+        net::Snapshot snapshot;
+        Clock::duration relayTime(0);
+        Result result;
+        int keyframes = 0;
+        int deltas = 0;
+        sf::Uint32 previousTick = 0;
+        for (int message = 0; message < MESSAGES; message++) {
+            unsigned int tick = (message + 1) * net::SNAPSHOT_INTERVAL;
+            for (Car& car : cars) {
+                car.speed = std::max(200.0, std::min(700.0, car.speed + (unit(rng) - 0.5) * 20));
+                car.angle += car.speed * TICK_TIME * net::SNAPSHOT_INTERVAL / car.radius;
+            }
+            writeSnapshot(cars, tick, snapshot);
+
+            for (auto& spectator : spectators) {
+                if (message == spectator->joinMessage
+                    || (message > spectator->joinMessage && (message - spectator->joinMessage) % KEEP_ALIVE_MESSAGES == 0)) {
+                    spectator->sendSpectate();
+                }
+            }
+
+            answerSubscriptions();
+            stream.encode(snapshot);
+            const sf::Packet& streamMessage = stream.getMessage();
+            server.send(streamMessage.getData(), streamMessage.getDataSize(), sf::IpAddress::LocalHost, RELAY_PORT);
+            if (&streamMessage == &stream.getKeyframe()) {
+                result.keyframeBytes += streamMessage.getDataSize();
+                keyframes++;
+            }
+            else {
+                result.deltaBytes += streamMessage.getDataSize();
+                deltas++;
+            }
+            packet.clear();
+            playerCodec.encode(snapshot, previousTick, 0, packet);
+            result.playerDeltaBytes += packet.getDataSize();
+            previousTick = tick;
+
+            Clock::time_point start = Clock::now();
+            relay.update();
+            relayTime += Clock::now() - start;
+
+            for (auto& spectator : spectators) {
+                if (message >= spectator->joinMessage) {
+                    spectator->receive(message);
+                }
+            }
+        }
+
+        // Every spectator decodes every message from the first one on and ends with the last.
+        int lateJoiners = 0;
+        for (auto& spectator : spectators) {
+            if (spectator->firstDecoded < 0) {
+                result.missing += MESSAGES - spectator->joinMessage;
+                result.worstWait = MESSAGES;
+                continue;
+            }
+            result.missing += MESSAGES - std::max(spectator->firstDecoded, spectator->joinMessage) - spectator->decoded;
+            if (spectator->joinMessage > 0) {
+                int wait = spectator->firstDecoded - spectator->joinMessage;
+                result.meanWait += wait;
+                result.worstWait = std::max(result.worstWait, wait);
+                lateJoiners++;
+            }
+            for (const net::VehicleState& v : spectator->snapshot.vehicles) {
+                const net::VehicleState& original = snapshot.vehicles[v.id - 1];
+                result.worstError = std::max(result.worstError, static_cast<double>(std::hypot(v.x - original.x, v.y - original.y)));
+            }
+        }
+        result.meanWait /= std::max(1, lateJoiners);
+
+        const net::BroadcastStats& stats = relay.getSpectators().getStats();
+        double sends = static_cast<double>(std::max<std::size_t>(1, stats.sends));
+        result.relayMicros = std::chrono::duration<double, std::micro>(relayTime).count() / sends;
+        result.sendMicros = stats.micros / sends;
+        result.kbitPerSpectator = stats.bytes / sends * 8 * TICK_RATE / net::SNAPSHOT_INTERVAL / 1000;
+        result.dropped = stats.dropped;
+        result.keyframeBytes /= std::max(1, keyframes);
+        result.deltaBytes /= std::max(1, deltas);
+        result.playerDeltaBytes /= MESSAGES;
+
+        relay.finish();
+        return result;
+    }
+}
+
+int main()
+{
+    std::printf("%d vehicles, %d messages/s, keyframe every %u messages, half of the spectators join late\n",
+                VEHICLES, TICK_RATE / net::SNAPSHOT_INTERVAL, net::SpectatorStream::KEYFRAME_INTERVAL);
+    std::printf("spectators   relay us/spectator   of which send   kbit/s each   late join wait (msgs)   dropped   missing\n");
+    bool valid = true;
+    Result last;
+    for (int spectators : {10, 100, 250, 500}) {
+        Result result = run(spectators);
+        std::printf("%10d   %18.2f   %13.2f   %11.1f   %10.1f mean %3d max   %7zu   %7d\n", spectators,
+                    result.relayMicros, result.sendMicros, result.kbitPerSpectator,
+                    result.meanWait, result.worstWait, result.dropped, result.missing);
+        valid = valid && result.missing == 0 && result.worstError <= 0.1;
+        last = result;
+    }
+    std::printf("\nkeyframe %.0f bytes, delta %.0f bytes on average, a player's acknowledged delta %.0f bytes\n",
+                last.keyframeBytes, last.deltaBytes, last.playerDeltaBytes);
+    std::printf("worst position error %.3f px\n", last.worstError);
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+/*
+ * Benchmark of Rollback: a headless race of 4 players and 12 bots where the inputs of
+ * players 2-4 arrive MAX_ROLLBACK ticks late, so every change of their input rolls the race
+ * back and simulates 8 ticks again. Prints the size of the saved state, the time of
+ * Race::saveState() and Race::loadState() and of advance() with and without a rollback,
+ * against the frame budget at 60 fps. Checks that the race ends in the same state, with
+ * the same state hash, as a race which had every input in time.
+ *
+ * Build and run (in the build directory, like the game): make rollbackbench && ./rollbackbench
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include "rollback.hpp"
+#include "xmlParser.hpp"
+#include "settings.hpp"
+
+namespace {
+    const int PLAYERS = 4;
+    const int BOTS = 12;
+    const unsigned int TICKS = COUNTDOWN_TICKS + 30 * TICK_RATE;
+    const unsigned int DELAY = Rollback::MAX_ROLLBACK;
+    const double FRAME_BUDGET = 1e6 / 60; // us
+    const double STATE_BUDGET = 100;      // us
+
+    typedef std::chrono::steady_clock Clock;
+
+    double microsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    // Throttle held, turns of one second now and then, and a shot every two seconds.
+    Controls getInput(int player, unsigned int tick)
+    {
+        unsigned int phase = (tick / TICK_RATE + player * 3) % 5;
+        Controls controls = control::ACCELERATE;
+        if (phase == 1) {
+            controls |= control::LEFT;
+        }
+        else if (phase == 3) {
+            controls |= control::RIGHT;
+        }
+        if ((tick + player * 37) % (2 * TICK_RATE) == 0) {
+            controls |= control::FIRE;
+        }
+        return controls;
+    }
+
+    std::unique_ptr<Race> createRace()
+    {
+        RaceSetup setup;
+        setup.xmlfile = "Map1.xml";
+        setup.raceType = Race::RaceType::NormalRace;
+        setup.seed = 1;
+        setup.players = PLAYERS;
+        setup.bots = BOTS;
+        setup.vehicleImage = "car2.png";
+        setup.backgroundImage = "background4.jpg";
+        std::unique_ptr<Race> race = Race::create(setup);
+        race->addVehicles(setup);
+        race->setSeed(setup.seed);
+        race->initialize();
+        return race;
+    }
+
+    bool isSameState(Race& a, Race& b)
+    {
+        auto isSame = [](Vehicle& v, Vehicle& w) {
+            const VehiclePhysics& p = v.getPhysics();
+            const VehiclePhysics& q = w.getPhysics();
+            return p.getX() == q.getX() && p.getY() == q.getY() && p.getRotation() == q.getRotation()
+                   && p.getVelocity().x == q.getVelocity().x && p.getVelocity().y == q.getVelocity().y
+                   && v.getHP() == w.getHP() && v.getLaps() == w.getLaps()
+                   && v.getVisitedCheckPoints() == w.getVisitedCheckPoints() && v.getWeapons().size() == w.getWeapons().size();
+        };
+        // A rollback must not change the hash chain either, peers compare it.
+        bool same = a.getTick() == b.getTick() && a.getStateHash().total == b.getStateHash().total;
+        for (std::size_t i = 0; i < a.getVehicles().size(); i++) {
+            same = same && isSame(*a.getVehicles()[i], *b.getVehicles()[i]);
+        }
+        for (std::size_t i = 0; i < a.getAIVehicles().size(); i++) {
+            same = same && isSame(*a.getAIVehicles()[i], *b.getAIVehicles()[i]);
+        }
+        return same;
+    }
+}
+
+int main()
+{
+    settings::headless = true;
+    std::unique_ptr<Race> race;
+    std::unique_ptr<Race> reference;
+    try {
+        race = createRace();
+        reference = createRace();
+    }
+    catch (XMLException &e) {
+        std::fprintf(stderr, "Cannot read the track: %s\n", e.what());
+        return 1;
+    }
+
+    Rollback rollback(*race);
+    double plainTime = 0, rollbackTime = 0, worstRollback = 0;
+    int plainCount = 0, rollbackCount = 0;
+    for (unsigned int tick = 1; tick <= TICKS; tick++) {
+        // The local player's input is known at once, the others' DELAY ticks later.
+        rollback.addInput(0, tick, getInput(0, tick));
+        if (tick > DELAY) {
+            for (int player = 1; player < PLAYERS; player++) {
+                rollback.addInput(player, tick - DELAY, getInput(player, tick - DELAY));
+            }
+        }
+        Clock::time_point start = Clock::now();
+        unsigned int resimulated = rollback.advance();
+        double time = microsSince(start);
+        if (resimulated == DELAY) {
+            rollbackTime += time;
+            worstRollback = std::max(worstRollback, time);
+            rollbackCount++;
+        }
+        else if (resimulated == 0) {
+            plainTime += time;
+            plainCount++;
+        }
+    }
+    // The late inputs arrive, and the next tick corrects the rest of the race.
+    for (unsigned int tick = TICKS - DELAY + 1; tick <= TICKS + 1; tick++) {
+        for (int player = 0; player < PLAYERS; player++) {
+            rollback.addInput(player, tick, getInput(player, tick));
+        }
+    }
+    rollback.advance();
+
+    for (unsigned int tick = 1; tick <= TICKS + 1; tick++) {
+        for (int player = 0; player < PLAYERS; player++) {
+            reference->getVehicles()[player]->setInputControls(getInput(player, tick));
+        }
+        reference->step();
+    }
+    bool same = isSameState(*race, *reference);
+
+    // Saving and restoring alone.
+    const int ROUNDS = 1000;
+    StateBuffer state;
+    race->saveState(state);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        state.clear();
+        race->saveState(state);
+    }
+    double saveTime = microsSince(start) / ROUNDS;
+    start = Clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        state.rewind();
+        race->loadState(state);
+    }
+    double loadTime = microsSince(start) / ROUNDS;
+
+    std::printf("%d players, %d bots, %u ticks, remote inputs %u ticks late\n", PLAYERS, BOTS, TICKS, DELAY);
+    std::printf("  state:     %u bytes\n", static_cast<unsigned int>(state.size()));
+    std::printf("  save:      %.2f us\n", saveTime);
+    std::printf("  restore:   %.2f us\n", loadTime);
+    std::printf("  tick:      %.1f us (%d ticks without rollback)\n", plainTime / std::max(1, plainCount), plainCount);
+    std::printf("  rollback:  %.1f us mean, %.1f us worst for %u ticks again (%d rollbacks), frame budget %.0f us\n",
+                rollbackTime / std::max(1, rollbackCount), worstRollback, DELAY, rollbackCount, FRAME_BUDGET);
+    std::printf("  the same final state as without delay: %s\n", same ? "yes" : "NO");
+
+    bool valid = same && saveTime < STATE_BUDGET && loadTime < STATE_BUDGET && worstRollback < FRAME_BUDGET;
+    return valid ? 0 : 1;
+}
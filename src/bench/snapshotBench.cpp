@@ -0,0 +1,181 @@
+/*
+ * Benchmark of net::SnapshotCodec and net::InterestFilter: vehicles driving around a track,
+ * snapshots at 60 Hz, acknowledgements delayed by the round trip time and some packets lost.
+ * Prints the size of a snapshot, the bandwidth per client and the encoding and decoding time
+ * for 16 vehicles, and how the size grows with the number of vehicles with and without
+ * the interest filter. Checks that the decoded positions are within the quantization error.
+ *
+ * Build and run: make snapshotbench && ./snapshotbench
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <random>
+
+#include "interestFilter.hpp"
+#include "snapshotCodec.hpp"
+#include "constants.hpp"
+
+namespace {
+    const int SECONDS = 60;
+    const int RTT_SNAPSHOTS = 6;   // 100 ms round trip at 60 Hz
+    const double LOSS = 0.05;      // share of snapshots lost
+    const double PI = 3.14159265358979323846;
+
+    struct Car {
+        double radius;
+        double angle;  // position on the circle, radians
+        double speed;  // px/s
+    };
+
+    // State of the cars after tick, like Race::writeSnapshot().
+    void writeSnapshot(const std::vector<Car>& cars, unsigned int tick, std::mt19937& rng, net::Snapshot& snapshot)
+    {
+        snapshot.tick = tick;
+        snapshot.started = true;
+        snapshot.lapsDriven = 1;
+        snapshot.vehicles.clear();
+        snapshot.projectiles.clear();
+        for (std::size_t i = 0; i < cars.size(); i++) {
+            const Car& car = cars[i];
+            net::VehicleState v;
+            v.id = static_cast<sf::Uint8>(i + 1);
+            v.x = static_cast<float>(1500 + car.radius * std::cos(car.angle));
+            v.y = static_cast<float>(1000 + car.radius * std::sin(car.angle));
+            v.vx = static_cast<float>(-car.speed * std::sin(car.angle));
+            v.vy = static_cast<float>(car.speed * std::cos(car.angle));
+            v.rotation = static_cast<float>(car.angle * 180 / PI + 90);
+            v.hp = 100;
+            v.laps = 1;
+            v.checkpoints = static_cast<sf::Uint8>(tick / 600);
+            v.place = static_cast<sf::Uint8>(i + 1);
+            std::fill(v.weapons, v.weapons + net::MAX_WEAPONS, 0);
+            snapshot.vehicles.push_back(v);
+        }
+        // A few bullets in the air now and then.
+        int bullets = std::uniform_int_distribution<int>(0, 6)(rng) < 2 ? static_cast<int>(cars.size()) / 5 : 0;
+        for (int i = 0; i < bullets; i++) {
+            const net::VehicleState& v = snapshot.vehicles[i];
+            snapshot.projectiles.push_back({net::ProjectileState::BULLET, v.id, v.x + 40, v.y, v.rotation});
+        }
+        snapshot.pickups = {{1, 400, 300}, {2, 1200, 900}, {3, 2000, 400}};
+    }
+
+    struct Result {
+        net::CodecStats sent;
+        net::CodecStats received;
+        int lost = 0;
+        int failed = 0;
+        double worstError = 0;
+    };
+
+    // One client driving the first car. Without filter, every snapshot has all the cars.
+    Result run(int vehicles, bool filter)
+    {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<double> unit(0, 1);
+        std::vector<Car> cars;
+        for (int i = 0; i < vehicles; i++) {
+            cars.push_back({700.0 + i * 15, i * 0.2, 350 + unit(rng) * 150});
+        }
+
+        net::SnapshotCodec server;
+        net::SnapshotCodec client;
+        net::InterestFilter interest;
+        net::Snapshot snapshot;
+        net::Snapshot relevant;
+        net::Snapshot decoded;
+        sf::Packet packet;
+        // Acknowledgements (tick and bits) on their way to the server.
+        std::deque<std::pair<sf::Uint32, sf::Uint32>> acks;
+        sf::Uint32 ackTick = 0;
+        sf::Uint32 ackBits = 0;
+        Result result;
+
+        unsigned int ticks = SECONDS * TICK_RATE;
+        for (unsigned int tick = 1; tick <= ticks; tick++) {
+            for (Car& car : cars) {
+                car.speed = std::max(200.0, std::min(700.0, car.speed + (unit(rng) - 0.5) * 20));
+                car.angle += car.speed * TICK_TIME / car.radius;
+            }
+            if (tick % net::SNAPSHOT_INTERVAL != 0) {
+                continue;
+            }
+            writeSnapshot(cars, tick, rng, snapshot);
+            if (filter) {
+                interest.select(snapshot, 1, sf::Vector2f(WIDTH, HEIGHT), relevant);
+            }
+            packet.clear();
+            server.encode(filter ? relevant : snapshot, ackTick, ackBits, packet);
+
+            if (unit(rng) < LOSS) {
+                result.lost++;
+            }
+            else if (!client.decode(packet, decoded)) {
+                result.failed++;
+            }
+            else {
+                acks.push_back(std::make_pair(decoded.tick, client.getAckBits(decoded.tick)));
+                for (const net::VehicleState& v : decoded.vehicles) {
+                    const net::VehicleState& original = snapshot.vehicles[v.id - 1];
+                    double error = std::hypot(v.x - original.x, v.y - original.y);
+                    result.worstError = std::max(result.worstError, error);
+                }
+            }
+            if (acks.size() > RTT_SNAPSHOTS) {
+                ackTick = acks.front().first;
+                ackBits = acks.front().second;
+                acks.pop_front();
+            }
+        }
+        result.sent = server.getStats();
+        result.received = client.getStats();
+        return result;
+    }
+
+    double bytesPerSnapshot(const Result& result)
+    {
+        return static_cast<double>(result.sent.bytes) / result.sent.snapshots;
+    }
+
+    double kbitPerSecond(const Result& result)
+    {
+        return bytesPerSnapshot(result) * 8 * TICK_RATE / net::SNAPSHOT_INTERVAL / 1000;
+    }
+
+    bool isValid(const Result& result)
+    {
+        return result.failed == 0 && result.worstError <= 0.1;
+    }
+}
+
+int main()
+{
+    std::printf("%d snapshots/s, %.0f ms RTT, %.0f %% loss, sizes without UDP/IP headers\n",
+                TICK_RATE / net::SNAPSHOT_INTERVAL, RTT_SNAPSHOTS * 1000.0 * net::SNAPSHOT_INTERVAL / TICK_RATE,
+                LOSS * 100);
+
+    Result all = run(16, false);
+    std::printf("16 vehicles, all sent:\n");
+    std::printf("  snapshot:  %.1f bytes (%.1f bytes/vehicle)\n", bytesPerSnapshot(all), bytesPerSnapshot(all) / 16);
+    std::printf("  bandwidth: %.1f kbit/s per client\n", kbitPerSecond(all));
+    std::printf("  encode:    %.2f us/snapshot\n", static_cast<double>(all.sent.micros) / all.sent.snapshots);
+    std::printf("  decode:    %.2f us/snapshot\n",
+                static_cast<double>(all.received.micros) / std::max(1u, all.received.snapshots));
+    std::printf("  lost %d, undecodable %d, worst position error %.3f px\n", all.lost, all.failed, all.worstError);
+    bool valid = isValid(all);
+
+    std::printf("\nvehicles   all sent          interest filter (%d vehicles at most)\n",
+                static_cast<int>(net::InterestFilter::MAX_VEHICLES));
+    for (int vehicles : {16, 32, 64, 128}) {
+        Result unfiltered = vehicles == 16 ? all : run(vehicles, false);
+        Result filtered = run(vehicles, true);
+        std::printf("%8d   %5.0f B %5.1f kbit/s   %5.0f B %5.1f kbit/s\n", vehicles,
+                    bytesPerSnapshot(unfiltered), kbitPerSecond(unfiltered),
+                    bytesPerSnapshot(filtered), kbitPerSecond(filtered));
+        valid = valid && isValid(unfiltered) && isValid(filtered);
+    }
+    return valid ? 0 : 1;
+}
@@ -25,17 +25,39 @@ public:
     /// Destructor.
     virtual ~AIVehicle() = default;
 
-    /// Function to move AI.
+    /// Level of detail of the simulation. See Race::updateDetailLevels().
+    enum class Detail {
+        FULL,      // physics, collisions and moveAI() on every tick
+        KINEMATIC  // moved along the racing line by moveKinematic(), no physics
+    };
+
+    Detail getDetail() const { return detail; }
+
+    /// Change the level of detail. Switching to KINEMATIC puts the vehicle on the racing line,
+    /// switching back to FULL continues with the position, rotation and speed it has there.
+    void setDetail(Detail newDetail, const Track& track);
+
+    /// Function to move AI. The AI follows the racing line of the track
+    /// (pure pursuit) and keeps the target speed of the line.
     void moveAI(Track& track);
 
+    /// Move a KINEMATIC vehicle time seconds along the racing line. The speed follows
+    /// the target speed of the line with the acceleration and braking of the physics.
+    void moveKinematic(const Track& track, double time);
+
+    /// Save, restore and hash the state of the vehicle and of the AI.
+    void saveState(StateBuffer& state) const override;
+    void loadState(StateBuffer& state) override;
+    void hashState(StateHasher& hasher) const override;
+
     /// Function for getting checkpoint that AI should aim at.
     static const sf::RectangleShape& getTargetCheckpoint(const Track& track, int& index);
 
     /// Function for getting middle point of sf::Rectangleshape.
     static structures::Point getMiddlePoint(const sf::RectangleShape& target);
 
-    /// Function for getting AI driving direction.
-    static Vector2D getAIDirection(sf::RectangleShape& shape);
+    /// Function for getting AI driving direction (approximate unit vector).
+    static physmath::Vector getAIDirection(sf::RectangleShape& shape);
 
     /// Function for getting distance between two points.
     static int calculateDistanceBetweenPoints(const structures::Point& point1,
@@ -43,11 +65,17 @@ public:
 
 private:
 
-    // index value for the next checkpoint
-    int targetCheckpoint;
+    // Index of the nearest racing line sample on the previous tick.
+    std::size_t lineIndex = 0;
+
+    // Set when lineIndex is valid. The first search goes through the whole line.
+    bool onLine = false;
+
+    Detail detail = Detail::FULL;
 
-    // acceleration flag
-    bool accelerating = false;
+    // KINEMATIC: distance along the racing line and speed.
+    physmath::Real lineDistance = 0;
+    physmath::Real lineSpeed = 0;
 
 };
 
@@ -0,0 +1,62 @@
+#ifndef BIT_STREAM_HPP
+#define BIT_STREAM_HPP
+
+#include <SFML/Config.hpp>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Writes values of any number of bits (1...32) one after another, without padding,
+ * least significant bit first. Used by net::SnapshotCodec.
+ */
+
+class BitWriter
+{
+public:
+
+    void clear();
+
+    /// Append the lowest bits of value.
+    void write(sf::Uint32 value, int bits);
+
+    void writeBool(bool value) { write(value ? 1 : 0, 1); }
+
+    /// Written bytes. The last byte is padded with zero bits.
+    const std::vector<sf::Uint8>& getData() const { return data; }
+
+    std::size_t getBitCount() const { return bitCount; }
+
+private:
+
+    std::vector<sf::Uint8> data;
+    std::size_t bitCount = 0;
+};
+
+/**
+ * Reads the values written by BitWriter in the same order. Reading past the end returns
+ * zeros and sets the overflow flag, so a corrupted message can be checked once at the end.
+ */
+
+class BitReader
+{
+public:
+
+    /// Read from size bytes at data. The data must outlive the reader.
+    BitReader(const sf::Uint8* data, std::size_t size) : data(data), size(size) {}
+
+    sf::Uint32 read(int bits);
+
+    bool readBool() { return read(1) != 0; }
+
+    bool isOverflowed() const { return overflowed; }
+
+private:
+
+    const sf::Uint8* data;
+    std::size_t size;
+    std::size_t position = 0; // in bits
+    bool overflowed = false;
+};
+
+
+#endif
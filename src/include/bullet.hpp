@@ -6,6 +6,8 @@
 #include <deque>
 
 #include "vehiclePhysics.hpp"
+#include "stateBuffer.hpp"
+#include "stateHash.hpp"
 
 /*
  * Class representing a single bullet.
@@ -46,12 +48,20 @@ public:
 	
 	const int &getOwnerID() const;
     
+    /// Save the simulation state to state, see Race::saveState().
+    void saveState(StateBuffer& state) const;
+    
+    /// Restore the state saved by saveState().
+    void loadState(StateBuffer& state);
+    
+    /// Add the simulation state to hasher, see Race::hashState().
+    void hashState(StateHasher& hasher) const;
+    
     
     
 private:
     sf::RectangleShape shape;
     VehiclePhysics physics;
-    sf::Texture bulletTexture; // Currently unused.
     
     /// Assign shape position and rotation to have same values as physics
     /// Called from update() function.
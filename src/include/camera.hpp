@@ -54,6 +54,9 @@ public:
     void followVehicle(Vehicle& vehicle, Views type);
     
     inline const sf::Vector2f getCenter() const { return view.getCenter(); }
+    
+    /// Size of the area the following view shows, in world coordinates (depends on zoom).
+    inline const sf::Vector2f getViewSize() const { return view.getSize(); }
 	
 	/// Zoom in num %.
 	void zoomIn(int num);
@@ -0,0 +1,82 @@
+#ifndef CLIENT_PREDICTION_HPP
+#define CLIENT_PREDICTION_HPP
+
+#include <SFML/Config.hpp>
+#include <vector>
+
+#include "vehicle.hpp"
+#include "track.hpp"
+
+/**
+ * Client-side prediction of the local player's vehicle in a network race.
+ *
+ * The server's state of the vehicle is a round trip behind the player's input, so the
+ * client doesn't wait for it: every tick the input is sent to the server and applied
+ * locally at once with the same physics code the server runs (Vehicle::applyControls(),
+ * Vehicle::update() and wall collisions). The inputs are kept in a ring buffer with the
+ * vehicle state after each of them.
+ *
+ * When a snapshot arrives, the vehicle is rewound to the state after the latest input the
+ * server has applied, corrected to the server's position, rotation and velocity, and the
+ * inputs the server hasn't applied yet are replayed. The server applies one input per tick
+ * too (see RaceServer), so only late or lost inputs make the replay differ from it.
+ *
+ * The difference to the old prediction is not shown at once: it becomes an offset of the
+ * drawn shape, which decays in a few ticks. Only very large errors (e.g. a missed
+ * collision) are snapped.
+ *
+ * Checkpoints, laps, HP and weapons are not predicted. They come from the server.
+ */
+
+class ClientPrediction
+{
+public:
+
+    /// Inputs kept for replaying (about 2 seconds at TICK_RATE).
+    static const std::size_t BUFFER_SIZE = 256;
+
+    /// Errors larger than this (px) are snapped instead of smoothed.
+    static constexpr double SNAP_DISTANCE = 150;
+
+    /// Share of the smoothing offset left after each tick (a half-life of about 60 ms).
+    static constexpr double SMOOTHING = 0.9;
+
+    /// Apply controls sent as INPUT sequence to vehicle for one tick. Controls are applied
+    /// only if the race has started, like in Race::applyControls().
+    void predict(Vehicle& vehicle, Track& track, sf::Uint32 sequence, Controls controls, bool started);
+
+    /// Correct the prediction with the state of vehicle from the server, which has applied
+    /// the inputs up to inputAck.
+    void reconcile(Vehicle& vehicle, Track& track, const Vector2D& position, double rotation,
+                   const Vector2D& velocity, sf::Uint32 inputAck);
+
+    /// Distance (px) between the prediction and the corrected prediction at the latest
+    /// reconcile(), i.e. how much the prediction was off.
+    double getLastError() const { return lastError; }
+
+private:
+
+    struct Input {
+        sf::Uint32 sequence;
+        Controls controls;
+        bool started;
+        Vehicle::LocalState state; // after applying controls
+    };
+
+    // One tick of the local simulation of vehicle.
+    static void step(Vehicle& vehicle, Track& track, Controls controls, bool started);
+
+    // Draw the vehicle displaced by the smoothing offset.
+    void applyOffset(Vehicle& vehicle) const;
+
+    std::vector<Input> inputs; // ring buffer, index sequence % BUFFER_SIZE
+    sf::Uint32 latestSequence = 0;
+
+    // The drawn shape is this much off the predicted physics state.
+    Vector2D offset = {0.0, 0.0};
+    double rotationOffset = 0;
+    double lastError = 0;
+};
+
+
+#endif
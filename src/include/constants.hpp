@@ -15,6 +15,12 @@ const int WIDTH = 1200;
 // Laps, player status, etc.
 const sf::Color TEXT_COLOR(230, 230, 230);
 
+// The race is simulated in fixed time steps (ticks). See Race::step().
+const int TICK_RATE = 120; // ticks per second
+const double TICK_TIME = 1.0 / TICK_RATE; // seconds
+// Countdown 3...2...1 before the race starts.
+const int COUNTDOWN_TICKS = 3 * TICK_RATE;
+
 
 // quantities
 const double ACC = 200;
@@ -26,6 +32,20 @@ const double ANG_VEL = 150;
 const double MISSILE_SPEED = 2600;
 const double AI_ANG_VEL = 300; // Bot cheats a bit
 const double MISSILE_ANG_VEL = 600;
+const double MISSILE_RANGE = 250; // a missile homes on vehicles closer than this
+// Racing line (see RacingLine and AIVehicle::moveAI)
+const double AI_MAX_SPEED = 1100; // target speed on straights
+const double AI_BRAKE = 250; // deceleration planned before turns
+const double AI_TURN_MARGIN = 0.7; // share of AI_ANG_VEL used for the planned turns
+const double AI_LOOKAHEAD = 120; // distance to the steering target at zero speed
+const double AI_LOOKAHEAD_TIME = 0.3; // lookahead grows with speed (seconds of driving)
+const double AI_RECOVERY_DISTANCE = 150; // farther from the racing line the AI uses the flow field
+// Level of detail (see Race::updateDetailLevels). Bots farther than AI_LOD_FAR from every
+// player follow the racing line without physics and are updated every AI_LOD_INTERVAL ticks.
+// They get full physics again when they are closer than AI_LOD_NEAR.
+const double AI_LOD_FAR = 3000;
+const double AI_LOD_NEAR = 2400;
+const int AI_LOD_INTERVAL = 4;
 
 const double BULLET_SPEED = 3000;
 
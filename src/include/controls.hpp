@@ -0,0 +1,26 @@
+#ifndef CONTROLS_HPP
+#define CONTROLS_HPP
+
+#include <SFML/Config.hpp>
+
+/*
+ * Control inputs of one vehicle during one simulation tick as a bit mask.
+ *
+ * Keyboard events are converted to these bits in Vehicle::handleEvents() and
+ * Race::handleWeaponEvents(). Race::step() applies them once per tick.
+ * Replays store only these bits, because the rest of the race can be simulated again.
+ */
+
+typedef sf::Uint8 Controls;
+
+namespace control {
+    const Controls ACCELERATE = 1 << 0;
+    const Controls BRAKE = 1 << 1;
+    const Controls LEFT = 1 << 2;
+    const Controls RIGHT = 1 << 3;
+    const Controls REVERSE = 1 << 4;
+    const Controls FIRE = 1 << 5;
+}
+
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef FAST_MATH_HPP
+#define FAST_MATH_HPP
+
+#include "vector2d.hpp"
+
+/**
+ * Approximate trigonometry for decisions that don't need full precision, e.g. AI steering
+ * ("is the target more than 10 degrees to the left?"). The physics uses the exact
+ * functions of <cmath>.
+ *
+ * The functions are polynomials with a few selects instead of library calls, so the
+ * compiler can inline and vectorize them. They are plain arithmetic and therefore
+ * deterministic, which the replays need.
+ *
+ * Error bounds (measured against <cmath>, see bench/mathBench.cpp):
+ * angleBetween: < 0.02 degrees, sin/cos: < 0.00001 (absolute).
+ */
+
+namespace fastmath {
+
+    constexpr double PI_D = 3.14159265358979323846;
+    constexpr double HALF_PI = PI_D / 2;
+    constexpr double RAD_TO_DEG = 180 / PI_D;
+    constexpr double DEG_TO_RAD = PI_D / 180;
+
+    /// Approximate atan2 in radians, -pi...pi.
+    inline double atan2(double y, double x)
+    {
+        double ax = x < 0 ? -x : x;
+        double ay = y < 0 ? -y : y;
+        double big = ax > ay ? ax : ay;
+        double small = ax > ay ? ay : ax;
+        // atan(0 / 0) = 0, like std::atan2.
+        double a = big == 0 ? 0 : small / big;
+        // Minimax polynomial of atan on 0...1.
+        double s = a * a;
+        double r = ((-0.0464964749 * s + 0.15931422) * s - 0.327622764) * s * a + a;
+        r = ay > ax ? HALF_PI - r : r;
+        r = x < 0 ? PI_D - r : r;
+        return y < 0 ? -r : r;
+    }
+
+    /// Approximate sine and cosine of an angle in degrees (any range).
+    inline void sincosDeg(double degs, double& sine, double& cosine)
+    {
+        // Reduce to -180...180 degrees.
+        double turns = degs * (1.0 / 360);
+        double reduced = (turns - static_cast<double>(static_cast<long long>(turns + (turns < 0 ? -0.5 : 0.5)))) * 360;
+        double rads = reduced * DEG_TO_RAD;
+        // sin(x) = sin(pi - x): fold to -pi/2...pi/2, where the Taylor series converges fast.
+        double folded = rads > HALF_PI ? PI_D - rads : (rads < -HALF_PI ? -PI_D - rads : rads);
+        double s2 = folded * folded;
+        sine = folded * (1 + s2 * (-1.0 / 6 + s2 * (1.0 / 120 + s2 * (-1.0 / 5040 + s2 * (1.0 / 362880)))));
+        // cos(x) = sin(x + pi/2), same folding.
+        double shifted = rads + HALF_PI;
+        shifted = shifted > PI_D ? shifted - 2 * PI_D : shifted;
+        folded = shifted > HALF_PI ? PI_D - shifted : (shifted < -HALF_PI ? -PI_D - shifted : shifted);
+        s2 = folded * folded;
+        cosine = folded * (1 + s2 * (-1.0 / 6 + s2 * (1.0 / 120 + s2 * (-1.0 / 5040 + s2 * (1.0 / 362880)))));
+    }
+
+    /// Approximate unit vector which angle is degs degrees relative to x-axis.
+    inline Vector2D unitVector(double degs)
+    {
+        Vector2D v;
+        sincosDeg(degs, v.y, v.x);
+        return v;
+    }
+
+    /// Approximate angle between two vectors in degrees, same as Vector2D::angleBetween().
+    inline double angleBetween(const Vector2D& v1, const Vector2D& v2)
+    {
+        return RAD_TO_DEG * fastmath::atan2(Vector2D::determinant(v1, v2), v1 * v2);
+    }
+
+}
+
+
+#endif
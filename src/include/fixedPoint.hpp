@@ -0,0 +1,360 @@
+#ifndef FIXED_POINT_HPP
+#define FIXED_POINT_HPP
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+
+#include "vector2d.hpp"
+
+/**
+ * Q32.32 fixed-point number for the deterministic physics mode (see physicsMath.hpp).
+ *
+ * The value is a 64-bit integer with 32 fractional bits: -2^31...2^31 in steps of 2.3e-10.
+ * Every operation is integer arithmetic with a defined rounding (products and quotients are
+ * truncated towards zero, with or without __int128), so the results are bit for bit the
+ * same with every compiler, standard library and optimisation flag. Overflow wraps around
+ * like with integers. The physics stays far from 2^31 (pixels, pixels per second), but
+ * the squared length of a vector longer than 46000 doesn't fit.
+ *
+ * Integers convert implicitly, doubles only explicitly, so no double arithmetic slips
+ * into the fixed-point code. A double converts to the nearest Fixed, and a Fixed converted
+ * to double and back is the same Fixed (for values below 2^20).
+ */
+
+class Fixed
+{
+public:
+
+    static const int FRACTION_BITS = 32;
+    static constexpr std::int64_t ONE = std::int64_t(1) << FRACTION_BITS;
+
+    /// Uninitialized, like a double.
+    Fixed() = default;
+
+    template <typename I, typename = typename std::enable_if<std::is_integral<I>::value>::type>
+    constexpr Fixed(I value) : raw(static_cast<std::int64_t>(value) * ONE) { }
+
+    /// value * ONE is exact (a power of two), so the rounding is the same also with
+    /// fused multiply-add.
+    explicit constexpr Fixed(double value)
+        : raw(static_cast<std::int64_t>(value * ONE + (value < 0 ? -0.5 : 0.5))) { }
+
+    static constexpr Fixed fromRaw(std::int64_t raw) { return Fixed(Raw(), raw); }
+
+    constexpr std::int64_t getRaw() const { return raw; }
+
+    double toDouble() const { return static_cast<double>(raw) * (1.0 / ONE); }
+
+    friend constexpr Fixed operator+(Fixed a, Fixed b) { return fromRaw(a.raw + b.raw); }
+    friend constexpr Fixed operator-(Fixed a, Fixed b) { return fromRaw(a.raw - b.raw); }
+    friend constexpr Fixed operator-(Fixed a) { return fromRaw(-a.raw); }
+    friend Fixed operator*(Fixed a, Fixed b) { return fromRaw(multiply(a.raw, b.raw)); }
+    friend Fixed operator/(Fixed a, Fixed b) { return fromRaw(divide(a.raw, b.raw)); }
+
+    Fixed& operator+=(Fixed b) { raw += b.raw; return *this; }
+    Fixed& operator-=(Fixed b) { raw -= b.raw; return *this; }
+    Fixed& operator*=(Fixed b) { raw = multiply(raw, b.raw); return *this; }
+    Fixed& operator/=(Fixed b) { raw = divide(raw, b.raw); return *this; }
+
+    friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+    friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+    friend constexpr bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+    friend constexpr bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+    friend constexpr bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+    friend constexpr bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+
+    friend std::ostream& operator<<(std::ostream& os, Fixed value) { return os << value.toDouble(); }
+
+private:
+
+    struct Raw { };
+    constexpr Fixed(Raw, std::int64_t value) : raw(value) { }
+
+    static std::uint64_t magnitude(std::int64_t value)
+    {
+        return value < 0 ? 0 - static_cast<std::uint64_t>(value) : static_cast<std::uint64_t>(value);
+    }
+
+    static std::int64_t withSign(std::uint64_t value, bool negative)
+    {
+        return static_cast<std::int64_t>(negative ? 0 - value : value);
+    }
+
+    static std::int64_t multiply(std::int64_t a, std::int64_t b)
+    {
+        std::uint64_t ua = magnitude(a), ub = magnitude(b);
+#ifdef __SIZEOF_INT128__
+        std::uint64_t product = static_cast<std::uint64_t>((static_cast<unsigned __int128>(ua) * ub) >> FRACTION_BITS);
+#else
+        std::uint64_t a1 = ua >> 32, a0 = ua & 0xFFFFFFFFu;
+        std::uint64_t b1 = ub >> 32, b0 = ub & 0xFFFFFFFFu;
+        std::uint64_t product = ((a1 * b1) << 32) + a1 * b0 + a0 * b1 + ((a0 * b0) >> 32);
+#endif
+        return withSign(product, (a < 0) != (b < 0));
+    }
+
+    static std::int64_t divide(std::int64_t a, std::int64_t b)
+    {
+        if (b == 0) {
+            // Saturate instead of crashing the simulation.
+            return a < 0 ? INT64_MIN : INT64_MAX;
+        }
+        std::uint64_t ua = magnitude(a), ub = magnitude(b);
+#ifdef __SIZEOF_INT128__
+        std::uint64_t quotient = static_cast<std::uint64_t>((static_cast<unsigned __int128>(ua) << FRACTION_BITS) / ub);
+#else
+        // Long division, one fractional bit at a time.
+        std::uint64_t quotient = ua / ub;
+        std::uint64_t remainder = ua % ub;
+        for (int i = 0; i < FRACTION_BITS; i++) {
+            remainder <<= 1;
+            quotient <<= 1;
+            if (remainder >= ub) {
+                remainder -= ub;
+                quotient |= 1;
+            }
+        }
+#endif
+        return withSign(quotient, (a < 0) != (b < 0));
+    }
+
+    std::int64_t raw;
+};
+
+static_assert(std::is_trivially_copyable<Fixed>::value, "Fixed must stay trivially copyable.");
+
+
+/**
+ * Square root and table-based trigonometry of Fixed, in degrees like the rest of the physics.
+ *
+ * sin and atan are tabulated at TABLE_STEPS points (per quarter turn, and on 0...1) and
+ * interpolated linearly: the error is below 3e-7 for sin and 5e-6 degrees for atan2. The
+ * tables are computed at startup with Fixed arithmetic (series, see fixedPoint.cpp), not
+ * with <cmath>, so they are the same in every build. Don't call these from the constructor
+ * of a static object.
+ */
+
+namespace fixedmath {
+
+    const int TABLE_STEPS = 1024;
+
+    /// sin(90 * i / TABLE_STEPS degrees), i = 0...TABLE_STEPS, as raw values.
+    extern std::int64_t sineTable[TABLE_STEPS + 1];
+
+    /// atan(i / TABLE_STEPS) in degrees, i = 0...TABLE_STEPS, as raw values.
+    extern std::int64_t atanTable[TABLE_STEPS + 1];
+
+    /// pi and 180 / pi, rounded to the nearest raw value.
+    const Fixed PI_F = Fixed::fromRaw(13493037705);
+    const Fixed RAD_TO_DEG = Fixed::fromRaw(246083499208);
+
+    inline Fixed abs(Fixed value)
+    {
+        return value < 0 ? -value : value;
+    }
+
+    /// Square root, at least 31 significant bits. 0 for negative values.
+    inline Fixed sqrt(Fixed value)
+    {
+        if (value <= 0) {
+            return 0;
+        }
+        // sqrt(raw * 2^32): shift as much of 2^32 into the integer as fits (an even amount),
+        // take the integer square root and shift the rest of the way.
+        std::uint64_t v = static_cast<std::uint64_t>(value.getRaw());
+        int shift = Fixed::FRACTION_BITS;
+        while (shift > 0 && v < (std::uint64_t(1) << 62)) {
+            v <<= 2;
+            shift -= 2;
+        }
+        std::uint64_t root = 0;
+        std::uint64_t bit = std::uint64_t(1) << 62;
+        while (bit > v) {
+            bit >>= 2;
+        }
+        while (bit != 0) {
+            if (v >= root + bit) {
+                v -= root + bit;
+                root = (root >> 1) + bit;
+            } else {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+        return Fixed::fromRaw(static_cast<std::int64_t>(root << (shift / 2)));
+    }
+
+    /// Sine of steps, which is 0...4 * TABLE_STEPS table steps (a full turn) with 32 fractional bits.
+    inline Fixed sineOfSteps(std::int64_t steps)
+    {
+        std::int64_t index = steps >> Fixed::FRACTION_BITS;
+        std::int64_t fraction = steps & (Fixed::ONE - 1);
+        std::int64_t quadrant = index / TABLE_STEPS;
+        std::int64_t i = index % TABLE_STEPS;
+        std::int64_t value;
+        if (quadrant % 2 == 0) {
+            value = sineTable[i] + (((sineTable[i + 1] - sineTable[i]) * fraction) >> Fixed::FRACTION_BITS);
+        } else {
+            // sin(90 + a) = sin(90 - a): the table backwards.
+            std::int64_t j = TABLE_STEPS - i;
+            value = sineTable[j] - (((sineTable[j] - sineTable[j - 1]) * fraction) >> Fixed::FRACTION_BITS);
+        }
+        return Fixed::fromRaw(quadrant >= 2 ? -value : value);
+    }
+
+    /// Sine and cosine of an angle in degrees (any range).
+    inline void sincosDeg(Fixed degs, Fixed& sine, Fixed& cosine)
+    {
+        const std::int64_t turn = 360 * Fixed::ONE;
+        const std::int64_t turnSteps = 4 * TABLE_STEPS * Fixed::ONE;
+        std::int64_t reduced = degs.getRaw() % turn;
+        if (reduced < 0) {
+            reduced += turn;
+        }
+        std::int64_t steps = reduced * TABLE_STEPS / 90;
+        sine = sineOfSteps(steps);
+        cosine = sineOfSteps((steps + TABLE_STEPS * Fixed::ONE) % turnSteps);
+    }
+
+    /// atan2 in degrees, -180...180. atan2(0, 0) = 0.
+    inline Fixed atan2Deg(Fixed y, Fixed x)
+    {
+        Fixed ax = abs(x);
+        Fixed ay = abs(y);
+        Fixed big = ax > ay ? ax : ay;
+        Fixed small = ax > ay ? ay : ax;
+        if (big == 0) {
+            return 0;
+        }
+        std::int64_t steps = (small / big).getRaw() * TABLE_STEPS;
+        std::int64_t index = steps >> Fixed::FRACTION_BITS;
+        std::int64_t fraction = steps & (Fixed::ONE - 1);
+        std::int64_t r = index >= TABLE_STEPS ? atanTable[TABLE_STEPS]
+                : atanTable[index] + (((atanTable[index + 1] - atanTable[index]) * fraction) >> Fixed::FRACTION_BITS);
+        Fixed angle = Fixed::fromRaw(r);
+        angle = ay > ax ? 90 - angle : angle;
+        angle = x < 0 ? 180 - angle : angle;
+        return y < 0 ? -angle : angle;
+    }
+
+}
+
+
+/**
+ * Vector of Fixed with the interface of Vector2 (see vector2d.hpp), so the physics can be
+ * written once for both (see physicsMath.hpp). Angles are in degrees, clockwise.
+ */
+
+class FixedVector
+{
+public:
+
+    /// Components are uninitialized, like with a plain struct.
+    FixedVector() = default;
+
+    constexpr FixedVector(Fixed x1, Fixed y1) : x(x1), y(y1) { }
+
+    /// Nearest vector to a floating-point vector.
+    template <typename T>
+    explicit FixedVector(const Vector2<T>& v) : x(static_cast<double>(v.x)), y(static_cast<double>(v.y)) { }
+
+    Vector2D toVector2D() const { return Vector2D(x.toDouble(), y.toDouble()); }
+
+    Fixed getLength() const { return fixedmath::sqrt(getLengthSquared()); }
+    Fixed getLengthSquared() const { return x * x + y * y; }
+
+    const Fixed& getX() const { return x; }
+    const Fixed& getY() const { return y; }
+
+    /// Rotate the vector clockwise.
+    void rotate(Fixed degs)
+    {
+        Fixed s, c;
+        fixedmath::sincosDeg(degs, s, c);
+        Fixed x2 = x * c - y * s;
+        y = x * s + y * c;
+        x = x2;
+    }
+
+    /// Mirror the vector about an arbitrary vector.
+    void mirror(const FixedVector& vector)
+    {
+        rotate(-2 * angleBetween(vector, *this));
+    }
+
+    /// Return an unit vector parallel to this vector.
+    FixedVector getUnitVector() const
+    {
+        FixedVector unitVector = *this / getLength();
+        Fixed length = unitVector.getLengthSquared();
+        if (length < Fixed(0.98) || length > Fixed(1.02))
+            throw std::runtime_error("Invalid unit vector.");
+        return unitVector;
+    }
+
+    /// Unit vector which angle is degs degrees relative to x-axis.
+    static FixedVector getUnitVector(Fixed degs)
+    {
+        FixedVector v;
+        fixedmath::sincosDeg(degs, v.y, v.x);
+        return v;
+    }
+
+    /// Normal of mirrorVector. Direction depends on v1.
+    static FixedVector getMirrorNormal(const FixedVector& v1, const FixedVector& mirrorVector)
+    {
+        Fixed angle1 = angleBetween(mirrorVector, v1);
+        if (angle1 > 0)
+            angle1 = 180 + angle1;
+        return rotated(v1, -angle1 + 90);
+    }
+
+    static FixedVector rotated(const FixedVector& v, Fixed degs)
+    {
+        FixedVector v2 = v;
+        v2.rotate(degs);
+        return v2;
+    }
+
+    /// Angle between two vectors in degrees.
+    static Fixed angleBetween(const FixedVector& v1, const FixedVector& v2)
+    {
+        return fixedmath::atan2Deg(determinant(v1, v2), v1 * v2);
+    }
+
+    static Fixed determinant(const FixedVector& v1, const FixedVector& v2)
+    {
+        return v1.x * v2.y - v1.y * v2.x;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const FixedVector& v)
+    {
+        os << "[" << v.x << ", " << v.y << "]";
+        return os;
+    }
+
+    friend Fixed operator*(const FixedVector& v1, const FixedVector& v2) { return v1.x * v2.x + v1.y * v2.y; }
+    friend FixedVector operator*(const FixedVector& v, Fixed coeff) { return FixedVector(v.x * coeff, v.y * coeff); }
+    friend FixedVector operator/(const FixedVector& v, Fixed coeff) { return FixedVector(v.x / coeff, v.y / coeff); }
+    friend FixedVector operator+(const FixedVector& v1, const FixedVector& v2) { return FixedVector(v1.x + v2.x, v1.y + v2.y); }
+    friend FixedVector operator-(const FixedVector& v1, const FixedVector& v2) { return FixedVector(v1.x - v2.x, v1.y - v2.y); }
+    friend FixedVector operator-(const FixedVector& v) { return FixedVector(-v.x, -v.y); }
+
+    FixedVector& operator+=(const FixedVector& v) { x += v.x; y += v.y; return *this; }
+    FixedVector& operator-=(const FixedVector& v) { x -= v.x; y -= v.y; return *this; }
+    FixedVector& operator*=(Fixed coeff) { x *= coeff; y *= coeff; return *this; }
+    FixedVector& operator/=(Fixed coeff) { x /= coeff; y /= coeff; return *this; }
+
+    friend bool operator==(const FixedVector& v1, const FixedVector& v2) { return v1.x == v2.x && v1.y == v2.y; }
+    friend bool operator!=(const FixedVector& v1, const FixedVector& v2) { return !(v1 == v2); }
+
+    Fixed x;
+    Fixed y;
+};
+
+static_assert(std::is_trivially_copyable<FixedVector>::value, "FixedVector must stay trivially copyable.");
+
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef FLOW_FIELD_HPP
+#define FLOW_FIELD_HPP
+
+#include <SFML/Graphics/RectangleShape.hpp>
+#include <vector>
+
+#include "vector2d.hpp"
+
+/**
+ * Wall-aware navigation for missiles and AI vehicles, computed once when the track is loaded.
+ *
+ * The track is rasterized to a grid of CELL_SIZE px cells. Cells closer than CLEARANCE px to
+ * a wall are blocked. For every target (the checkpoints and the finish line) a Dijkstra wave
+ * from the target cells gives the driving distance of every free cell to the target.
+ * Going downhill in the distance field leads to the target around the walls.
+ *
+ * Queries are O(1): getDirection() looks at the four neighbours of one cell.
+ * Memory is 2 bytes per cell per target.
+ */
+
+class FlowField
+{
+public:
+
+    /// Size of a grid cell (px).
+    static constexpr float CELL_SIZE = 32;
+
+    /// Distance to walls, which is treated as blocked (px).
+    static constexpr float CLEARANCE = 16;
+
+    /// Build the grid from the walls and the distance fields to the targets.
+    void build(const std::vector<sf::RectangleShape>& walls, const std::vector<sf::RectangleShape>& targets);
+
+    bool empty() const { return fields.empty(); }
+
+    /// Number of targets (distance fields).
+    std::size_t getTargetCount() const { return fields.size(); }
+
+    /// Unit vector from position towards the target along the shortest free path.
+    /// Returns false if position is outside the grid or the target cannot be reached from there.
+    bool getDirection(std::size_t target, const Vector2D& position, Vector2D& direction) const;
+
+    /// Driving distance from position to target (px), -1 if unknown.
+    double getDistance(std::size_t target, const Vector2D& position) const;
+
+    /// Tell if the straight segment from -> to doesn't go through blocked cells.
+    bool isClear(const Vector2D& from, const Vector2D& to) const;
+
+private:
+
+    // Distance of cells which cannot reach the target.
+    static const sf::Uint16 UNREACHABLE = 0xFFFF;
+
+    // Cell index of a position, -1 if outside the grid.
+    int getCell(const Vector2D& position) const;
+
+    Vector2D getCellCenter(int cell) const;
+
+    void computeField(const sf::RectangleShape& target, std::vector<sf::Uint16>& field) const;
+
+    float left = 0;
+    float top = 0;
+    int columns = 0;
+    int rows = 0;
+    std::vector<bool> blocked;
+    // Distances in 1/10 cells, one field per target.
+    std::vector<std::vector<sf::Uint16>> fields;
+};
+
+
+#endif
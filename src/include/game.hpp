@@ -7,6 +7,8 @@
 #include "mainmenu.hpp"
 #include "race.hpp"
 #include "menu.hpp"
+#include "replay.hpp"
+#include "raceClient.hpp"
 
 /*
  * All content from main function is copied to gameLoop() function.
@@ -27,7 +29,10 @@ public:
     Game(const Game&) = delete;
 
     // Run as long as the window is open.
-    void run();
+    // If replayFile is given, the replay is played instead of showing the menus.
+    // If serverAddress ("host" or "host:port") is given, the race of that server is joined,
+    // or watched if spectate is set (the server can also be a SpectatorRelay).
+    void run(const std::string& replayFile = "", const std::string& serverAddress = "", bool spectate = false);
     void setNextState(GameStates);
     void createMainMenu();
     void gameLoop();
@@ -41,6 +46,22 @@ public:
 private:
     
     void loadBackgroundTexture();
+    
+    // Create the race described by raceSetup. Returns false if the track cannot be read.
+    bool createRace();
+    
+    // Initialize the race and start the simulation thread.
+    void startRace();
+    
+    // Load a replay and start playing it. Returns false if the replay cannot be played.
+    bool playReplay(const std::string& filename);
+    
+    // Join the race of a RaceServer, or watch it with spectate. Returns false if the server
+    // cannot be joined.
+    bool joinServer(const std::string& address, bool spectate);
+    
+    // Save the recorded race to the replays directory.
+    void saveReplay();
 
     GameStates cState;
     sf::RenderWindow window;
@@ -55,11 +76,18 @@ private:
     
     sf::Texture backgroundTexture;
     sf::Sprite backgroundSprite;
-    std::string vehicleImage;
-    std::string backgroundImage;
     
     sf::Image image; // Image for background
-    sf::Vector2f vehicleSize;
+    
+    // Track, race type, vehicles etc. selected in the menus.
+    RaceSetup raceSetup;
+    
+    // Every race is recorded. See saveReplay().
+    Replay replay;
+    
+    // Connection to the server in network play. The race is not simulated here then,
+    // only the snapshots from the server are shown.
+    std::unique_ptr<RaceClient> client;
     
     sf::Thread updatingThread;
     
@@ -69,6 +97,12 @@ private:
 	
 	sf::Mutex mutex; // For thread safety. See SFML documentation for more information.
 	
+	// Lock the mutex and report the time spent waiting to the performance overlay.
+	void lockMutex(bool simulationThread);
+	
+	// Measures the time between displayed frames for the performance overlay.
+	sf::Clock frameClock;
+	
 	bool backgroundLoaded = false;
 };
 
@@ -0,0 +1,73 @@
+#ifndef GAME_EVENTS_HPP
+#define GAME_EVENTS_HPP
+
+#include <atomic>
+
+#include "spscQueue.hpp"
+
+/// Something that happened in the simulation. Published by Race on the simulation thread.
+struct GameEvent {
+    enum Type {
+        COLLISION,    // vehicle hit a wall
+        PICKUP,       // vehicle picked up a weapon, value is the Weapon::WeaponType
+        LAP,          // vehicle finished a lap, value is the number of laps driven
+        DESTROYED,    // vehicle HP dropped to 0
+        WEAPON_FIRED  // vehicle used a weapon, value is the Weapon::WeaponType
+    };
+
+    Type type;
+    int vehicleID;
+    int value;
+    unsigned int tick; // simulation tick of the event
+};
+
+/**
+ * Carries GameEvents from the simulation thread to the consumers on the render thread.
+ *
+ * Every consumer has its own SpscQueue, so each one sees every event exactly once,
+ * in order, whenever it polls. Publishing neither locks nor allocates. If a consumer
+ * doesn't keep up (or there is no render thread, as in headless mode), its queue fills up
+ * and the new events are dropped for that consumer only.
+ */
+class EventBus
+{
+public:
+
+    enum Consumer {
+        AUDIO,      // Race::updateSounds
+        HUD,        // Race::updateTexts
+        TELEMETRY,  // Race::updateTelemetry
+        CONSUMER_COUNT
+    };
+
+    /// Events a consumer can fall behind. About two seconds of a busy race.
+    static const std::size_t CAPACITY = 256;
+
+    /// Add event to the queues of all consumers. Call only from the simulation thread.
+    void publish(const GameEvent& event)
+    {
+        for (auto& queue : queues) {
+            if (!queue.push(event)) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// Take the next event of consumer. Returns false if there are no new events.
+    /// Call only from the thread of that consumer.
+    bool poll(Consumer consumer, GameEvent& event)
+    {
+        return queues[consumer].pop(event);
+    }
+
+    /// Number of events dropped because a queue was full.
+    unsigned int getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+
+    SpscQueue<GameEvent, CAPACITY> queues[CONSUMER_COUNT];
+    std::atomic<unsigned int> dropped{0};
+};
+
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef GHOST_HPP
+#define GHOST_HPP
+
+#include <SFML/Config.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * Trajectory of one lap: position and rotation of the vehicle on every simulation tick.
+ * TimeTrial records the current lap and draws the best lap as a ghost vehicle.
+ * The ghost is only drawn, it has no physics and it doesn't collide with anything.
+ *
+ * In memory, samples are quantized to 1/4 px and 1/10 degrees and stored as a flat array,
+ * so drawing the ghost is just an array lookup. In the file, every sample is stored as
+ * the difference to the previous sample (zigzag varint), which takes about 3 bytes per tick.
+ * Decoding a lap takes well under a millisecond. Swapping the best lap with a new one
+ * is done with swap() and doesn't copy or decode anything.
+ */
+
+class Ghost
+{
+public:
+
+    /// Remove all samples.
+    void clear() { samples.clear(); }
+
+    /// Append the position and rotation of one tick.
+    void addSample(double x, double y, double rotation);
+
+    /// Number of recorded ticks.
+    std::size_t size() const { return samples.size(); }
+    bool empty() const { return samples.empty(); }
+
+    /// Get the position and rotation (degrees) of tick. Ticks past the end give the last sample.
+    /// The ghost must not be empty.
+    void getPose(std::size_t tick, float& x, float& y, float& rotation) const;
+
+    void swap(Ghost& other) { samples.swap(other.samples); }
+
+    /// Save the lap and its lap time to file. Returns false if the file cannot be written.
+    bool save(const std::string& filename, double lapTime) const;
+
+    /// Load a lap saved with save(). Returns false if the file doesn't exist or is invalid.
+    bool load(const std::string& filename, double& lapTime);
+
+private:
+
+    struct Sample {
+        sf::Int32 x; // 1/4 px
+        sf::Int32 y;
+        sf::Int32 rotation; // 1/10 degrees, 0...3599
+    };
+
+    std::vector<Sample> samples;
+};
+
+
+#endif
@@ -13,7 +13,7 @@ public:
     
     virtual void useWeapon() override;
     
-	virtual void updateSound(SoundHandler&) override;
+    // The gunshot sound is played by Race::updateSounds on GameEvent::WEAPON_FIRED.
     // void getBullet
     
     
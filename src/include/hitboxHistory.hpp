@@ -0,0 +1,72 @@
+#ifndef HITBOX_HISTORY_HPP
+#define HITBOX_HISTORY_HPP
+
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+
+#include "spatialIndex.hpp"
+#include "vehicleRegistry.hpp"
+
+class Vehicle;
+
+/**
+ * Hitboxes of the vehicles on the latest HISTORY_TICKS ticks, for lag compensated hits
+ * (see Race::findHits).
+ *
+ * A network player sees the other vehicles where they were in the latest snapshot, a
+ * round trip behind the server. The server rewinds the targets of the player's bullets
+ * and missiles to that tick, so a shot hits what the shooter saw.
+ *
+ * The history is a ring buffer of rows, one per tick. A row has the bounding box of each
+ * vehicle (16 bytes, indexed by ID - 1) and how far any vehicle moved since the previous
+ * row. A query doesn't scan the row: it asks the spatial index (the current positions) for
+ * the vehicles that can have been within reach at the rewound tick, i.e. within the
+ * distance the fastest vehicle could have moved since, and tests only their old boxes.
+ */
+
+class HitboxHistory
+{
+public:
+
+    /// Ticks kept (about half a second at TICK_RATE). Older ticks are not rewound to.
+    static const unsigned int HISTORY_TICKS = 64;
+
+    /// Remember the boxes gathered by registry after tick. Called once per tick after the
+    /// vehicles have moved. The entity of a vehicle must be its ID - 1.
+    void record(unsigned int tick, const VehicleRegistry& registry);
+
+    void clear();
+
+    /// The oldest tick which can be rewound to (0 if nothing has been recorded).
+    unsigned int getOldestTick() const;
+
+    /// Append to result the vehicles whose box on tick intersected bounds, the nearest (now) first.
+    /// Ticks outside the history are clamped to it. index must have the positions of the
+    /// latest record(). The vehicle with ID excludeID (the shooter) is ignored.
+    void findHits(const sf::FloatRect& bounds, unsigned int tick, const SpatialIndex& index,
+            std::vector<Vehicle*>& result, int excludeID = -1) const;
+
+private:
+
+    struct Box {
+        float left;
+        float top;
+        float right;
+        float bottom;
+    };
+
+    struct Row {
+        unsigned int tick;
+        float maxStep;   // the longest distance (px) a vehicle moved since the previous row
+        float maxExtent; // the largest half diagonal (px) of a box
+    };
+
+    std::vector<Box> boxes; // HISTORY_TICKS rows of vehicleCount boxes
+    Row rows[HISTORY_TICKS];
+    std::size_t vehicleCount = 0;
+    unsigned int recorded = 0; // rows in use
+    unsigned int latest = 0;   // tick of the latest row
+};
+
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef HUD_HPP
+#define HUD_HPP
+
+#include <SFML/Graphics.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Retained texts and icons drawn on top of the race (see Race::drawStaticObjects).
+ *
+ * Texts and icons are added once. After that only their values change: setString()
+ * with the same string does nothing, and isChanged() lets the caller skip formatting
+ * a value that is the same as on the previous frame.
+ *
+ * The geometry is kept in vertex arrays and rebuilt only when a text has changed.
+ * All the glyphs of one character size are in the same font texture, so they are drawn
+ * with one draw call per size, and all the icons share the icon texture, one draw call.
+ */
+
+class Hud
+{
+public:
+
+    /// Font of all texts and texture of all icons. Both must outlive the HUD.
+    void setFont(const sf::Font& font);
+    void setIconTexture(const sf::Texture& texture);
+
+    /// Remove all texts and icons.
+    void clear();
+
+    /// Add a text and return its index.
+    std::size_t addText(unsigned int characterSize, const sf::Vector2f& position, const sf::Color& color);
+
+    /// Add an icon (the whole icon texture tinted with color) and return its index.
+    std::size_t addIcon(const sf::FloatRect& rect, const sf::Color& color);
+
+    /// Change the string of a text. Geometry is rebuilt on the next draw only if it changed.
+    void setString(std::size_t text, const std::string& value);
+
+    /// Remember key as the value shown by text. Returns true if key differs from the
+    /// previous one, i.e. the string must be formatted again.
+    bool isChanged(std::size_t text, long long key);
+
+    std::size_t getTextCount() const { return texts.size(); }
+
+    /// Draw icons and texts. Rebuilds the geometry first if something has changed.
+    void draw(sf::RenderWindow& window);
+
+private:
+
+    struct Text {
+        unsigned int characterSize;
+        sf::Vector2f position;
+        sf::Color color;
+        std::string value;
+        long long key;
+        bool hasKey;
+    };
+
+    // Rebuild the glyph quads of all texts.
+    void build();
+
+    // Append the quads of text to vertices.
+    void appendGlyphs(const Text& text, sf::VertexArray& vertices) const;
+
+    const sf::Font* font = nullptr;
+    const sf::Texture* iconTexture = nullptr;
+    std::vector<Text> texts;
+    bool dirty = false;
+    std::map<unsigned int, sf::VertexArray> glyphs; // by character size
+    sf::VertexArray icons{sf::Quads};
+};
+
+
+#endif
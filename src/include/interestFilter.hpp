@@ -0,0 +1,59 @@
+#ifndef INTEREST_FILTER_HPP
+#define INTEREST_FILTER_HPP
+
+#include <SFML/System/Vector2.hpp>
+#include <vector>
+
+#include "netProtocol.hpp"
+
+namespace net {
+
+    /**
+     * Chooses the part of a snapshot that is relevant to one client (server side).
+     *
+     * The client's own vehicle is always sent. The other vehicles compete for the
+     * remaining MAX_VEHICLES - 1 places with priority accumulation: every snapshot adds
+     * the relevance of a vehicle to its priority, the vehicles with the highest priority
+     * are sent and their priority is reset. A vehicle in the client's view (the camera
+     * view around its own vehicle, as zoomed by the player) gains 1 per snapshot, so it's
+     * sent every snapshot unless the view is crowded. A vehicle further away gains less
+     * the further it is, so it's sent less often but never starves.
+     *
+     * Bullets and missiles are sent only if they are in the view, the nearest ones
+     * first. Pickups are few and always sent. So the size of a snapshot doesn't grow
+     * with the number of entities in the race.
+     */
+
+    class InterestFilter
+    {
+    public:
+
+        /// Vehicles in one snapshot, including the client's own.
+        static const std::size_t MAX_VEHICLES = 12;
+
+        /// Bullets and missiles in one snapshot.
+        static const std::size_t MAX_PROJECTILES = 24;
+
+        /// Entities this far (px) outside the view are treated as in view, so that
+        /// they are known before they appear.
+        static const int VIEW_MARGIN = 200;
+
+        /// Write to relevant the part of snapshot which is sent to the client driving the
+        /// vehicle ownID, whose camera shows viewSize px around it. The vehicles stay in
+        /// ID order.
+        void select(const Snapshot& snapshot, sf::Uint8 ownID, const sf::Vector2f& viewSize, Snapshot& relevant);
+
+        /// Forget the accumulated priorities, e.g. when a new client takes the slot.
+        void reset() { priorities.clear(); }
+
+    private:
+
+        std::vector<float> priorities; // by vehicle ID
+        std::vector<std::pair<float, std::size_t>> candidates; // priority, index in snapshot
+        std::vector<bool> chosen; // by index in snapshot
+        std::vector<std::pair<float, std::size_t>> nearby; // squared distance, index of a projectile
+    };
+}
+
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef LAP_DATABASE_HPP
+#define LAP_DATABASE_HPP
+
+#include <SFML/Config.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "writeQueue.hpp"
+
+/**
+ * Lap times of all tracks and players in one append-only binary file (xml/laps.db).
+ *
+ * Every lap is one record:
+ * magic "LAPR", payload length (u16), payload, CRC-32 of the payload (u32), all little endian.
+ * Payload: track name and player name (u8 length + bytes), lap time (f64) and unix time (u64).
+ *
+ * Records are only appended, never rewritten. If the game crashes in the middle of a write,
+ * the broken record fails the CRC check and open() skips it and finds the next magic.
+ *
+ * open() builds an index of the TOP_K best laps per track and player, so leaderboard
+ * lookups are a hash map lookup. addLap() updates the index at once and gives the write to
+ * the WriteQueue, so the game never waits for the disk.
+ */
+
+class LapDatabase
+{
+public:
+
+    /// Number of best laps kept in the index per track and player.
+    static const std::size_t TOP_K = 10;
+
+    /// Param. writer runs the file writes. It must outlive this object.
+    explicit LapDatabase(WriteQueue& writer);
+
+    /// Read all the records of the file and build the index. A missing file is not an error,
+    /// it's created when the first lap is added. Returns the number of records read.
+    std::size_t open(const std::string& filename);
+
+    /// Add a lap to the index and append it to the file in the background.
+    void addLap(const std::string& track, const std::string& player, double lapTime);
+
+    /// Best laps of the player on the track in ascending order. At most TOP_K laps.
+    const std::vector<double>& getTopLaps(const std::string& track, const std::string& player) const;
+
+    /// Best lap of the player on the track or -1 if there are no laps.
+    double getBestLapTime(const std::string& track, const std::string& player) const;
+
+private:
+
+    static std::string makeKey(const std::string& track, const std::string& player);
+
+    // Insert lap time to the sorted top list of key.
+    void insert(const std::string& key, double lapTime);
+
+    WriteQueue& writer;
+    std::string filename;
+    std::unordered_map<std::string, std::vector<double>> topLaps;
+};
+
+
+#endif
@@ -20,7 +20,7 @@ public:
     };
 
     /// Function for checking if two lines are intersecting.
-    bool intersects(const Line &line2);
+    bool intersects(const Line &line2) const;
 
     /// Function for getting starting point of line.
     const structures::Point& getStart() const {
@@ -38,6 +38,15 @@ public:
     /// Function for moving the missile.
     void moveMissile(const Race& race);
     
+    /// Save the simulation state to state, see Race::saveState().
+    void saveState(StateBuffer& state) const;
+    
+    /// Restore the state saved by saveState().
+    void loadState(StateBuffer& state);
+    
+    /// Add the simulation state to hasher, see Race::hashState().
+    void hashState(StateHasher& hasher) const;
+    
     /// Tell if missile is launched. Set this true in the lauch() function.
     /// If this is false, the missile will never be drawn or updated.
     bool isFlying = false;
@@ -50,30 +59,24 @@ private:
     // Assign shape position and rotation to have same values as physics.
     void sync();
     
-    // search and return rectangleshape corresponding to vehicle
-    sf::RectangleShape searchShapeByVehicleID(const int& vehicleID, const Race& race) const;
-    
-    // do some damage for vehicle with given ID
-    int missileHitVehicle(const int& vehicleID, const Race& race);
-    
     // missile shape
     sf::RectangleShape shape;
     
-    // texture for missile
-    sf::Texture missileTexture; 
-    
     // target checkpoint index
-    int targetCheckpoint;
+    int targetCheckpoint = 0;
     
     // owned ID
-    int ownerID;
+    int ownerID = -1;
+    
+    // vehicles hit on this tick, see Race::findHits
+    std::vector<Vehicle*> hits;
     
     // check flag for acceleration
     bool accelerating = false;
     
-    // clock that counts how long the missile
+    // simulation time (s) that the missile
     // has been flying. after 10 s -> self destroy
-    sf::Clock fuelTime;
+    double fuelTime = 0.0;
     
 };
 
@@ -42,6 +42,11 @@ public:
 
 
 	virtual void updateSound(SoundHandler&) override;
+    
+    /// Save and restore the state of the launcher and its missile.
+    virtual void saveState(StateBuffer& state) const override;
+    virtual void loadState(StateBuffer& state) override;
+    virtual void hashState(StateHasher& hasher) const override;
 
 private:
 
@@ -0,0 +1,146 @@
+#ifndef NET_PROTOCOL_HPP
+#define NET_PROTOCOL_HPP
+
+#include <SFML/Network.hpp>
+#include <vector>
+
+#include "controls.hpp"
+
+struct RaceSetup;
+
+/*
+ * Messages between RaceServer and RaceClient. Every message is one UDP datagram
+ * (sf::Packet, big endian) starting with PROTOCOL_ID and the MessageType.
+ *
+ *   HELLO     client -> server  ask for a player slot
+ *   WELCOME   server -> client  slot (index of the vehicle) and RaceSetup
+ *   INPUT     client -> server  input sequence number, Controls of the local vehicle,
+ *                               the tick of the latest snapshot received, which of the
+ *                               32 snapshots before it were received (bits) and the size
+ *                               of the camera view (px, Uint16 width and height)
+ *   SNAPSHOT  server -> client  the part of the race state after a tick that is relevant
+ *                               to the client (InterestFilter), encoded by SnapshotCodec
+ *   BYE       both ways         leaving, or the server is full / the race is over
+ *   SPECTATE  client -> server  watch the race without a vehicle: Uint8 1 if WELCOME has
+ *                               been received, else 0. Sent again once per second.
+ *   KEYFRAME  server -> client  a whole snapshot for spectators (see SpectatorStream)
+ *
+ * The server owns the simulation. Clients only send their controls and show the latest
+ * snapshot, so a lost packet is simply replaced by the next one. Vehicles missing from
+ * a snapshot keep their previous state.
+ *
+ * A spectator gets WELCOME with SPECTATOR_SLOT and then the same KEYFRAME and SNAPSHOT
+ * messages as every other spectator. A SpectatorRelay subscribes to a server as a
+ * spectator and forwards the messages to its own spectators unchanged.
+ */
+
+namespace net {
+
+    const unsigned short DEFAULT_PORT = 54321;
+
+    /// Port of a SpectatorRelay unless told otherwise.
+    const unsigned short DEFAULT_RELAY_PORT = 54400;
+
+    const sf::Uint32 PROTOCOL_ID = 0x4D4D4E34; // "MMN4"
+
+    /// A snapshot is sent every SNAPSHOT_INTERVAL ticks (60 Hz).
+    const int SNAPSHOT_INTERVAL = 2;
+
+    /// A peer that has not sent anything for this long is disconnected.
+    const float TIMEOUT = 5; // seconds
+
+    /// A vehicle has at most one weapon of each type.
+    const int MAX_WEAPONS = 3;
+
+    /// Slot in the WELCOME of a spectator.
+    const sf::Uint8 SPECTATOR_SLOT = 255;
+
+    /// Spectators served by a RaceServer itself, e.g. a few relays. More spectators
+    /// connect to a relay.
+    const std::size_t MAX_SERVER_SPECTATORS = 8;
+
+    /// Inputs of a client waiting for their tick on the server (about 67 ms). More are
+    /// queued only if the client's clock runs faster than the server's or after a stall;
+    /// then the oldest ones are dropped so that the input delay doesn't keep growing.
+    const std::size_t MAX_QUEUED_INPUTS = 8;
+
+    enum MessageType : sf::Uint8 {
+        HELLO,
+        WELCOME,
+        INPUT,
+        SNAPSHOT,
+        BYE,
+        SPECTATE,
+        KEYFRAME
+    };
+
+    /// State of one vehicle in a snapshot.
+    struct VehicleState {
+        sf::Uint8 id;
+        float x;
+        float y;
+        float rotation;
+        float vx;
+        float vy;
+        sf::Int16 hp;
+        sf::Uint8 laps;
+        sf::Uint8 checkpoints;
+        sf::Uint8 place;
+        sf::Uint8 weapons[MAX_WEAPONS]; // Weapon::WeaponType in the order of use, UNDEFINED if none
+    };
+
+    /// A flying bullet or missile.
+    struct ProjectileState {
+        enum Type : sf::Uint8 {
+            BULLET,
+            MISSILE
+        };
+        sf::Uint8 type;
+        sf::Uint8 owner; // vehicle ID
+        float x;
+        float y;
+        float rotation;
+    };
+
+    /// A weapon lying on the track.
+    struct PickupState {
+        sf::Uint8 type; // Weapon::WeaponType
+        float x;
+        float y;
+    };
+
+    /// Everything a client needs to draw the race. See Race::writeSnapshot().
+    struct Snapshot {
+        sf::Uint32 tick = 0;
+        sf::Uint32 clockStartTick = 0;
+        bool started = false;
+        bool ended = false;
+        sf::Uint8 lapsDriven = 0;
+        // Input sequence the server applied for the receiving client on the latest tick.
+        // When no new input had arrived, the one before was applied again.
+        sf::Uint32 inputAck = 0;
+        std::vector<VehicleState> vehicles; // players first, then bots (ID order)
+        std::vector<ProjectileState> projectiles;
+        std::vector<PickupState> pickups;
+    };
+
+    /// Start a message of type.
+    void beginMessage(sf::Packet& packet, MessageType type);
+
+    /// Read the header of a message. Returns false if it's not a message of this protocol.
+    bool readHeader(sf::Packet& packet, MessageType& type);
+
+    /// Size of the header (PROTOCOL_ID and MessageType).
+    const std::size_t HEADER_SIZE = 5;
+
+    /// Read the header of a message of size bytes at data, e.g. a datagram that is
+    /// forwarded without copying it to a packet.
+    bool readHeader(const void* data, std::size_t size, MessageType& type);
+}
+
+/// RaceSetup in the same format as in a replay file.
+sf::Packet& operator<<(sf::Packet& packet, const RaceSetup& setup);
+sf::Packet& operator>>(sf::Packet& packet, RaceSetup& setup);
+
+
+#endif
@@ -2,6 +2,7 @@
 #define OBSTACLE_HPP
 
 #include <SFML/Graphics.hpp>
+#include <random>
 
 #include "structures.hpp"
 
@@ -21,7 +22,8 @@ class Obstacle
 public:
     Obstacle() {}
     Obstacle(const std::string& textureName);
-    void setSpawnPoint(const std::vector<structures::Point> points);
+    /// Move to a random point. Param. rng is the random engine of the race.
+    void setSpawnPoint(const std::vector<structures::Point>& points, std::mt19937& rng);
     sf::RectangleShape& getShape();
     void drawObstacle(sf::RenderWindow& window) const;
     
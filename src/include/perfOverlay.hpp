@@ -0,0 +1,125 @@
+#ifndef PERF_OVERLAY_HPP
+#define PERF_OVERLAY_HPP
+
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <vector>
+
+/**
+ * Toggleable performance overlay. Press F3 during a race to show or hide it.
+ *
+ * The overlay shows render FPS, simulation ticks per second, a frame time graph,
+ * draw call and vertex counts, live entity counts and the time both threads spend
+ * waiting on Game::mutex. It is drawn in the STATIC camera view by
+ * Race::drawStaticObjects(), so set that view before calling draw().
+ *
+ * The simulation thread reports only through tickFinished() and addSimLockWait(),
+ * which use atomic counters. Everything else is called from the render thread.
+ *
+ * SFML doesn't expose draw call statistics, so drawing code reports every
+ * window.draw() with countDraw(). Counting is skipped while the overlay is hidden.
+ */
+
+class PerfOverlay
+{
+public:
+
+    PerfOverlay();
+
+    /// Set font for the overlay texts. The font must outlive the overlay.
+    void setFont(const sf::Font& font);
+
+    /// Show or hide the overlay.
+    void toggle();
+
+    bool isVisible() const { return visible; }
+
+    /// Render thread. Call once per frame after window.display().
+    /// Param. frameTime is the time between two displayed frames and renderTime
+    /// the time spent before display() (i.e. without waiting for vsync).
+    void frameFinished(sf::Time frameTime, sf::Time renderTime);
+
+    /// Simulation thread. Call after every simulation tick with its duration.
+    void tickFinished(sf::Time tickTime);
+
+    /// Time the render thread spent waiting to lock Game::mutex.
+    void addRenderLockWait(sf::Time waitTime);
+
+    /// Time the simulation thread spent waiting to lock Game::mutex.
+    void addSimLockWait(sf::Time waitTime);
+
+    /// Number of flying bullets, flying missiles and weapons lying on the track.
+    void setEntityCounts(int bullets, int missiles, int trackWeapons);
+
+    /// Events of the race so far and events dropped because the render thread fell behind.
+    void setEventCounts(int laps, int pickups, int destroyed, unsigned int dropped);
+
+    /// Snapshot bandwidth, decoding time and latest prediction error (px) of a network
+    /// client. Shown once set.
+    void setNetworkStats(float kbitPerSecond, float decodeMicros, float predictionError);
+
+    /// Draw the overlay. Does nothing if the overlay is hidden.
+    void draw(sf::RenderWindow& window);
+
+    /// Report a drawn object to the draw call statistics.
+    static void countDraw(const sf::Shape& shape);
+    static void countDraw(const sf::Text& text);
+    static void countDraw(const sf::Sprite& sprite);
+
+    /// Report a single draw call of raw vertices.
+    static void countDraw(std::size_t vertexCount);
+
+private:
+
+    // Rebuild the texts from the counters collected since the last update.
+    void updateTexts(float elapsed);
+
+    // Rebuild the frame time graph from the frameTimes ring buffer.
+    void updateGraph();
+
+    bool visible = false;
+
+    sf::RectangleShape background;
+    sf::Text statsText;
+    sf::VertexArray graph;
+    sf::VertexArray graphGrid; // reference lines for 60 and 30 FPS
+
+    // Frame times (ms) of the latest frames. frameIndex points to the oldest sample.
+    std::vector<float> frameTimes;
+    std::size_t frameIndex = 0;
+
+    // Render thread counters since the last text update.
+    sf::Clock updateClock;
+    int frames = 0;
+    float renderMs = 0;
+    float worstFrameMs = 0;
+    float renderLockMs = 0;
+
+    // Simulation thread counters (microseconds), read and reset by the render thread.
+    std::atomic<int> ticks;
+    std::atomic<long long> tickMicros;
+    std::atomic<long long> simLockMicros;
+
+    int bulletCount = 0;
+    int missileCount = 0;
+    int trackWeaponCount = 0;
+
+    int lapEvents = 0;
+    int pickupEvents = 0;
+    int destroyedEvents = 0;
+    unsigned int droppedEvents = 0;
+
+    float networkKbit = -1; // negative: not a network client
+    float networkPredictionError = 0;
+    float networkDecodeMicros = 0;
+
+    // Draw statistics of the frame being drawn and the previous complete frame.
+    static bool counting;
+    static unsigned int drawCalls;
+    static unsigned int vertices;
+    unsigned int lastDrawCalls = 0;
+    unsigned int lastVertices = 0;
+};
+
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef PHYSICS_MATH_HPP
+#define PHYSICS_MATH_HPP
+
+#include <cmath>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Shape.hpp>
+
+#include "fastMath.hpp"
+#include "fixedPoint.hpp"
+#include "structures.hpp"
+
+/**
+ * Numbers of the simulation: VehiclePhysics, the collision tests and the AI steering.
+ *
+ * By default Real is double, Vector is Vector2D and the trigonometry comes from <cmath>
+ * and SFML. Those can round differently with another compiler, standard library or
+ * optimisation flags (e.g. fused multiply-add), and then a replay or a rollback peer built
+ * differently drifts apart. Building with -DFIXED_POINT_PHYSICS=ON makes Real a Q32.32
+ * Fixed with table-based trigonometry (see fixedPoint.hpp): integer arithmetic only, so the
+ * simulation is bit for bit the same in every build. It costs some speed, see
+ * bench/mathBench.cpp.
+ *
+ * The interfaces of the classes stay in doubles. A Fixed converted to double and back is
+ * the same Fixed, so values read from the physics and given back don't change. Replays
+ * and rollback states of one mode don't work in the other.
+ */
+
+namespace physmath {
+
+#ifdef FIXED_POINT_PHYSICS
+    typedef Fixed Real;
+    typedef FixedVector Vector;
+
+    inline double toDouble(Fixed value) { return value.toDouble(); }
+    inline Vector2D toVector2D(const FixedVector& v) { return v.toVector2D(); }
+    inline Fixed abs(Fixed value) { return fixedmath::abs(value); }
+    inline Fixed fmod(Fixed a, Fixed b) { return Fixed::fromRaw(a.getRaw() % b.getRaw()); }
+    inline Fixed atan2Deg(Fixed y, Fixed x) { return fixedmath::atan2Deg(y, x); }
+
+    // The steering of the AI and missiles. The tables are as fast as the approximations.
+    inline Fixed approxAngleBetween(const FixedVector& v1, const FixedVector& v2) { return FixedVector::angleBetween(v1, v2); }
+    inline void approxSincosDeg(Fixed degs, Fixed& sine, Fixed& cosine) { fixedmath::sincosDeg(degs, sine, cosine); }
+    inline FixedVector approxUnitVector(Fixed degs) { return FixedVector::getUnitVector(degs); }
+#else
+    typedef double Real;
+    typedef Vector2D Vector;
+
+    inline double toDouble(double value) { return value; }
+    inline const Vector2D& toVector2D(const Vector2D& v) { return v; }
+    inline double abs(double value) { return std::abs(value); }
+    inline double fmod(double a, double b) { return std::fmod(a, b); }
+    inline double atan2Deg(double y, double x) { return Vector2D::rad2deg(std::atan2(y, x)); }
+
+    // The steering of the AI and missiles (see fastMath.hpp).
+    inline double approxAngleBetween(const Vector2D& v1, const Vector2D& v2) { return fastmath::angleBetween(v1, v2); }
+    inline void approxSincosDeg(double degs, double& sine, double& cosine) { fastmath::sincosDeg(degs, sine, cosine); }
+    inline Vector2D approxUnitVector(double degs) { return fastmath::unitVector(degs); }
+#endif
+
+    /// A point of object (e.g. a corner of a shape) in world coordinates, the same as
+    /// object.getTransform().transformPoint(point).
+    structures::Point transformPoint(const sf::Transformable& object, const sf::Vector2f& point);
+
+    /// A point in world coordinates in the local coordinates of object, the same as
+    /// object.getInverseTransform().transformPoint(point).
+    structures::Point inverseTransformPoint(const sf::Transformable& object, const sf::Vector2f& point);
+
+    /// Bounding box of a shape in world coordinates, the same as shape.getGlobalBounds().
+    sf::FloatRect getGlobalBounds(const sf::Shape& shape);
+
+}
+
+
+#endif
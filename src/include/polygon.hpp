@@ -28,7 +28,7 @@ public:
     const Line getCrashedLine(const Polygon &poly2);
 
     /// Get Line-objects forming the polygon.
-    const std::vector<Line> getLines() const;
+    const std::vector<Line>& getLines() const;
 
 private:
 
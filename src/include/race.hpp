@@ -7,6 +7,31 @@
 #include "aivehicle.hpp"
 #include "track.hpp"
 #include "camera.hpp"
+#include "perfOverlay.hpp"
+#include "vehicleRegistry.hpp"
+#include "spatialIndex.hpp"
+#include "hitboxHistory.hpp"
+#include "stateHash.hpp"
+#include "constants.hpp"
+#include "gameEvents.hpp"
+#include "hud.hpp"
+#include "netProtocol.hpp"
+#include "clientPrediction.hpp"
+
+class Replay;
+
+/// Everything needed to create the same race again. Stored in replays.
+struct RaceSetup {
+    std::string xmlfile;
+    int raceType = 2; // Race::RaceType
+    unsigned int seed = 0;
+    int players = 1;
+    int bots = 0;
+    int vehicleWidth = 60;
+    int vehicleHeight = 30;
+    std::string vehicleImage;
+    std::string backgroundImage;
+};
 
 /**
  *
@@ -17,6 +42,10 @@
  * and attributes specific to that type of race.
  * In addition, they override a couple of virtual Race functions and define their own implemention.
  *
+ * The race is simulated in fixed time steps by step(), which is called TICK_RATE times per second
+ * from a separate thread in Game. Nothing in the simulation depends on the wall clock or
+ * on an unseeded random number, so the same seed and the same control inputs on the same ticks
+ * always give the same race. This is how replays work (see Replay).
  *
  */
 
@@ -37,10 +66,43 @@ public:
     virtual ~Race();
     Race(const Race&) = delete;
     
-    std::vector<std::shared_ptr<Vehicle>> getVehicles() const;
-    std::vector<std::shared_ptr<AIVehicle>> getAIVehicles() const;
+    /// Create a race of the type setup.raceType. Vehicles are not added yet.
+    /// Throws XMLException if the track cannot be read.
+    static std::unique_ptr<Race> create(const RaceSetup& setup);
+    
+    const std::vector<std::shared_ptr<Vehicle>>& getVehicles() const { return vehicles; }
+    const std::vector<std::shared_ptr<AIVehicle>>& getAIVehicles() const { return aivehicles; }
+    
+    /// Positions of all the vehicles for finding weapon targets. Built on every tick
+    /// after the vehicles have moved and before bullets and missiles are updated.
+    const SpatialIndex& getSpatialIndex() const { return spatialIndex; }
+    
+    /// Append to result the vehicles that a bullet or missile of shooterID with bounds hits
+    /// on this tick, the nearest first. The vehicles are where the shooter saw them: for a
+    /// network player they are rewound to the view tick (see setViewTick and HitboxHistory).
+    void findHits(const sf::FloatRect& bounds, int shooterID, std::vector<Vehicle*>& result) const;
+    
+    /// Server. The player with index (into getVehicles()) sees the vehicles as they were on
+    /// viewTick, the tick of the latest snapshot it has received. 0 (default): as they are now.
+    void setViewTick(int index, unsigned int viewTick);
+    
     Camera& getCamera();
-    sf::Clock& getRaceClock();
+    
+    /// Seconds since the start of the race (or since the last lap in time trial).
+    double getRaceTime() const;
+    
+    /// Seconds since the race was created, countdown included.
+    double getSimTime() const { return tick * TICK_TIME; }
+    
+    /// Number of simulated ticks.
+    unsigned int getTick() const { return tick; }
+    
+    /// Seed of the random engine. A random seed is chosen in the constructor.
+    unsigned int getSeed() const { return seed; }
+    void setSeed(unsigned int newSeed);
+    
+    /// Add players and bots described by setup.
+    void addVehicles(const RaceSetup& setup);
     
     /// Add a vehicle to the race.
     virtual void addVehicle(std::shared_ptr<Vehicle> vehicle);
@@ -54,7 +116,63 @@ public:
     /// Start clock and keyboard event listening.
     void startRace();
     
-    /// Check collisions of all the vehicles. Called from a separate thread in Game.
+    /// Simulate one tick: apply control inputs, move vehicles, bullets and missiles
+    /// and check collisions and hits. Called TICK_RATE times per second from a separate thread.
+    void step();
+    
+    /// Record the control inputs of every tick to replay.
+    void recordTo(Replay* replay) { recording = replay; }
+    
+    /// Take the control inputs from replay instead of the keyboard.
+    void playFrom(Replay* replay) { playback = replay; }
+    
+    bool isRecording() const { return recording != nullptr; }
+    bool isReplaying() const { return playback != nullptr; }
+    
+    /// Write the state shown by network clients (see RaceServer).
+    void writeSnapshot(net::Snapshot& snapshot);
+    
+    /// Show the state received from the server. A network client calls this instead of step().
+    /// The local player's vehicle is reconciled with its prediction.
+    void readSnapshot(const net::Snapshot& snapshot);
+    
+    /// Save the whole simulation state after the latest tick to state: the tick and race
+    /// status, vehicles with their physics, weapons and bullets, the track pickups, the
+    /// random engine, the standings and the state hash chain. Used for rollback (see Rollback).
+    void saveState(StateBuffer& state) const;
+    
+    /// Restore the state saved by saveState() of this race. The simulation continues from
+    /// the saved tick as if the ticks after it never happened.
+    void loadState(StateBuffer& state);
+    
+    /// Hash of the state after the latest tick, updated by step(). Compare it with
+    /// another simulation of the same race to find a desync (see StateHash).
+    const StateHash& getStateHash() const { return stateHash; }
+    
+    /// Hash the state after the latest tick. The total of hash is chained with its
+    /// previous total.
+    void hashState(StateHash& hash) const;
+    
+    /// Print the values of a component of StateHash, e.g. the first divergent one.
+    void dumpStateComponent(std::ostream& out, std::size_t component);
+    
+    /// Publish game events (sounds, laps, telemetry). Rollback turns this off while it
+    /// simulates ticks again, whose events have been published already.
+    void setPublishing(bool enabled) { publishing = enabled; }
+    
+    /// Network client. Predict one tick of the local player's vehicle with its current
+    /// input, which has been sent to the server as INPUT sequence (see ClientPrediction).
+    void predictLocalPlayer(sf::Uint32 sequence);
+    
+    /// How much (px) the prediction of the local player was off at the latest snapshot.
+    double getPredictionError() const { return prediction.getLastError(); }
+    
+    /// In network play only the player with this index (into getVehicles()) is controlled
+    /// from the keyboard, with the keys of the first player. -1 (default): all players are local.
+    void setLocalPlayer(int index) { localPlayer = index; }
+    int getLocalPlayer() const { return localPlayer; }
+    
+    /// Check collisions of all the vehicles. Called by step().
     void checkCollisions();
     
     /// Check weapon, obstacle, finish line etc. hits.
@@ -76,7 +194,7 @@ public:
     /// If player has a weapon, draw the icon next to helmet icon.
     void drawPlayerWeapons(sf::RenderWindow& window);
     
-    /// Update vehicle logics. Called from a separate thread in Game.
+    /// Update vehicle logics. Called by step().
     virtual void update();
     
 	/// Update turbo timing and the acceleration set by said turbo.
@@ -88,9 +206,18 @@ public:
     /// Update missile positions.
     void updateMissiles();
     
-	/// Update sounds. Some sounds are handled by flags, other might not.
+	/// Play the sounds of new events and the engine sound. Called from the render thread.
 	void updateSounds(SoundHandler&);
 
+    /// Count new events for the performance overlay. Called from the render thread.
+    void updateTelemetry();
+    
+    /// Events of the simulation for the render thread. See EventBus.
+    EventBus& getEvents() { return events; }
+    
+    /// Vehicle with ID (see initialize()), nullptr if there is none.
+    Vehicle* getVehicleByID(int ID) const;
+
     /// Update the content of texts on the screen (e.g. lap time, player status, laps).
     void updateTexts();
     
@@ -105,7 +232,7 @@ public:
     /// Update the countdown text based on the elapsed time: 3...2...1...Go!.
     void handleCountdownEvents();
     
-    /// Check if a player uses a weapon and use the weapon if a proper keyboard event has occured.
+    /// Update the FIRE control of the players. The weapon is used on the next tick.
     void handleWeaponEvents(sf::Event& event);
     
     /// Tell if the race is started (countdown has reached ZERO).
@@ -126,39 +253,89 @@ public:
     
     sf::RectangleShape& getViewDivider() { return viewDivider; }
     
+    /// Performance overlay drawn with the static objects.
+    PerfOverlay& getPerfOverlay() { return perfOverlay; }
+    
 protected:
     int raceType; // use enum value
     int lapsDriven = 1; // Change the name to current lap
     int totalLaps = 5;
     
-    sf::Clock raceClock;
+    // Simulated ticks and the tick when the race clock was started.
+    unsigned int tick = 0;
+    unsigned int clockStartTick = 0;
+    
+    unsigned int seed;
+    
+    // Replay which the inputs are recorded to or played from. Not owned.
+    Replay* recording = nullptr;
+    Replay* playback = nullptr;
+    
+    int localPlayer = -1;
+    ClientPrediction prediction;
+    
+    // Bullets and missiles of the latest snapshot, drawn with the shapes below.
+    std::vector<net::ProjectileState> remoteProjectiles;
+    sf::RectangleShape remoteBullet;
+    sf::RectangleShape remoteMissile;
+    
+    /// Restart the race clock and return the time before restarting.
+    double restartRaceClock();
+    
+    /// Apply the control inputs of this tick to player vehicles.
+    void applyControls();
+    
+    /// Use the first weapon of the vehicle.
+    void useWeapon(Vehicle& vehicle);
+    
+    /// Choose the level of detail of every bot by its distance to the vehicles the cameras
+    /// follow: the players, and in split screen with one player the first bot.
+    /// Only simulation state is used, so replays choose the same levels.
+    void updateDetailLevels();
+    
+    /// Tell if vehicle is simulated on this tick. KINEMATIC bots are simulated every
+    /// AI_LOD_INTERVAL ticks, spread over the ticks by ID.
+    bool isDetailTick(const AIVehicle& vehicle) const;
     
     // Containers for vehicles and AI vehicles.
     // Pointers are used to utilize polymorphism.
-    // shared_ptr is used because racePlaces container shares the ownership of vehicles
-    // with this container.
+    // Loop over them by reference (auto &v) to avoid copying the shared_ptrs.
     std::vector<std::shared_ptr<Vehicle>> vehicles;
     std::vector<std::shared_ptr<AIVehicle>> aivehicles;
     
+    // Components of the vehicles above in dense arrays, shared with the vehicles.
+    // Created by initialize().
+    std::shared_ptr<VehicleRegistry> registry;
+    
+    SpatialIndex spatialIndex;
+    HitboxHistory hitboxHistory;
+    std::vector<unsigned int> viewTicks; // by player index, see setViewTick
+    std::vector<Vehicle*> bulletHits;
+    
     Camera camera;
     Track track;
     
     bool splitScreen = false;
     
     sf::Font textFont; // All texts use this.
-    sf::Text clockText;
-    sf::Text lapsText;
     sf::Text countdownText;
-    sf::Text playerStatusText;
-    std::vector<sf::Text> playerTexts;
-    std::vector<sf::Text> botTexts;
+    
+    // Clock, laps, player status texts and helmet icons. The members below are text indexes.
+    Hud hud;
+    std::size_t clockText = 0;
+    std::size_t lapsText = 0;
+    std::vector<std::size_t> playerTexts;
+    std::vector<std::size_t> botTexts;
     sf::Sprite flagShape;
     sf::Texture flagTexture;
+    sf::Sprite explosionSprite; // texture is shared, see resources.hpp
     sf::Text winnerText;
     
     // Thin black rectange to divide left and right view during split screen game.
     sf::RectangleShape viewDivider;
     
+    PerfOverlay perfOverlay;
+    
     /// Create a text for race clock in the upper right corner of the window
     /// and for driven laps.
     void createTexts();
@@ -166,20 +343,24 @@ protected:
     // Override these in TimeTrial.
     virtual void createLapTimeText() {}
     virtual void updateLapTimeText() {}
-    virtual void drawTimeTrialObjects(sf::RenderWindow& window) {}
+    // Drawn along with the camera before vehicles.
+    virtual void drawGhost(sf::RenderWindow&) {}
     
     /// Declare winner. Stop keyboard event listening (not ready yet)
     void endRace();
     
     void updateWinnerText();
     
+    // Draw the explosion of a destroyed vehicle.
+    void drawExplosion(sf::RenderWindow& window, Vehicle& vehicle);
+    
     // Player name, HP remaining, helmet icon to be drawn on the screen.
     void createPlayerStatus();
 
-    // Sort racePlaces container based on places in the race. The leader will be the first item.
-    void fixPlaces();
+    // Update the progress of every vehicle and sort the standings by it. The leader will be
+    // the first item. Called on every tick, see cpp file.
+    void updateStandings();
     
-    std::vector<sf::RectangleShape> helmetIcons;
     sf::Texture helmetTexture;
     std::vector<sf::Color> helmetIconColors = {sf::Color(255, 0, 0), sf::Color(0, 255, 0),
         sf::Color(0, 0, 255), sf::Color(178, 102, 255)
@@ -187,18 +368,27 @@ protected:
     std::vector<sf::Color> colors = {sf::Color(255, 0, 0), sf::Color(50, 50, 255),
         sf::Color(0, 205, 0), sf::Color(255, 255, 0)};
 
-    
-    // Container to hold pointers to Vehicle objects in the specific order.
-    // This vector is sorted every time a vehicle passes a checkpoint.
-    // Race leader will be the first etc.
-    // Also AI vehicles is stored to this container.
-    // See Race::fixPlaces().
-    std::vector<std::shared_ptr<Vehicle>> racePlaces;
 
 
-	/// Flags for updateSound()
-	bool pickedUpFlag = false;
-	bool collisionFlag = false;
+    // Written by the simulation thread, read by the render thread.
+    EventBus events;
+    bool publishing = true;
+    
+    StateHash stateHash;
+    
+    // Compare the state hash with the one recorded in the replay. Reports the first desync.
+    void checkReplay();
+    
+    // Events counted by updateTelemetry().
+    int lapEvents = 0;
+    int pickupEvents = 0;
+    int destroyedEvents = 0;
+    
+    // Publish an event of this tick.
+    void publish(GameEvent::Type type, int vehicleID, int value = 0);
+    
+    // Publish DESTROYED for the vehicles destroyed on this tick.
+    void publishDestroyed();
 
 };
 
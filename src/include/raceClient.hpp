@@ -0,0 +1,112 @@
+#ifndef RACE_CLIENT_HPP
+#define RACE_CLIENT_HPP
+
+#include <SFML/Network.hpp>
+#include <string>
+
+#include "netProtocol.hpp"
+#include "race.hpp"
+#include "snapshotCodec.hpp"
+
+/**
+ * Connection to a RaceServer. Sends the controls of the local vehicle and keeps
+ * the latest snapshot received from the server.
+ *
+ * Game uses this instead of simulating the race: on every tick it sends the input
+ * and shows the latest snapshot with Race::readSnapshot().
+ *
+ * A spectator joins with spectate() instead of connect() and has no vehicle. It gets the
+ * snapshots of the whole race from the server or from a SpectatorRelay and sends nothing
+ * but a keep-alive now and then.
+ */
+
+class RaceClient
+{
+public:
+
+    /// Join the server at address:port. HELLO is sent again until the server answers
+    /// or timeout has passed. Returns false if the server didn't answer or is full.
+    bool connect(const sf::IpAddress& address, unsigned short port, sf::Time timeout = sf::seconds(5));
+
+    /// Watch the race of the server or relay at address:port like connect(), without a vehicle.
+    bool spectate(const sf::IpAddress& address, unsigned short port, sf::Time timeout = sf::seconds(5));
+
+    /// True after spectate().
+    bool isSpectator() const { return slot == net::SPECTATOR_SLOT; }
+
+    /// Race setup and the player slot (index of the local vehicle) given by the server.
+    const RaceSetup& getSetup() const { return setup; }
+    int getSlot() const { return slot; }
+
+    /// Size of the camera view (px) sent with the input. The server sends only what's
+    /// relevant to this view. Default: the window size.
+    void setViewSize(const sf::Vector2f& size) { viewSize = size; }
+
+    /// Send the controls of the local vehicle. Each call has a new sequence number.
+    /// Also acknowledges the latest snapshot received, the baseline of the next ones.
+    /// Returns the sequence number of the input, or 0 if not connected.
+    sf::Uint32 sendInput(Controls controls);
+
+    /// Handle all the messages from the server. Returns true if a newer snapshot arrived.
+    /// A spectator also sends its keep-alive from here.
+    bool receive();
+
+    /// Latest snapshot. Older snapshots arriving late are ignored.
+    const net::Snapshot& getSnapshot() const { return snapshot; }
+
+    /// Number of snapshots received.
+    unsigned int getSnapshotCount() const { return snapshotCount; }
+
+    /// Bytes received since connecting.
+    std::size_t getBytesReceived() const { return bytesReceived; }
+
+    /// Size and decoding time of the snapshots received.
+    const net::CodecStats& getStats() const { return codec.getStats(); }
+
+    /// False after the server has said BYE or has not sent anything for net::TIMEOUT.
+    bool isConnected() const { return connected; }
+
+    /// Tell the server we are leaving.
+    void disconnect();
+
+private:
+
+    // Send request (HELLO or SPECTATE) until the server answers with WELCOME.
+    bool join(const sf::IpAddress& address, unsigned short port, sf::Time timeout, net::MessageType request);
+
+    // Start request in packet.
+    void beginRequest(net::MessageType request);
+
+    void send(sf::Packet& packet);
+
+    sf::UdpSocket socket;
+    sf::IpAddress serverAddress;
+    unsigned short serverPort = 0;
+    bool connected = false;
+    sf::Clock lastHeard;
+    sf::Clock keepAliveClock; // spectator
+
+    RaceSetup setup;
+    int slot = -1;
+    sf::Uint32 inputSequence = 0;
+    sf::Vector2f viewSize = sf::Vector2f(WIDTH, HEIGHT);
+
+    net::SnapshotCodec codec;
+    sf::Uint32 ackTick = 0;
+    net::Snapshot snapshot;
+    net::Snapshot received;
+    unsigned int snapshotCount = 0;
+    std::size_t bytesReceived = 0;
+    sf::Packet packet;
+};
+
+/// Parse "host" or "host:port". Returns false if the port is not a number.
+bool parseServerAddress(const std::string& text, std::string& host, unsigned short& port);
+
+/// Join a server without a window, hold the throttle and print what the snapshots tell
+/// once per second until the server leaves. For testing servers. With spectate, watch the
+/// race of a server or relay instead. Returns the exit code.
+int runHeadlessClient(const std::string& host, unsigned short port, bool spectate = false);
+
+
+#endif
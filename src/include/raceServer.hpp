@@ -0,0 +1,176 @@
+#ifndef RACE_SERVER_HPP
+#define RACE_SERVER_HPP
+
+#include <SFML/Network.hpp>
+#include <map>
+#include <memory>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "netProtocol.hpp"
+#include "race.hpp"
+#include "interestFilter.hpp"
+#include "snapshotCodec.hpp"
+#include "spectatorList.hpp"
+#include "spectatorStream.hpp"
+#include "threadPool.hpp"
+
+/**
+ * Dedicated race server. Owns the only simulated Race and runs it headless at TICK_RATE,
+ * the same fixed tick as in Game::updateVehicles().
+ *
+ * Clients join with HELLO and get a player slot, i.e. one of the player vehicles.
+ * Their INPUT messages are queued by sequence number, and each tick applies the next one
+ * to the vehicle like keyboard input, the same one input per tick as the client predicts
+ * with (see ClientPrediction). Without a new input the previous one is applied again.
+ * The countdown starts when every slot is taken. After that,
+ * a snapshot is sent to every client each net::SNAPSHOT_INTERVAL ticks. It contains only
+ * what's relevant to the client's view (see net::InterestFilter) and is delta compressed
+ * against the latest snapshot the client has acknowledged (see net::SnapshotCodec).
+ * The bandwidth and encoding time per client are printed every few seconds.
+ *
+ * Up to net::MAX_SERVER_SPECTATORS spectators (typically SpectatorRelays) can watch with
+ * SPECTATE. They all get the same net::SpectatorStream of whole snapshots, encoded once
+ * per snapshot however many there are.
+ *
+ * Everything runs in one thread on a non-blocking socket. run() returns when the race
+ * has ended, or when all the clients have left. A RaceHost runs many servers by calling
+ * start(), update() and finish() itself.
+ */
+
+class RaceServer
+{
+public:
+
+    /// Create the race of setup. Throws XMLException if the track cannot be read.
+    /// logName is printed at the start of every message.
+    RaceServer(const RaceSetup& setup, unsigned short port, const std::string& logName = "");
+
+    RaceServer(const RaceServer&) = delete;
+
+    /// Serve the race. Returns the exit code of the program.
+    int run();
+
+    /// Start listening on the port. Returns false if the port cannot be used.
+    bool start();
+
+    /// Handle the waiting messages and simulate the ticks due since the previous call.
+    /// Returns false when the race is over; then call finish().
+    bool update();
+
+    /// Tell the clients that the server leaves and print the results.
+    void finish();
+
+private:
+
+    struct QueuedInput {
+        Controls controls;
+        sf::Uint32 viewTick; // the latest snapshot the client had received
+    };
+
+    struct Client {
+        bool connected = false;
+        sf::IpAddress address;
+        unsigned short port = 0;
+        sf::Uint32 inputSequence = 0; // INPUT applied on the latest tick
+        std::map<sf::Uint32, QueuedInput> inputs; // received, not applied yet, by sequence
+        sf::Uint32 ackTick = 0; // latest snapshot received by the client
+        sf::Uint32 ackBits = 0; // and the ones before it, see net::SnapshotCodec::getAckBits()
+        sf::Clock lastHeard;
+        sf::Vector2f viewSize = sf::Vector2f(WIDTH, HEIGHT); // camera view of the client (px)
+        net::InterestFilter interest;
+        net::SnapshotCodec codec;
+        net::CodecStats reportedStats; // stats at the previous report
+    };
+
+    // Handle all the messages waiting in the socket.
+    void receive();
+    void handleHello(const sf::IpAddress& address, unsigned short port);
+    void handleInput(sf::Packet& packet, const sf::IpAddress& address, unsigned short port);
+    void handleSpectate(sf::Packet& packet, const sf::IpAddress& address, unsigned short port);
+
+    // Set the controls of every connected client's vehicle for the next tick.
+    void applyInputs();
+
+    // Slot of the client at address:port, -1 if it's not connected.
+    int findClient(const sf::IpAddress& address, unsigned short port) const;
+
+    // Disconnect clients which have been silent for net::TIMEOUT.
+    void checkTimeouts();
+
+    void sendSnapshots();
+    void send(sf::Packet& packet, const Client& client);
+    void sendBye(const sf::IpAddress& address, unsigned short port);
+
+    int connectedCount() const;
+
+    // Print the bandwidth used by each client since the previous report.
+    void reportBandwidth();
+
+    // Print the final state of the race, like runHeadlessReplay().
+    void printResults() const;
+
+    // Print the lines of message, each starting with name.
+    void log(const std::string& message, std::ostream& stream = std::cout) const;
+
+    RaceSetup setup;
+    unsigned short port;
+    std::string name;
+    std::unique_ptr<Race> race;
+    sf::UdpSocket socket;
+    std::vector<Client> clients; // by slot, one per player vehicle
+    bool running = false; // all slots have been taken and the race is simulated
+    net::Snapshot snapshot;
+    net::Snapshot relevant; // the part of snapshot sent to one client
+    net::SpectatorList spectators;
+    net::SpectatorStream spectatorStream;
+    sf::Packet packet;
+    sf::Clock reportClock;
+    sf::Clock stepClock;
+    double lag = 0; // simulation time behind the clock (s)
+    double endTime = -1; // simulation time when the race ended, negative before that
+};
+
+/**
+ * Many independent races in one server process, e.g. dozens on one server box. Each race is
+ * a RaceServer on its own UDP port: the first port, the next one and so on.
+ *
+ * Races on the same track share its TrackData, so an extra race costs only its vehicles and
+ * the pickups and obstacles of its Track. The memory of the track and of each race is
+ * printed when the races have been created.
+ *
+ * The races are updated in rounds on a ThreadPool, each race by one thread at a time.
+ * The share of time the threads are busy is printed every few seconds. run() returns when
+ * every race is over.
+ */
+
+class RaceHost
+{
+public:
+
+    /// Create a race for each setup. Throws XMLException if a track cannot be read.
+    /// threads 0: one per hardware thread.
+    RaceHost(const std::vector<RaceSetup>& setups, unsigned short firstPort, unsigned int threads);
+
+    RaceHost(const RaceHost&) = delete;
+
+    /// Serve the races. Returns the exit code of the program.
+    int run();
+
+private:
+
+    std::vector<std::shared_ptr<const TrackData>> tracks; // kept loaded between the races
+    std::vector<std::unique_ptr<RaceServer>> servers;
+    ThreadPool pool;
+};
+
+/// Run a dedicated server for setup on port. Returns the exit code of the program.
+int runRaceServer(const RaceSetup& setup, unsigned short port);
+
+/// Run the races of setups on ports firstPort... in one process with threads threads
+/// (0: one per hardware thread). Returns the exit code of the program.
+int runRaceHost(const std::vector<RaceSetup>& setups, unsigned short firstPort, unsigned int threads);
+
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef RACING_LINE_HPP
+#define RACING_LINE_HPP
+
+#include <vector>
+
+#include "structures.hpp"
+
+/**
+ * The line AI vehicles drive along, computed once when the track is loaded (see Track).
+ *
+ * The line is a closed Catmull-Rom spline (centripetal, so it has no loops or cusps)
+ * through the middle points of the finish line and the checkpoints in driving order.
+ * It's stored as samples at equal distances. Every sample has a target speed,
+ * which depends on the curvature: a vehicle can turn only AI_ANG_VEL degrees per second,
+ * so in a turn of radius r the speed must be below AI_ANG_VEL * r. The speeds are then
+ * lowered before the turns, so that there is distance enough to brake.
+ *
+ * Following the line is a lookup: findNearest() with the previous index as a hint
+ * only searches a few samples.
+ */
+
+class RacingLine
+{
+public:
+
+    struct Sample {
+        structures::Point position;
+        float distance;  // distance from the first sample along the line
+        float curvature; // 1 / turn radius
+        float speed;     // target speed
+    };
+
+    /// Distance between two samples (px).
+    static constexpr float SPACING = 16;
+
+    /// Build the line through the points. Needs at least 2 points, otherwise the line is empty.
+    void build(const std::vector<structures::Point>& controlPoints);
+
+    bool empty() const { return samples.empty(); }
+    std::size_t size() const { return samples.size(); }
+    const Sample& operator[](std::size_t index) const { return samples[index]; }
+
+    /// Length of the whole loop (px).
+    float getLength() const { return length; }
+
+    /// Index of the sample nearest to position. Searches the whole line.
+    std::size_t findNearest(const structures::Point& position) const;
+
+    /// Index of the sample nearest to position, searched around hint (the previous result).
+    /// A vehicle moves only a few pixels per tick, so the nearest sample is close to hint.
+    std::size_t findNearest(const structures::Point& position, std::size_t hint) const;
+
+    /// Index of the sample distance px ahead of index along the line.
+    std::size_t advance(std::size_t index, float distance) const;
+
+private:
+
+    // Resample the dense spline points to SPACING.
+    void resample(const std::vector<structures::Point>& dense);
+    void computeCurvature();
+    void computeSpeeds();
+
+    std::vector<Sample> samples;
+    float length = 0;
+};
+
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <SFML/Network.hpp>
+#include <string>
+#include <vector>
+
+#include "controls.hpp"
+#include "race.hpp"
+
+/**
+ * Race replay: the race setup (track, seed, vehicles) and the control inputs of every
+ * player on every tick. Race::step() is deterministic, so that is enough to simulate
+ * the same race again, either in the window or headless (see runHeadlessReplay()).
+ *
+ * Control inputs change only a few times per second, so they are stored as runs:
+ * the number of ticks (varint) followed by the controls of each player (one byte each).
+ * A minute of racing takes a few kilobytes.
+ *
+ * Every CHECK_INTERVAL ticks the state hash of the race (see StateHash) is stored too:
+ * the total and the lower 32 bits of each component. Playing compares them with the
+ * simulation, so a replay which doesn't play the same race is noticed at once, with the
+ * component which diverged first.
+ *
+ * File format (sf::Packet, i.e. big endian):
+ * magic "MMRP", version, tick rate, RaceSetup, tick count, run data size and run data,
+ * check count, component count and the checks (tick, total, components).
+ *
+ * Race calls record() and play() from the simulation thread. Save after the thread has stopped.
+ */
+
+class Replay
+{
+public:
+
+    Replay() {}
+
+    /// Ticks between the stored state hashes (one second).
+    static const unsigned int CHECK_INTERVAL = TICK_RATE;
+
+    /// Start recording a new race. Clears the previous recording.
+    void startRecording(const RaceSetup& raceSetup);
+
+    /// Append the control inputs of one tick (one item per player).
+    void record(const std::vector<Controls>& controls);
+
+    /// Read the control inputs of the next tick. When the replay has ended,
+    /// controls are all zero and false is returned.
+    bool play(std::vector<Controls>& controls);
+
+    /// Store the state hash of the tick recorded last.
+    void recordCheck(const StateHash& hash);
+
+    /// Compare the state hash of a played tick with the stored one. Returns false if they
+    /// differ, for the first time only. Then component is the first component which
+    /// differs, or -1 if only the earlier history does (the totals are chained).
+    bool check(const StateHash& hash, int& component);
+
+    /// Number of stored hashes the played race has matched so far.
+    unsigned int getChecksPassed() const { return checksPassed; }
+
+    /// Tell if all the recorded ticks are played.
+    bool isFinished() const { return ticksPlayed >= tickCount; }
+
+    /// Save to file. Returns false if the file cannot be written.
+    bool save(const std::string& filename);
+
+    /// Load from file and rewind to the first tick. Returns false if the file cannot be read
+    /// or it's not a replay of this version.
+    bool load(const std::string& filename);
+
+    const RaceSetup& getSetup() const { return setup; }
+
+    unsigned int getTickCount() const { return tickCount; }
+
+    /// Size of the encoded control inputs in bytes.
+    std::size_t getDataSize() const { return data.size(); }
+
+    /// Path for a new replay file in the replays directory. The name is the current date and time.
+    static std::string newFilePath();
+
+private:
+
+    // Append the current run to data.
+    void flushRun();
+
+    void writeVarint(unsigned int value);
+    bool readVarint(unsigned int& value);
+
+    RaceSetup setup;
+
+    // Encoded runs.
+    std::vector<sf::Uint8> data;
+    unsigned int tickCount = 0;
+
+    // Controls and length of the run, which is being recorded or played.
+    std::vector<Controls> runControls;
+    unsigned int runLength = 0;
+
+    // Read position in data and played ticks.
+    std::size_t readPos = 0;
+    unsigned int ticksPlayed = 0;
+
+    struct Check {
+        sf::Uint32 tick;
+        sf::Uint64 total;
+        std::vector<sf::Uint32> components;
+    };
+    std::vector<Check> checks;
+    std::size_t nextCheck = 0;
+    unsigned int checksPassed = 0;
+    bool diverged = false;
+};
+
+/// Simulate a replay without a window and print the result. Param. speed limits the speed
+/// to speed times real time, 0 is as fast as possible. Returns the exit code of the program.
+int runHeadlessReplay(const std::string& filename, double speed);
+
+
+#endif
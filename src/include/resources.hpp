@@ -0,0 +1,27 @@
+#ifndef RESOURCES_HPP
+#define RESOURCES_HPP
+
+#include <SFML/Graphics.hpp>
+#include <string>
+
+/*
+ * Textures and fonts shared by all the objects that use them.
+ *
+ * Every file is loaded only once, the first time it's asked for, and kept until the
+ * program exits. A race with many vehicles then has one copy of the vehicle texture
+ * on the GPU instead of one per vehicle, and creating a vehicle doesn't read files.
+ *
+ * Paths are relative to the images directory, which is searched in "../images/" and
+ * "../../images/" like elsewhere. Can be called from both threads.
+ */
+
+namespace resources {
+    /// Texture loaded from the images directory, nullptr if it cannot be loaded.
+    const sf::Texture* getTexture(const std::string& name);
+
+    /// Font loaded from the images directory, nullptr if it cannot be loaded.
+    const sf::Font* getFont(const std::string& name);
+}
+
+
+#endif
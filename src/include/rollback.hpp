@@ -0,0 +1,75 @@
+#ifndef ROLLBACK_HPP
+#define ROLLBACK_HPP
+
+#include <vector>
+
+#include "race.hpp"
+#include "stateBuffer.hpp"
+#include "controls.hpp"
+
+/**
+ * Rollback for peer-to-peer races (GGPO style).
+ *
+ * Every peer simulates the whole race. The input of a remote player arrives some ticks
+ * late, so it's predicted: the player is assumed to keep the controls of its latest input
+ * received. The race state before each tick is saved (Race::saveState, a flat copy of a few
+ * kilobytes). When an input arrives which differs from the one predicted for its tick, the
+ * next advance() restores the state before that tick and simulates the ticks up to the
+ * present again with the corrected inputs, all within one frame.
+ *
+ * Inputs can be at most MAX_ROLLBACK ticks late. Events of the ticks simulated again
+ * are not published a second time (see Race::setPublishing). The race must not record
+ * or play a replay at the same time.
+ */
+
+class Rollback
+{
+public:
+
+    /// The most ticks rolled back (67 ms at TICK_RATE), and the latest an input can arrive.
+    static const unsigned int MAX_ROLLBACK = 8;
+
+    /// Inputs kept, including the ones that have arrived early.
+    static const unsigned int INPUT_BUFFER = 64;
+
+    /// Simulate race, which has been initialized, with the inputs given to addInput().
+    explicit Rollback(Race& race);
+
+    /// The controls of the player with index (into Race::getVehicles()) on tick, either
+    /// local or received from a peer. Returns false if tick is too old to roll back to
+    /// or too far in the future.
+    bool addInput(int player, unsigned int tick, Controls controls);
+
+    /// Simulate the next tick with the inputs received and predicted, rolling back first
+    /// if an input of a simulated tick was mispredicted. Returns the number of ticks
+    /// simulated again.
+    unsigned int advance();
+
+private:
+
+    // Inputs of all the players on one tick.
+    struct Inputs {
+        unsigned int tick = 0;
+        std::vector<Controls> controls;  // received, or used if not confirmed
+        std::vector<bool> confirmed;     // received
+    };
+
+    // The inputs of tick, cleared if the slot had an older tick.
+    Inputs& getInputs(unsigned int tick);
+
+    // The latest received input of player on or before tick, 0 if there is none.
+    Controls predict(int player, unsigned int tick) const;
+
+    // Save the state before tick, set the inputs and step the race.
+    void simulate(unsigned int tick);
+
+    Race& race;
+    std::size_t players;
+    std::vector<Inputs> inputs;   // ring buffer, index tick % INPUT_BUFFER
+    std::vector<StateBuffer> states; // state before the tick, index tick % MAX_ROLLBACK
+    unsigned int firstTick;        // the first tick simulated by this
+    unsigned int rollbackTick = 0; // the first mispredicted tick, 0 if none
+};
+
+
+#endif
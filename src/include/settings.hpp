@@ -0,0 +1,19 @@
+#ifndef SETTINGS_HPP
+#define SETTINGS_HPP
+
+/*
+ * Settings which are given on the command line and don't change after startup.
+ * Unlike constants.hpp, these are set in main().
+ */
+
+namespace settings {
+    /// Run without a window. Textures, fonts and sounds are not loaded in headless mode,
+    /// only the simulation is run (e.g. verifying a replay). Set before creating a Race.
+    extern bool headless;
+
+    /// Number of AI vehicles, overrides the menu selection if not negative.
+    extern int bots;
+}
+
+
+#endif
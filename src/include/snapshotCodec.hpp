@@ -0,0 +1,162 @@
+#ifndef SNAPSHOT_CODEC_HPP
+#define SNAPSHOT_CODEC_HPP
+
+#include <SFML/Network.hpp>
+#include <vector>
+
+#include "bitStream.hpp"
+#include "netProtocol.hpp"
+
+namespace net {
+
+    /// Counters for the bandwidth and codec time metrics.
+    struct CodecStats {
+        unsigned int snapshots = 0;
+        std::size_t bytes = 0;  // whole SNAPSHOT messages, without UDP/IP headers
+        sf::Int64 micros = 0;   // time spent encoding or decoding
+    };
+
+    /**
+     * Encodes Snapshots for one client (server side) or decodes them (client side).
+     *
+     * Values are quantized to fixed point: positions to 1/8 px, velocities to 1 px/s and
+     * rotations to 12 bits per turn. A snapshot is encoded as the difference to a baseline,
+     * a snapshot the client has acknowledged (the latest tick it has received, sent back in
+     * INPUT). Both sides keep the quantized snapshots of the last HISTORY_SIZE ticks sent,
+     * so they have the same baseline. Without a baseline the snapshot is encoded against
+     * zeros, i.e. in full.
+     *
+     * A snapshot may contain any subset of the vehicles, so a vehicle is compared with the
+     * baseline vehicle with the same ID. If the baseline doesn't have it, e.g. a distant
+     * vehicle that is sent only now and then, the latest snapshot with it that the client has
+     * received is used instead, or it's encoded in full.
+     * The position of a vehicle is predicted from the baseline position and velocity, and
+     * only the error of the prediction is sent. Differences are bit-packed with a 2-bit size
+     * class, so a small change takes a few bits. A vehicle that hasn't changed takes one bit,
+     * and so do the track pickups. Bullets and missiles are short-lived and move every tick,
+     * so they are sent in full at 1 px precision.
+     */
+
+    class SnapshotCodec
+    {
+    public:
+
+        /// Snapshots remembered as baselines (about one second).
+        static const std::size_t HISTORY_SIZE = 64;
+
+        /// Bits of the distance to the baseline of a vehicle missing from the common baseline.
+        static const int DISTANCE_BITS = 6;
+
+        SnapshotCodec();
+
+        /// Server side. Append snapshot to packet, delta compressed against the snapshot
+        /// of tick ackTick if it's still in the history. ackBits tells which of the 32
+        /// snapshots before it the client has received too (see getAckBits()).
+        /// Remembers the snapshot.
+        void encode(const Snapshot& snapshot, sf::Uint32 ackTick, sf::Uint32 ackBits, sf::Packet& packet);
+
+        /// Broadcast side (see SpectatorStream). Append snapshot to packet, delta compressed
+        /// against the remembered snapshot of baseTick, or in full if baseTick is 0 or no
+        /// longer in the history. Vehicles are compared only with that baseline, so every
+        /// receiver who has decoded it can decode this. Don't mix with encode().
+        void encodeBroadcast(const Snapshot& snapshot, sf::Uint32 baseTick, sf::Packet& packet);
+
+        /// Client side. Read a snapshot written by encode() from the rest of packet and
+        /// remember it. Returns false if the message is corrupted or its baseline is no
+        /// longer in the history.
+        bool decode(sf::Packet& packet, Snapshot& snapshot);
+
+        /// Client side. Bit n is set if the snapshot (n + 1) * SNAPSHOT_INTERVAL ticks
+        /// before ackTick has been decoded. Sent with ackTick.
+        sf::Uint32 getAckBits(sf::Uint32 ackTick) const;
+
+        const CodecStats& getStats() const { return stats; }
+
+    private:
+
+        struct QuantizedVehicle {
+            sf::Int32 x = 0;
+            sf::Int32 y = 0;
+            sf::Int32 vx = 0;
+            sf::Int32 vy = 0;
+            sf::Uint16 rotation = 0;
+            sf::Uint8 id = 0;
+            sf::Uint8 hp = 0;
+            sf::Uint8 laps = 0;
+            sf::Uint8 checkpoints = 0;
+            sf::Uint8 place = 0;
+            sf::Uint8 weapons[MAX_WEAPONS] = {};
+        };
+
+        struct QuantizedProjectile {
+            sf::Uint8 type;
+            sf::Uint8 owner;
+            sf::Uint16 x;
+            sf::Uint16 y;
+            sf::Uint8 rotation;
+        };
+
+        struct QuantizedPickup {
+            sf::Uint8 type;
+            sf::Uint16 x;
+            sf::Uint16 y;
+            bool operator==(const QuantizedPickup& other) const {
+                return type == other.type && x == other.x && y == other.y;
+            }
+        };
+
+        struct QuantizedState {
+            bool valid = false;
+            bool acked = false; // server side: the client has received it
+            sf::Uint32 tick = 0;
+            sf::Uint32 clockStartTick = 0;
+            bool started = false;
+            bool ended = false;
+            sf::Uint8 lapsDriven = 0;
+            std::vector<QuantizedVehicle> vehicles;
+            std::vector<QuantizedProjectile> projectiles;
+            std::vector<QuantizedPickup> pickups;
+        };
+
+        // Append snapshot to packet against the remembered snapshot of baseTick and remember it.
+        void encodeAgainst(const Snapshot& snapshot, sf::Uint32 baseTick, sf::Packet& packet);
+
+        static void quantize(const Snapshot& snapshot, QuantizedState& state);
+        static void dequantize(const QuantizedState& state, Snapshot& snapshot);
+
+        // Write state as the difference to base, and read it back.
+        void write(const QuantizedState& state, const QuantizedState& base);
+        bool read(BitReader& reader, QuantizedState& state, const QuantizedState& base);
+
+        void writeDelta(sf::Int32 delta);
+        static sf::Int32 readDelta(BitReader& reader);
+
+        // Server side. Mark the snapshots the client has received and update ackedTicks.
+        void acknowledge(sf::Uint32 ackTick, sf::Uint32 ackBits);
+
+        // Server side. The latest snapshot before tick with vehicle id that the client has
+        // received and still remembers, nullptr if there is none.
+        const QuantizedState* findAcknowledged(sf::Uint8 id, sf::Uint32 tick) const;
+
+        static const QuantizedVehicle* findVehicle(const QuantizedState& state, sf::Uint8 id);
+
+        // Fill baseIndex with the indexes of the vehicles of base.
+        void indexVehicles(const QuantizedState& base);
+
+        // Remembered snapshot of tick, nullptr if it's not in the history.
+        const QuantizedState* findBaseline(sf::Uint32 tick) const;
+        void remember(const QuantizedState& state);
+
+        std::vector<QuantizedState> history;
+        QuantizedState empty; // baseline of a full snapshot, never changed
+        QuantizedState current;
+        BitWriter writer;
+        std::vector<sf::Uint8> buffer;
+        int baseIndex[256]; // index of each vehicle ID in the baseline, -1 if it's not there
+        sf::Uint32 ackedTicks[256]; // latest acknowledged snapshot with each vehicle ID
+        CodecStats stats;
+    };
+}
+
+
+#endif
@@ -8,21 +8,32 @@
 #include <algorithm>
 #include <utility>
 #include <memory>
+#include <random>
+#include <vector>
 
 /*
 Author: Vili Karilas
 	Class implementation is very similar to mainmenu:
 
-	This class contains 2 maps. One with all sounds loaded into memory (soundbuffers) and another to play them.
+	This class contains a map with all sounds loaded into memory (soundbuffers) and a fixed pool of voices to play them.
 	initSound loads a sound in the ../sound/ directory into memory, making it ready to play at any time.
-	
+
+	The number of voices doesn't depend on the number of vehicles or shots:
+	- VOICE_COUNT voices play the one-shot sounds. A sound is not started if it's out of hearing distance.
+	  If all voices are busy, the new sound replaces the least important one (priority, then volume),
+	  or is dropped if it's the least important itself.
+	- ENGINE_VOICES looping voices play the engines of the vehicles closest to the listener (updateEngines).
+	Positional sounds are attenuated and panned by their distance to the listener (the camera).
+
+	In headless mode nothing is loaded and no voices are created, so there is no audio device.
+	All the functions still work and just don't play anything.
 */
 
 // an enum class for different types of sound, making it simpler to manage them
 enum class SoundType
 {
-	ENGINE,		
-	TURBO,	
+	ENGINE,
+	TURBO,
 	GUNSHOT,
 	ROCKET,
 	COLLISION,
@@ -34,6 +45,21 @@ enum class SoundType
 class SoundHandler
 {
 public:
+	/// Number of voices for one-shot sounds.
+	static const std::size_t VOICE_COUNT = 16;
+
+	/// Number of engines heard at the same time.
+	static const std::size_t ENGINE_VOICES = 4;
+
+	/// Sounds farther than this from the listener are not heard (px).
+	static constexpr float HEARING_DISTANCE = 2000;
+
+	/// An engine for updateEngines().
+	struct EngineSource {
+		sf::Vector2f position;
+		float speed;
+	};
+
 	SoundHandler();
 
 	void initSound(SoundType, const std::string&); //add a single sound and allocate it to memory
@@ -41,44 +67,70 @@ public:
 	/// Returns true if the sound exists and is loaded. This could be used for better error handling.
 	bool isSound(SoundType);
 
-	/// Returns the sound specified by its filename. (Type: sf::Sound)
-	/// The sound can be modified. Use this to set looping sounds (engine, etc.)
-	sf::Sound& getSound(SoundType);
-
-	/// Plays the given sound.
+	/// Plays the given sound at the listener (full volume).
 	void playSound(SoundType);
 
+	/// Plays the given sound at position on the track.
+	void playSound(SoundType, const sf::Vector2f& position);
+
 	/// Plays the given sound with a varying pitch.
 	/// Use small numbers (~0.1) when you want a subtle change.
 	/// Use large numbers (1-4) when you want a substantial change.
 	void playRandomPitch(SoundType, float);
-
-	/// PLays the given sound as a loop, if it isn't already playing.
-	void playAsLoop(SoundType);
+	void playRandomPitch(SoundType, float, const sf::Vector2f& position);
 
 	/// Stops a sound.
 	void stopSound(SoundType);
 
 	/// Stops all sounds.
-	void stopAllSound(SoundType);
+	void stopAllSound();
 
 	/// Pauses all sounds (doesn't reset the playing position).
-	void pauseAllSound(SoundType);
+	void pauseAllSound();
 
 	/// See if the sound is currently being played.
 	/// Use this if you have the possibility of multiples of the same sound triggering at the same time.
 	bool isPlaying(SoundType);
 
-	/// Simulates the engine revving. Takes a pitch parameter which is relative to current speed of the vehicle.
-	/// Lower values of pitch (speed/700) indicate longer gearing, higher values (speed/300) indicate short gearing.
-	void revvingSound(SoundType, float);
+	/// Set the position sounds are heard from, i.e. the center of the camera.
+	void setListener(const sf::Vector2f& position) { listener = position; }
+
+	/// Play the engines of the ENGINE_VOICES sources closest to the listener and stop the rest.
+	/// Call once per frame with all the running engines. Reorders sources.
+	/// The pitch simulates the engine revving with the speed.
+	void updateEngines(std::vector<EngineSource>& sources);
+
+	/// Number of voices playing now, engines included.
+	std::size_t getActiveVoices() const;
 
 private:
+	struct Voice {
+		sf::Sound sound;
+		SoundType type = SoundType::BUTTON;
+		int priority = 0;
+	};
+
+	// Start a one-shot sound at position. Volume and panning depend on the distance to the listener.
+	void play(SoundType, const sf::Vector2f& position, float pitch);
+
+	// Free voice or the voice to replace for a sound with priority and volume, nullptr if none.
+	Voice* allocate(int priority, float volume);
+
+	// Volume multiplier 0...1 by distance to the listener.
+	float getAttenuation(const sf::Vector2f& position) const;
+
+	// Set volume and stereo position of sound for a source at position.
+	void place(sf::Sound& sound, float volume, const sf::Vector2f& position) const;
+
 	std::map< SoundType, std::unique_ptr<sf::SoundBuffer>> soundBuffers;
-	std::map< SoundType, sf::Sound> sounds;
+	std::map< SoundType, float> volumes; // full volume of every type, 0...100
+	std::vector<Voice> voices;
+	std::vector<sf::Sound> engines;
+	sf::Vector2f listener;
+	bool nullOutput = false;
+	// Pitch variation only. Not the random engine of the race, so sounds never change the simulation.
+	std::minstd_rand pitchRandom;
 };
 
-//NOTE: Since we're only using a few sounds, we don't really need to remove sf::Sound instances when they're not being played.
-
 
 #endif
@@ -0,0 +1,69 @@
+#ifndef SPATIAL_INDEX_HPP
+#define SPATIAL_INDEX_HPP
+
+#include <vector>
+
+#include "vehicleRegistry.hpp"
+
+class Vehicle;
+
+/**
+ * Index of vehicle positions for weapons that look for targets (see Race::getSpatialIndex).
+ *
+ * The vehicles are hashed to square cells of CELL_SIZE px and kept sorted by cell.
+ * The index is built once per tick, after the vehicles have moved (O(n log n)).
+ * A query looks up only the cells its radius covers, each one with a binary search,
+ * so it's O(log n) for the few cells a weapon range covers instead of a scan of all vehicles.
+ *
+ * Destroyed vehicles are skipped when querying, because vehicles can be destroyed
+ * during the tick after the index was built. Results are sorted by distance and then by ID,
+ * so they don't depend on the order of the vehicles.
+ */
+
+class SpatialIndex
+{
+public:
+
+    /// Size of a cell (px). About the range of a missile.
+    static constexpr double CELL_SIZE = 256;
+
+    /// Index the middle points gathered by registry. The vehicles must live until the next build().
+    void build(const VehicleRegistry& registry);
+
+    void clear() { entries.clear(); }
+    std::size_t size() const { return entries.size(); }
+
+    /// The nearest vehicle within radius of position, nullptr if there is none.
+    /// The vehicle with ID excludeID (e.g. the owner of a missile) is ignored.
+    Vehicle* findNearest(const Vector2D& position, double radius, int excludeID = -1) const;
+
+    /// The k nearest vehicles within radius of position, the nearest first.
+    void findNearest(const Vector2D& position, std::size_t k, double radius,
+            std::vector<Vehicle*>& result, int excludeID = -1) const;
+
+    /// All the vehicles within radius of position, the nearest first.
+    void findWithinRadius(const Vector2D& position, double radius,
+            std::vector<Vehicle*>& result, int excludeID = -1) const;
+
+private:
+
+    struct Entry {
+        unsigned long long cell;
+        Vector2D position;
+        Vehicle* vehicle;
+    };
+
+    // Key of the cell containing position.
+    static unsigned long long getCell(const Vector2D& position);
+    static unsigned long long getCell(long long x, long long y);
+
+    // Append the matching entries to found, sorted by distance.
+    void query(const Vector2D& position, double radius, int excludeID,
+            std::vector<const Entry*>& found) const;
+
+    // Sorted by cell.
+    std::vector<Entry> entries;
+};
+
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef SPECTATOR_LIST_HPP
+#define SPECTATOR_LIST_HPP
+
+#include <SFML/Network.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "netProtocol.hpp"
+
+namespace net {
+
+    /// Counters of SpectatorList::broadcast().
+    struct BroadcastStats {
+        unsigned int messages = 0;
+        std::size_t sends = 0;    // datagrams, one per message and spectator
+        std::size_t bytes = 0;
+        std::size_t dropped = 0;  // the send buffer of the socket was full
+        sf::Int64 micros = 0;     // time spent sending
+    };
+
+    /**
+     * The spectators of a RaceServer or a SpectatorRelay, and sending the same message to
+     * all of them.
+     *
+     * A spectator is added by its first SPECTATE and removed by BYE or when it hasn't sent
+     * SPECTATE for net::TIMEOUT. broadcast() sends one buffer to every spectator as it is:
+     * nothing is copied, encoded or allocated per spectator, so a spectator costs one
+     * system call per message.
+     */
+
+    class SpectatorList
+    {
+    public:
+
+        explicit SpectatorList(std::size_t capacity);
+
+        /// A SPECTATE from address:port. Adds the spectator, or notes that it's still there.
+        /// added tells which. Returns false if the list is full.
+        bool handleSpectate(const sf::IpAddress& address, unsigned short port, bool& added);
+
+        /// Remove the spectator at address:port if it's in the list.
+        void remove(const sf::IpAddress& address, unsigned short port);
+
+        /// Remove the spectators who have been silent for net::TIMEOUT. Returns how many.
+        std::size_t removeSilent();
+
+        /// Send the size bytes at data to every spectator on socket.
+        void broadcast(sf::UdpSocket& socket, const void* data, std::size_t size);
+
+        void broadcast(sf::UdpSocket& socket, const sf::Packet& message)
+        {
+            broadcast(socket, message.getData(), message.getDataSize());
+        }
+
+        std::size_t getCount() const { return spectators.size(); }
+        std::size_t getCapacity() const { return capacity; }
+
+        const BroadcastStats& getStats() const { return stats; }
+
+    private:
+
+        struct Spectator {
+            sf::IpAddress address;
+            unsigned short port;
+            sf::Time lastHeard; // on clock
+        };
+
+        static sf::Uint64 getKey(const sf::IpAddress& address, unsigned short port)
+        {
+            return (static_cast<sf::Uint64>(address.toInteger()) << 16) | port;
+        }
+
+        std::size_t capacity;
+        std::vector<Spectator> spectators; // in no particular order
+        std::unordered_map<sf::Uint64, std::size_t> indexes; // by getKey()
+        sf::Clock clock;
+        BroadcastStats stats;
+    };
+}
+
+
+#endif
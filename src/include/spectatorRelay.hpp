@@ -0,0 +1,90 @@
+#ifndef SPECTATOR_RELAY_HPP
+#define SPECTATOR_RELAY_HPP
+
+#include <SFML/Network.hpp>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "netProtocol.hpp"
+#include "spectatorList.hpp"
+
+/**
+ * Streams a race to many spectators without loading the RaceServer: the relay watches the
+ * race as one spectator of the server and forwards what it gets to its own spectators.
+ *
+ * The WELCOME, KEYFRAME and SNAPSHOT messages of the server (see net::SpectatorStream) are
+ * forwarded unchanged. A datagram is received into one buffer and sent from it to every
+ * spectator (net::SpectatorList::broadcast()), without decoding, encoding or copying it per
+ * spectator. Only the latest WELCOME and KEYFRAME are copied, for the spectators who join
+ * later: they get both at once and can decode the next delta.
+ *
+ * Everything runs in one thread on a non-blocking socket. run() returns when the server
+ * leaves or stops answering. The number of spectators, the bandwidth, the sending time per
+ * spectator and the CPU time are printed every few seconds.
+ */
+
+class SpectatorRelay
+{
+public:
+
+    /// Spectators of a relay unless told otherwise.
+    static const std::size_t DEFAULT_MAX_SPECTATORS = 512;
+
+    /// Relay the race of the server at serverAddress:serverPort to at most maxSpectators
+    /// spectators on port.
+    SpectatorRelay(const sf::IpAddress& serverAddress, unsigned short serverPort, unsigned short port,
+                   std::size_t maxSpectators = DEFAULT_MAX_SPECTATORS);
+
+    SpectatorRelay(const SpectatorRelay&) = delete;
+
+    /// Relay the race. Returns the exit code of the program.
+    int run();
+
+    /// Start listening on the port and subscribe to the server. Returns false if the port
+    /// cannot be used.
+    bool start();
+
+    /// Handle the waiting messages. Returns false when the server has left or stopped
+    /// answering; then call finish().
+    bool update();
+
+    /// Tell the spectators and the server that the relay leaves.
+    void finish();
+
+    const net::SpectatorList& getSpectators() const { return spectators; }
+
+private:
+
+    void handleServerMessage(net::MessageType type, std::size_t size);
+    void handleSpectate(const sf::IpAddress& address, unsigned short port, std::size_t size);
+
+    // Send SPECTATE to the server: again and again until it answers, then as a keep-alive.
+    void subscribe();
+
+    // Print the numbers of the relay since the previous report.
+    void report();
+
+    sf::UdpSocket socket;
+    sf::IpAddress serverAddress;
+    unsigned short serverPort;
+    unsigned short port;
+    net::SpectatorList spectators;
+    std::vector<sf::Uint8> buffer; // the datagram being handled
+    std::vector<sf::Uint8> welcome; // latest WELCOME of the server, empty before it
+    std::vector<sf::Uint8> keyframe; // latest KEYFRAME of the server, empty before it
+    bool serverLeft = false;
+    sf::Clock lastHeard; // from the server
+    sf::Clock subscribeClock;
+    sf::Clock reportClock;
+    sf::Packet packet;
+    net::BroadcastStats reportedStats; // stats at the previous report
+    std::clock_t reportedCpu = 0;
+};
+
+/// Relay the race of the server at host:serverPort on port. Returns the exit code of the program.
+int runSpectatorRelay(const std::string& host, unsigned short serverPort, unsigned short port,
+                      std::size_t maxSpectators);
+
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef SPECTATOR_STREAM_HPP
+#define SPECTATOR_STREAM_HPP
+
+#include <SFML/Network.hpp>
+
+#include "netProtocol.hpp"
+#include "snapshotCodec.hpp"
+
+namespace net {
+
+    /**
+     * Encodes the snapshots of a race once for all its spectators.
+     *
+     * A player gets snapshots encoded for it alone (see RaceServer), delta compressed against
+     * what it has acknowledged. That costs an encode per player and tick, too much for
+     * hundreds of spectators. Spectators don't acknowledge anything. Instead every
+     * KEYFRAME_INTERVAL-th snapshot is a KEYFRAME, encoded in full, and the snapshots between
+     * are SNAPSHOT messages delta compressed against the latest keyframe. Every spectator gets
+     * the same bytes, so the stream can be forwarded as such (see SpectatorRelay).
+     *
+     * A delta depends only on the keyframe, so a lost delta costs nothing more. Whoever lost
+     * the keyframe or joins late needs the keyframe: getKeyframe() is sent to them at once.
+     * The deltas grow as the keyframe gets older, see bench/relayBench.cpp for the sizes.
+     */
+
+    class SpectatorStream
+    {
+    public:
+
+        /// Snapshots from a keyframe to the next (0.5 s). At most SnapshotCodec::HISTORY_SIZE,
+        /// so that the receivers still remember the keyframe.
+        static const unsigned int KEYFRAME_INTERVAL = 30;
+
+        SpectatorStream();
+
+        /// Encode snapshot as the next message of the stream. Spectators have no input,
+        /// so the inputAck of snapshot should be 0.
+        void encode(const Snapshot& snapshot);
+
+        /// The message encoded last, a KEYFRAME or a SNAPSHOT.
+        const sf::Packet& getMessage() const { return *latest; }
+
+        /// The latest KEYFRAME message. Empty before the first encode().
+        const sf::Packet& getKeyframe() const { return keyframe; }
+
+        /// Start again with a keyframe, e.g. when nobody has received the stream for a while.
+        void reset();
+
+        const CodecStats& getStats() const { return codec.getStats(); }
+
+    private:
+
+        SnapshotCodec codec;
+        sf::Packet keyframe;
+        sf::Packet delta;
+        const sf::Packet* latest;
+        sf::Uint32 keyframeTick = 0;
+        unsigned int sinceKeyframe = 0; // snapshots encoded after the keyframe
+    };
+}
+
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Fixed size ring buffer for one producer thread and one consumer thread.
+ *
+ * push() and pop() never lock or allocate. The producer only writes head and the consumer
+ * only writes tail, so both ends are wait-free. Capacity must be a power of two;
+ * one slot is kept empty to tell a full queue from an empty one.
+ */
+
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+
+    /// Add item to the queue. Returns false if the queue is full (the item is dropped).
+    /// Call only from the producer thread.
+    bool push(const T& item)
+    {
+        std::size_t head = this->head.load(std::memory_order_relaxed);
+        std::size_t next = (head + 1) & (Capacity - 1);
+        if (next == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        items[head] = item;
+        this->head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /// Take the oldest item from the queue. Returns false if the queue is empty.
+    /// Call only from the consumer thread.
+    bool pop(T& item)
+    {
+        std::size_t tail = this->tail.load(std::memory_order_relaxed);
+        if (tail == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[tail];
+        this->tail.store((tail + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+private:
+
+    std::array<T, Capacity> items;
+    // On different cache lines, so that the threads don't invalidate each other's line.
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+};
+
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef STATE_BUFFER_HPP
+#define STATE_BUFFER_HPP
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Flat buffer of simulation state, for saving and restoring a race (see Race::saveState
+ * and Rollback).
+ *
+ * Values are copied byte by byte, so only trivially copyable types can be written, and
+ * they are read back in the same order by the same program. It's not a file or network
+ * format. clear() keeps the memory, so saving the same race again doesn't allocate.
+ */
+
+class StateBuffer
+{
+public:
+
+    void clear()
+    {
+        data.clear();
+        readPosition = 0;
+    }
+
+    /// Read from the beginning again.
+    void rewind() { readPosition = 0; }
+
+    std::size_t size() const { return data.size(); }
+
+    template <typename T>
+    void write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "StateBuffer can only copy plain values");
+        std::size_t position = data.size();
+        data.resize(position + sizeof(T));
+        std::memcpy(&data[position], &value, sizeof(T));
+    }
+
+    template <typename T>
+    void read(T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "StateBuffer can only copy plain values");
+        std::memcpy(&value, &data[readPosition], sizeof(T));
+        readPosition += sizeof(T);
+    }
+
+private:
+
+    std::vector<char> data;
+    std::size_t readPosition = 0;
+};
+
+
+#endif
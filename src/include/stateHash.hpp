@@ -0,0 +1,89 @@
+#ifndef STATE_HASH_HPP
+#define STATE_HASH_HPP
+
+#include <SFML/Config.hpp>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "vector2d.hpp"
+
+/**
+ * Hash of the simulation state of a race after one tick, for detecting desyncs between
+ * two simulations of the same race (peers, or a replay and its recording).
+ *
+ * The state is hashed by components: the race status, the track, the random engine and
+ * every vehicle in ID order. A component is hashed from its values, not from memory (no
+ * padding bytes), and doubles by their bits, so two simulations have the same hash only if
+ * every value is bit for bit the same. When the totals differ, comparing the components
+ * tells where the simulations diverged first (see Race::dumpStateComponent).
+ *
+ * The total is incremental: it chains the components of each tick with the total of the
+ * previous tick, so equal totals mean equal states on every tick so far.
+ *
+ * The random engine is 5 kB, so it's hashed only every RNG_INTERVAL ticks. A divergence in
+ * it shows sooner in what it's used for (weapon spawns, oil spills).
+ */
+
+class StateHash
+{
+public:
+
+    /// Components before the vehicles. Vehicle ID i is component FIRST_VEHICLE + i - 1.
+    enum Component {
+        RACE = 0,
+        TRACK = 1,
+        RANDOM_ENGINE = 2,
+        FIRST_VEHICLE = 3
+    };
+
+    /// Ticks between the hashes of the random engine.
+    static const unsigned int RNG_INTERVAL = 32;
+
+    unsigned int tick = 0;
+    sf::Uint64 total = 0;
+    std::vector<sf::Uint64> components;
+
+    /// Name of a component for messages: "race", "track", "random engine" or "vehicle ID".
+    static std::string getComponentName(std::size_t component);
+};
+
+/**
+ * Mixes values into a 64-bit hash one word at a time (see StateHash).
+ */
+
+class StateHasher
+{
+public:
+
+    void add(sf::Uint64 word)
+    {
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 29;
+    }
+
+    void addDouble(double value)
+    {
+        sf::Uint64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        add(bits);
+    }
+
+    void add(const Vector2D& vector)
+    {
+        addDouble(vector.x);
+        addDouble(vector.y);
+    }
+
+    /// Hash the bytes of a plain value, e.g. the random engine.
+    void addBytes(const void* data, std::size_t size);
+
+    sf::Uint64 get() const { return hash; }
+
+private:
+
+    sf::Uint64 hash = 0xCBF29CE484222325ULL;
+};
+
+
+#endif
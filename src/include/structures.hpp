@@ -1,25 +1,23 @@
-/* 
+/*
  * File:   structures.hpp
  * Author: Martin Vidjeskog
  *
  * Created on November 22, 2017, 3:47 PM
- * 
- * Namespace containing datastructures. 
+ *
+ * Namespace containing datastructures.
  */
 
 #ifndef STRUCTURES_HPP
 #define STRUCTURES_HPP
 
+#include "vector2d.hpp"
+
 namespace structures {
 
-    /// struct representing xy-coordinates.
-    struct Point {
-        float x;
-        float y;
-    };
+    /// xy-coordinates. Same type as the physics vectors, only in float.
+    typedef Vector2<float> Point;
 
 }
 
 
 #endif /* STRUCTURES_HPP */
-
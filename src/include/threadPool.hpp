@@ -0,0 +1,65 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Worker threads which run the tasks of a batch in parallel, e.g. one update of every race
+ * on a server (see RaceHost).
+ *
+ * run() gives the indexes 0...count-1 to the workers one at a time, so a worker that
+ * finishes a short task takes the next one and long tasks don't hold up the others.
+ * The thread calling run() works too and returns when every task is done. Tasks of one
+ * batch must not depend on each other.
+ *
+ * Like WriteQueue, this uses the standard library threads for the condition variables.
+ */
+
+class ThreadPool
+{
+public:
+
+    /// Start threads - 1 workers; the caller of run() is the last thread.
+    /// 0 threads: one per hardware thread.
+    explicit ThreadPool(unsigned int threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// Number of threads running the tasks, the caller of run() included.
+    unsigned int getThreadCount() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+    /// Call task(i) for i = 0...count-1 in the threads and wait until all have returned.
+    /// The tasks must not throw.
+    void run(std::size_t count, const std::function<void(std::size_t)>& task);
+
+private:
+
+    // Thread function of a worker. Runs tasks of every batch until stopping is set.
+    void work();
+
+    // Run tasks of the current batch until there are no more. Called with lock held.
+    void runTasks(std::unique_lock<std::mutex>& lock);
+
+    std::mutex mutex;
+    std::condition_variable batchStarted;
+    std::condition_variable batchDone;
+    const std::function<void(std::size_t)>* task = nullptr;
+    std::size_t taskCount = 0;
+    std::size_t nextTask = 0;
+    std::size_t runningTasks = 0;
+    unsigned int batch = 0; // increased by run(), tells the workers that a new batch started
+    bool stopping = false;
+
+    // Declared last, so that the other members exist when the threads start.
+    std::vector<std::thread> workers;
+};
+
+
+#endif
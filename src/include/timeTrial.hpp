@@ -4,6 +4,9 @@
 #include <list>
 
 #include "race.hpp"
+#include "ghost.hpp"
+#include "lapDatabase.hpp"
+#include "writeQueue.hpp"
 
 /*
  * @Author: Miika Karsimus
@@ -13,6 +16,13 @@
  * This class has some extra attributes and functions, which are not declared
  * in the base class.
  *
+ * The best lap of the track is shown as a translucent ghost vehicle. The trajectory of
+ * every lap is recorded (see Ghost) and a faster lap replaces the ghost. The ghost is saved
+ * next to the xml files, one file per track.
+ *
+ * Lap times are stored in the lap database (see LapDatabase). Lap times and ghosts are
+ * written in the background by the write queue, so finishing a lap never waits for the disk.
+ *
  */
 
 
@@ -27,6 +37,9 @@ public:
     
     // Only one vehicle can be added to TimeTrial
     virtual void addVehicle(std::shared_ptr<Vehicle> vehicle) override;
+    
+    /// Calls the base class version and creates the ghost vehicle.
+    virtual void initialize() override;
   
     /// Differs a bit from the base class version.
     virtual void update() override;
@@ -38,29 +51,35 @@ private:
     double bestLapTime = 1000;
     std::list<double> lapTimes; // Currently unused
     
-    std::string filepath;
-    
-    // Define where the lap times file is located and set the path
-    // to filepath variable. The relative path depends on the used IDE/OS.
-    void defineFilePath();
+    // Track name (xml file without .xml) used as the lap database key.
+    std::string trackName;
     
-    // Save the last lap to the file.
-    void saveLastLap();
+    // Best lap of this track and the lap being driven.
+    Ghost ghost;
+    Ghost currentLap;
+    double ghostLapTime = 1000;
+    std::string ghostPath;
+    sf::RectangleShape ghostShape;
     
-    // Get best lap time from the file and store it to the bestLapTime variable.
-    void getBestLapTime();
+    // Lap times and ghosts are saved in the writer thread, because I/O is a slow
+    // operation and our game-loop cannot wait that. The writer is declared before
+    // the database, because the database uses it.
+    WriteQueue writer;
+    LapDatabase lapDatabase;
     
-    // Lap times will be save to the file in a separate thread
-    // because I/O is a slow operation and our game-loop cannot wait that.
-    sf::Thread saveThread;
+    // Define where the lap database is located and open it.
+    // The relative path depends on the used IDE/OS.
+    // Also the ghost file of the track is located here.
+    void defineFilePath(const std::string& xmlfile);
     
-    sf::Text lapTimeText;
+    // Last and best lap time, a text of the HUD.
+    std::size_t lapTimeText = 0;
     
     // These functions are declared as empty in the base class.
     // Functionality is definen in this class.
     virtual void createLapTimeText() override;
     virtual void updateLapTimeText() override;
-    virtual void drawTimeTrialObjects(sf::RenderWindow& window) override;
+    virtual void drawGhost(sf::RenderWindow& window) override;
 };
 
 
@@ -13,41 +13,63 @@
 #include <SFML/Graphics.hpp>
 #include <vector>
 #include <list>
+#include <random>
 
 #include "structures.hpp"
 #include "line.hpp"
 #include "weapon.hpp"
 #include "obstacle.hpp"
+#include "trackData.hpp"
+
+/**
+ * The state of the race track in one race: the weapons waiting to be picked up, the oil
+ * splats and the weapon spawning. The walls, checkpoints and navigation don't change and
+ * are shared with the other races on the same track, see TrackData.
+ */
 
 class Track {
 public:
 
-    /// Constructor.
+    /// Constructor. Uses the shared TrackData of xmlfile (see TrackData::load()).
     Track(const std::string &xmlfile);
 
+    /// Race on trackData.
+    Track(std::shared_ptr<const TrackData> trackData);
+
+    /// The unchanging part of the track, shared with the other races on it.
+    const std::shared_ptr<const TrackData>& getData() const { return data; }
+
     /// Draw the race track. 
     void drawTrack(sf::RenderWindow &window);
 
-    /// Check if player is on finish line.
-    bool isOnFinishLine(const sf::Shape &player) const;
+    /// Simulation tick. Spawns a new weapon when certain time has elapsed.
+    void update();
 
-    /// Check if object is colliding with wall.
-    bool isWallHit(const sf::Shape &object) const;
+    /// Seed the random engine of the race and place the obstacles.
+    /// The same seed gives the same obstacles and weapons.
+    void setSeed(unsigned int seed);
+
+    /// Random engine of the race. Everything random in the simulation must use this.
+    std::mt19937& getRandomEngine() { return rng; }
 
-    /// Set the finish line. 
-    void setFinishLine(const sf::RectangleShape& finishLine);
+    /// Save the state that changes during the race (pickups, weapon spawning and the
+    /// random engine) to state, see Race::saveState(). Walls and obstacles don't change.
+    void saveState(StateBuffer& state) const;
 
-    /// Set walls for track. 
-    void setWalls(const std::vector<sf::RectangleShape> &newWalls);
+    /// Restore the state saved by saveState().
+    void loadState(StateBuffer& state);
 
-    /// Set spawnpoints for track. 
-    void setSpawnpoints(const std::vector<structures::Point> &newPoints);
+    /// Add the pickups and the weapon spawning state to hasher, see Race::hashState().
+    /// The random engine is hashed separately.
+    void hashState(StateHasher& hasher) const;
 
-    /// Set checkpoints for track. 
-    void setCheckpoints(const std::vector<sf::RectangleShape> &newCheckpoints);
+    const std::mt19937& getRandomEngine() const { return rng; }
 
-    /// Set weapon spawnpoints for track. 
-    void setWeaponPoints(const std::vector<structures::Point> &newPoints);
+    /// Check if player is on finish line.
+    bool isOnFinishLine(const sf::Shape &player) const;
+
+    /// Check if object is colliding with wall.
+    bool isWallHit(const sf::Shape &object) const;
 
     /// Get finish line.
     const sf::RectangleShape& getFinishLine() const;
@@ -68,6 +90,18 @@ public:
     /// Get weapon spawnpoints.
     const std::vector<structures::Point>& getWeaponPoints() const;
     
+    /// Get the racing line of the AI. It's built when the track is loaded.
+    const RacingLine& getRacingLine() const { return data->getRacingLine(); }
+    
+    /// Get the navigation grid. Target i is checkpoint i, the last target is the finish line.
+    /// Built at the same time as the racing line.
+    const FlowField& getFlowField() const { return data->getFlowField(); }
+    
+    /// Progress of a lap: whole checkpoints passed plus the share of the way to the next one
+    /// (the finish line after the last checkpoint), measured along the flow field.
+    /// Goes from 0 to getCheckpoints().size() + 1 during a lap.
+    double getLapProgress(unsigned int visitedCheckPoints, const Vector2D& position) const;
+    
     /// Test if rect hits the checkpoint with index.
     bool isCheckpointHit(const sf::RectangleShape& rect, const int& index) const;
     
@@ -93,15 +127,8 @@ public:
 
 private:
 
-    sf::RectangleShape finishLine; // finish line
-    std::vector<sf::RectangleShape> walls; // walls
-    std::vector<structures::Point> spawnPoints; // spawnpoints
-    std::vector<sf::RectangleShape> checkPoints; // points for lap progress and AI
-    std::vector<structures::Point> weaponPoints; // spawn points for weapons
+    std::shared_ptr<const TrackData> data;
     std::vector<Obstacle> obstacles;
-    sf::Texture textureOil;
-    sf::Texture textureFinish; // texture for finish line
-    sf::Texture textureWall; // texture for walls
     
     // Weapons on the track are stored in this container
     // and weapons owned by vehicles are stored in similar container
@@ -112,8 +139,11 @@ private:
     // vector which contains indexes of used spawnpoints.
     std::vector<int> reservedSpawnpoints;
     
-    // time for weapon spawning
-    sf::Clock spawnClock;
+    // simulation time since the last weapon spawn
+    double spawnTime = 0.0;
+    
+    // Random engine of the race. See setSeed().
+    std::mt19937 rng;
     
     // missiles spawned
     int missilesSpawned = 0;
@@ -0,0 +1,93 @@
+#ifndef TRACK_DATA_HPP
+#define TRACK_DATA_HPP
+
+#include <SFML/Graphics.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "structures.hpp"
+#include "racingLine.hpp"
+#include "flowField.hpp"
+
+/**
+ * The part of a race track that never changes during a race: the walls, checkpoints,
+ * finish line and spawn points read from the xml file, the racing line and the flow field
+ * built from them, and the textures.
+ *
+ * Loading a track parses the xml file and builds the flow field, which takes much longer
+ * than the rest of creating a race. load() does it once per file and hands out the same
+ * object to every race on that track, so a server hosting many races has one copy of the
+ * track. The state that changes during a race (pickups, obstacles, the random engine) is
+ * in Track, one per race.
+ *
+ * A shared TrackData is const, so races in different threads can read it at the same time.
+ * A TrackData constructed directly can be changed with the setters before it's given to
+ * a Track.
+ */
+
+class TrackData
+{
+public:
+
+    /// Read the track from xmlfile. Throws XMLException if it cannot be read.
+    /// The textures are not loaded in headless mode.
+    TrackData(const std::string& xmlfile);
+
+    /// The track of xmlfile, shared by all the races on it. The file is read only when no
+    /// race uses the track yet. Can be called from any thread. Throws XMLException.
+    static std::shared_ptr<const TrackData> load(const std::string& xmlfile);
+
+    const sf::RectangleShape& getFinishLine() const { return finishLine; }
+    const std::vector<sf::RectangleShape>& getWalls() const { return walls; }
+    const std::vector<structures::Point>& getSpawnpoints() const { return spawnPoints; }
+    const std::vector<sf::RectangleShape>& getCheckpoints() const { return checkPoints; }
+    const std::vector<structures::Point>& getWeaponPoints() const { return weaponPoints; }
+    const RacingLine& getRacingLine() const { return racingLine; }
+    const FlowField& getFlowField() const { return flowField; }
+
+    /// Driving distance to flow field target i from the previous gate (px).
+    const std::vector<double>& getGateDistances() const { return gateDistances; }
+
+    const sf::Texture& getOilTexture() const { return textureOil; }
+
+    /// Set the finish line. Rebuilds the navigation.
+    void setFinishLine(const sf::RectangleShape& newFinishLine);
+
+    /// Set walls for track. Rebuilds the navigation.
+    void setWalls(const std::vector<sf::RectangleShape>& newWalls);
+
+    /// Set spawnpoints for track.
+    void setSpawnpoints(const std::vector<structures::Point>& newPoints);
+
+    /// Set checkpoints for track. Rebuilds the navigation.
+    void setCheckpoints(const std::vector<sf::RectangleShape>& newCheckpoints);
+
+    /// Set weapon spawnpoints for track.
+    void setWeaponPoints(const std::vector<structures::Point>& newPoints);
+
+private:
+
+    sf::RectangleShape finishLine; // finish line
+    std::vector<sf::RectangleShape> walls; // walls
+    std::vector<structures::Point> spawnPoints; // spawnpoints
+    std::vector<sf::RectangleShape> checkPoints; // points for lap progress and AI
+    std::vector<structures::Point> weaponPoints; // spawn points for weapons
+    RacingLine racingLine;
+    FlowField flowField;
+    std::vector<double> gateDistances;
+    sf::Texture textureOil;
+    sf::Texture textureFinish; // texture for finish line
+    sf::Texture textureWall; // texture for walls
+
+    // The shapes point to the textures of this object.
+    TrackData(const TrackData&) = delete;
+    TrackData& operator=(const TrackData&) = delete;
+
+    // Build the racing line through the finish line and the checkpoints,
+    // and the flow field to them.
+    void buildNavigation();
+};
+
+
+#endif
@@ -3,9 +3,12 @@
 
 #define PI 3.141592654
 
+#include <cmath>
 #include <iostream>
-
-#include "structures.hpp"
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 
 /**
  * Author: Miika Karsimus
@@ -14,133 +17,203 @@
  * Note that most part of the functions are overloaded operators.
  * It makes it easy to use the class. You can, for example, sum two vector by typing v1 + v2
  * or calculate the dot product of two vectors by typing v1 * v2.
- * 
- * The vector can be used for example representing velocity, acceleration, direction or 
+ *
+ * The vector can be used for example representing velocity, acceleration, direction or
  * just a point in xy-space.
+ *
+ * The class is a header-only template, so the compiler can inline every operation.
+ * Arithmetic is constexpr, and the vector is trivially copyable (two plain members, no
+ * user-defined copy or move). Vector2D (double) is used for physics and Point (float,
+ * see structures.hpp) for geometry. They convert to each other with an explicit constructor.
  */
 
 
-class Vector2D
+template <typename T>
+class Vector2
 {
+    static_assert(std::is_floating_point<T>::value, "Vector2 is meant for float and double.");
+
 public:
+    /// Components are uninitialized, like with a plain struct.
+    Vector2() = default;
+
 	/// Pass x and y components as parameters
-    Vector2D(const double& x1, const double& y1);
-    
-    double getLength() const;
-    
+    constexpr Vector2(T x1, T y1) : x(x1), y(y1) { }
+
+    /// Convert from a vector of another precision.
+    template <typename U>
+    constexpr explicit Vector2(const Vector2<U>& v) : x(static_cast<T>(v.x)), y(static_cast<T>(v.y)) { }
+
+    T getLength() const { return std::sqrt(x * x + y * y); }
+
+    /// Squared length. Cheaper than getLength() when only comparing lengths.
+    constexpr T getLengthSquared() const { return x * x + y * y; }
+
     // Self-explanatory functions.
-    inline const double& getX() const { return x; }
-    inline const double& getY() const { return y; }
-    inline void setX(double x1) { x = x1; }
-    inline void setY(double y1) { y = y1; }
-   
+    constexpr const T& getX() const { return x; }
+    constexpr const T& getY() const { return y; }
+    constexpr void setX(T x1) { x = x1; }
+    constexpr void setY(T y1) { y = y1; }
+
     /// Rotate the vector clockwise (direction in SFML coordinate frame).
-    void rotate(double degs);
+    void rotate(T degs)
+    {
+        T rads = deg2rad(degs);
+        T c = std::cos(rads);
+        T s = std::sin(rads);
+        T x2 = x * c - y * s;
+        y = x * s + y * c;
+        x = x2;
+    }
 
     /// Mirror the vector about x or y-axis.
-    void mirror(const char& c);
-    
+    constexpr void mirror(char c)
+    {
+        if (c == 'x')
+            y = -y;
+        else if (c == 'y')
+            x = -x;
+    }
+
     /// Mirror the vector about and arbitrary vector.
     /// E.g. [0, 1] mirrored about [1, 1] yields [1, 0].
-    void mirror(const Vector2D& vector);
-    
+    void mirror(const Vector2& vector)
+    {
+        // Param. vector is the "mirror surface."
+        rotate(-2 * angleBetween(vector, *this));
+    }
+
     /// Returns a string representation of the vector.
-    std::string str() const;
+    std::string str() const
+    {
+        std::stringstream ss;
+        ss << *this;
+        return ss.str();
+    }
 
     /// Return an unit vector parallel to this vector.
-    Vector2D getUnitVector() const;
-    
+    Vector2 getUnitVector() const
+    {
+        Vector2 unitVector = *this / getLength();
+        T length = unitVector.getLengthSquared();
+        if (length < T(0.98) || length > T(1.02))
+            throw std::runtime_error("Invalid unit vector.");
+        return unitVector;
+    }
+
     /// Get unit vector which angle is degs degrees relative to x-axis.
     /// e.g. calling with parameter 45 would result [0.707, 0.707].
-    static Vector2D getUnitVector(const double& degs);
-    
-    
+    static Vector2 getUnitVector(T degs)
+    {
+        T rads = deg2rad(degs);
+        return Vector2(std::cos(rads), std::sin(rads));
+    }
+
     /// Get vector which is the normal of mirrorVector. Direction depends on v1.
-    static Vector2D getMirrorNormal(Vector2D& v1, const Vector2D& mirrorVector);
-    
+    static Vector2 getMirrorNormal(const Vector2& v1, const Vector2& mirrorVector)
+    {
+        T angle1 = angleBetween(mirrorVector, v1);
+        if (angle1 > 0)
+            angle1 = 180 + angle1;
+        return rotated(v1, -angle1 + 90);
+    }
+
     /// Convert degrees to radians.
-    static double deg2rad(const double& degs);
-    
+    static constexpr T deg2rad(T degs) { return T(PI) * degs / 180; }
+
     /// Convert radians to degrees.
-    static double rad2deg(const double& rads);
-    
+    static constexpr T rad2deg(T rads) { return 180 * rads / T(PI); }
+
     /// Return angle between vector and x-axis.
-    static double axisAngle(const Vector2D& v);
-    
-    /// Move point to the direction of the vector and return a new Point.
+    static T axisAngle(const Vector2& v)
+    {
+        // vector [1, 0] is parallel to x-axis
+        return angleBetween(v, Vector2(1, 0));
+    }
+
+    /// Move point to the direction of the vector and return a new point.
     /// E.g. calling with {2, 1}, {5, 7} yields {7, 8}.
-    static structures::Point movePoint(const structures::Point& point, const Vector2D& v);
-    
+    template <typename U>
+    static constexpr Vector2<U> movePoint(const Vector2<U>& point, const Vector2& v)
+    {
+        return point + Vector2<U>(v);
+    }
+
     /// Return a new rotated vector. Doesn't affect this vector.
     /// Note the difference between this and the member-function rotate.
-    static Vector2D rotated(const Vector2D& v, double degs);
-    
+    static Vector2 rotated(const Vector2& v, T degs)
+    {
+        Vector2 v2 = v;
+        v2.rotate(degs);
+        return v2;
+    }
+
     /// Tell if two vector are parallel.
-    static bool isParallel(const Vector2D& v1, const Vector2D& v2);
-    
-    /// Return the angle between two vectors in degrees.
-    static double angleBetween(const Vector2D& v1, const Vector2D& v2);
-    
-    /// Determinant between two vector. Needed by the angleBetween() function.
-    static double determinant(const Vector2D& v1, const Vector2D& v2);
-
-private:
-	double x; // x-component
-    double y; // y-component
-
-// The following functions are declared as friends in order to
-// access the private members x and y.
-friend std::ostream& operator<<(std::ostream& os, const Vector2D& v);
-friend double operator*(const Vector2D& v1, const Vector2D& v2);
-friend Vector2D operator*(const Vector2D& v1, double coeff);
-friend Vector2D operator/(const Vector2D& v1, double coeff);
-friend Vector2D operator+(const Vector2D& v1, const Vector2D& v2);
-friend Vector2D operator-(const Vector2D& v1, const Vector2D& v2);
-friend Vector2D operator-(const Vector2D& v);
-
-friend class VehiclePhysics;
-};
+    static constexpr bool isParallel(const Vector2& v1, const Vector2& v2)
+    {
+        // Two vectors are parallel if their dot product is zero.
+        return v1 * v2 == 0;
+    }
 
+    /// Return the angle between two vectors in degrees.
+    static T angleBetween(const Vector2& v1, const Vector2& v2)
+    {
+        // Direction is clockwise (same as the angle directon of SFML)
+        return rad2deg(std::atan2(determinant(v1, v2), v1 * v2));
+    }
 
-// overloaded operators
+    /// Determinant between two vector. Needed by the angleBetween() function.
+    static constexpr T determinant(const Vector2& v1, const Vector2& v2)
+    {
+        return v1.x * v2.y - v1.y * v2.x;
+    }
 
-/// Print vector to stdout.
-std::ostream& operator<<(std::ostream& os, const Vector2D& v);
+    // overloaded operators
+    // They are defined as friends here, so that scalars of any arithmetic type
+    // convert to T without template deduction failures.
 
+    /// Print vector to stdout.
+    friend std::ostream& operator<<(std::ostream& os, const Vector2& v)
+    {
+        os << "[" << v.x << ", " << v.y << "]";
+        return os;
+    }
 
-// Dot product with another vector. Returns scalar (double).
-double operator*(const Vector2D& v1, const Vector2D& v2);
+    /// Dot product with another vector. Returns scalar.
+    friend constexpr T operator*(const Vector2& v1, const Vector2& v2) { return v1.x * v2.x + v1.y * v2.y; }
 
-/// Product with a floating point number.
-Vector2D operator*(const Vector2D& v1, double coeff);
+    /// Product with a floating point number.
+    friend constexpr Vector2 operator*(const Vector2& v, T coeff) { return Vector2(v.x * coeff, v.y * coeff); }
 
-/// Divide vector with floating point number.
-Vector2D operator/(const Vector2D& v1, double coeff);
+    /// Divide vector with floating point number.
+    friend constexpr Vector2 operator/(const Vector2& v, T coeff) { return Vector2(v.x / coeff, v.y / coeff); }
 
-/// Sum two vectors.
-Vector2D operator+(const Vector2D& v1, const Vector2D& v2);
+    /// Sum two vectors.
+    friend constexpr Vector2 operator+(const Vector2& v1, const Vector2& v2) { return Vector2(v1.x + v2.x, v1.y + v2.y); }
 
-/// Substraction of two vectors.
-Vector2D operator-(const Vector2D& v1, const Vector2D& v2);
+    /// Substraction of two vectors.
+    friend constexpr Vector2 operator-(const Vector2& v1, const Vector2& v2) { return Vector2(v1.x - v2.x, v1.y - v2.y); }
 
-/// Unary operator.
-Vector2D operator-(const Vector2D& v);
+    /// Unary operator.
+    friend constexpr Vector2 operator-(const Vector2& v) { return Vector2(-v.x, -v.y); }
 
+    constexpr Vector2& operator+=(const Vector2& v) { x += v.x; y += v.y; return *this; }
+    constexpr Vector2& operator-=(const Vector2& v) { x -= v.x; y -= v.y; return *this; }
+    constexpr Vector2& operator*=(T coeff) { x *= coeff; y *= coeff; return *this; }
+    constexpr Vector2& operator/=(T coeff) { x /= coeff; y /= coeff; return *this; }
 
+    friend constexpr bool operator==(const Vector2& v1, const Vector2& v2) { return v1.x == v2.x && v1.y == v2.y; }
+    friend constexpr bool operator!=(const Vector2& v1, const Vector2& v2) { return !(v1 == v2); }
 
+	T x; // x-component
+    T y; // y-component
+};
 
+/// Vector used by the physics.
+typedef Vector2<double> Vector2D;
 
+static_assert(std::is_trivially_copyable<Vector2<float>>::value, "Vector2 must stay trivially copyable.");
+static_assert(std::is_trivially_copyable<Vector2<double>>::value, "Vector2 must stay trivially copyable.");
 
 
 #endif
-
-
-
-
-
-
-
-
-
-
-
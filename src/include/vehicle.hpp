@@ -7,8 +7,10 @@
 #include <deque>
 
 #include "vehiclePhysics.hpp"
+#include "vehicleRegistry.hpp"
 #include "weapon.hpp"
 #include "bullet.hpp"
+#include "controls.hpp"
 
 /**
  * Author: Miika Karsimus
@@ -17,6 +19,9 @@
  * while this class contains general features of vehicles.
  * Vehicle is drawn as a rectangle shape.
  *
+ * The physics, HP and race progress are components in a VehicleRegistry, which the
+ * vehicle reaches by its entity. The other members are kept in the vehicle.
+ *
  *
  *
  *----------------------------------------------------
@@ -37,6 +42,9 @@
  * Vehicle also brakes automatically if throttle is not used (simulates friction) but in that case,
  * deceleration is slower.
  *
+ * Keyboard events don't move the vehicle directly. They only update the input controls
+ * (see controls.hpp), which Race::step() applies once per simulation tick.
+ *
  *----------------------------------------------------
  *
  * Move vehicle towars its front by calling physics.accelerate() function.
@@ -65,10 +73,17 @@ public:
     
     virtual ~Vehicle();
     
-    /// Use these to access private variables physics and shape.
-    VehiclePhysics& getPhysics();
+    /// Use these to access the physics component and the shape.
+    VehiclePhysics& getPhysics() { return registry->getPhysics()[entity]; }
+    const VehiclePhysics& getPhysics() const { return registry->getPhysics()[entity]; }
     sf::RectangleShape& getShape();
     
+    /// Move the components of the vehicle to registry. Race::initialize() moves the vehicles
+    /// in ID order, so that the entity is ID - 1.
+    void moveTo(const std::shared_ptr<VehicleRegistry>& registry);
+    
+    std::size_t getEntity() const { return entity; }
+    
     // Must return a reference because unique_ptr cannot be copied.
     std::vector<std::unique_ptr<Weapon>>& getWeapons();
     
@@ -89,9 +104,7 @@ public:
     /// Remove the first (the oldest) weapon from the contaner.
     void removeWeapon();
     
-    sf::Sprite& getExplosionSprite();
-    
-    const int& getHP() const;
+    const int& getHP() const { return getHealth().hp; }
     
     /// Returns true if HP is 0.
     bool isDestroyed() const;
@@ -110,22 +123,21 @@ public:
     /// Draw the vehicle on the window.
     void drawVehicle(sf::RenderWindow& window);
     
-    /// Draw acc, vel, rot etc. onto screen as string form.
-    /// Not used in the final version.
-    void drawText(sf::RenderWindow& window);
-    
-    /// Initialize drawable status text. See cpp file.
-    void createStatusText();
-    
     /// Handle keyboard events to control car moving.
+    /// Updates the input controls, which are applied on the next simulation tick.
     void handleEvents(sf::Event& event, EventKeys keys);
     
+    /// Controls set by the keyboard (or by a replay). FIRE is set by Race::handleWeaponEvents.
+    Controls getInputControls() const { return inputControls; }
+    void setInputControls(Controls controls) { inputControls = controls; }
+    
+    /// Apply controls of this tick to the physics. Call once per simulation tick.
+    /// Returns the controls that were pressed on this tick (i.e. not on the previous one).
+    Controls applyControls(Controls newControls);
+    
     /// Draw acceleration vector to window. It is just a thin line.
     void drawVector(sf::RenderWindow& window);
     
-    // Status text is not used in the final version.
-    void updateTextPosition(const sf::Vector2f& centerPoint);
-    
     // Set unique ID to Vehicle.
     void setID(const int id);
     
@@ -135,65 +147,88 @@ public:
     bool hasWeapon(Weapon::WeaponType type);
     
     // The number of checkpoints visited during this lap.
-    unsigned int visitedCheckPoints = 0;
-    
-    // The last visited checkpoint. nullptr by default
-    // Note that this is NOT a const pointer, but the object this points to is const.
-    // i.e. non-const pointer to const value.
-    // So you can assing this to point another object later.
-    const sf::RectangleShape *lastCheckpoint = nullptr;
+    unsigned int getVisitedCheckPoints() const { return getProgress().visitedCheckPoints; }
+    void setVisitedCheckPoints(unsigned int count) { getProgress().visitedCheckPoints = count; }
     
     /// Tell if all the checkpoints are passed during this lap.
     /// Call this, when the vehicle passes the finnish line.
     bool allCheckpointsPassed(const Track& track) const;
     
-    const int& getRacePlace() const { return racePlace; }
+    const int& getRacePlace() const { return getProgress().racePlace; }
     
     // Set race place. Leader has place 1.
     void setRacePlace(const int p);
     
-    const int& getLaps() const { return laps; }
+    const int& getLaps() const { return getProgress().laps; }
+    
+    void increaseLapCount() { getProgress().laps++; }
+    
+    /// Overwrite the simulation state with a state received from the server (see RaceClient).
+    void setRemoteState(const Vector2D& position, double rotation, const Vector2D& velocity,
+                        int hp, int lapCount, unsigned int checkpoints);
+    
+    /// Set the state received from the server except for the physics, which the local
+    /// player predicts (see ClientPrediction).
+    void setRemoteStatus(int hp, int lapCount, unsigned int checkpoints);
+    
+    /// Everything applyControls() and update() change. Copying it is cheap, so
+    /// ClientPrediction saves it after every predicted tick.
+    struct LocalState {
+        VehiclePhysics physics;
+        Controls controls;
+        bool isAccelerating;
+    };
+    
+    LocalState saveLocalState() const { return {getPhysics(), controls, isAccelerating}; }
     
-    void increaseLapCount() { laps++; }
+    /// Restore a saved state and move the shape with it.
+    void restoreLocalState(const LocalState& state);
     
-	// For sound handling. Set true when hp drops to 0.
-	bool destroyedFlag = false;
+    /// Save the simulation state kept in the vehicle (controls, weapons and bullets) to state.
+    /// The components are saved by VehicleRegistry::saveState(), see Race::saveState().
+    virtual void saveState(StateBuffer& state) const;
+    
+    /// Restore the state saved by saveState() and move the shape with the physics, which
+    /// must have been restored first.
+    virtual void loadState(StateBuffer& state);
+    
+    /// Add the simulation state to hasher, see Race::hashState().
+    virtual void hashState(StateHasher& hasher) const;
+    
+    /// Sync the shape with the physics. Race::update() moves the shapes after the physics.
+    void syncShape() { sync(); }
 
 
 protected:
     // Derived classes can use these directly.
-    VehiclePhysics physics;
     sf::RectangleShape shape;
     
+    // Sync member variable shape to have same values (position, rotatation, etc..) as physics
+    // Check the method in cpp file to understand what it actually does
+    virtual void sync();
+    
 private:
     
-    // Amount of HP. Not used yet.
-    int HP = 150;
+    VehicleRegistry::Health& getHealth() { return registry->getHealth()[entity]; }
+    const VehicleRegistry::Health& getHealth() const { return registry->getHealth()[entity]; }
+    VehicleRegistry::Progress& getProgress() { return registry->getProgress()[entity]; }
+    const VehicleRegistry::Progress& getProgress() const { return registry->getProgress()[entity]; }
+    
+    // Registry of the components and the index of this vehicle in it.
+    std::shared_ptr<VehicleRegistry> registry;
+    std::size_t entity;
     
     // ID of the vehicle. Each vehicle should have an unique ID.
     int ID;
     
-    sf::Text statusText;
-    // Texture object must be alive as long as texture is used.
-    // That is why this is a member variable. 
-    sf::Texture vehicleTexture;
-    sf::Texture explosionTexture; // Booom!!!!
-    sf::Sprite explosionSprite;
-    
-    
-    // Note that font object must be alive as long as the text with this font
-    // is drawn onto screen. Otherwise segmentation fault will arise.
-    // This is the reason that font is a member variable instead of a local variable
-    // in createStatusText() function.
-    sf::Font textFont; // will be loaded from file
-    
     // For event handling
     bool isAccelerating = false;
     
-    // Sync member variable shape to have same values (position, rotatation, etc..) as physics
-    // Check the method in cpp file to understand what it actually does
-    // Note that this is a private function
-    virtual void sync();
+    // Controls from the keyboard, not applied yet.
+    Controls inputControls = 0;
+    
+    // Controls applied on the latest tick.
+    Controls controls = 0;
     
     /// Container to store all picked weapons.
     std::vector<std::unique_ptr<Weapon>> weapons;
@@ -203,12 +238,6 @@ private:
     // I.e. push back, pop front
     std::deque<Bullet> bullets;
     
-    // Place in the race. -1 by default;
-    int racePlace = -1;
-    
-    // How many laps are driven.
-    int laps = 0;
-    
 
     
 };
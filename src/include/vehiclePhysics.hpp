@@ -2,9 +2,10 @@
 #define DYNAMIC_OBJECT_HH
 
 #include <iostream>
-#include <SFML/Graphics.hpp> // Needed by sf::Clock
+#include <SFML/Graphics.hpp>
 
 #include "vector2d.hpp"
+#include "physicsMath.hpp"
 #include "line.hpp"
 #include "track.hpp"
 
@@ -16,12 +17,16 @@
  * This class includes physical features of a vehicle.
  * The class has properties, such as position, velocity,
  * acceleration, angular velocity and rotation. The object calucalates its position based on
- * elapsed time (sf::Clock is used). If you want to move the object, you should set a desired
+ * elapsed simulation time. If you want to move the object, you should set a desired
  * acceleration to the object, using accelerate() function. Also position can be set directly,
  * meaning that the object "teleports".
  *
- * Note: Every VehiclePhysics has its own clock.
- * Clock is a private attribute and any other class don't have to access to it.
+ * Note: Every VehiclePhysics keeps its own simulation time, which is advanced by TICK_TIME
+ * in updatePosition(). Wall clock time is never used, so the same inputs on the same ticks
+ * always give the same result (needed by replays).
+ *
+ * The state is kept in physmath::Real, double or Fixed depending on the build (see
+ * physicsMath.hpp). The getters and setters are in doubles in both.
  *
  *----------------------------------------
  * How to use this class properly:
@@ -55,14 +60,18 @@ public:
         STOP = 2
     };
     
-    inline const Vector2D& getPosition() const { return position; }
-    inline const double& getX() const { return position.getX(); }
-    inline const double& getY() const { return position.getY(); }
-    inline const Vector2D& getVelocity() const { return velocity; }
-    inline const Vector2D& getAcceleration() const { return acceleration; }
-    inline const double& getAngularVelocity() const { return angularVelocity; }
-    inline const double& getAngularAcceleration() const { return angularAcceleration; }
-    inline const double& getRotation() const { return rotation; }
+    inline Vector2D getPosition() const { return physmath::toVector2D(position); }
+    inline double getX() const { return physmath::toDouble(position.getX()); }
+    inline double getY() const { return physmath::toDouble(position.getY()); }
+    inline Vector2D getVelocity() const { return physmath::toVector2D(velocity); }
+    inline Vector2D getAcceleration() const { return physmath::toVector2D(acceleration); }
+    inline double getAngularVelocity() const { return physmath::toDouble(angularVelocity); }
+    inline double getAngularAcceleration() const { return physmath::toDouble(angularAcceleration); }
+    inline double getRotation() const { return physmath::toDouble(rotation); }
+    
+    /// Unit vector towards the nose of the vehicle. It's recalculated only when the
+    /// rotation has changed since the last call, so calling this is cheap.
+    inline Vector2D getHeading() const { return physmath::toVector2D(getHeadingVector()); }
     inline const int& getHeight() const { return height; }
     inline const int& getWidth() const { return width; }
     
@@ -82,6 +91,14 @@ public:
     /// Works only if locked velocity is false.
     void setRotation(double degs);
     
+    /// Set position, rotation and velocity at once, without any acceleration or rotating.
+    /// Used when the vehicle is moved by something else than the physics (see AIVehicle).
+    void setState(const Vector2D& pos, double degs, const Vector2D& vel);
+    
+    /// Set position, rotation and velocity, but keep accelerating and turning as before.
+    /// Used to correct a predicted state with the state from the server (see ClientPrediction).
+    void correctState(const Vector2D& pos, double degs, const Vector2D& vel);
+    
     /// Set acceleration towards the nose of the vehicle.
     /// Basic interface for manipulating the acceleration of the object.
     void accelerate();
@@ -99,7 +116,7 @@ public:
     /// Reverse with vehicle.
     void reverse();
     
-    /// Updates the position of the object based on elapsed time.
+    /// Advance the simulation time by one tick (TICK_TIME) and update the position.
     void updatePosition();
     
     /// Fix velocity direction when collision occurs. Param. shape is vehicle shape.
@@ -121,31 +138,51 @@ public:
     
     
 private:
+    typedef physmath::Real Real;
+    typedef physmath::Vector Vector;
+
     int width;
     int height;
     
     // Quantities are initialized to zero-vectors
-    Vector2D position = {0.0, 0.0};
-    Vector2D velocity = {0.0, 0.0};
-    Vector2D acceleration = {0.0, 0.0};
+    Vector position = {0, 0};
+    Vector velocity = {0, 0};
+    Vector acceleration = {0, 0};
+    
+    Real rotation = 0;
     
-    double rotation = 0.0;
+    // Cache of getHeading(): unit vector of headingRotation.
+    mutable Vector heading = {1, 0};
+    mutable Real headingRotation = 0;
     
     int movingState = MovingState::STOP;
     
     /// Positive direction of angle is clockwise. Unit is deg/s.
-    double angularVelocity = 0.0;
+    Real angularVelocity = 0;
     
-    double angularAcceleration = 0.0;
+    Real angularAcceleration = 0;
     
     /// Reference variables, used by updatePosition function.
     /// In order to calculate the current position, you have to know x0, y0 and v0
     /// because s = s0 + v0 * t + 0.5 * a * t^2.
-    double pos_x0 = 0.0;
-    double pos_y0 = 0.0;
-    Vector2D vel0 = {0.0, 0.0};
-    double rot0 = 0.0;
-    double angVel0 = 0.0;
+    Real pos_x0 = 0;
+    Real pos_y0 = 0;
+    Vector vel0 = {0, 0};
+    Real rot0 = 0;
+    Real angVel0 = 0;
+    
+    const Vector& getHeadingVector() const {
+        if (rotation != headingRotation) {
+            heading = Vector::getUnitVector(rotation);
+            headingRotation = rotation;
+        }
+        return heading;
+    }
+    
+    // The setters without conversion from double.
+    void changeAcceleration(const Vector& acc);
+    void changeVelocity(const Vector& vel);
+    void changeAngularVelocity(Real angVel);
     
     /// Reset reference variables to correspond current values
     /// x0 = position.x, y0 = position.y and so on.
@@ -153,13 +190,13 @@ private:
     /// that, for example, if you change the acceleration of the object, reset is called.
     void reset();
     
-    // The position if calculated using this clock.
+    // Simulation time (s) since the last reset(). The position is calculated using this.
     // Restarted every time the acceleration changes.
-    sf::Clock clock;
-    // Clock which tells the duration of the last collision.
-    sf::Clock collisionClock;
-    // Clock which tells the duration of the last reset() call.
-    sf::Clock resetClock;
+    Real elapsedTime = 0;
+    // Simulation time since the last collision. Large at start, i.e. no recent collision.
+    Real collisionTime = 1000;
+    // Simulation time since the last fixDirections() call.
+    Real fixTime = 0;
     
     // Test if the velocity reaches zero.
     // old velocity: x1 and y1, new velocity: x2 and y2
@@ -167,14 +204,14 @@ private:
     bool checkVelocitySign(double x1, double y1, double x2, double y2);
     
     /// Update angle based on elapsed time and angular velocity.
-    void updateAngle(double& time);
+    void updateAngle(Real& time);
     
     /// Adjust velocity and acceleration direction to correspond rotation.
     /// Call every time when rotation changes.
     void fixDirections();
     
     // Currently unused.
-    double rotateTime;
+    Real rotateTime = 0;
     
     
 };
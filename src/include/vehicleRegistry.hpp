@@ -0,0 +1,84 @@
+#ifndef VEHICLE_REGISTRY_HPP
+#define VEHICLE_REGISTRY_HPP
+
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+
+#include "vehiclePhysics.hpp"
+#include "stateBuffer.hpp"
+
+class Vehicle;
+
+/**
+ * The hot simulation state of the vehicles in dense component arrays (see Race::step).
+ *
+ * An entity is an index: in a race the players first, then the bots, i.e. the vehicle ID - 1.
+ * Each component is a separate array indexed by entity, and the stages which go through
+ * every vehicle on every tick (physics, collisions, laps, standings, saving) loop over
+ * the arrays instead of following a pointer to every Vehicle.
+ *
+ * A Vehicle holds its entity and reaches its components through the registry. A new
+ * vehicle has a registry of its own. Race::initialize() moves the vehicles to the race's
+ * registry in ID order (see Vehicle::moveTo). Weapons, bullets, controls and the shape
+ * stay in the Vehicle.
+ */
+
+class VehicleRegistry
+{
+public:
+
+    struct Health {
+        int hp;
+        bool destroyedFlag; // set when hp drops to 0, see Race::publishDestroyed
+    };
+
+    struct Progress {
+        int laps;
+        unsigned int visitedCheckPoints; // during this lap
+        int racePlace;                   // the leader has place 1, -1 before the first standings
+        double distance;                 // driven in the race, see Race::updateStandings
+    };
+
+    /// Add the components of vehicle. Returns its entity.
+    std::size_t add(Vehicle* vehicle, const VehiclePhysics& physics, const Health& health, const Progress& progress);
+
+    std::size_t size() const { return objects.size(); }
+
+    Vehicle& getVehicle(std::size_t entity) const { return *objects[entity]; }
+
+    std::vector<VehiclePhysics>& getPhysics() { return physics; }
+    const std::vector<VehiclePhysics>& getPhysics() const { return physics; }
+    std::vector<Health>& getHealth() { return health; }
+    const std::vector<Health>& getHealth() const { return health; }
+    std::vector<Progress>& getProgress() { return progress; }
+    const std::vector<Progress>& getProgress() const { return progress; }
+
+    /// Copy the middle points and the bounding boxes of the shapes. Call when the vehicles
+    /// have moved; the spatial index and the hitbox history are built from these.
+    void gather();
+
+    /// Middle point of each shape (see AIVehicle::getMiddlePoint) and its bounding box.
+    const std::vector<Vector2D>& getCenters() const { return centers; }
+    const std::vector<sf::FloatRect>& getBounds() const { return bounds; }
+
+    /// Entities by race place, the leader first.
+    std::vector<std::size_t>& getStandings() { return standings; }
+    const std::vector<std::size_t>& getStandings() const { return standings; }
+
+    /// Save and restore the components (see Race::saveState). The entities must be the same.
+    void saveState(StateBuffer& state) const;
+    void loadState(StateBuffer& state);
+
+private:
+
+    std::vector<Vehicle*> objects;
+    std::vector<VehiclePhysics> physics;
+    std::vector<Health> health;
+    std::vector<Progress> progress;
+    std::vector<Vector2D> centers;
+    std::vector<sf::FloatRect> bounds;
+    std::vector<std::size_t> standings;
+};
+
+
+#endif
@@ -2,8 +2,12 @@
 #define WEAPON_HH
 
 #include "SFML/Graphics.hpp"
+#include <memory>
+#include <random>
 #include "soundhandler.hpp"
 #include "structures.hpp"
+#include "stateBuffer.hpp"
+#include "stateHash.hpp"
 
 /*
  * Abstract base class for weapons.
@@ -55,8 +59,9 @@ public:
     virtual void drawWeapon(sf::RenderWindow& window) const;
     
     /// Sen position of the shape to a random spawn point
-    /// which is read from the Track class.
-    virtual void setSpawnPoint(const std::vector<structures::Point>& points, std::vector<int>& reserved);
+    /// which is read from the Track class. Param. rng is the random engine of the race.
+    virtual void setSpawnPoint(const std::vector<structures::Point>& points, std::vector<int>& reserved,
+                               std::mt19937& rng);
     sf::RectangleShape& getShape();
 
     /// Check if weapon is already used.
@@ -67,8 +72,14 @@ public:
     
     WeaponType getType() const;
     
+    /// Create a Gun, Turbo or MissileLauncher. Returns nullptr for UNDEFINED.
+    /// Used by network clients to rebuild the weapons of a snapshot.
+    static std::unique_ptr<Weapon> create(WeaponType type);
+    
     /// Get random number between low and high (including them).
-    static int getRandomNumber(int low, int high);
+    /// Use the random engine of the race (see Track::getRandomEngine()), so that
+    /// the race can be replayed with the same seed.
+    static int getRandomNumber(int low, int high, std::mt19937& rng);
     
     /// Initialize weapon controls
     virtual void initializeControls(Vehicle* vehicle, Race *race){};
@@ -76,6 +87,22 @@ public:
     /// Get Missile
     virtual Missile* getMissile() {return NULL;}
     
+    /// Save the simulation state to state, see Race::saveState(). The type is not saved.
+    virtual void saveState(StateBuffer& state) const;
+    
+    /// Restore the state saved by saveState() of a weapon of the same type.
+    virtual void loadState(StateBuffer& state);
+    
+    /// Add the type and simulation state to hasher, see Race::hashState().
+    virtual void hashState(StateHasher& hasher) const;
+    
+    /// Save the types and states of weapons.
+    static void saveWeapons(const std::vector<std::unique_ptr<Weapon>>& weapons, StateBuffer& state);
+    
+    /// Restore weapons saved by saveWeapons(). The weapons of the same type are reused,
+    /// the others are created again.
+    static void loadWeapons(std::vector<std::unique_ptr<Weapon>>& weapons, StateBuffer& state);
+    
 protected:
     // Weapon icon that appears on the track.
     sf::RectangleShape shape;
@@ -84,7 +111,7 @@ protected:
 
     bool isUsing = false;
     bool isUsed = false;
-    float timer;
+    float timer = 0;
     
     WeaponType type = UNDEFINED;
 };
@@ -0,0 +1,52 @@
+#ifndef WRITE_QUEUE_HPP
+#define WRITE_QUEUE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * A single background thread, which runs file writing jobs one at a time in the order
+ * they were pushed. The game loop never waits for I/O: push() only adds the job to the queue.
+ *
+ * SFML has no condition variable, so this uses the standard library threads instead of sf::Thread.
+ * The destructor finishes all the queued jobs before returning.
+ */
+
+class WriteQueue
+{
+public:
+
+    WriteQueue();
+    ~WriteQueue();
+
+    WriteQueue(const WriteQueue&) = delete;
+    WriteQueue& operator=(const WriteQueue&) = delete;
+
+    /// Add a job to the end of the queue. The job must not use objects that may be
+    /// destroyed before it's run, so capture copies.
+    void push(std::function<void()> job);
+
+    /// Wait until all the queued jobs are done.
+    void flush();
+
+private:
+
+    // Thread function. Runs jobs until the queue is empty and stopping is set.
+    void run();
+
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable jobAdded;
+    std::condition_variable jobsDone;
+    bool busy = false;
+    bool stopping = false;
+
+    // Declared last, so that the other members exist when the thread starts.
+    std::thread thread;
+};
+
+
+#endif
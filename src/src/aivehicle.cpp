@@ -1,68 +1,165 @@
 #include "aivehicle.hpp"
 #include "polygon.hpp"
+#include <algorithm>
 #include <iostream>
 #include <cmath> 
 #include "constants.hpp"
+#include "physicsMath.hpp"
+
+using physmath::Real;
+using physmath::Vector;
 
 AIVehicle::AIVehicle(const int& width, const int& height) : Vehicle(width, height) {
-    targetCheckpoint = 0;
+
 }
 
 AIVehicle::AIVehicle(const int& width, const int& height, const std::string& textureName)
 : Vehicle(width, height, textureName) {
-    targetCheckpoint = 0;
+
 }
 
 void AIVehicle::moveAI(Track& track) {
-    // check flag for acceleration
-    bool doAccelerate = true;
-    // first get the targetCheckpoint
-    const sf::RectangleShape target = getTargetCheckpoint(track, targetCheckpoint);
-    // check if AI is on target checkpoint
-    // if on target -> increase targetCheckpoint, get next target
-    Polygon polyAI = Polygon(shape);
-    Polygon polyTarget = Polygon(target);
-    if (polyAI.intersects(polyTarget)) {
-        targetCheckpoint++;
-        const sf::RectangleShape targetNew = getTargetCheckpoint(track, targetCheckpoint);
-        polyTarget = Polygon(targetNew);
-        physics.brake();
-        doAccelerate = false;
+    const RacingLine& line = track.getRacingLine();
+    if (line.empty()) {
+        return;
     }
-    // get middlepoint of target and AI
-    structures::Point pointTarget = getMiddlePoint(target);
-    structures::Point pointAI = getMiddlePoint(shape);
-    // get vector from AI to target
-    Vector2D vectorAI(pointAI.x, pointAI.y);
-    Vector2D vectorTarget(pointTarget.x, pointTarget.y);
-    Vector2D targetDirection = vectorTarget - vectorAI;
-    // get vector pointing to AI's direction
-    Vector2D AIDirection = getAIDirection(shape);
-    // get angle difference-between directions
-    double angle = Vector2D::angleBetween(targetDirection, AIDirection);
-    if (abs(angle) > 10) {
-        if (angle > 0) {
-            if (getPhysics().getAngularVelocity() != -AI_ANG_VEL) {
-                physics.setAngularVelocity(-AI_ANG_VEL); // see constants.hpp
-            }
-        } else {
-            if (getPhysics().getAngularVelocity() != AI_ANG_VEL) {
-                physics.setAngularVelocity(AI_ANG_VEL);
-            }
+    VehiclePhysics& physics = getPhysics();
+    // Find where on the line the AI is. Usually only a few samples from the last tick.
+    // The math is in physmath::Real, so the steering is deterministic in the fixed-point
+    // build too. The doubles of the physics convert back to Real exactly.
+    Vector position(physics.getPosition());
+    lineIndex = onLine ? line.findNearest(structures::Point(physics.getPosition()), lineIndex)
+                       : line.findNearest(structures::Point(physics.getPosition()));
+    onLine = true;
+    Real speed = Vector(physics.getVelocity()).getLength();
+
+    // Steering (pure pursuit): aim at a point ahead on the line. The arc through the target
+    // has curvature 2 * sin(angle) / distance, which gives the angular velocity at this speed.
+    Real lookahead = Real(AI_LOOKAHEAD) + Real(AI_LOOKAHEAD_TIME) * speed;
+    Vector target(line[line.advance(lineIndex, physmath::toDouble(lookahead))].position);
+    Vector targetDirection = target - position;
+    Real distance = std::max(targetDirection.getLength(), Real(1.0));
+    // Off the line (e.g. after a spin or a crash) or a wall in between: follow the flow field
+    // to the next checkpoint, it goes around the walls.
+    const FlowField& field = track.getFlowField();
+    Real offLine = (Vector(line[lineIndex].position) - position).getLength();
+    if (offLine > Real(AI_RECOVERY_DISTANCE) || !field.isClear(physics.getPosition(), physmath::toVector2D(target))) {
+        std::size_t next = std::min<std::size_t>(getVisitedCheckPoints(), track.getCheckpoints().size());
+        Vector2D flow;
+        if (field.getDirection(next, physics.getPosition(), flow)) {
+            targetDirection = Vector(flow);
+            distance = Real(AI_LOOKAHEAD);
         }
+    }
+    Real angle = physmath::approxAngleBetween(targetDirection, Vector(physics.getHeading()));
+    Real angVel;
+    if (physmath::abs(angle) > 90) {
+        // Target is behind: turn as fast as possible.
+        angVel = angle > 0 ? -Real(AI_ANG_VEL) : Real(AI_ANG_VEL);
     } else {
-        // go straight
-        if (getPhysics().getAngularVelocity() != 0) {
-            physics.setAngularVelocity(0);
-            accelerating = false;
+        Real sine, cosine;
+        physmath::approxSincosDeg(angle, sine, cosine);
+        // Turning is possible also when (almost) standing still.
+        Real turnSpeed = std::max(speed, Real(AI_LOOKAHEAD));
+        angVel = -Real(fastmath::RAD_TO_DEG) * 2 * sine * turnSpeed / distance;
+        angVel = std::max(-Real(AI_ANG_VEL), std::min(Real(AI_ANG_VEL), angVel));
+    }
+    // Changing the angular velocity restarts the integration of the physics,
+    // so ignore very small changes.
+    if (physmath::abs(angVel - Real(physics.getAngularVelocity())) > 5) {
+        physics.setAngularVelocity(physmath::toDouble(angVel));
+    }
+
+    // Speed: the target speed of the line a moment ahead, so there is time to react.
+    float targetSpeed = std::min(line[lineIndex].speed,
+            line[line.advance(lineIndex, physmath::toDouble(Real(AI_LOOKAHEAD_TIME) * speed))].speed);
+    if (speed > Real(targetSpeed) * Real(1.1)) {
+        if (!physics.isBraking) {
+            physics.brake(speed > Real(targetSpeed) * Real(1.3));
+        }
+    } else if (speed < Real(targetSpeed)) {
+        // Physics drops the acceleration at top speed and after braking.
+        if (physics.isBraking || physics.getAcceleration().getLengthSquared() == 0) {
+            physics.accelerate();
         }
-        physics.isBraking = false;
-        doAccelerate = true;
     }
-    if (doAccelerate && !physics.isBraking && !accelerating) {
-        physics.accelerate();
-        accelerating = true;
+}
+
+void AIVehicle::saveState(StateBuffer& state) const {
+    Vehicle::saveState(state);
+    state.write(lineIndex);
+    state.write(onLine);
+    state.write(detail);
+    state.write(lineDistance);
+    state.write(lineSpeed);
+}
+
+void AIVehicle::loadState(StateBuffer& state) {
+    Vehicle::loadState(state);
+    state.read(lineIndex);
+    state.read(onLine);
+    state.read(detail);
+    state.read(lineDistance);
+    state.read(lineSpeed);
+}
+
+void AIVehicle::hashState(StateHasher& hasher) const {
+    Vehicle::hashState(hasher);
+    hasher.add(lineIndex);
+    hasher.add(static_cast<int>(detail));
+    hasher.addDouble(physmath::toDouble(lineDistance));
+    hasher.addDouble(physmath::toDouble(lineSpeed));
+}
+
+void AIVehicle::setDetail(Detail newDetail, const Track& track) {
+    if (newDetail == detail) {
+        return;
+    }
+    detail = newDetail;
+    const RacingLine& line = track.getRacingLine();
+    if (detail == Detail::KINEMATIC && !line.empty()) {
+        const VehiclePhysics& physics = getPhysics();
+        // Continue from the nearest point of the line with the current speed.
+        structures::Point position(physics.getPosition());
+        lineIndex = onLine ? line.findNearest(position, lineIndex) : line.findNearest(position);
+        onLine = true;
+        lineDistance = Real(line[lineIndex].distance);
+        lineSpeed = Vector(physics.getVelocity()).getLength();
+    }
+    // Back to FULL: moveKinematic() has kept the physics state up to date,
+    // so moveAI() just continues from there.
+}
+
+void AIVehicle::moveKinematic(const Track& track, double time) {
+    const RacingLine& line = track.getRacingLine();
+    if (line.empty()) {
+        return;
+    }
+    VehiclePhysics& physics = getPhysics();
+    // Speed towards the target speed of the line.
+    Real dt(time);
+    Real targetSpeed(line[lineIndex].speed);
+    if (lineSpeed < targetSpeed) {
+        lineSpeed = std::min(targetSpeed, lineSpeed + Real(ACC) * dt);
+    } else {
+        lineSpeed = std::max(targetSpeed, lineSpeed - Real(AI_BRAKE) * dt);
     }
+    lineDistance = physmath::fmod(lineDistance + lineSpeed * dt, Real(static_cast<double>(line.getLength())));
+
+    // Position between the two samples around lineDistance.
+    lineIndex = std::min(static_cast<std::size_t>(physmath::toDouble(lineDistance / Real(RacingLine::SPACING))), line.size() - 1);
+    const RacingLine::Sample& sample = line[lineIndex];
+    Vector start(sample.position);
+    Vector end(line[(lineIndex + 1) % line.size()].position);
+    Vector segment = end - start;
+    Real segmentLength = segment.getLength();
+    Real t = segmentLength > 0 ? std::min(Real(1.0), (lineDistance - Real(sample.distance)) / segmentLength) : Real(0);
+    Vector position = start + segment * t;
+    Real rotation = segmentLength > 0 ? physmath::atan2Deg(segment.y, segment.x) : Real(physics.getRotation());
+    Vector heading = segmentLength > 0 ? segment / segmentLength : Vector(physics.getHeading());
+
+    physics.setState(physmath::toVector2D(position), physmath::toDouble(rotation), physmath::toVector2D(heading * lineSpeed));
+    sync();
 }
 
 const sf::RectangleShape& AIVehicle::getTargetCheckpoint(const Track& track, int& index) {
@@ -80,27 +177,13 @@ const sf::RectangleShape& AIVehicle::getTargetCheckpoint(const Track& track, int
 }
 
 structures::Point AIVehicle::getMiddlePoint(const sf::RectangleShape& target) {
-    structures::Point pointOriginal = {target.getPoint(0).x, target.getPoint(0).y};
-    pointOriginal.x = pointOriginal.x + target.getSize().x / 2;
-    pointOriginal.y = pointOriginal.y + target.getSize().y / 2;
-    sf::Transform tran = target.getTransform();
-    structures::Point pointTransformed = {tran.transformPoint(pointOriginal.x, pointOriginal.y).x,
-        tran.transformPoint(pointOriginal.x, pointOriginal.y).y};
-    return pointTransformed;
+    return physmath::transformPoint(target, target.getPoint(0) + target.getSize() / 2.f);
 }
 
-Vector2D AIVehicle::getAIDirection(sf::RectangleShape& shape) {
-    structures::Point backLeft = {shape.getPoint(0).x, shape.getPoint(0).y};
-    structures::Point frontLeft = {shape.getPoint(1).x, shape.getPoint(1).y};
-    sf::Transform tran = shape.getTransform();
-    structures::Point backTran = {tran.transformPoint(backLeft.x, backLeft.y).x,
-        tran.transformPoint(backLeft.x, backLeft.y).y};
-    structures::Point frontTran = {tran.transformPoint(frontLeft.x, frontLeft.y).x,
-        tran.transformPoint(frontLeft.x, frontLeft.y).y};
-    Vector2D back(backTran.x, backTran.y);
-    Vector2D front(frontTran.x, frontTran.y);
-    Vector2D vector = front - back;
-    return vector;
+Vector AIVehicle::getAIDirection(sf::RectangleShape& shape) {
+    // The first side of the rectangle (back left -> front left) points along the x-axis
+    // rotated by the shape rotation.
+    return physmath::approxUnitVector(Real(shape.getRotation()));
 }
 
 int AIVehicle::calculateDistanceBetweenPoints(const structures::Point& point1,
@@ -0,0 +1,45 @@
+#include <algorithm>
+
+#include "bitStream.hpp"
+
+void BitWriter::clear()
+{
+    data.clear();
+    bitCount = 0;
+}
+
+void BitWriter::write(sf::Uint32 value, int bits)
+{
+    // Fill the free bits of the last byte, then continue in a new one.
+    while (bits > 0) {
+        int offset = bitCount % 8;
+        if (offset == 0) {
+            data.push_back(0);
+        }
+        int count = std::min(bits, 8 - offset);
+        data.back() |= static_cast<sf::Uint8>((value & ((1u << count) - 1)) << offset);
+        value >>= count;
+        bits -= count;
+        bitCount += count;
+    }
+}
+
+sf::Uint32 BitReader::read(int bits)
+{
+    sf::Uint32 value = 0;
+    int shift = 0;
+    while (bits > 0) {
+        if (position >= size * 8) {
+            overflowed = true;
+            return 0;
+        }
+        int offset = position % 8;
+        int count = std::min(bits, 8 - offset);
+        sf::Uint32 chunk = (data[position / 8] >> offset) & ((1u << count) - 1);
+        value |= chunk << shift;
+        shift += count;
+        bits -= count;
+        position += count;
+    }
+    return value;
+}
@@ -1,19 +1,12 @@
 #include "bullet.hpp"
 #include "constants.hpp"
+#include "perfOverlay.hpp"
 
 
 Bullet::Bullet(const int& width, const int& height)
 : shape(sf::Vector2f(width, height)), physics(width, height)
 {
     shape.setFillColor(sf::Color(50, 205, 50));
-    /*
-    if (!bulletTexture.loadFromFile("../images/bullet1.jpg")) {
-        if (!bulletTexture.loadFromFile("../../images/bullet1.jpg")) {
-            std::cerr << "Failed to load bullet texture." << std::endl;
-        }
-    }
-    shape.setTexture(&bulletTexture);
-     */
 }
 
 
@@ -30,6 +23,7 @@ sf::RectangleShape& Bullet::getShape()
 void Bullet::draw(sf::RenderWindow& window)
 {
     window.draw(shape);
+    PerfOverlay::countDraw(shape);
 }
 
 // static
@@ -67,7 +61,7 @@ void Bullet::launch(const VehiclePhysics& vPhys)
     // Set initial rotation to correspond the rotation of the vehicle.
     getPhysics().setRotation(vPhys.getRotation());
     // Calculate lauching direction and speed
-    Vector2D unitVector = Vector2D::getUnitVector(vPhys.getRotation());
+    Vector2D unitVector = vPhys.getHeading();
     // Direction of unitVector is already correct but length is wrong
     // Calculate scalar speed: Initial speed of the vehicle + BULLET_SPEED
     double speed = vPhys.getVelocity().getLength() + BULLET_SPEED;
@@ -77,6 +71,31 @@ void Bullet::launch(const VehiclePhysics& vPhys)
 }
 
 
+void Bullet::saveState(StateBuffer& state) const
+{
+    state.write(physics);
+    state.write(isFlying);
+    state.write(ownerID);
+}
+
+void Bullet::loadState(StateBuffer& state)
+{
+    state.read(physics);
+    state.read(isFlying);
+    state.read(ownerID);
+    sync();
+}
+
+void Bullet::hashState(StateHasher& hasher) const
+{
+    hasher.add(isFlying);
+    if (isFlying) {
+        hasher.add(physics.getPosition());
+        hasher.add(physics.getVelocity());
+    }
+}
+
+
 // Private
 
 void Bullet::sync()
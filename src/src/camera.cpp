@@ -47,17 +47,17 @@ void Camera::followVehicle(Vehicle& vehicle, Views type)
     if (!isFollowing)
         return;
     
+    // Follow the drawn shape. It's at the physics position, except for a predicted vehicle
+    // of a network client, which is drawn smoothed (see ClientPrediction).
+    const sf::Vector2f& position = vehicle.getShape().getPosition();
     if (type == Views::DEFAULT) {
-        view.setCenter(vehicle.getPhysics().getPosition().getX(),
-                       vehicle.getPhysics().getPosition().getY());
+        view.setCenter(position);
     }
     else if (type == Views::LEFT) {
-        leftView.setCenter(vehicle.getPhysics().getPosition().getX(),
-                           vehicle.getPhysics().getPosition().getY());
+        leftView.setCenter(position);
     }
     else if (type == Views::RIGHT) {
-        rightView.setCenter(vehicle.getPhysics().getPosition().getX(),
-                            vehicle.getPhysics().getPosition().getY());
+        rightView.setCenter(position);
     }
 
     
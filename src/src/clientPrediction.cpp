@@ -0,0 +1,79 @@
+#include <cmath>
+
+#include "clientPrediction.hpp"
+
+void ClientPrediction::predict(Vehicle& vehicle, Track& track, sf::Uint32 sequence, Controls controls, bool started)
+{
+    if (inputs.empty()) {
+        inputs.assign(BUFFER_SIZE, Input{0, 0, false, vehicle.saveLocalState()});
+    }
+    step(vehicle, track, controls, started);
+    inputs[sequence % BUFFER_SIZE] = Input{sequence, controls, started, vehicle.saveLocalState()};
+    latestSequence = sequence;
+
+    offset *= SMOOTHING;
+    rotationOffset *= SMOOTHING;
+    applyOffset(vehicle);
+}
+
+void ClientPrediction::reconcile(Vehicle& vehicle, Track& track, const Vector2D& position, double rotation,
+                                 const Vector2D& velocity, sf::Uint32 inputAck)
+{
+    Vector2D predicted = vehicle.getPhysics().getPosition();
+    double predictedRotation = vehicle.getPhysics().getRotation();
+
+    // Rewind to the state after the latest input the server has applied. Without it
+    // (nothing sent yet, or too old) the server state is taken as it is.
+    bool canReplay = !inputs.empty() && inputAck != 0 && inputAck <= latestSequence
+                     && latestSequence - inputAck < BUFFER_SIZE
+                     && inputs[inputAck % BUFFER_SIZE].sequence == inputAck;
+    if (canReplay) {
+        vehicle.restoreLocalState(inputs[inputAck % BUFFER_SIZE].state);
+    }
+    vehicle.getPhysics().correctState(position, rotation, velocity);
+    if (canReplay) {
+        for (sf::Uint32 sequence = inputAck + 1; sequence <= latestSequence; sequence++) {
+            Input& input = inputs[sequence % BUFFER_SIZE];
+            step(vehicle, track, input.controls, input.started);
+            input.state = vehicle.saveLocalState();
+        }
+    }
+
+    // Keep drawing the vehicle where it was and let the offset decay.
+    Vector2D error = predicted - vehicle.getPhysics().getPosition();
+    double rotationError = std::remainder(predictedRotation - vehicle.getPhysics().getRotation(), 360.0);
+    lastError = error.getLength();
+    if (lastError > SNAP_DISTANCE || !canReplay) {
+        offset = {0.0, 0.0};
+        rotationOffset = 0;
+    }
+    else {
+        offset += error;
+        rotationOffset += rotationError;
+    }
+    applyOffset(vehicle);
+}
+
+// static
+void ClientPrediction::step(Vehicle& vehicle, Track& track, Controls controls, bool started)
+{
+    // The same as Race::step() does to a player vehicle, without weapons and checkpoints.
+    if (started && !vehicle.isDestroyed()) {
+        vehicle.applyControls(controls & ~control::FIRE);
+    }
+    vehicle.update();
+    if (vehicle.isDestroyed()) {
+        vehicle.getPhysics().stop();
+    }
+    if (track.isWallHit(vehicle.getShape())) {
+        vehicle.getPhysics().handleCollision(track.getCrashedLine(vehicle.getShape()), track, vehicle.getShape());
+    }
+}
+
+void ClientPrediction::applyOffset(Vehicle& vehicle) const
+{
+    const VehiclePhysics& physics = vehicle.getPhysics();
+    vehicle.getShape().setPosition(static_cast<float>(physics.getX() + offset.x),
+                                   static_cast<float>(physics.getY() + offset.y));
+    vehicle.getShape().setRotation(static_cast<float>(physics.getRotation() + rotationOffset));
+}
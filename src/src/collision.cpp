@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cstdint>
 #include "collision.hpp"
 
 bool onSegment(const structures::Point &p, const structures::Point &q,
@@ -13,8 +14,16 @@ int orientation(const structures::Point &p, const structures::Point &q,
         const structures::Point &r) {
     // See http://www.geeksforgeeks.org/orientation-3-ordered-points/
     // for details of below formula.
+#ifdef FIXED_POINT_PHYSICS
+    // Exact: the coordinates on a 1/256 px grid (scaling a float by 256 is exact) and the
+    // products in 64-bit integers, so there is nothing for the compiler to round differently.
+    auto grid = [](float v) { return static_cast<std::int64_t>(v * 256); };
+    std::int64_t val = (grid(q.y) - grid(p.y)) * (grid(r.x) - grid(q.x)) -
+            (grid(q.x) - grid(p.x)) * (grid(r.y) - grid(q.y));
+#else
     int val = (q.y - p.y) * (r.x - q.x) -
             (q.x - p.x) * (r.y - q.y);
+#endif
     if (val == 0) return 0; // colinear
     return (val > 0) ? 1 : 2; // clock or counterclock wise
 }
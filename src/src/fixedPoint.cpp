@@ -0,0 +1,59 @@
+#include "fixedPoint.hpp"
+
+const int Fixed::FRACTION_BITS;
+constexpr std::int64_t Fixed::ONE;
+
+namespace fixedmath {
+    std::int64_t sineTable[TABLE_STEPS + 1];
+    std::int64_t atanTable[TABLE_STEPS + 1];
+}
+
+namespace {
+
+    // Taylor series of sin(x), x in radians (0...pi/2). Stops when the terms underflow.
+    Fixed sine(Fixed x)
+    {
+        Fixed square = x * x;
+        Fixed term = x;
+        Fixed sum = x;
+        for (int n = 1; term != 0; n++) {
+            term = -term * square / ((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // atan(t) in radians, t = 0...1. atan(t) = 2 atan(t / (1 + sqrt(1 + t^2))): twice
+    // brings t below 0.2, where the series t - t^3/3 + t^5/5 - ... converges fast.
+    Fixed arctan(Fixed t)
+    {
+        Fixed scale = 1;
+        for (int i = 0; i < 2; i++) {
+            t = t / (1 + fixedmath::sqrt(1 + t * t));
+            scale = scale * 2;
+        }
+        Fixed square = t * t;
+        Fixed power = t;
+        Fixed sum = t;
+        for (int n = 1; power != 0; n++) {
+            power = -power * square;
+            sum += power / (2 * n + 1);
+        }
+        return sum * scale;
+    }
+
+    struct Tables {
+        Tables()
+        {
+            using namespace fixedmath;
+            for (int i = 0; i <= TABLE_STEPS; i++) {
+                Fixed angle = Fixed::fromRaw(PI_F.getRaw() * i / (2 * TABLE_STEPS));
+                sineTable[i] = sine(angle).getRaw();
+                Fixed ratio = Fixed::fromRaw(Fixed::ONE * i / TABLE_STEPS);
+                atanTable[i] = (arctan(ratio) * RAD_TO_DEG).getRaw();
+            }
+        }
+    };
+
+    const Tables tables;
+}
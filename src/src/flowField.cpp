@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <utility>
+
+#include "flowField.hpp"
+#include "physicsMath.hpp"
+
+constexpr float FlowField::CELL_SIZE;
+constexpr float FlowField::CLEARANCE;
+const sf::Uint16 FlowField::UNREACHABLE;
+
+namespace {
+    // Step costs in 1/10 cells. Diagonal is sqrt(2).
+    const sf::Uint16 STRAIGHT = 10;
+    const sf::Uint16 DIAGONAL = 14;
+
+    const int DX[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+    const int DY[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+    // Test if a point is inside the rectangle grown by margin on every side.
+    bool isInside(const sf::RectangleShape& rect, float x, float y, float margin)
+    {
+        structures::Point local = physmath::inverseTransformPoint(rect, sf::Vector2f(x, y));
+        sf::Vector2f size = rect.getSize();
+        return local.x >= -margin && local.y >= -margin && local.x <= size.x + margin && local.y <= size.y + margin;
+    }
+}
+
+void FlowField::build(const std::vector<sf::RectangleShape>& walls, const std::vector<sf::RectangleShape>& targets)
+{
+    fields.clear();
+    blocked.clear();
+    columns = rows = 0;
+    if (walls.empty() || targets.empty()) {
+        return;
+    }
+
+    // The grid covers all the walls. Everything outside them is off the track.
+    sf::FloatRect bounds = physmath::getGlobalBounds(walls[0]);
+    for (const sf::RectangleShape& wall : walls) {
+        sf::FloatRect b = physmath::getGlobalBounds(wall);
+        float right = std::max(bounds.left + bounds.width, b.left + b.width);
+        float bottom = std::max(bounds.top + bounds.height, b.top + b.height);
+        bounds.left = std::min(bounds.left, b.left);
+        bounds.top = std::min(bounds.top, b.top);
+        bounds.width = right - bounds.left;
+        bounds.height = bottom - bounds.top;
+    }
+    left = bounds.left;
+    top = bounds.top;
+    columns = static_cast<int>(std::ceil(bounds.width / CELL_SIZE)) + 1;
+    rows = static_cast<int>(std::ceil(bounds.height / CELL_SIZE)) + 1;
+
+    // Rasterize the walls. Only the cells under the bounding box of a wall are tested.
+    blocked.assign(columns * rows, false);
+    for (const sf::RectangleShape& wall : walls) {
+        sf::FloatRect b = physmath::getGlobalBounds(wall);
+        int x0 = std::max(0, static_cast<int>((b.left - CLEARANCE - left) / CELL_SIZE));
+        int y0 = std::max(0, static_cast<int>((b.top - CLEARANCE - top) / CELL_SIZE));
+        int x1 = std::min(columns - 1, static_cast<int>((b.left + b.width + CLEARANCE - left) / CELL_SIZE));
+        int y1 = std::min(rows - 1, static_cast<int>((b.top + b.height + CLEARANCE - top) / CELL_SIZE));
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                Vector2D center = getCellCenter(y * columns + x);
+                if (isInside(wall, center.x, center.y, CLEARANCE)) {
+                    blocked[y * columns + x] = true;
+                }
+            }
+        }
+    }
+
+    fields.resize(targets.size());
+    for (std::size_t i = 0; i < targets.size(); i++) {
+        computeField(targets[i], fields[i]);
+    }
+}
+
+void FlowField::computeField(const sf::RectangleShape& target, std::vector<sf::Uint16>& field) const
+{
+    field.assign(columns * rows, UNREACHABLE);
+    typedef std::pair<sf::Uint32, int> Entry; // distance, cell
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+
+    // Every free cell inside the target is a start of the wave.
+    for (int cell = 0; cell < columns * rows; cell++) {
+        Vector2D center = getCellCenter(cell);
+        if (!blocked[cell] && isInside(target, center.x, center.y, 0)) {
+            field[cell] = 0;
+            queue.push(Entry(0, cell));
+        }
+    }
+    // The target is smaller than a cell: start from its middle point.
+    if (queue.empty()) {
+        structures::Point middle = physmath::transformPoint(target, target.getSize() / 2.f);
+        int cell = getCell(Vector2D(middle));
+        if (cell < 0) {
+            return;
+        }
+        field[cell] = 0;
+        queue.push(Entry(0, cell));
+    }
+
+    while (!queue.empty()) {
+        Entry entry = queue.top();
+        queue.pop();
+        int cell = entry.second;
+        if (entry.first > field[cell]) {
+            continue; // already found a shorter way
+        }
+        int x = cell % columns;
+        int y = cell / columns;
+        for (int k = 0; k < 8; k++) {
+            int nx = x + DX[k];
+            int ny = y + DY[k];
+            if (nx < 0 || ny < 0 || nx >= columns || ny >= rows || blocked[ny * columns + nx]) {
+                continue;
+            }
+            // Don't cut corners of walls diagonally.
+            if (k >= 4 && (blocked[y * columns + nx] || blocked[ny * columns + x])) {
+                continue;
+            }
+            sf::Uint32 distance = entry.first + (k < 4 ? STRAIGHT : DIAGONAL);
+            int next = ny * columns + nx;
+            if (distance < field[next]) {
+                field[next] = static_cast<sf::Uint16>(std::min<sf::Uint32>(distance, UNREACHABLE - 1));
+                queue.push(Entry(field[next], next));
+            }
+        }
+    }
+}
+
+int FlowField::getCell(const Vector2D& position) const
+{
+    int x = static_cast<int>(std::floor((position.x - left) / CELL_SIZE));
+    int y = static_cast<int>(std::floor((position.y - top) / CELL_SIZE));
+    if (x < 0 || y < 0 || x >= columns || y >= rows) {
+        return -1;
+    }
+    return y * columns + x;
+}
+
+Vector2D FlowField::getCellCenter(int cell) const
+{
+    return Vector2D(left + (cell % columns + 0.5) * CELL_SIZE, top + (cell / columns + 0.5) * CELL_SIZE);
+}
+
+bool FlowField::getDirection(std::size_t target, const Vector2D& position, Vector2D& direction) const
+{
+    int cell = getCell(position);
+    if (cell < 0 || target >= fields.size()) {
+        return false;
+    }
+    const std::vector<sf::Uint16>& field = fields[target];
+    int x = cell % columns;
+    int y = cell / columns;
+    sf::Uint16 here = field[cell];
+
+    if (here != UNREACHABLE) {
+        // Downhill direction of the distance field (central differences). Walls and the edge
+        // of the grid count as uphill, which also keeps the direction away from the walls.
+        auto value = [&](int cx, int cy) -> double {
+            if (cx < 0 || cy < 0 || cx >= columns || cy >= rows || field[cy * columns + cx] == UNREACHABLE) {
+                return here + STRAIGHT;
+            }
+            return field[cy * columns + cx];
+        };
+        Vector2D gradient(value(x + 1, y) - value(x - 1, y), value(x, y + 1) - value(x, y - 1));
+        if (gradient.getLengthSquared() > 0) {
+            direction = -gradient / gradient.getLength();
+            return true;
+        }
+    }
+
+    // In a blocked cell (touching a wall) or on a flat spot: go to the nearest neighbour.
+    int best = -1;
+    for (int k = 0; k < 8; k++) {
+        int nx = x + DX[k];
+        int ny = y + DY[k];
+        if (nx < 0 || ny < 0 || nx >= columns || ny >= rows) {
+            continue;
+        }
+        int next = ny * columns + nx;
+        if (field[next] < std::min(here, best < 0 ? UNREACHABLE : field[best])) {
+            best = next;
+        }
+    }
+    if (best < 0) {
+        return false;
+    }
+    Vector2D toBest = getCellCenter(best) - position;
+    if (toBest.getLengthSquared() == 0) {
+        return false;
+    }
+    direction = toBest / toBest.getLength();
+    return true;
+}
+
+double FlowField::getDistance(std::size_t target, const Vector2D& position) const
+{
+    int cell = getCell(position);
+    if (cell < 0 || target >= fields.size() || fields[target][cell] == UNREACHABLE) {
+        return -1;
+    }
+    return fields[target][cell] * CELL_SIZE / STRAIGHT;
+}
+
+bool FlowField::isClear(const Vector2D& from, const Vector2D& to) const
+{
+    if (blocked.empty()) {
+        return true;
+    }
+    // Test a point every half cell.
+    Vector2D segment = to - from;
+    int steps = static_cast<int>(std::ceil(segment.getLength() / (CELL_SIZE / 2)));
+    for (int i = 0; i <= steps; i++) {
+        int cell = getCell(steps > 0 ? from + segment * (double(i) / steps) : from);
+        if (cell < 0 || blocked[cell]) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -9,6 +9,7 @@
 #include "timeTrial.hpp"
 #include "splitScreen.hpp"
 #include "xmlParser.hpp"
+#include "settings.hpp"
 
 
 Game::Game() :
@@ -23,9 +24,9 @@ updatingThread(&Game::updateVehicles, this)
 
 void Game::loadBackgroundTexture()
 {
-    std::string path = "../images/" + backgroundImage;
+    std::string path = "../images/" + raceSetup.backgroundImage;
     if (!image.loadFromFile(path)) {
-        path = "../../images/" + backgroundImage;
+        path = "../../images/" + raceSetup.backgroundImage;
         if (!image.loadFromFile(path)) {
             // Failed to load
         }
@@ -41,75 +42,59 @@ void Game::loadBackgroundTexture()
 
 bool Game::setRaceType(Race::RaceType type)
 {
-    // Change view divider color if theme is space.
-    bool changeColor = false;
-
-	std::string xmlfile;
+    raceSetup.raceType = type;
     if (menu.back()->getSelected(ButtonTexture::AI1)) {
-		xmlfile = "Map1.xml";
-        vehicleImage = "car2.png";
-        backgroundImage = "background4.jpg";
-        vehicleSize = {60, 30};
+		raceSetup.xmlfile = "Map1.xml";
+        raceSetup.vehicleImage = "car2.png";
+        raceSetup.backgroundImage = "background4.jpg";
+        raceSetup.vehicleWidth = 60;
+        raceSetup.vehicleHeight = 30;
     }
     else if (menu.back()->getSelected(ButtonTexture::AI2)) {
-		xmlfile = "Map2.xml";
-        vehicleImage = "spaceship2.png";
-        backgroundImage = "space1.png";
-        vehicleSize = {60, 40};
-        changeColor = true;
+		raceSetup.xmlfile = "Map2.xml";
+        raceSetup.vehicleImage = "spaceship2.png";
+        raceSetup.backgroundImage = "space1.png";
+        raceSetup.vehicleWidth = 60;
+        raceSetup.vehicleHeight = 40;
     }
     else {
-		xmlfile = "Map1.xml";
-        vehicleImage = "car2.png";
-        backgroundImage = "background4.jpg";
-        vehicleSize = {60, 30};
+		raceSetup.xmlfile = "Map1.xml";
+        raceSetup.vehicleImage = "car2.png";
+        raceSetup.backgroundImage = "background4.jpg";
+        raceSetup.vehicleWidth = 60;
+        raceSetup.vehicleHeight = 30;
+    }
+
+    if (!createRace()) {
+		setNextState(GameStates::STATE_MAINMENU);
+		menu.back()->setText(WIDTH * 0.5f, HEIGHT * 0.9f, "ERROR occurred while reading xml file.");
+		return false;
     }
+	return true;
+}
+
+bool Game::createRace()
+{
 	if (!backgroundLoaded) {
 		loadBackgroundTexture();
 		backgroundLoaded = true;
 	}
 
     // If an error occurs during reading xml file, XMLException is thrown from the XMLParser class,
-    // which is called from the Track constructor.
+    // which is called from TrackData::load() in the Track constructor.
     // Track object is constructed in Race constructor.
     // That is why this try-catch block is here.
     try {
-        switch (type) {
-            case Race::TimeTrial:
-                race = std::make_unique<TimeTrial>(xmlfile);
-                break;
-                
-            case Race::SplitScreen:
-                race = std::make_unique<SplitScreen>(xmlfile);
-                if (changeColor) {
-                    race->getViewDivider().setFillColor(sf::Color(50, 50, 50));
-                }
-                break;
-                
-            case Race::Practice:
-                race = std::make_unique<Race>(xmlfile);
-                break;
-                
-            case Race::NormalRace:
-                race = std::make_unique<Race>(xmlfile);
-                break;
-                
-            default:
-                break;
+        race = Race::create(raceSetup);
+        // Change view divider color if theme is space.
+        if (race->isSplitScreen() && raceSetup.xmlfile == "Map2.xml") {
+            race->getViewDivider().setFillColor(sf::Color(50, 50, 50));
         }
-		if (!race->isSplitScreen()) {
-			race->getCamera().zoomOut(20);
-		}
-		
     } // Try block ends here
     catch (XMLException &e) {
         std::cout << "Error occured while reading xml file." << std::endl
         << e.what() << std::endl;
-
-		setNextState(GameStates::STATE_MAINMENU);
-		menu.back()->setText(WIDTH * 0.5f, HEIGHT * 0.9f, "ERROR occurred while reading xml file.");
 		return false;
-
     }
 	return true;
 }
@@ -117,66 +102,123 @@ bool Game::setRaceType(Race::RaceType type)
 void Game::setRaceVehicles()
 {
 
-	if (menu.back()->getSelected(ButtonTexture::AI0))
+	if (menu.back()->getSelected(ButtonTexture::AI0)) {
 		std::cout << "No AI vehicles will be added." << std::endl;
-
+		raceSetup.bots = 0;
+	}
 	else if (menu.back()->getSelected(ButtonTexture::AI1))
 	{
 		std::cout << "One AI vehicle will be added." << std::endl;
-		race->addAIVehicle(std::make_shared<AICar>(vehicleSize.x, vehicleSize.y, vehicleImage));
+		raceSetup.bots = 1;
 	}
 	else if (menu.back()->getSelected(ButtonTexture::AI2))
 	{
 		std::cout << "Two AI vehicles will be added." << std::endl;
-		race->addAIVehicle(std::make_shared<AICar>(vehicleSize.x, vehicleSize.y, vehicleImage));
-		race->addAIVehicle(std::make_shared<AICar>(vehicleSize.x, vehicleSize.y, vehicleImage));
+		raceSetup.bots = 2;
 	}
 
-	if (menu.back()->getSelected(ButtonTexture::PL0))
+	if (menu.back()->getSelected(ButtonTexture::PL0)) {
 		std::cout << "No players will be added." << std::endl;
+		raceSetup.players = 0;
+	}
 	else if (menu.front()->getSelected(ButtonTexture::PL1))
 	{
 		std::cout << "One player will be added." << std::endl;
-		race->addVehicle(std::make_shared<Car>(vehicleSize.x, vehicleSize.y, vehicleImage));
+		raceSetup.players = 1;
 	}
 	else if (menu.back()->getSelected(ButtonTexture::PL2))
 	{
 		std::cout << "Two players will be added." << std::endl;
-		race->addVehicle(std::make_shared<Car>(vehicleSize.x, vehicleSize.y, vehicleImage));
-		race->addVehicle(std::make_shared<Car>(vehicleSize.x, vehicleSize.y, vehicleImage));
+		raceSetup.players = 2;
+	}
+	if (settings::bots >= 0) {
+		raceSetup.bots = settings::bots;
 	}
+	race->addVehicles(raceSetup);
 }
 
 void Game::updateVehicles()
 {
+    // The race is simulated in fixed time steps. This loop runs steps until the
+    // simulation has caught up with the wall clock, so the simulation speed doesn't
+    // depend on how often the loop runs.
+    sf::Clock stepClock;
+    double lag = 0;
+    sf::Clock networkClock;
+    net::CodecStats reportedStats;
     while (window.isOpen()) {
-        loopCount++;
-        //std::cout << "Loop count: " << loopCount << std::endl;
-        // For testing the frequency of the loop
-		
-		// Block another thread until vehicles are updated, because
-		// we shouldn't draw and update the camera while the position of the vehcle
-		// is changing.
-        mutex.lock(); 
-        race->update();
-		mutex.unlock(); // Release lock
-        race->checkCollisions();
-        sf::sleep(sf::milliseconds(2));
-        // If CPU load gets too high, we could sleep a bit longer.
-        // Otherwise, 2 ms is good or even 1 ms, if the vehicles are still lagging
-        // while accelerating or turning.
-        // With MacBook pro, this loop runs about 360 times per sec.
-        // The frequency of the window loop depends on the monitor's refresh rate and
-        // it is about 60-100 /s.
+        lag += stepClock.restart().asSeconds();
+        // Don't try to catch up after a long stall (e.g. the window was dragged).
+        if (lag > 0.25) {
+            lag = 0.25;
+        }
+        while (lag >= TICK_TIME) {
+		    // Block another thread until the tick is simulated, because
+		    // we shouldn't draw and update the camera while the position of the vehcle
+		    // is changing.
+            lockMutex(true);
+            sf::Clock tickClock;
+            if (client) {
+                // The server simulates the race. Show the latest state from the server,
+                // send the input of this tick and predict its effect on the own vehicle.
+                if (client->receive()) {
+                    race->readSnapshot(client->getSnapshot());
+                }
+                if (!client->isSpectator()) {
+                    client->setViewSize(race->getCamera().getViewSize());
+                    sf::Uint32 sequence = client->sendInput(race->getVehicles()[race->getLocalPlayer()]->getInputControls());
+                    if (sequence != 0) {
+                        race->predictLocalPlayer(sequence);
+                    }
+                }
+                if (networkClock.getElapsedTime() >= sf::seconds(1)) {
+                    const net::CodecStats& stats = client->getStats();
+                    unsigned int snapshots = stats.snapshots - reportedStats.snapshots;
+                    float seconds = networkClock.restart().asSeconds();
+                    race->getPerfOverlay().setNetworkStats(
+                        (stats.bytes - reportedStats.bytes) * 8 / 1000.0f / seconds,
+                        snapshots > 0 ? static_cast<float>(stats.micros - reportedStats.micros) / snapshots : 0,
+                        static_cast<float>(race->getPredictionError()));
+                    reportedStats = stats;
+                }
+            }
+            else {
+                race->step();
+            }
+            sf::Time tickTime = tickClock.getElapsedTime();
+		    mutex.unlock(); // Release lock
+            race->getPerfOverlay().tickFinished(tickTime);
+            lag -= TICK_TIME;
+        }
+        sf::sleep(sf::milliseconds(1));
+    }
+}
+
+void Game::lockMutex(bool simulationThread)
+{
+    sf::Clock waitClock;
+    mutex.lock();
+    if (simulationThread) {
+        race->getPerfOverlay().addSimLockWait(waitClock.getElapsedTime());
+    }
+    else {
+        race->getPerfOverlay().addRenderLockWait(waitClock.getElapsedTime());
     }
 }
 
-void Game::run() {
+void Game::run(const std::string& replayFile, const std::string& serverAddress, bool spectate) {
     // create the window
     window.create(sf::VideoMode(WIDTH, HEIGHT), "Micro Machines");
 
     window.setVerticalSyncEnabled(true);
 
+    if (!replayFile.empty() && !playReplay(replayFile)) {
+        window.close();
+    }
+    else if (!serverAddress.empty() && !joinServer(serverAddress, spectate)) {
+        window.close();
+    }
+
 
     // run the program as long as the window is open
     while (window.isOpen()) {
@@ -212,6 +254,86 @@ void Game::run() {
 
         }
     }
+    // The simulation thread stops when the window is closed.
+    updatingThread.wait();
+    if (client) {
+        client->disconnect();
+    }
+    saveReplay();
+}
+
+bool Game::playReplay(const std::string& filename)
+{
+    if (!replay.load(filename)) {
+        return false;
+    }
+    raceSetup = replay.getSetup();
+    if (!createRace()) {
+        return false;
+    }
+    race->addVehicles(raceSetup);
+    race->setSeed(raceSetup.seed);
+    race->playFrom(&replay);
+    menu.clear();
+    startRace();
+    std::cout << "Playing replay " << filename << " (" << replay.getTickCount() * TICK_TIME << " s)" << std::endl;
+    return true;
+}
+
+bool Game::joinServer(const std::string& address, bool spectate)
+{
+    std::string host;
+    unsigned short port;
+    if (!parseServerAddress(address, host, port)) {
+        std::cerr << "Invalid server address " << address << std::endl;
+        return false;
+    }
+    client = std::make_unique<RaceClient>();
+    bool joined = spectate ? client->spectate(sf::IpAddress(host), port) : client->connect(sf::IpAddress(host), port);
+    if (!joined) {
+        client.reset();
+        return false;
+    }
+    raceSetup = client->getSetup();
+    if (!createRace()) {
+        return false;
+    }
+    race->addVehicles(raceSetup);
+    race->setSeed(raceSetup.seed);
+    menu.clear();
+    if (spectate) {
+        // No local player. The camera follows the first player.
+        startRace();
+        std::cout << "Watching " << host << ":" << port << std::endl;
+        return true;
+    }
+    race->setLocalPlayer(client->getSlot());
+    startRace();
+    std::cout << "Joined " << host << ":" << port << " as player " << client->getSlot() + 1 << std::endl;
+    return true;
+}
+
+void Game::saveReplay()
+{
+    if (!race || !race->isRecording()) {
+        return;
+    }
+    std::string path = Replay::newFilePath();
+    if (replay.save(path)) {
+        std::cout << "Replay saved to " << path << " (" << replay.getDataSize() << " bytes of input)" << std::endl;
+    }
+}
+
+void Game::startRace()
+{
+    race->initialize(); // Make sure that vehicles are added before calling this.
+    race->showCountdown(3);
+    AIclock.restart();
+
+    updatingThread.launch();
+
+    race->updateWeaponIcons();
+    cState = GameStates::STATE_TRACK;
 }
 
 void Game::setNextState(GameStates nextState)
@@ -283,22 +405,13 @@ void Game::setNextState(GameStates nextState)
 	case(GameStates::STATE_TRACK): {
 
 			setRaceVehicles();
-			race->initialize(); // Make sure that vehicles are added before calling this.
-			race->showCountdown(3);
-			AIclock.restart();
-
-			updatingThread.launch();
-			race->getRaceClock().restart();
 
-			// We should use std::make_unique instead of new (basically same thing)
-			//std::unique_ptr<Turbo> turbo = std::unique_ptr<Turbo>(new Turbo());
-			/****************
-			 Turbo should be added in Race::handleWeaponEvents like other weapon
-			 *****************/
-			 //race->getVehicles()[0]->addWeapon(std::move(turbo));
-			race->updateWeaponIcons();
+			// Record the race. The seed is chosen by the race.
+			raceSetup.seed = race->getSeed();
+			replay.startRecording(raceSetup);
+			race->recordTo(&replay);
 
-			cState = nextState;
+			startRace();
 			std::cout << "State change success. The screen should change to STATE_TRACK." << std::endl;
 			break;
 		}
@@ -352,6 +465,9 @@ void Game::createMainMenu() {
 
 void Game::gameLoop() {
 
+    // Rendering time of this frame for the performance overlay. Doesn't include
+    // the time display() waits for vertical sync.
+    sf::Clock renderClock;
 
     sf::Event event;
     
@@ -361,12 +477,19 @@ void Game::gameLoop() {
         if (event.type == sf::Event::Closed)
             window.close();
 
-        if (race->isStarted) {
-            race->handleEvents(event);
-            mutex.lock();
-            race->handleWeaponEvents(event);
-            mutex.unlock();
+        // Show or hide the performance overlay.
+        if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F3) {
+            race->getPerfOverlay().toggle();
+        }
 
+        // Keyboard events only update the control inputs. The simulation thread
+        // applies them on the next tick (see Race::step()).
+        lockMutex(false);
+        race->handleEvents(event);
+        race->handleWeaponEvents(event);
+        mutex.unlock();
+
+        if (race->isStarted) {
 			if (event.type == sf::Event::KeyReleased && event.key.code == sf::Keyboard::Escape)
 			{
 				setNextState(GameStates::STATE_EXIT); //press esc to exit track mode and quit the game
@@ -374,30 +497,17 @@ void Game::gameLoop() {
 			
         }
     }
-    
-    
-    // handle AI updates
-    if (race->isStarted) {
-        race->handleAI();
-    }
-
 
+    // AI, bullets, missiles and hits are updated by the simulation thread.
+    // Here we only update what is shown and heard.
+    lockMutex(false);
     if (!race->isStarted) {
         race->handleCountdownEvents();
     }
-
-    //race->update();
-    //race->checkCollisions();
-    // The camera follows the first vehicle.
-    //race->getCamera().followVehicle(*(race->getVehicles()[0]), Camera::Views::DEFAULT);
-	race->updateBullets();
-	race->updateTurbo();
-    race->updateMissiles();
 	race->updateSounds(soundHandler);
-
-
+    race->updateTelemetry();
     race->updateTexts(); // This should be moved  inside the race class.
-    race->checkHits(); // finish line hit and weapon hit 
+    mutex.unlock();
 
     // Clear the window before drawing anything.
     window.clear(sf::Color(80, 80, 80));
@@ -405,10 +515,11 @@ void Game::gameLoop() {
     if (race->isSplitScreen()) {
         
         // First, draw obejcts on the left side of the window.
-		mutex.lock();
+		lockMutex(false);
         race->getCamera().followVehicle(*(race->getVehicles()[0]), Camera::Views::LEFT);
         race->getCamera().setViewToWindow(window, Camera::Views::LEFT);
         window.draw(backgroundSprite);
+        PerfOverlay::countDraw(backgroundSprite);
         race->drawObjects(window);
 		
         
@@ -423,24 +534,32 @@ void Game::gameLoop() {
         // Draw objects on the right side of the window.
         race->getCamera().setViewToWindow(window, Camera::Views::RIGHT);
         window.draw(backgroundSprite);
+        PerfOverlay::countDraw(backgroundSprite);
         race->drawObjects(window);
 		mutex.unlock();
     }
     else {
         // If not split screen, use the full size default view, which follows
-        // the first vehicle.
-		mutex.lock(); // Block another thread until everything is drawn.
-		race->getCamera().followVehicle(*(race->getVehicles()[0]), Camera::Views::DEFAULT);
+        // the first vehicle (in network play the local one).
+		lockMutex(false); // Block another thread until everything is drawn.
+		int followed = std::max(race->getLocalPlayer(), 0);
+		race->getCamera().followVehicle(*(race->getVehicles()[followed]), Camera::Views::DEFAULT);
         race->getCamera().setViewToWindow(window, Camera::Views::DEFAULT);
         window.draw(backgroundSprite);
+        PerfOverlay::countDraw(backgroundSprite);
         race->drawObjects(window);
 		mutex.unlock(); // Release lock
         
     }
     // Draw static objects (e.g. texts) with using the static view, which never moves.
+    // Weapons are picked and used by the simulation thread, so lock also here.
     race->getCamera().setViewToWindow(window, Camera::Views::STATIC);
+    lockMutex(false);
     race->drawStaticObjects(window);
+    mutex.unlock();
 
+    sf::Time renderTime = renderClock.getElapsedTime();
     // end the current frame
     window.display();
+    race->getPerfOverlay().frameFinished(frameClock.restart(), renderTime);
 }
@@ -0,0 +1,144 @@
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <SFML/Network/Packet.hpp>
+
+#include "ghost.hpp"
+#include "constants.hpp"
+
+namespace {
+    const sf::Uint32 MAGIC = 0x4D4D4748; // "MMGH"
+    const sf::Uint8 VERSION = 1;
+
+    // Quantization steps
+    const double POSITION_SCALE = 4;  // 1/4 px
+    const double ROTATION_SCALE = 10; // 1/10 degrees
+    const sf::Int32 FULL_CIRCLE = 3600;
+
+    // Zigzag encoding maps small negative and positive numbers to small unsigned numbers:
+    // 0 -> 0, -1 -> 1, 1 -> 2, -2 -> 3 ...
+    void writeZigzag(std::vector<sf::Uint8>& data, sf::Int32 value)
+    {
+        sf::Uint32 zigzag = (static_cast<sf::Uint32>(value) << 1) ^ static_cast<sf::Uint32>(value >> 31);
+        while (zigzag >= 0x80) {
+            data.push_back(static_cast<sf::Uint8>(zigzag | 0x80));
+            zigzag >>= 7;
+        }
+        data.push_back(static_cast<sf::Uint8>(zigzag));
+    }
+
+    bool readZigzag(const std::vector<sf::Uint8>& data, std::size_t& pos, sf::Int32& value)
+    {
+        sf::Uint32 zigzag = 0;
+        for (int shift = 0; shift < 35 && pos < data.size(); shift += 7) {
+            sf::Uint8 byte = data[pos++];
+            zigzag |= static_cast<sf::Uint32>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                value = static_cast<sf::Int32>(zigzag >> 1) ^ -static_cast<sf::Int32>(zigzag & 1);
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+void Ghost::addSample(double x, double y, double rotation)
+{
+    Sample sample;
+    sample.x = static_cast<sf::Int32>(std::lround(x * POSITION_SCALE));
+    sample.y = static_cast<sf::Int32>(std::lround(y * POSITION_SCALE));
+    sample.rotation = static_cast<sf::Int32>(std::lround(rotation * ROTATION_SCALE)) % FULL_CIRCLE;
+    if (sample.rotation < 0) {
+        sample.rotation += FULL_CIRCLE;
+    }
+    samples.push_back(sample);
+}
+
+void Ghost::getPose(std::size_t tick, float& x, float& y, float& rotation) const
+{
+    const Sample& sample = samples[tick < samples.size() ? tick : samples.size() - 1];
+    x = static_cast<float>(sample.x / POSITION_SCALE);
+    y = static_cast<float>(sample.y / POSITION_SCALE);
+    rotation = static_cast<float>(sample.rotation / ROTATION_SCALE);
+}
+
+bool Ghost::save(const std::string& filename, double lapTime) const
+{
+    std::vector<sf::Uint8> data;
+    data.reserve(samples.size() * 3);
+    Sample previous = {0, 0, 0};
+    for (const Sample& sample : samples) {
+        writeZigzag(data, sample.x - previous.x);
+        writeZigzag(data, sample.y - previous.y);
+        // Take the shorter way around the circle, e.g. 359 -> 1 is +2, not -358.
+        sf::Int32 turn = sample.rotation - previous.rotation;
+        if (turn > FULL_CIRCLE / 2) {
+            turn -= FULL_CIRCLE;
+        }
+        else if (turn < -FULL_CIRCLE / 2) {
+            turn += FULL_CIRCLE;
+        }
+        writeZigzag(data, turn);
+        previous = sample;
+    }
+
+    sf::Packet packet;
+    packet << MAGIC << VERSION << static_cast<sf::Uint16>(TICK_RATE) << lapTime
+           << static_cast<sf::Uint32>(samples.size()) << static_cast<sf::Uint32>(data.size());
+    packet.append(data.data(), data.size());
+
+    std::ofstream out(filename, std::ofstream::binary);
+    if (!out) {
+        return false;
+    }
+    out.write(static_cast<const char*>(packet.getData()), packet.getDataSize());
+    return out.good();
+}
+
+bool Ghost::load(const std::string& filename, double& lapTime)
+{
+    std::ifstream in(filename, std::ifstream::binary);
+    if (!in) {
+        return false;
+    }
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    sf::Packet packet;
+    packet.append(bytes.data(), bytes.size());
+
+    sf::Uint32 magic = 0, count = 0, size = 0;
+    sf::Uint8 version = 0;
+    sf::Uint16 tickRate = 0;
+    double time = 0;
+    packet >> magic >> version >> tickRate >> time >> count >> size;
+    // A ghost recorded with another tick rate would move at wrong speed. A sample takes at
+    // least 3 bytes, so a larger count comes from a broken file.
+    if (!packet || magic != MAGIC || version != VERSION || tickRate != TICK_RATE || size > bytes.size()
+        || count > size / 3) {
+        return false;
+    }
+    std::vector<sf::Uint8> data(size);
+    for (sf::Uint8& byte : data) {
+        packet >> byte;
+    }
+    if (!packet) {
+        return false;
+    }
+
+    std::vector<Sample> decoded;
+    decoded.reserve(count);
+    Sample sample = {0, 0, 0};
+    std::size_t pos = 0;
+    for (sf::Uint32 i = 0; i < count; i++) {
+        sf::Int32 dx, dy, turn;
+        if (!readZigzag(data, pos, dx) || !readZigzag(data, pos, dy) || !readZigzag(data, pos, turn)) {
+            return false;
+        }
+        sample.x += dx;
+        sample.y += dy;
+        sample.rotation = (sample.rotation + turn + FULL_CIRCLE) % FULL_CIRCLE;
+        decoded.push_back(sample);
+    }
+    samples.swap(decoded);
+    lapTime = time;
+    return true;
+}
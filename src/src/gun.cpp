@@ -1,11 +1,12 @@
 #include "gun.hpp"
 #include "structures.hpp"
+#include "settings.hpp"
 
 
 Gun::Gun() : Weapon()
 {
     // Load texture
-    if (!weaponTexture.loadFromFile("../images/laser_gun1.png")) {
+    if (!settings::headless && !weaponTexture.loadFromFile("../images/laser_gun1.png")) {
         if (!weaponTexture.loadFromFile("../../images/laser_gun1.png")) {
             std::cerr << "Cannot load gun icon texture" << std::endl;
         }
@@ -23,22 +24,11 @@ Gun::~Gun()
 void Gun::useWeapon(float startTime)
 {
 	isUsing = true;
-    std::cout << "Gun used" << std::endl;
 }
 
 
 void Gun::useWeapon()
 {
-    std::cout << "Gun used" << std::endl;
 	isUsing = true;
     //bullet.getShape().setPosition(300, 300);
 }
-
-void Gun::updateSound(SoundHandler& soundHandler)
-{
-	if (isUsing)
-	{
-		soundHandler.playSound(SoundType::GUNSHOT);
-		isUsing = false;
-	}
-}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cmath>
+
+#include "hitboxHistory.hpp"
+#include "vehicle.hpp"
+
+const unsigned int HitboxHistory::HISTORY_TICKS;
+
+void HitboxHistory::record(unsigned int tick, const VehicleRegistry& registry)
+{
+    const std::vector<sf::FloatRect>& bounds = registry.getBounds();
+    std::size_t count = bounds.size();
+    // Start again if the vehicles have changed or ticks were skipped (e.g. a restart).
+    if (count != vehicleCount || (recorded > 0 && tick != latest + 1)) {
+        clear();
+        vehicleCount = count;
+        boxes.resize(HISTORY_TICKS * count);
+    }
+    Box* current = boxes.data() + (tick % HISTORY_TICKS) * count;
+    for (std::size_t e = 0; e < count; e++) {
+        const sf::FloatRect& b = bounds[e];
+        current[e] = {b.left, b.top, b.left + b.width, b.top + b.height};
+    }
+
+    const Box* previous = recorded > 0 ? boxes.data() + (latest % HISTORY_TICKS) * count : nullptr;
+    Row row = {tick, 0, 0};
+    for (std::size_t i = 0; i < count; i++) {
+        const Box& box = current[i];
+        row.maxExtent = std::max(row.maxExtent, std::hypot(box.right - box.left, box.bottom - box.top) / 2);
+        if (previous != nullptr) {
+            const Box& old = previous[i];
+            float step = std::hypot(box.left + box.right - old.left - old.right,
+                                    box.top + box.bottom - old.top - old.bottom) / 2;
+            row.maxStep = std::max(row.maxStep, step);
+        }
+    }
+    rows[tick % HISTORY_TICKS] = row;
+    latest = tick;
+    recorded = std::min(recorded + 1, HISTORY_TICKS);
+}
+
+void HitboxHistory::clear()
+{
+    boxes.clear();
+    vehicleCount = 0;
+    recorded = 0;
+    latest = 0;
+}
+
+unsigned int HitboxHistory::getOldestTick() const
+{
+    return recorded > 0 ? latest - recorded + 1 : 0;
+}
+
+void HitboxHistory::findHits(const sf::FloatRect& bounds, unsigned int tick, const SpatialIndex& index,
+        std::vector<Vehicle*>& result, int excludeID) const
+{
+    if (recorded == 0) {
+        return;
+    }
+    tick = std::max(getOldestTick(), std::min(latest, tick));
+
+    // No vehicle can have moved further than the fastest one on each tick since.
+    float travel = 0;
+    for (unsigned int t = latest; t > tick; t--) {
+        travel += rows[t % HISTORY_TICKS].maxStep;
+    }
+    const Row& row = rows[tick % HISTORY_TICKS];
+    const Box* rowBoxes = boxes.data() + (tick % HISTORY_TICKS) * vehicleCount;
+    Vector2D center(bounds.left + bounds.width / 2, bounds.top + bounds.height / 2);
+    double reach = std::hypot(bounds.width, bounds.height) / 2 + row.maxExtent + travel;
+
+    // Candidates by their current position, then the exact test with the old boxes
+    // (the same test as sf::FloatRect::intersects()).
+    std::size_t first = result.size();
+    index.findWithinRadius(center, reach, result, excludeID);
+    float right = bounds.left + bounds.width;
+    float bottom = bounds.top + bounds.height;
+    auto isMiss = [&](Vehicle* vehicle) {
+        int id = vehicle->getID();
+        if (id < 1 || id > static_cast<int>(vehicleCount)) {
+            return true;
+        }
+        const Box& box = rowBoxes[id - 1];
+        return !(box.left < right && bounds.left < box.right && box.top < bottom && bounds.top < box.bottom);
+    };
+    result.erase(std::remove_if(result.begin() + first, result.end(), isMiss), result.end());
+}
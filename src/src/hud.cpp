@@ -0,0 +1,122 @@
+#include "hud.hpp"
+#include "perfOverlay.hpp"
+
+void Hud::setFont(const sf::Font& newFont)
+{
+    font = &newFont;
+    dirty = true;
+}
+
+void Hud::setIconTexture(const sf::Texture& texture)
+{
+    iconTexture = &texture;
+}
+
+void Hud::clear()
+{
+    texts.clear();
+    glyphs.clear();
+    icons.clear();
+    dirty = false;
+}
+
+std::size_t Hud::addText(unsigned int characterSize, const sf::Vector2f& position, const sf::Color& color)
+{
+    texts.push_back({characterSize, position, color, std::string(), 0, false});
+    return texts.size() - 1;
+}
+
+std::size_t Hud::addIcon(const sf::FloatRect& rect, const sf::Color& color)
+{
+    sf::Vector2f size = iconTexture != nullptr ? sf::Vector2f(iconTexture->getSize()) : sf::Vector2f(0, 0);
+    icons.append(sf::Vertex(sf::Vector2f(rect.left, rect.top), color, sf::Vector2f(0, 0)));
+    icons.append(sf::Vertex(sf::Vector2f(rect.left + rect.width, rect.top), color, sf::Vector2f(size.x, 0)));
+    icons.append(sf::Vertex(sf::Vector2f(rect.left + rect.width, rect.top + rect.height), color, size));
+    icons.append(sf::Vertex(sf::Vector2f(rect.left, rect.top + rect.height), color, sf::Vector2f(0, size.y)));
+    return icons.getVertexCount() / 4 - 1;
+}
+
+void Hud::setString(std::size_t text, const std::string& value)
+{
+    if (texts[text].value != value) {
+        texts[text].value = value;
+        dirty = true;
+    }
+}
+
+bool Hud::isChanged(std::size_t text, long long key)
+{
+    Text& t = texts[text];
+    if (t.hasKey && t.key == key) {
+        return false;
+    }
+    t.key = key;
+    t.hasKey = true;
+    return true;
+}
+
+void Hud::build()
+{
+    for (auto& batch : glyphs) {
+        batch.second.clear();
+    }
+    if (font != nullptr) {
+        for (const Text& text : texts) {
+            sf::VertexArray& vertices = glyphs[text.characterSize];
+            vertices.setPrimitiveType(sf::Quads);
+            appendGlyphs(text, vertices);
+        }
+    }
+    dirty = false;
+}
+
+void Hud::appendGlyphs(const Text& text, sf::VertexArray& vertices) const
+{
+    // Same layout as sf::Text: the position is the top left corner and the first line
+    // starts one character size below it.
+    float x = text.position.x;
+    float y = text.position.y + text.characterSize;
+    sf::Uint32 previous = 0;
+    for (char c : text.value) {
+        sf::Uint32 current = static_cast<unsigned char>(c);
+        x += font->getKerning(previous, current, text.characterSize);
+        previous = current;
+        const sf::Glyph& glyph = font->getGlyph(current, text.characterSize, false);
+        if (current != ' ') {
+            float left = x + glyph.bounds.left;
+            float top = y + glyph.bounds.top;
+            float right = left + glyph.bounds.width;
+            float bottom = top + glyph.bounds.height;
+            float u1 = static_cast<float>(glyph.textureRect.left);
+            float v1 = static_cast<float>(glyph.textureRect.top);
+            float u2 = u1 + glyph.textureRect.width;
+            float v2 = v1 + glyph.textureRect.height;
+            vertices.append(sf::Vertex(sf::Vector2f(left, top), text.color, sf::Vector2f(u1, v1)));
+            vertices.append(sf::Vertex(sf::Vector2f(right, top), text.color, sf::Vector2f(u2, v1)));
+            vertices.append(sf::Vertex(sf::Vector2f(right, bottom), text.color, sf::Vector2f(u2, v2)));
+            vertices.append(sf::Vertex(sf::Vector2f(left, bottom), text.color, sf::Vector2f(u1, v2)));
+        }
+        x += glyph.advance;
+    }
+}
+
+void Hud::draw(sf::RenderWindow& window)
+{
+    if (dirty) {
+        build();
+    }
+    if (icons.getVertexCount() > 0) {
+        window.draw(icons, iconTexture);
+        PerfOverlay::countDraw(icons.getVertexCount());
+    }
+    if (font == nullptr) {
+        return;
+    }
+    for (auto& batch : glyphs) {
+        if (batch.second.getVertexCount() > 0) {
+            // The texture of a size is ready, build() has loaded all the glyphs.
+            window.draw(batch.second, &font->getTexture(batch.first));
+            PerfOverlay::countDraw(batch.second.getVertexCount());
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "interestFilter.hpp"
+
+namespace {
+    // Priority gained per snapshot by a vehicle outside the view: MAX_OUTSIDE_PRIORITY
+    // at the edge of the view, falling with the square of the distance, but at least
+    // MIN_PRIORITY so that it's sent every 1 / MIN_PRIORITY snapshots (3 Hz).
+    const float MAX_OUTSIDE_PRIORITY = 0.5f;
+    const float MIN_PRIORITY = 0.05f;
+}
+
+namespace net {
+
+    void InterestFilter::select(const Snapshot& snapshot, sf::Uint8 ownID, const sf::Vector2f& viewSize,
+                                Snapshot& relevant)
+    {
+        relevant.tick = snapshot.tick;
+        relevant.clockStartTick = snapshot.clockStartTick;
+        relevant.started = snapshot.started;
+        relevant.ended = snapshot.ended;
+        relevant.lapsDriven = snapshot.lapsDriven;
+        relevant.inputAck = snapshot.inputAck;
+        relevant.pickups = snapshot.pickups;
+
+        // The camera follows the own vehicle.
+        sf::Vector2f center;
+        bool hasOwn = false;
+        for (const VehicleState& v : snapshot.vehicles) {
+            if (v.id == ownID) {
+                center = sf::Vector2f(v.x, v.y);
+                hasOwn = true;
+            }
+        }
+        float halfWidth = viewSize.x / 2 + VIEW_MARGIN;
+        float halfHeight = viewSize.y / 2 + VIEW_MARGIN;
+        float viewRadius = std::hypot(halfWidth, halfHeight);
+        auto isInView = [&](float x, float y) {
+            return std::abs(x - center.x) <= halfWidth && std::abs(y - center.y) <= halfHeight;
+        };
+
+        priorities.resize(256, 0.0f);
+        candidates.clear();
+        chosen.assign(snapshot.vehicles.size(), false);
+        for (std::size_t i = 0; i < snapshot.vehicles.size(); i++) {
+            const VehicleState& v = snapshot.vehicles[i];
+            if (v.id == ownID) {
+                chosen[i] = true;
+                continue;
+            }
+            float gain = 1;
+            if (!isInView(v.x, v.y)) {
+                float ratio = viewRadius / std::hypot(v.x - center.x, v.y - center.y);
+                gain = std::max(MIN_PRIORITY, MAX_OUTSIDE_PRIORITY * ratio * ratio);
+            }
+            priorities[v.id] += gain;
+            candidates.push_back(std::make_pair(priorities[v.id], i));
+        }
+        std::size_t places = MAX_VEHICLES - (hasOwn ? 1 : 0);
+        if (candidates.size() > places) {
+            std::nth_element(candidates.begin(), candidates.begin() + places, candidates.end(),
+                             std::greater<std::pair<float, std::size_t>>());
+            candidates.resize(places);
+        }
+        for (const auto& candidate : candidates) {
+            chosen[candidate.second] = true;
+            priorities[snapshot.vehicles[candidate.second].id] = 0;
+        }
+        relevant.vehicles.clear();
+        for (std::size_t i = 0; i < snapshot.vehicles.size(); i++) {
+            if (chosen[i]) {
+                relevant.vehicles.push_back(snapshot.vehicles[i]);
+            }
+        }
+
+        nearby.clear();
+        for (std::size_t i = 0; i < snapshot.projectiles.size(); i++) {
+            const ProjectileState& p = snapshot.projectiles[i];
+            if (isInView(p.x, p.y)) {
+                float dx = p.x - center.x;
+                float dy = p.y - center.y;
+                nearby.push_back(std::make_pair(dx * dx + dy * dy, i));
+            }
+        }
+        if (nearby.size() > MAX_PROJECTILES) {
+            std::nth_element(nearby.begin(), nearby.begin() + MAX_PROJECTILES, nearby.end());
+            nearby.resize(MAX_PROJECTILES);
+        }
+        relevant.projectiles.clear();
+        for (const auto& projectile : nearby) {
+            relevant.projectiles.push_back(snapshot.projectiles[projectile.second]);
+        }
+    }
+}
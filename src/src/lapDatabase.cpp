@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+
+#include "lapDatabase.hpp"
+
+namespace {
+    const sf::Uint32 MAGIC = 0x5250414C; // "LAPR" in little endian
+    const std::size_t HEADER_SIZE = 6;  // magic + payload length
+    const std::size_t CRC_SIZE = 4;
+    const std::size_t MAX_NAME = 255;
+
+    const std::vector<double> NO_LAPS;
+
+    sf::Uint32 crc32(const sf::Uint8* data, std::size_t size)
+    {
+        sf::Uint32 crc = 0xFFFFFFFF;
+        for (std::size_t i = 0; i < size; i++) {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+            }
+        }
+        return ~crc;
+    }
+
+    void writeUint(std::vector<sf::Uint8>& out, sf::Uint64 value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++) {
+            out.push_back(static_cast<sf::Uint8>(value >> (8 * i)));
+        }
+    }
+
+    sf::Uint64 readUint(const sf::Uint8* in, int bytes)
+    {
+        sf::Uint64 value = 0;
+        for (int i = 0; i < bytes; i++) {
+            value |= static_cast<sf::Uint64>(in[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    void writeString(std::vector<sf::Uint8>& out, const std::string& str)
+    {
+        std::size_t length = std::min(str.size(), MAX_NAME);
+        out.push_back(static_cast<sf::Uint8>(length));
+        out.insert(out.end(), str.begin(), str.begin() + length);
+    }
+
+    bool readString(const sf::Uint8* in, std::size_t size, std::size_t& pos, std::string& str)
+    {
+        if (pos >= size || pos + 1 + in[pos] > size) {
+            return false;
+        }
+        std::size_t length = in[pos++];
+        str.assign(reinterpret_cast<const char*>(in + pos), length);
+        pos += length;
+        return true;
+    }
+
+    std::vector<sf::Uint8> encodeRecord(const std::string& track, const std::string& player, double lapTime)
+    {
+        std::vector<sf::Uint8> payload;
+        writeString(payload, track);
+        writeString(payload, player);
+        sf::Uint64 bits;
+        std::memcpy(&bits, &lapTime, sizeof(bits));
+        writeUint(payload, bits, 8);
+        writeUint(payload, static_cast<sf::Uint64>(std::time(nullptr)), 8);
+
+        std::vector<sf::Uint8> record;
+        record.reserve(HEADER_SIZE + payload.size() + CRC_SIZE);
+        writeUint(record, MAGIC, 4);
+        writeUint(record, payload.size(), 2);
+        record.insert(record.end(), payload.begin(), payload.end());
+        writeUint(record, crc32(payload.data(), payload.size()), 4);
+        return record;
+    }
+}
+
+LapDatabase::LapDatabase(WriteQueue& writer) : writer(writer)
+{
+
+}
+
+std::size_t LapDatabase::open(const std::string& file)
+{
+    filename = file;
+    topLaps.clear();
+
+    std::ifstream in(filename, std::ifstream::binary);
+    if (!in) {
+        return 0;
+    }
+    std::vector<sf::Uint8> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    std::size_t records = 0;
+    std::size_t pos = 0;
+    while (pos + HEADER_SIZE + CRC_SIZE <= bytes.size()) {
+        const sf::Uint8* record = bytes.data() + pos;
+        if (readUint(record, 4) != MAGIC) {
+            // Garbage after an interrupted write: find the next record.
+            pos++;
+            continue;
+        }
+        std::size_t length = static_cast<std::size_t>(readUint(record + 4, 2));
+        const sf::Uint8* payload = record + HEADER_SIZE;
+        // A torn write may be followed by later records: resync like after a bad CRC.
+        if (pos + HEADER_SIZE + length + CRC_SIZE > bytes.size()
+            || readUint(payload + length, 4) != crc32(payload, length)) {
+            pos++;
+            continue;
+        }
+
+        std::string track, player;
+        std::size_t field = 0;
+        if (readString(payload, length, field, track) && readString(payload, length, field, player)
+            && field + 16 <= length) {
+            sf::Uint64 bits = readUint(payload + field, 8);
+            double lapTime;
+            std::memcpy(&lapTime, &bits, sizeof(lapTime));
+            insert(makeKey(track, player), lapTime);
+            records++;
+        }
+        pos += HEADER_SIZE + length + CRC_SIZE;
+    }
+    return records;
+}
+
+void LapDatabase::addLap(const std::string& track, const std::string& player, double lapTime)
+{
+    insert(makeKey(track, player), lapTime);
+    if (filename.empty()) {
+        return;
+    }
+    std::vector<sf::Uint8> record = encodeRecord(track, player, lapTime);
+    std::string file = filename;
+    writer.push([file, record] {
+        std::ofstream out(file, std::ofstream::binary | std::ofstream::app);
+        out.write(reinterpret_cast<const char*>(record.data()), record.size());
+        out.flush();
+    });
+}
+
+const std::vector<double>& LapDatabase::getTopLaps(const std::string& track, const std::string& player) const
+{
+    auto it = topLaps.find(makeKey(track, player));
+    return it == topLaps.end() ? NO_LAPS : it->second;
+}
+
+double LapDatabase::getBestLapTime(const std::string& track, const std::string& player) const
+{
+    const std::vector<double>& laps = getTopLaps(track, player);
+    return laps.empty() ? -1 : laps.front();
+}
+
+std::string LapDatabase::makeKey(const std::string& track, const std::string& player)
+{
+    std::string key = track;
+    key += '\0';
+    key += player;
+    return key;
+}
+
+void LapDatabase::insert(const std::string& key, double lapTime)
+{
+    std::vector<double>& laps = topLaps[key];
+    if (laps.size() >= TOP_K && lapTime >= laps.back()) {
+        return;
+    }
+    laps.insert(std::upper_bound(laps.begin(), laps.end(), lapTime), lapTime);
+    if (laps.size() > TOP_K) {
+        laps.pop_back();
+    }
+}
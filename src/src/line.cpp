@@ -1,6 +1,6 @@
 #include "line.hpp"
 #include "collision.hpp"
 
-bool Line::intersects(const Line &line2) {
+bool Line::intersects(const Line &line2) const {
     return doIntersect(this->getStart(), this->getEnd(), line2.getStart(), line2.getEnd());
 }
\ No newline at end of file
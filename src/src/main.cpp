@@ -1,12 +1,196 @@
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
 #include "game.hpp"
+#include "raceClient.hpp"
+#include "raceServer.hpp"
+#include "spectatorRelay.hpp"
+#include "replay.hpp"
+#include "settings.hpp"
+
+namespace {
+    void printUsage(const char* program)
+    {
+        std::cout << "Usage: " << program << " [--bots N] [--replay FILE [--headless] [--speed N]]" << std::endl
+                  << "       " << program << " --server [--port N] [--players N] [--bots N] [--track FILE] [--races N [--threads N]]" << std::endl
+                  << "       " << program << " --connect HOST[:PORT] [--headless]" << std::endl
+                  << "       " << program << " --spectate HOST[:PORT] [--headless]" << std::endl
+                  << "       " << program << " --relay HOST[:PORT] [--port N] [--spectators N]" << std::endl
+                  << "  --bots N       race against N AI vehicles instead of the number selected in the menu" << std::endl
+                  << "  --replay FILE  play a recorded race" << std::endl
+                  << "  --headless     simulate the replay without a window and print the result," << std::endl
+                  << "                 or join a server without a window and hold the throttle" << std::endl
+                  << "  --speed N      headless speed as N times real time (default: as fast as possible)" << std::endl
+                  << "  --server       run a dedicated race server without a window" << std::endl
+                  << "  --port N       UDP port of the server (default: " << net::DEFAULT_PORT << ")" << std::endl
+                  << "  --players N    number of network players the server waits for (default: 2)" << std::endl
+                  << "  --track FILE   track of the server, Map1.xml or Map2.xml (default: Map1.xml)" << std::endl
+                  << "  --races N      host N independent races on ports PORT...PORT+N-1 (default: 1)" << std::endl
+                  << "  --threads N    threads updating the races (default: one per hardware thread)" << std::endl
+                  << "  --connect HOST[:PORT]  join the race of a server" << std::endl
+                  << "  --spectate HOST[:PORT] watch the race of a server or relay" << std::endl
+                  << "  --relay HOST[:PORT]    relay the race of a server to spectators on port N" << std::endl
+                  << "                         (default: " << net::DEFAULT_RELAY_PORT << ")" << std::endl
+                  << "  --spectators N  spectators of the relay (default: "
+                  << SpectatorRelay::DEFAULT_MAX_SPECTATORS << ")" << std::endl;
+    }
 
-int main()
+    // Same vehicles and background as selected in the menu for the track (see Game::setRaceType).
+    RaceSetup serverSetup(const std::string& track, int players)
+    {
+        RaceSetup setup;
+        setup.xmlfile = track;
+        setup.raceType = Race::RaceType::NormalRace;
+        setup.seed = std::random_device()();
+        setup.players = players;
+        setup.bots = settings::bots >= 0 ? settings::bots : 0;
+        if (track == "Map2.xml") {
+            setup.vehicleImage = "spaceship2.png";
+            setup.backgroundImage = "space1.png";
+            setup.vehicleWidth = 60;
+            setup.vehicleHeight = 40;
+        }
+        else {
+            setup.vehicleImage = "car2.png";
+            setup.backgroundImage = "background4.jpg";
+            setup.vehicleWidth = 60;
+            setup.vehicleHeight = 30;
+        }
+        return setup;
+    }
+}
+
+int main(int argc, char* argv[])
 {
+    std::string replayFile;
+    std::string serverAddress;
+    std::string relayServer;
+    bool spectate = false;
+    int spectators = static_cast<int>(SpectatorRelay::DEFAULT_MAX_SPECTATORS);
+    std::string track = "Map1.xml";
+    bool headless = false;
+    double speed = 0;
+    int players = 2;
+    int races = 1;
+    int threads = 0;
+    unsigned short port = net::DEFAULT_PORT;
+    bool portGiven = false;
+#ifdef DEDICATED_SERVER
+    // The raceserver executable is always a server.
+    bool server = true;
+#else
+    bool server = false;
+#endif
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--replay" && i + 1 < argc) {
+            replayFile = argv[++i];
+        }
+        else if (arg == "--bots" && i + 1 < argc) {
+            settings::bots = std::atoi(argv[++i]);
+        }
+        else if (arg == "--headless") {
+            headless = true;
+        }
+        else if (arg == "--speed" && i + 1 < argc) {
+            speed = std::atof(argv[++i]);
+        }
+        else if (arg == "--server") {
+            server = true;
+        }
+        else if (arg == "--port" && i + 1 < argc) {
+            port = static_cast<unsigned short>(std::atoi(argv[++i]));
+            portGiven = true;
+        }
+        else if (arg == "--players" && i + 1 < argc) {
+            players = std::atoi(argv[++i]);
+        }
+        else if (arg == "--races" && i + 1 < argc) {
+            races = std::atoi(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (arg == "--track" && i + 1 < argc) {
+            track = argv[++i];
+        }
+        else if (arg == "--connect" && i + 1 < argc) {
+            serverAddress = argv[++i];
+        }
+        else if (arg == "--spectate" && i + 1 < argc) {
+            serverAddress = argv[++i];
+            spectate = true;
+        }
+        else if (arg == "--relay" && i + 1 < argc) {
+            relayServer = argv[++i];
+        }
+        else if (arg == "--spectators" && i + 1 < argc) {
+            spectators = std::atoi(argv[++i]);
+        }
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!relayServer.empty()) {
+        std::string host;
+        unsigned short serverPort;
+        if (!parseServerAddress(relayServer, host, serverPort) || spectators < 1) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        settings::headless = true;
+        return runSpectatorRelay(host, serverPort, portGiven ? port : net::DEFAULT_RELAY_PORT, spectators);
+    }
+
+    if (server) {
+        if (players < 1 || players > 4) {
+            std::cerr << "A server has 1...4 players." << std::endl;
+            return 1;
+        }
+        if (races < 1 || threads < 0) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        settings::headless = true;
+        if (races > 1) {
+            // Every race gets its own seed.
+            std::vector<RaceSetup> setups;
+            for (int i = 0; i < races; i++) {
+                setups.push_back(serverSetup(track, players));
+            }
+            return runRaceHost(setups, port, threads);
+        }
+        return runRaceServer(serverSetup(track, players), port);
+    }
+
+    if (headless) {
+        if (!serverAddress.empty()) {
+            std::string host;
+            if (!parseServerAddress(serverAddress, host, port)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            settings::headless = true;
+            return runHeadlessClient(host, port, spectate);
+        }
+        if (replayFile.empty()) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        settings::headless = true;
+        return runHeadlessReplay(replayFile, speed);
+    }
+
     Game game;
-    
+
     // All the content from main function is copied to game loop.
     // Game loop run as long as the window is open.
-	game.run();
+	game.run(replayFile, serverAddress, spectate);
 	return 0;
-    
+
 }
@@ -3,17 +3,21 @@
 #include "missile.hpp"
 #include "aivehicle.hpp"
 #include "constants.hpp"
+#include "physicsMath.hpp"
 #include "polygon.hpp"
+#include "resources.hpp"
+#include "settings.hpp"
 
 Missile::Missile(const int& width, const int& height) :
 VehiclePhysics(width, height), shape(sf::Vector2f(width, height)) {
-    if (!missileTexture.loadFromFile("../images/missile.png")) {
-        if (!missileTexture.loadFromFile("../../images/missile.png")) {
+    if (!settings::headless) {
+        const sf::Texture* missileTexture = resources::getTexture("missile.png");
+        if (missileTexture == nullptr) {
             std::cerr << "Cannot load missile icon texture" << std::endl;
             shape.setFillColor(sf::Color(255, 0, 0));
         }
+        shape.setTexture(missileTexture);
     }
-    shape.setTexture(&missileTexture);
     this->isMissile = true;
 }
 
@@ -32,25 +36,27 @@ void Missile::launchMissile(const int& ownerID, const int& checkpoint,
     // Set initial rotation to correspond the rotation of the vehicle.
     setRotation(vPhys.getRotation());
     // Calculate lauching direction and speed
-    Vector2D unitVector = Vector2D::getUnitVector(vPhys.getRotation());
+    Vector2D unitVector = vPhys.getHeading();
     // Direction of unitVector is already correct but length is wrong
     // Calculate scalar speed: Initial speed of the vehicle + MISSILE_SPEED
     double speed = vPhys.getVelocity().getLength() + MISSILE_SPEED;
     // Set final velocity
     setVelocity(unitVector * speed);
     isFlying = true;
-    this->fuelTime.restart();
+    this->fuelTime = 0.0;
 }
 
 void Missile::draw(sf::RenderWindow& window) {
     if (this->isFlying && !this->isDestroyed) {
         window.draw(shape);
+        PerfOverlay::countDraw(shape);
     }
 }
 
 void Missile::moveMissile(const Race& race) {
-    // check that fuel is not over
-    if (fuelTime.getElapsedTime().asSeconds() > 10) {
+    // check that fuel is not over. Called once per simulation tick.
+    fuelTime += TICK_TIME;
+    if (fuelTime > 10) {
         this->isFlying = false;
         this->isDestroyed = true;
     }
@@ -59,67 +65,32 @@ void Missile::moveMissile(const Race& race) {
     // check flag for acceleration
     bool doAccelerate = true;
     // first get the targetCheckpoint
-    const sf::RectangleShape target = AIVehicle::getTargetCheckpoint(race.getTrack(), targetCheckpoint);
+    const sf::RectangleShape& target = AIVehicle::getTargetCheckpoint(race.getTrack(), targetCheckpoint);
     // check if missile is on target checkpoint
     // if on target -> increase targetCheckpoint, get next target
     Polygon polyMissile = Polygon(shape);
     Polygon polyTarget = Polygon(target);
     if (polyMissile.intersects(polyTarget)) {
         targetCheckpoint++;
-        const sf::RectangleShape targetNew = AIVehicle::getTargetCheckpoint(race.getTrack(), targetCheckpoint);
+        const sf::RectangleShape& targetNew = AIVehicle::getTargetCheckpoint(race.getTrack(), targetCheckpoint);
         polyTarget = Polygon(targetNew);
         brake();
         doAccelerate = false;
     }
-    // check if there is any vehicle in range (not the owner of missile)
+    // Find the nearest vehicle in range (not the owner of missile).
     structures::Point targetPoint;
     structures::Point missilePoint = AIVehicle::getMiddlePoint(shape);
-    bool vehicleInRange = false;
-    int closest = 0; // ID of the closest target
-    double minDistance = std::numeric_limits<double>::max();
-    // first check regular player controlled vehicles. Bad style to use 
-    // copy paste code. However... feel too lazy and really have no time.
-    for (auto v : race.getVehicles()) {
-        // check that vehicle is not owner 
-        if (ownerID == v->getID() || v->isDestroyed()) {
-            continue; // go to next vehicle
-        }
-        // otherwise get the middle point of vehicle and calculate distance
-        // between missile and vehicle.
-        structures::Point vehiclePoint = AIVehicle::getMiddlePoint(v->getShape());
-        double distance = AIVehicle::calculateDistanceBetweenPoints(missilePoint, vehiclePoint);
-        // update the distance to nearest vehicle that is in range
-        if (distance <= 250 && distance < minDistance) {
-            targetPoint = vehiclePoint;
-            closest = v->getID();
-            minDistance = distance;
-            vehicleInRange = true;
-        }
-    }
-    for (auto v : race.getAIVehicles()) {
-        // check that vehicle is not owner 
-        if (ownerID == v->getID() || v->isDestroyed()) {
-            continue; // go to next vehicle
-        }
-        // otherwise get the middle point of vehicle and calculate distance
-        // between missile and vehicle.
-        structures::Point vehiclePoint = AIVehicle::getMiddlePoint(v->getShape());
-        double distance = AIVehicle::calculateDistanceBetweenPoints(missilePoint, vehiclePoint);
-        // update the distance to nearest vehicle that is in range
-        if (distance <= 250 && distance < minDistance) {
-            targetPoint = vehiclePoint;
-            closest = v->getID();
-            minDistance = distance;
-            vehicleInRange = true;
-        }
-    }
+    Vehicle* closest = race.getSpatialIndex().findNearest(Vector2D(missilePoint), MISSILE_RANGE, ownerID);
+    bool vehicleInRange = closest != nullptr;
     // if vehicle was in range -> check if there is a collision to it
     // if there is... do some dmg.
     if (vehicleInRange) {
-        sf::FloatRect missileBounds = shape.getGlobalBounds();
-        sf::FloatRect vehicleBounds = searchShapeByVehicleID(closest, race).getGlobalBounds();
-        if (missileBounds.intersects(vehicleBounds)) {
-            if (missileHitVehicle(closest, race) <= 0) {
+        targetPoint = AIVehicle::getMiddlePoint(closest->getShape());
+        // The target is where the owner saw it (lag compensation).
+        hits.clear();
+        race.findHits(physmath::getGlobalBounds(shape), ownerID, hits);
+        if (!hits.empty()) {
+            if (hits.front()->damageVehicle(MISSILE_DMG) <= 0) {
                 // destroy the missile.
                 this->isFlying = false;
                 this->isDestroyed = true;
@@ -127,20 +98,30 @@ void Missile::moveMissile(const Race& race) {
             }
         }
     }
+    // Home straight to the vehicle only if no wall is in between.
+    const FlowField& field = race.getTrack().getFlowField();
+    if (vehicleInRange && !field.isClear(Vector2D(missilePoint), Vector2D(targetPoint))) {
+        vehicleInRange = false;
+    }
     // if vehicle was in range -> skip the next if sentence. Next 
     // is only for finding the middle point of target checkpoint.   
     if (!vehicleInRange) {
         targetPoint = AIVehicle::getMiddlePoint(target);
     }
     // get vector from missile to target
-    Vector2D vectorMissile(missilePoint.x, missilePoint.y);
-    Vector2D vectorTarget(targetPoint.x, targetPoint.y);
+    Vector2D vectorMissile(missilePoint);
+    Vector2D vectorTarget(targetPoint);
     Vector2D targetDirection = vectorTarget - vectorMissile;
+    // Fly to the checkpoint around the walls.
+    Vector2D flow;
+    if (!vehicleInRange && field.getDirection(targetCheckpoint, vectorMissile, flow)) {
+        targetDirection = flow;
+    }
     // get vector pointing to missiles's direction
-    Vector2D missileDirection = AIVehicle::getAIDirection(shape);
+    physmath::Vector missileDirection = AIVehicle::getAIDirection(shape);
     // get angle difference-between directions
-    double angle = Vector2D::angleBetween(targetDirection, missileDirection);
-    if (abs(angle) > 10) {
+    physmath::Real angle = physmath::approxAngleBetween(physmath::Vector(targetDirection), missileDirection);
+    if (physmath::abs(angle) > 10) {
         if (angle > 0) {
             if (getAngularVelocity() != -MISSILE_ANG_VEL) {
                 setAngularVelocity(-MISSILE_ANG_VEL);
@@ -168,34 +149,40 @@ void Missile::moveMissile(const Race& race) {
     sync();
 }
 
-void Missile::sync() {
-    shape.setPosition(getPosition().getX(), getPosition().getY());
-    shape.setRotation(getRotation());
+void Missile::saveState(StateBuffer& state) const {
+    state.write(static_cast<const VehiclePhysics&>(*this));
+    state.write(targetCheckpoint);
+    state.write(ownerID);
+    state.write(accelerating);
+    state.write(fuelTime);
+    state.write(isFlying);
+    state.write(isDestroyed);
 }
 
-sf::RectangleShape Missile::searchShapeByVehicleID(const int& vehicleID,
-        const Race& race) const {
-    for (auto v : race.getVehicles()) {
-        if (v->getID() == vehicleID)
-            return v->getShape();
-    }
-    for (auto v : race.getAIVehicles()) {
-        if (v->getID() == vehicleID)
-            return v->getShape();
-    }
-    // in error situation
-    return race.getVehicles()[0]->getShape();
+void Missile::loadState(StateBuffer& state) {
+    state.read(static_cast<VehiclePhysics&>(*this));
+    state.read(targetCheckpoint);
+    state.read(ownerID);
+    state.read(accelerating);
+    state.read(fuelTime);
+    state.read(isFlying);
+    state.read(isDestroyed);
+    sync();
 }
 
-int Missile::missileHitVehicle(const int& vehicleID, const Race& race) {
-    for (auto v : race.getVehicles()) {
-        if (v->getID() == vehicleID)
-            return v->damageVehicle(MISSILE_DMG);
-    }
-    for (auto v : race.getAIVehicles()) {
-        if (v->getID() == vehicleID)
-            return v->damageVehicle(MISSILE_DMG);
+void Missile::hashState(StateHasher& hasher) const {
+    hasher.add(isFlying);
+    hasher.add(isDestroyed);
+    if (isFlying) {
+        hasher.add(getPosition());
+        hasher.add(getVelocity());
+        hasher.addDouble(getRotation());
+        hasher.add(targetCheckpoint);
+        hasher.addDouble(fuelTime);
     }
-    // in error situation
-    return 100;
+}
+
+void Missile::sync() {
+    shape.setPosition(getPosition().getX(), getPosition().getY());
+    shape.setRotation(getRotation());
 }
@@ -1,8 +1,9 @@
 #include "missileLauncher.hpp"
+#include "settings.hpp"
 
 MissileLauncher::MissileLauncher() : Weapon(), missile(60, 30) {
     // Load texture
-    if (!weaponTexture.loadFromFile("../images/missileLaunch.png")) {
+    if (!settings::headless && !weaponTexture.loadFromFile("../images/missileLaunch.png")) {
         if (!weaponTexture.loadFromFile("../../images/missileLaunch.png")) {
             std::cerr << "Cannot load missile launcher icon texture" << std::endl;
             shape.setFillColor(sf::Color(255, 0, 0));
@@ -18,7 +19,7 @@ void MissileLauncher::useWeapon() {
         if (!isUsing && !isUsed) {
             isUsing = true;
             isUsed = true;
-            missile.launchMissile(owner->getID(), owner->visitedCheckPoints,
+            missile.launchMissile(owner->getID(), owner->getVisitedCheckPoints(),
                     owner->getPhysics());
         }
     } else {
@@ -30,6 +31,21 @@ void MissileLauncher::initializeControls(Vehicle* owner, Race * race) {
     this->owner = owner;
     this->race = race;
 }
+void MissileLauncher::saveState(StateBuffer& state) const {
+    Weapon::saveState(state);
+    missile.saveState(state);
+}
+
+void MissileLauncher::loadState(StateBuffer& state) {
+    Weapon::loadState(state);
+    missile.loadState(state);
+}
+
+void MissileLauncher::hashState(StateHasher& hasher) const {
+    Weapon::hashState(hasher);
+    missile.hashState(hasher);
+}
+
 void MissileLauncher::updateSound(SoundHandler& soundHandler) {
 	if (isUsing) {
 		if (!soundHandler.isPlaying(SoundType::ROCKET))
@@ -0,0 +1,63 @@
+#include "netProtocol.hpp"
+#include "race.hpp"
+
+namespace net {
+
+    void beginMessage(sf::Packet& packet, MessageType type)
+    {
+        packet.clear();
+        packet << PROTOCOL_ID << static_cast<sf::Uint8>(type);
+    }
+
+    bool readHeader(sf::Packet& packet, MessageType& type)
+    {
+        sf::Uint32 id = 0;
+        sf::Uint8 value = 0;
+        if (!(packet >> id >> value) || id != PROTOCOL_ID || value > KEYFRAME) {
+            return false;
+        }
+        type = static_cast<MessageType>(value);
+        return true;
+    }
+
+    bool readHeader(const void* data, std::size_t size, MessageType& type)
+    {
+        const sf::Uint8* bytes = static_cast<const sf::Uint8*>(data);
+        if (size < HEADER_SIZE) {
+            return false;
+        }
+        // Big endian, like sf::Packet.
+        sf::Uint32 id = (static_cast<sf::Uint32>(bytes[0]) << 24) | (static_cast<sf::Uint32>(bytes[1]) << 16)
+                        | (static_cast<sf::Uint32>(bytes[2]) << 8) | bytes[3];
+        if (id != PROTOCOL_ID || bytes[4] > KEYFRAME) {
+            return false;
+        }
+        type = static_cast<MessageType>(bytes[4]);
+        return true;
+    }
+}
+
+sf::Packet& operator<<(sf::Packet& packet, const RaceSetup& setup)
+{
+    return packet << setup.xmlfile << static_cast<sf::Uint8>(setup.raceType) << static_cast<sf::Uint32>(setup.seed)
+                  << static_cast<sf::Uint8>(setup.players) << static_cast<sf::Uint8>(setup.bots)
+                  << static_cast<sf::Uint16>(setup.vehicleWidth) << static_cast<sf::Uint16>(setup.vehicleHeight)
+                  << setup.vehicleImage << setup.backgroundImage;
+}
+
+sf::Packet& operator>>(sf::Packet& packet, RaceSetup& setup)
+{
+    sf::Uint8 raceType, players, bots;
+    sf::Uint32 seed;
+    sf::Uint16 width, height;
+    if (packet >> setup.xmlfile >> raceType >> seed >> players >> bots >> width >> height
+               >> setup.vehicleImage >> setup.backgroundImage) {
+        setup.raceType = raceType;
+        setup.seed = seed;
+        setup.players = players;
+        setup.bots = bots;
+        setup.vehicleWidth = width;
+        setup.vehicleHeight = height;
+    }
+    return packet;
+}
@@ -1,5 +1,7 @@
 #include <random>
 #include "obstacle.hpp"
+#include "weapon.hpp"
+#include "perfOverlay.hpp"
 
 
 Obstacle::Obstacle(const std::string& textureName) : oil(sf::Vector2f(70, 70))//Constructor for the Obstacles class
@@ -7,14 +9,10 @@ Obstacle::Obstacle(const std::string& textureName) : oil(sf::Vector2f(70, 70))//
 
 }
 
-void Obstacle::setSpawnPoint(const std::vector<structures::Point> points)
+void Obstacle::setSpawnPoint(const std::vector<structures::Point>& points, std::mt19937& rng)
 {
     
-    std::random_device rd;     // only used once to initialise (seed) engine
-    std::mt19937 rng(rd());    // random-number engine used (Mersenne-Twister in this case)
-    std::uniform_int_distribution<int> uni(0, points.size() - 1); // guaranteed unbiased
-    
-    auto index = uni(rng);
+    auto index = Weapon::getRandomNumber(0, points.size() - 1, rng);
     auto p = points[index];
     
     oil.setPosition(p.x, p.y);
@@ -31,4 +29,5 @@ sf::RectangleShape& Obstacle::getShape()
 void Obstacle::drawObstacle(sf::RenderWindow& window) const
 {
     window.draw(oil);
+    PerfOverlay::countDraw(oil);
 }
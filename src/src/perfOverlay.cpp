@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "perfOverlay.hpp"
+#include "constants.hpp"
+
+namespace {
+    // Number of frames shown in the frame time graph.
+    const std::size_t GRAPH_SAMPLES = 120;
+    // Size and position of the overlay (lower left corner of the window).
+    const float PANEL_X = 5;
+    const float PANEL_Y = HEIGHT - 215;
+    const float PANEL_WIDTH = 300;
+    const float GRAPH_HEIGHT = 50; // 1 px = 1 ms
+    const float GRAPH_Y = PANEL_Y + 155;
+}
+
+bool PerfOverlay::counting = false;
+unsigned int PerfOverlay::drawCalls = 0;
+unsigned int PerfOverlay::vertices = 0;
+
+PerfOverlay::PerfOverlay() :
+background(sf::Vector2f(PANEL_WIDTH, 210)),
+graph(sf::LinesStrip, GRAPH_SAMPLES),
+graphGrid(sf::Lines, 4),
+frameTimes(GRAPH_SAMPLES, 0.0f),
+ticks(0), tickMicros(0), simLockMicros(0)
+{
+    background.setPosition(PANEL_X, PANEL_Y);
+    background.setFillColor(sf::Color(0, 0, 0, 170));
+
+    statsText.setCharacterSize(14);
+    statsText.setPosition(PANEL_X + 8, PANEL_Y + 5);
+#if SFML_VERSION_MAJOR > 2 || SFML_VERSION_MINOR >= 4
+    statsText.setFillColor(TEXT_COLOR);
+#else
+    // sf::Text has no setFillColor before SFML 2.4.
+    statsText.setColor(TEXT_COLOR);
+#endif
+
+    // Reference lines for 16.7 ms (60 FPS) and 33.3 ms (30 FPS).
+    float bottom = GRAPH_Y + GRAPH_HEIGHT;
+    float y60 = bottom - 1000.0f / 60;
+    float y30 = bottom - 1000.0f / 30;
+    graphGrid[0] = sf::Vertex(sf::Vector2f(PANEL_X + 8, y60), sf::Color(0, 160, 0));
+    graphGrid[1] = sf::Vertex(sf::Vector2f(PANEL_X + PANEL_WIDTH - 8, y60), sf::Color(0, 160, 0));
+    graphGrid[2] = sf::Vertex(sf::Vector2f(PANEL_X + 8, y30), sf::Color(160, 120, 0));
+    graphGrid[3] = sf::Vertex(sf::Vector2f(PANEL_X + PANEL_WIDTH - 8, y30), sf::Color(160, 120, 0));
+}
+
+void PerfOverlay::setFont(const sf::Font& font)
+{
+    statsText.setFont(font);
+}
+
+void PerfOverlay::toggle()
+{
+    visible = !visible;
+    counting = visible;
+    drawCalls = 0;
+    vertices = 0;
+}
+
+void PerfOverlay::frameFinished(sf::Time frameTime, sf::Time renderTime)
+{
+    float frameMs = frameTime.asSeconds() * 1000;
+    frameTimes[frameIndex] = frameMs;
+    frameIndex = (frameIndex + 1) % frameTimes.size();
+
+    frames++;
+    renderMs += renderTime.asSeconds() * 1000;
+    worstFrameMs = std::max(worstFrameMs, frameMs);
+
+    // Draw calls are counted per frame.
+    lastDrawCalls = drawCalls;
+    lastVertices = vertices;
+    drawCalls = 0;
+    vertices = 0;
+
+    // Texts are updated twice per second. Otherwise the numbers are unreadable.
+    float elapsed = updateClock.getElapsedTime().asSeconds();
+    if (elapsed >= 0.5f) {
+        updateTexts(elapsed);
+        updateClock.restart();
+    }
+}
+
+void PerfOverlay::tickFinished(sf::Time tickTime)
+{
+    ticks++;
+    tickMicros += tickTime.asMicroseconds();
+}
+
+void PerfOverlay::addRenderLockWait(sf::Time waitTime)
+{
+    renderLockMs += waitTime.asSeconds() * 1000;
+}
+
+void PerfOverlay::addSimLockWait(sf::Time waitTime)
+{
+    simLockMicros += waitTime.asMicroseconds();
+}
+
+void PerfOverlay::setEntityCounts(int bullets, int missiles, int trackWeapons)
+{
+    bulletCount = bullets;
+    missileCount = missiles;
+    trackWeaponCount = trackWeapons;
+}
+
+void PerfOverlay::setEventCounts(int laps, int pickups, int destroyed, unsigned int dropped)
+{
+    lapEvents = laps;
+    pickupEvents = pickups;
+    destroyedEvents = destroyed;
+    droppedEvents = dropped;
+}
+
+void PerfOverlay::setNetworkStats(float kbitPerSecond, float decodeMicros, float predictionError)
+{
+    networkKbit = kbitPerSecond;
+    networkDecodeMicros = decodeMicros;
+    networkPredictionError = predictionError;
+}
+
+void PerfOverlay::updateTexts(float elapsed)
+{
+    // Take the simulation counters and start a new measuring period.
+    int tickCount = ticks.exchange(0);
+    float simMs = tickMicros.exchange(0) / 1000.0f;
+    float simLockMs = simLockMicros.exchange(0) / 1000.0f;
+
+    float elapsedMs = elapsed * 1000;
+    // Share of the wall clock time spent rendering, simulating and waiting for the lock.
+    float renderShare = 100 * renderMs / elapsedMs;
+    float simShare = 100 * simMs / elapsedMs;
+    float lockShare = 100 * (renderLockMs + simLockMs) / elapsedMs;
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << "FPS: " << frames / elapsed << "   worst frame: " << worstFrameMs << " ms" << std::endl;
+    ss << "Render: " << (frames > 0 ? renderMs / frames : 0) << " ms/frame (" << renderShare << " %)" << std::endl;
+    ss << "Sim: " << tickCount / elapsed << " ticks/s  "
+       << std::setprecision(3) << (tickCount > 0 ? simMs / tickCount : 0) << " ms/tick"
+       << std::setprecision(1) << " (" << simShare << " %)" << std::endl;
+    ss << "Lock wait: render " << renderLockMs / elapsed << " ms/s  sim "
+       << simLockMs / elapsed << " ms/s" << std::endl;
+    ss << "Draw calls: " << lastDrawCalls << "   vertices: " << lastVertices << std::endl;
+    ss << "Bullets: " << bulletCount << "  missiles: " << missileCount
+       << "  weapons: " << trackWeaponCount << std::endl;
+    ss << "Events: laps " << lapEvents << "  pickups " << pickupEvents << "  destroyed "
+       << destroyedEvents << "  dropped " << droppedEvents << std::endl;
+    if (networkKbit >= 0) {
+        ss << "Net: " << networkKbit << " kbit/s  decode " << networkDecodeMicros << " us"
+           << "  correction " << networkPredictionError << " px" << std::endl;
+    }
+
+    // The largest share tells where a stall comes from.
+    ss << "Bound: ";
+    if (lockShare >= renderShare && lockShare >= simShare) {
+        ss << "lock";
+    }
+    else if (simShare >= renderShare) {
+        ss << "sim";
+    }
+    else {
+        ss << "render";
+    }
+    statsText.setString(ss.str());
+
+    frames = 0;
+    renderMs = 0;
+    worstFrameMs = 0;
+    renderLockMs = 0;
+}
+
+void PerfOverlay::updateGraph()
+{
+    float bottom = GRAPH_Y + GRAPH_HEIGHT;
+    float step = (PANEL_WIDTH - 16) / (GRAPH_SAMPLES - 1);
+    for (std::size_t i = 0; i < GRAPH_SAMPLES; i++) {
+        // Start from the oldest sample so that the newest one is on the right.
+        float ms = frameTimes[(frameIndex + i) % GRAPH_SAMPLES];
+        float height = std::min(ms, GRAPH_HEIGHT);
+        graph[i].position = sf::Vector2f(PANEL_X + 8 + i * step, bottom - height);
+        graph[i].color = ms > 1000.0f / 30 ? sf::Color(255, 60, 60) : sf::Color(230, 230, 230);
+    }
+}
+
+void PerfOverlay::draw(sf::RenderWindow& window)
+{
+    if (!visible) {
+        return;
+    }
+    updateGraph();
+    window.draw(background);
+    countDraw(background);
+    window.draw(statsText);
+    countDraw(statsText);
+    window.draw(graphGrid);
+    countDraw(graphGrid.getVertexCount());
+    window.draw(graph);
+    countDraw(graph.getVertexCount());
+}
+
+// static
+void PerfOverlay::countDraw(const sf::Shape& shape)
+{
+    if (!counting) {
+        return;
+    }
+    // The fill is a triangle fan with the center point and a closing point.
+    drawCalls++;
+    vertices += shape.getPointCount() + 2;
+    // The outline is a separate triangle strip.
+    if (shape.getOutlineThickness() != 0) {
+        drawCalls++;
+        vertices += (shape.getPointCount() + 1) * 2;
+    }
+}
+
+// static
+void PerfOverlay::countDraw(const sf::Text& text)
+{
+    if (!counting) {
+        return;
+    }
+    // Every visible glyph is a quad made of two triangles.
+    const sf::String& str = text.getString();
+    unsigned int glyphs = 0;
+    for (auto it = str.begin(); it != str.end(); it++) {
+        if (*it != ' ' && *it != '\t' && *it != '\n') {
+            glyphs++;
+        }
+    }
+    drawCalls++;
+    vertices += glyphs * 6;
+}
+
+// static
+void PerfOverlay::countDraw(const sf::Sprite&)
+{
+    if (!counting) {
+        return;
+    }
+    drawCalls++;
+    vertices += 4;
+}
+
+// static
+void PerfOverlay::countDraw(std::size_t vertexCount)
+{
+    if (!counting) {
+        return;
+    }
+    drawCalls++;
+    vertices += vertexCount;
+}
@@ -0,0 +1,74 @@
+#include <algorithm>
+
+#include "physicsMath.hpp"
+
+namespace physmath {
+
+#ifdef FIXED_POINT_PHYSICS
+
+    structures::Point transformPoint(const sf::Transformable& object, const sf::Vector2f& point)
+    {
+        // The transform of sf::Transformable: scale and rotate about the origin, then move.
+        Fixed sine, cosine;
+        fixedmath::sincosDeg(Fixed(object.getRotation()), sine, cosine);
+        Fixed x = Fixed(object.getScale().x) * (Fixed(point.x) - Fixed(object.getOrigin().x));
+        Fixed y = Fixed(object.getScale().y) * (Fixed(point.y) - Fixed(object.getOrigin().y));
+        Fixed worldX = x * cosine - y * sine + Fixed(object.getPosition().x);
+        Fixed worldY = x * sine + y * cosine + Fixed(object.getPosition().y);
+        return structures::Point(static_cast<float>(worldX.toDouble()), static_cast<float>(worldY.toDouble()));
+    }
+
+    structures::Point inverseTransformPoint(const sf::Transformable& object, const sf::Vector2f& point)
+    {
+        // Move, rotate back and scale back about the origin.
+        Fixed sine, cosine;
+        fixedmath::sincosDeg(Fixed(object.getRotation()), sine, cosine);
+        Fixed x = Fixed(point.x) - Fixed(object.getPosition().x);
+        Fixed y = Fixed(point.y) - Fixed(object.getPosition().y);
+        Fixed localX = (x * cosine + y * sine) / Fixed(object.getScale().x) + Fixed(object.getOrigin().x);
+        Fixed localY = (y * cosine - x * sine) / Fixed(object.getScale().y) + Fixed(object.getOrigin().y);
+        return structures::Point(static_cast<float>(localX.toDouble()), static_cast<float>(localY.toDouble()));
+    }
+
+    sf::FloatRect getGlobalBounds(const sf::Shape& shape)
+    {
+        // The corners of the local bounds, like sf::Transform::transformRect().
+        sf::FloatRect local = shape.getLocalBounds();
+        const sf::Vector2f corners[4] = {
+            {local.left, local.top}, {local.left, local.top + local.height},
+            {local.left + local.width, local.top}, {local.left + local.width, local.top + local.height}
+        };
+        structures::Point first = transformPoint(shape, corners[0]);
+        float left = first.x, top = first.y, right = first.x, bottom = first.y;
+        for (int i = 1; i < 4; i++) {
+            structures::Point p = transformPoint(shape, corners[i]);
+            left = std::min(left, p.x);
+            top = std::min(top, p.y);
+            right = std::max(right, p.x);
+            bottom = std::max(bottom, p.y);
+        }
+        return sf::FloatRect(left, top, right - left, bottom - top);
+    }
+
+#else
+
+    structures::Point transformPoint(const sf::Transformable& object, const sf::Vector2f& point)
+    {
+        sf::Vector2f transformed = object.getTransform().transformPoint(point);
+        return structures::Point(transformed.x, transformed.y);
+    }
+
+    structures::Point inverseTransformPoint(const sf::Transformable& object, const sf::Vector2f& point)
+    {
+        sf::Vector2f local = object.getInverseTransform().transformPoint(point);
+        return structures::Point(local.x, local.y);
+    }
+
+    sf::FloatRect getGlobalBounds(const sf::Shape& shape)
+    {
+        return shape.getGlobalBounds();
+    }
+
+#endif
+
+}
@@ -1,7 +1,9 @@
+#include <limits>
 #include <vector>
 #include <SFML/Graphics.hpp>
 
 #include "polygon.hpp"
+#include "physicsMath.hpp"
 #include "structures.hpp"
 #include "line.hpp"
 
@@ -28,8 +30,8 @@ Polygon::Polygon(const sf::Shape &shape) {
 
 bool Polygon::intersects(const Polygon &poly2) {
     // loop through the lines and check for intersections
-    for (Line lineOne : lines) {
-        for (Line lineTwo : poly2.getLines()) {
+    for (const Line& lineOne : lines) {
+        for (const Line& lineTwo : poly2.getLines()) {
             if (lineOne.intersects(lineTwo)) {
                 return true;
             }
@@ -40,9 +42,9 @@ bool Polygon::intersects(const Polygon &poly2) {
 
 const Line Polygon::getCrashedLine(const Polygon &poly2) {
     // loop through the lines and check for intersections
-    for (Line lineOne : lines) {
+    for (const Line& lineOne : lines) {
         int index = 0;
-        for (Line lineTwo : poly2.getLines()) {
+        for (const Line& lineTwo : poly2.getLines()) {
             if (lineOne.intersects(lineTwo)) {
                 return poly2.getLines()[index];
             }
@@ -51,21 +53,17 @@ const Line Polygon::getCrashedLine(const Polygon &poly2) {
     }
     // Failed to determine line --> return line with NaN-points.
     // Error handling must be performed where function is called.
-    structures::Point point = {std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN()};
+    structures::Point point = {std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::quiet_NaN()};
     Line line(point, point);
     return line;
 }
 
-const std::vector<Line> Polygon::getLines() const {
+const std::vector<Line>& Polygon::getLines() const {
     return lines;
 }
 
 structures::Point getTransformedPoint(const sf::Shape &shape, const int& index) {
-    structures::Point pointOriginal = {shape.getPoint(index).x, shape.getPoint(index).y};
-    sf::Transform tran = shape.getTransform();
-    structures::Point pointTransformed = {tran.transformPoint(pointOriginal.x, pointOriginal.y).x,
-        tran.transformPoint(pointOriginal.x, pointOriginal.y).y};
-    return pointTransformed;
+    return physmath::transformPoint(shape, shape.getPoint(index));
 }
 
 
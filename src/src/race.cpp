@@ -1,15 +1,31 @@
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
+#include <limits>
 #include <sstream>
+#include <random>
 
 #include "constants.hpp"
 #include "race.hpp"
 #include "missile.hpp"
+#include "netProtocol.hpp"
+#include "physicsMath.hpp"
+#include "replay.hpp"
+#include "resources.hpp"
+#include "settings.hpp"
+#include "timeTrial.hpp"
+#include "splitScreen.hpp"
+#include "car.hpp"
+#include "aicar.hpp"
 
 Race::Race(std::string& xmlfile) : camera(WIDTH, HEIGHT), track(xmlfile),
 viewDivider(sf::Vector2f(10, 2 * HEIGHT)) {
+    // Every race gets a random seed unless a replay sets it.
+    setSeed(std::random_device()());
+
     //viewDivider is constructed here, but not used in this class.
     // Only SplitScreen uses it.
-    if (!flagTexture.loadFromFile("../images/flag2.png")) {
+    if (!settings::headless && !flagTexture.loadFromFile("../images/flag2.png")) {
         if (!flagTexture.loadFromFile("../../images/flag2.png")) {
             std::cerr << "Failed to load flag texture" << std::endl;
         }
@@ -18,6 +34,25 @@ viewDivider(sf::Vector2f(10, 2 * HEIGHT)) {
     flagShape.setPosition(400, 500);
     flagShape.setScale(0.25, 0.25);
 
+    // One sprite draws the explosions of all the destroyed vehicles.
+    if (!settings::headless) {
+        const sf::Texture* explosionTexture = resources::getTexture("boom4.png");
+        if (explosionTexture == nullptr) {
+            std::cerr << "Cannot load explosion texture." << std::endl;
+        } else {
+            explosionSprite.setTexture(*explosionTexture);
+        }
+    }
+    explosionSprite.setScale(sf::Vector2f(0.1f, 0.1f)); // Original image is too big
+
+    // Bullets and missiles received from a server look like the local ones.
+    remoteBullet.setSize(sf::Vector2f(30, 10));
+    remoteBullet.setFillColor(sf::Color(50, 205, 50));
+    remoteMissile.setSize(sf::Vector2f(60, 30));
+    if (!settings::headless) {
+        remoteMissile.setTexture(resources::getTexture("missile.png"));
+    }
+
     raceType = RaceType::NormalRace;
 }
 
@@ -25,20 +60,55 @@ Race::~Race() {
     //bullets.clear();
 }
 
-std::vector<std::shared_ptr<Vehicle>> Race::getVehicles() const {
-    return vehicles;
+Camera& Race::getCamera() {
+    return camera;
 }
 
-std::vector<std::shared_ptr<AIVehicle>> Race::getAIVehicles() const {
-    return aivehicles;
+// static
+std::unique_ptr<Race> Race::create(const RaceSetup& setup) {
+    // Constructors take a non-const reference.
+    std::string xmlfile = setup.xmlfile;
+    std::unique_ptr<Race> race;
+    // Note that inside Race, TimeTrial and SplitScreen refer to the enum values.
+    switch (setup.raceType) {
+        case RaceType::TimeTrial:
+            race = std::make_unique<::TimeTrial>(xmlfile);
+            break;
+        case RaceType::SplitScreen:
+            race = std::make_unique<::SplitScreen>(xmlfile);
+            break;
+        default: // NormalRace and Practice
+            race = std::make_unique<Race>(xmlfile);
+            break;
+    }
+    if (!race->isSplitScreen()) {
+        race->getCamera().zoomOut(20);
+    }
+    return race;
 }
 
-Camera& Race::getCamera() {
-    return camera;
+void Race::addVehicles(const RaceSetup& setup) {
+    for (int i = 0; i < setup.bots; i++) {
+        addAIVehicle(std::make_shared<AICar>(setup.vehicleWidth, setup.vehicleHeight, setup.vehicleImage));
+    }
+    for (int i = 0; i < setup.players; i++) {
+        addVehicle(std::make_shared<Car>(setup.vehicleWidth, setup.vehicleHeight, setup.vehicleImage));
+    }
+}
+
+void Race::setSeed(unsigned int newSeed) {
+    seed = newSeed;
+    track.setSeed(seed);
+}
+
+double Race::getRaceTime() const {
+    return (tick - clockStartTick) * TICK_TIME;
 }
 
-sf::Clock& Race::getRaceClock() {
-    return raceClock;
+double Race::restartRaceClock() {
+    double time = getRaceTime();
+    clockStartTick = tick;
+    return time;
 }
 
 void Race::addVehicle(std::shared_ptr<Vehicle> vehicle) {
@@ -57,56 +127,60 @@ void Race::initialize() {
 
     // Set colors to vehicles
     int j = 0;
-    for (auto v : vehicles) {
-        v->getShape().setFillColor(colors[j]);
+    for (auto &v : vehicles) {
+        v->getShape().setFillColor(colors[j % colors.size()]);
         j++;
     }
-    for (auto v : aivehicles) {
-        v->getShape().setFillColor(colors[j]);
+    for (auto &v : aivehicles) {
+        v->getShape().setFillColor(colors[j % colors.size()]);
         j++;
     }
 
+    // If there are more vehicles than spawnpoints, the rest start in rows behind them.
+    const auto& spawnpoints = track.getSpawnpoints();
     int index = 0;
-    for (decltype(vehicles.size()) i = 0; i != vehicles.size(); i++) {
-        structures::Point spawnpoint = track.getSpawnpoints()[i];
-        vehicles[i]->getPhysics().move(spawnpoint.x, spawnpoint.y);
+    auto spawn = [&](Vehicle& v) {
+        structures::Point spawnpoint = spawnpoints[index % spawnpoints.size()];
+        float row = static_cast<float>(index / spawnpoints.size());
+        v.getPhysics().move(spawnpoint.x - row * (v.getPhysics().getWidth() + 20), spawnpoint.y);
         index++;
+    };
+    for (auto &v : vehicles) {
+        spawn(*v);
     }
-    for (decltype(aivehicles.size()) i = 0; i != aivehicles.size(); i++) {
-        structures::Point spawnpoint = track.getSpawnpoints()[index];
-        aivehicles[i]->getPhysics().move(spawnpoint.x, spawnpoint.y);
-        index++;
+    for (auto &v : aivehicles) {
+        spawn(*v);
     }
 
     // Create all texts here.
     createTexts();
     createPlayerStatus();
 
-    // Set vehicle places and set unique ID to each vehicle.
+    // Set unique ID to each vehicle. The entity of a vehicle in the registry is ID - 1.
+    registry = std::make_shared<VehicleRegistry>();
     int ID = 1;
-    for (auto v : vehicles) {
-        racePlaces.push_back(v);
+    for (auto &v : vehicles) {
         v->setID(ID);
+        v->moveTo(registry);
         ID++;
     }
-    for (auto v : aivehicles) {
-        racePlaces.push_back(v);
+    for (auto &v : aivehicles) {
         v->setID(ID);
+        v->moveTo(registry);
         ID++;
     }
-    fixPlaces();
+    updateStandings();
 }
 
 void Race::drawObjects(sf::RenderWindow &window) {
     track.drawTrack(window);
+    drawGhost(window); // Does nothing if caller is Race-class.
     // We use auto because we don't know the actual type of vehicle (Car, Boat, etc.)
-    for (auto v : vehicles) {
+    for (auto &v : vehicles) {
         if (!v->isDestroyed()) {
             v->drawVehicle(window);
         } else { // If the vehicle is destroyed, draw the greatest "animation" you have ever seen!
-            v->getExplosionSprite().setPosition(v->getPhysics().getX() - 100, v->getPhysics().getY() - 100);
-            v->getExplosionSprite().setScale(sf::Vector2f(0.1f, 0.1f)); // Original image is too big
-            window.draw(v->getExplosionSprite());
+            drawExplosion(window, *v);
         }
         // Draw bullets owned by vehicles
         for (Bullet &b : v->getBullets()) {
@@ -121,43 +195,67 @@ void Race::drawObjects(sf::RenderWindow &window) {
     }
 
     // AI Vehicles
-    for (auto v : aivehicles) {
+    for (auto &v : aivehicles) {
         if (!v->isDestroyed()) {
             v->drawVehicle(window);
         } else {
-            v->getExplosionSprite().setPosition(v->getPhysics().getX() - 100, v->getPhysics().getY() - 100);
-            v->getExplosionSprite().setScale(sf::Vector2f(0.1f, 0.1f)); // Original image is too big
-            window.draw(v->getExplosionSprite());
+            drawExplosion(window, *v);
         }
     }
 
+    // Bullets and missiles of a network race.
+    for (const net::ProjectileState& p : remoteProjectiles) {
+        sf::RectangleShape& shape = p.type == net::ProjectileState::MISSILE ? remoteMissile : remoteBullet;
+        shape.setPosition(p.x, p.y);
+        shape.setRotation(p.rotation);
+        window.draw(shape);
+        PerfOverlay::countDraw(shape);
+    }
+
     //window.draw(clockText);
     window.draw(countdownText);
+    PerfOverlay::countDraw(countdownText);
+
+    // Entity counts are only needed by the performance overlay.
+    if (perfOverlay.isVisible()) {
+        int bullets = 0;
+        int missiles = 0;
+        for (auto &v : vehicles) {
+            for (Bullet &b : v->getBullets()) {
+                if (b.isFlying) {
+                    bullets++;
+                }
+            }
+            for (auto &w : v->getWeapons()) {
+                if (w->getMissile() != NULL && w->getMissile()->isFlying && !w->getMissile()->isDestroyed) {
+                    missiles++;
+                }
+            }
+        }
+        perfOverlay.setEntityCounts(bullets, missiles, track.getWeapons().size());
+    }
+}
+
+void Race::drawExplosion(sf::RenderWindow& window, Vehicle& vehicle) {
+    explosionSprite.setPosition(vehicle.getPhysics().getX() - 100, vehicle.getPhysics().getY() - 100);
+    window.draw(explosionSprite);
+    PerfOverlay::countDraw(explosionSprite);
 }
 
 void Race::drawStaticObjects(sf::RenderWindow &window) {
-    window.draw(clockText);
-    window.draw(lapsText);
-    //window.draw(playerStatusText);
     drawPlayerWeapons(window);
-    for (auto &t : playerTexts) {
-        window.draw(t);
-    }
-    for (auto &t : botTexts) {
-        window.draw(t);
-    }
-    for (sf::RectangleShape rect : helmetIcons) {
-        window.draw(rect);
-    }
-    drawTimeTrialObjects(window); // Does nothing if caller is Race-class.
+    hud.draw(window); // clock, laps, helmet icons and status texts
     drawViewDivider(window);
     if (isEnd) {
         window.draw(winnerText);
+        PerfOverlay::countDraw(winnerText);
         window.draw(flagShape);
+        PerfOverlay::countDraw(flagShape);
         if (flagShape.getPosition().y > 0) {
             flagShape.move(0, -2);
         }
     }
+    perfOverlay.draw(window); // Does nothing if the overlay is hidden.
 }
 
 void Race::drawPlayerWeapons(sf::RenderWindow& window) {
@@ -173,30 +271,23 @@ void Race::drawPlayerWeapons(sf::RenderWindow& window) {
 void Race::createTexts() {
 
     // Load the font, which is used in all texts.
-    if (!textFont.loadFromFile("../images/fonts/open-sans/OpenSans-Bold.ttf")) {
+    if (!settings::headless && !textFont.loadFromFile("../images/fonts/open-sans/OpenSans-Bold.ttf")) {
         if (!textFont.loadFromFile("../../images/fonts/open-sans/OpenSans-Bold.ttf")) {
             std::cerr << "Cannot load fonts." << std::endl;
         }
     }
+    hud.clear();
+    hud.setFont(textFont);
+
     // Clock text, which shows the elapsed time.
-    clockText.setFont(textFont);
-    clockText.setCharacterSize(36);
-    clockText.setPosition(WIDTH - 120, 5);
-    clockText.setString("0.00");
+    clockText = hud.addText(36, sf::Vector2f(WIDTH - 120, 5), sf::Color(200, 200, 200));
+    hud.setString(clockText, "0.00");
 
-    // Lap text, which shows lap progression.
-    lapsText.setFont(textFont);
-    lapsText.setCharacterSize(36);
-    lapsText.setPosition(WIDTH - 400, 5);
-    lapsText.setString("0");
+    perfOverlay.setFont(textFont);
 
-#ifdef _WIN32
-    clockText.setFillColor(sf::Color(200, 200, 200));
-    lapsText.setFillColor(sf::Color(200, 200, 200));
-#else
-    clockText.setColor(sf::Color(200, 200, 200));
-    lapsText.setColor(sf::Color(200, 200, 200));
-#endif
+    // Lap text, which shows lap progression.
+    lapsText = hud.addText(36, sf::Vector2f(WIDTH - 400, 5), sf::Color(200, 200, 200));
+    hud.setString(lapsText, "0");
 
     // Set position of the view divider. It's drawn only in Split Screen class.
     viewDivider.setPosition(WIDTH / 2 - 5, 0);
@@ -215,107 +306,477 @@ void Race::createTexts() {
 void Race::createPlayerStatus() {
 
     // Create helmet icons
-    if (!helmetTexture.loadFromFile("../images/helmet_icon3.png")) {
+    if (!settings::headless && !helmetTexture.loadFromFile("../images/helmet_icon3.png")) {
         if (!helmetTexture.loadFromFile("../../images/helmet_icon3.png")) {
             std::cerr << "Cannot load helmet textures." << std::endl;
         }
     }
+    hud.setIconTexture(helmetTexture);
     // Helmet icons for players
     for (decltype(vehicles.size()) i = 0; i != vehicles.size(); i++) {
-        sf::RectangleShape rect(sf::Vector2f(30, 30));
-        rect.setTexture(&helmetTexture);
         if (i > 3) throw std::logic_error("Only 4 default helmet colors set.");
-        rect.setFillColor(helmetIconColors[i]);
-        rect.setPosition(5, 5 + i * 30);
-        helmetIcons.push_back(rect);
-    }
-    // Helmet icons for bots.
-    for (decltype(aivehicles.size()) i = 0; i != aivehicles.size(); i++) {
-        sf::RectangleShape rect(sf::Vector2f(30, 30));
-        rect.setTexture(&helmetTexture);
-        if (i > 3) throw std::logic_error("Only 4 default helmet colors set.");
-        rect.setFillColor(helmetIconColors[i]);
-        rect.setPosition(5, 80 + i * 30);
-        helmetIcons.push_back(rect);
-    }
-    // Set text formatting for both player and bot texts.
-    sf::Text text;
-    text.setFont(textFont);
-    text.setCharacterSize(20);
-    //text.setPosition(40, 8);
-    playerTexts.insert(playerTexts.begin(), vehicles.size(), text);
-    int i = 0;
+        hud.addIcon(sf::FloatRect(5, 5 + i * 30, 30, 30), helmetIconColors[i]);
+    }
+    // Helmet icons for bots. Only the first bots fit on the screen.
+    const std::size_t botStatusCount = std::min<std::size_t>(aivehicles.size(), helmetIconColors.size());
+    for (decltype(aivehicles.size()) i = 0; i != botStatusCount; i++) {
+        hud.addIcon(sf::FloatRect(5, 80 + i * 30, 30, 30), helmetIconColors[i]);
+    }
+    // Player and bot texts. The strings are set in updateTexts.
+    playerTexts.clear();
+    botTexts.clear();
     int j = 0;
-    for (sf::Text& txt : playerTexts) {
-        txt.setString("Default"); // Changed in updateTexts
-        txt.setPosition(40, 5 + i * 30);
-        txt.setColor(colors[j]);
-        i++;
+    for (decltype(vehicles.size()) i = 0; i != vehicles.size(); i++) {
+        playerTexts.push_back(hud.addText(20, sf::Vector2f(40, 5 + i * 30), colors[j % colors.size()]));
         j++;
     }
-    i = 0;
-    botTexts.insert(botTexts.begin(), aivehicles.size(), text);
-    for (sf::Text& txt : botTexts) {
-        txt.setString("Default");
-        txt.setPosition(40, 70 + 5 + i * 30);
-        txt.setColor(colors[j]);
-        i++;
+    for (decltype(aivehicles.size()) i = 0; i != botStatusCount; i++) {
+        botTexts.push_back(hud.addText(20, sf::Vector2f(40, 70 + 5 + i * 30), colors[j % colors.size()]));
         j++;
     }
 }
 
 void Race::startRace() {
-    raceClock.restart();
+    restartRaceClock();
     isStarted = true;
 }
 
-void Race::checkCollisions() {
-    /*****
-     NOTE! This function is called from a separate thread in Game class.
-     ******/
-    for (auto& v : vehicles) {
-        if (track.isWallHit(v->getShape())) {
-            v->getPhysics().handleCollision(track.getCrashedLine(v->getShape()), track, v->getShape());
-            v->damageVehicle(10); // Just testing. Not final.
-            collisionFlag = true;
+void Race::step() {
+    tick++;
+    if (!isStarted && !isEnd && tick >= static_cast<unsigned int>(COUNTDOWN_TICKS)) {
+        startRace();
+    }
+
+    // Control inputs of this tick come either from the keyboard or from the replay.
+    if (playback != nullptr) {
+        std::vector<Controls> controls;
+        playback->play(controls);
+        for (decltype(vehicles.size()) i = 0; i != vehicles.size() && i != controls.size(); i++) {
+            vehicles[i]->setInputControls(controls[i]);
         }
-        // Check checkpoint "collision"
-        if (track.isCheckpointHit(v->getShape(), v->visitedCheckPoints)) {
-            // v->visitedCheckPoints in an INTEGER value, which tells how many checkpoints are passed
-            // during this lap
-            v->lastCheckpoint = &(track.getCheckpoints()[v->visitedCheckPoints]);
-            // now lastCheckpoint points to the last passed checkpoint (sf::RectangleShape in Track-class)
-            v->visitedCheckPoints++; // Increase integer value by one
-            fixPlaces();
+    }
+    if (recording != nullptr) {
+        std::vector<Controls> controls;
+        for (auto &v : vehicles) {
+            controls.push_back(v->getInputControls());
+        }
+        recording->record(controls);
+    }
+    applyControls();
+
+    updateDetailLevels();
+    if (isStarted) {
+        handleAI();
+    }
+    update();
+    checkCollisions();
+    // The vehicles don't move during the rest of the tick.
+    registry->gather();
+    spatialIndex.build(*registry);
+    hitboxHistory.record(tick, *registry);
+    updateBullets();
+    updateTurbo();
+    updateMissiles();
+    checkHits(); // finish line hit and weapon hit
+    publishDestroyed();
+    updateStandings();
+    track.update();
+
+    hashState(stateHash);
+    if (recording != nullptr && tick % Replay::CHECK_INTERVAL == 0) {
+        recording->recordCheck(stateHash);
+    }
+    if (playback != nullptr) {
+        checkReplay();
+    }
+}
+
+void Race::hashState(StateHash& hash) const {
+    hash.tick = tick;
+    hash.components.resize(StateHash::FIRST_VEHICLE + vehicles.size() + aivehicles.size());
+
+    StateHasher status;
+    status.add(tick);
+    status.add(clockStartTick);
+    status.add(isStarted);
+    status.add(isEnd);
+    status.add(lapsDriven);
+    for (std::size_t e : registry->getStandings()) {
+        status.add(static_cast<int>(e + 1));
+    }
+    hash.components[StateHash::RACE] = status.get();
+
+    StateHasher trackHasher;
+    track.hashState(trackHasher);
+    hash.components[StateHash::TRACK] = trackHasher.get();
+
+    // The previous value is kept between the hashes of the random engine.
+    if (tick % StateHash::RNG_INTERVAL == 0) {
+        StateHasher rngHasher;
+        rngHasher.addBytes(&track.getRandomEngine(), sizeof(std::mt19937));
+        hash.components[StateHash::RANDOM_ENGINE] = rngHasher.get();
+    }
+
+    std::size_t i = StateHash::FIRST_VEHICLE;
+    for (auto &v : vehicles) {
+        StateHasher vehicleHasher;
+        v->hashState(vehicleHasher);
+        hash.components[i++] = vehicleHasher.get();
+    }
+    for (auto &v : aivehicles) {
+        StateHasher vehicleHasher;
+        v->hashState(vehicleHasher);
+        hash.components[i++] = vehicleHasher.get();
+    }
+
+    StateHasher total;
+    total.add(hash.total);
+    for (sf::Uint64 component : hash.components) {
+        total.add(component);
+    }
+    hash.total = total.get();
+}
+
+void Race::dumpStateComponent(std::ostream& out, std::size_t component) {
+    out << StateHash::getComponentName(component) << " on tick " << tick << ":" << std::endl;
+    if (component == StateHash::RACE) {
+        out << "started " << isStarted << ", ended " << isEnd << ", laps driven " << lapsDriven
+            << ", clock started on tick " << clockStartTick << std::endl << "standings (IDs):";
+        for (std::size_t e : registry->getStandings()) {
+            out << " " << e + 1;
+        }
+        out << std::endl;
+    }
+    else if (component == StateHash::TRACK) {
+        for (auto &w : track.getWeapons()) {
+            out << "pickup type " << w->getType() << " at (" << w->getShape().getPosition().x
+                << ", " << w->getShape().getPosition().y << ")" << std::endl;
+        }
+    }
+    else if (component == StateHash::RANDOM_ENGINE) {
+        std::mt19937 copy = track.getRandomEngine();
+        out << "next random number " << copy() << std::endl;
+    }
+    else {
+        Vehicle* v = getVehicleByID(static_cast<int>(component - StateHash::FIRST_VEHICLE + 1));
+        if (v == nullptr) {
+            return;
+        }
+        out << "HP " << v->getHP() << ", laps " << v->getLaps() << ", checkpoints " << v->getVisitedCheckPoints()
+            << ", place " << v->getRacePlace() << std::endl << v->getPhysics() << "weapons:";
+        for (auto &w : v->getWeapons()) {
+            out << " " << w->getType();
+        }
+        int flying = 0;
+        for (Bullet& b : v->getBullets()) {
+            flying += b.isFlying ? 1 : 0;
+        }
+        out << std::endl << "bullets " << v->getBullets().size() << ", flying " << flying << std::endl;
+    }
+}
+
+void Race::checkReplay() {
+    int component = -1;
+    if (playback->check(stateHash, component)) {
+        return;
+    }
+    std::cerr << "Desync on tick " << tick << ": the state differs from the recording. ";
+    if (component < 0) {
+        std::cerr << "It diverged before and is the same again." << std::endl;
+    }
+    else {
+        std::cerr << "The first divergent component:" << std::endl;
+        dumpStateComponent(std::cerr, component);
+    }
+}
+
+void Race::writeSnapshot(net::Snapshot& snapshot) {
+    snapshot.tick = tick;
+    snapshot.clockStartTick = clockStartTick;
+    snapshot.started = isStarted;
+    snapshot.ended = isEnd;
+    snapshot.lapsDriven = static_cast<sf::Uint8>(lapsDriven);
+    snapshot.vehicles.clear();
+    snapshot.projectiles.clear();
+    auto addVehicle = [&snapshot](Vehicle& v) {
+        const VehiclePhysics& physics = v.getPhysics();
+        net::VehicleState state;
+        state.id = static_cast<sf::Uint8>(v.getID());
+        state.x = static_cast<float>(physics.getX());
+        state.y = static_cast<float>(physics.getY());
+        state.rotation = static_cast<float>(physics.getRotation());
+        state.vx = static_cast<float>(physics.getVelocity().x);
+        state.vy = static_cast<float>(physics.getVelocity().y);
+        state.hp = static_cast<sf::Int16>(v.getHP());
+        state.laps = static_cast<sf::Uint8>(v.getLaps());
+        state.checkpoints = static_cast<sf::Uint8>(v.getVisitedCheckPoints());
+        state.place = static_cast<sf::Uint8>(v.getRacePlace());
+        const auto& weapons = v.getWeapons();
+        for (std::size_t i = 0; i != net::MAX_WEAPONS; i++) {
+            state.weapons[i] = static_cast<sf::Uint8>(i < weapons.size() ? weapons[i]->getType() : Weapon::UNDEFINED);
+        }
+        snapshot.vehicles.push_back(state);
+
+        for (Bullet& b : v.getBullets()) {
+            if (b.isFlying) {
+                snapshot.projectiles.push_back({net::ProjectileState::BULLET, state.id,
+                                                static_cast<float>(b.getPhysics().getX()),
+                                                static_cast<float>(b.getPhysics().getY()),
+                                                static_cast<float>(b.getPhysics().getRotation())});
+            }
+        }
+        for (auto& w : weapons) {
+            Missile* m = w->getMissile();
+            if (m != NULL && m->isFlying && !m->isDestroyed) {
+                const sf::RectangleShape& shape = m->getShape();
+                snapshot.projectiles.push_back({net::ProjectileState::MISSILE, state.id,
+                                                shape.getPosition().x, shape.getPosition().y,
+                                                shape.getRotation()});
+            }
+        }
+    };
+    for (auto &v : vehicles) {
+        addVehicle(*v);
+    }
+    for (auto &v : aivehicles) {
+        addVehicle(*v);
+    }
+
+    snapshot.pickups.clear();
+    for (auto& w : track.getWeapons()) {
+        const sf::Vector2f& position = w->getShape().getPosition();
+        snapshot.pickups.push_back({static_cast<sf::Uint8>(w->getType()), position.x, position.y});
+    }
+}
+
+void Race::readSnapshot(const net::Snapshot& snapshot) {
+    tick = snapshot.tick;
+    clockStartTick = snapshot.clockStartTick;
+    lapsDriven = snapshot.lapsDriven;
+    isStarted = snapshot.started;
+    bool weaponsChanged = false;
+    for (const net::VehicleState& state : snapshot.vehicles) {
+        Vehicle* v = getVehicleByID(state.id);
+        if (v == nullptr) {
+            continue;
+        }
+        if (localPlayer >= 0 && v == vehicles[localPlayer].get()) {
+            // The local player is predicted and only corrected by the server.
+            v->setRemoteStatus(state.hp, state.laps, state.checkpoints);
+            prediction.reconcile(*v, track, Vector2D(state.x, state.y), state.rotation,
+                                 Vector2D(state.vx, state.vy), snapshot.inputAck);
+        }
+        else {
+            v->setRemoteState(Vector2D(state.x, state.y), state.rotation, Vector2D(state.vx, state.vy),
+                              state.hp, state.laps, state.checkpoints);
+        }
+        v->setRacePlace(state.place);
+
+        // Weapons are created again only when they have changed.
+        auto& weapons = v->getWeapons();
+        bool same = true;
+        for (std::size_t i = 0; i != net::MAX_WEAPONS; i++) {
+            int type = i < weapons.size() ? weapons[i]->getType() : Weapon::UNDEFINED;
+            same = same && type == state.weapons[i];
+        }
+        if (!same) {
+            weapons.clear();
+            for (sf::Uint8 type : state.weapons) {
+                if (type != Weapon::UNDEFINED) {
+                    v->addWeapon(Weapon::create(static_cast<Weapon::WeaponType>(type)));
+                }
+            }
+            weaponsChanged = true;
+        }
+    }
+    if (weaponsChanged) {
+        updateWeaponIcons();
+    }
+    // The leader is needed for the winner text.
+    const std::vector<VehicleRegistry::Progress>& progress = registry->getProgress();
+    std::vector<std::size_t>& standings = registry->getStandings();
+    std::sort(standings.begin(), standings.end(), [&progress](std::size_t a, std::size_t b) {
+        return progress[a].racePlace < progress[b].racePlace;
+    });
+    if (snapshot.ended && !isEnd) {
+        isEnd = true;
+        updateWinnerText();
+    }
+
+    remoteProjectiles = snapshot.projectiles;
+
+    // Pickups are positioned to the nearest pixel.
+    auto& pickups = track.getWeapons();
+    bool samePickups = pickups.size() == snapshot.pickups.size();
+    for (std::size_t i = 0; samePickups && i != pickups.size(); i++) {
+        const sf::Vector2f& position = pickups[i]->getShape().getPosition();
+        samePickups = pickups[i]->getType() == snapshot.pickups[i].type
+                      && std::abs(position.x - snapshot.pickups[i].x) <= 1
+                      && std::abs(position.y - snapshot.pickups[i].y) <= 1;
+    }
+    if (!samePickups) {
+        pickups.clear();
+        for (const net::PickupState& state : snapshot.pickups) {
+            std::unique_ptr<Weapon> weapon = Weapon::create(static_cast<Weapon::WeaponType>(state.type));
+            if (weapon) {
+                weapon->getShape().setPosition(state.x, state.y);
+                pickups.push_back(std::move(weapon));
+            }
+        }
+    }
+}
+
+void Race::saveState(StateBuffer& state) const {
+    state.write(tick);
+    state.write(clockStartTick);
+    state.write(isStarted);
+    state.write(isEnd);
+    state.write(lapsDriven);
+    registry->saveState(state);
+    for (auto &v : vehicles) {
+        v->saveState(state);
+    }
+    for (auto &v : aivehicles) {
+        v->saveState(state);
+    }
+    track.saveState(state);
+    // The standings by ID, the leader first.
+    for (std::size_t e : registry->getStandings()) {
+        state.write(static_cast<int>(e + 1));
+    }
+    // The hash chain, so that re-simulated ticks chain onto the same total as on a peer
+    // that didn't roll back. The hash of the random engine is kept between its hashes.
+    state.write(stateHash.tick);
+    state.write(stateHash.total);
+    sf::Uint64 rngHash = 0;
+    if (stateHash.components.size() > StateHash::RANDOM_ENGINE) {
+        rngHash = stateHash.components[StateHash::RANDOM_ENGINE];
+    }
+    state.write(rngHash);
+}
+
+void Race::loadState(StateBuffer& state) {
+    state.read(tick);
+    state.read(clockStartTick);
+    state.read(isStarted);
+    state.read(isEnd);
+    state.read(lapsDriven);
+    // Before the vehicles, which move their shapes to the restored physics.
+    registry->loadState(state);
+    for (auto &v : vehicles) {
+        v->loadState(state);
+    }
+    for (auto &v : aivehicles) {
+        v->loadState(state);
+    }
+    track.loadState(state);
+    for (std::size_t& e : registry->getStandings()) {
+        int ID;
+        state.read(ID);
+        e = static_cast<std::size_t>(ID - 1);
+    }
+    state.read(stateHash.tick);
+    state.read(stateHash.total);
+    if (stateHash.components.size() <= StateHash::RANDOM_ENGINE) {
+        stateHash.components.resize(StateHash::FIRST_VEHICLE);
+    }
+    state.read(stateHash.components[StateHash::RANDOM_ENGINE]);
+}
+
+void Race::predictLocalPlayer(sf::Uint32 sequence) {
+    Vehicle& vehicle = *vehicles[localPlayer];
+    prediction.predict(vehicle, track, sequence, vehicle.getInputControls(), isStarted && !isEnd);
+}
+
+void Race::applyControls() {
+    // Vehicles don't move before the countdown has finished or after the race has ended.
+    if (!isStarted) {
+        return;
+    }
+    for (auto &v : vehicles) {
+        if (v->isDestroyed()) {
+            continue;
+        }
+        Controls pressed = v->applyControls(v->getInputControls());
+        if (pressed & control::FIRE) {
+            useWeapon(*v);
+        }
+    }
+}
+
+void Race::useWeapon(Vehicle& vehicle) {
+    if (vehicle.getWeapons().empty()) {
+        return;
+    }
+    // Get reference to the FIRST weapon (unique_ptr).
+    // You can use the weapons in the same order they are picked from the track.
+    auto &weapon = vehicle.getWeapons().front();
+    publish(GameEvent::WEAPON_FIRED, vehicle.getID(), weapon->getType());
+
+    if (weapon->getType() == Weapon::WeaponType::GUN) {
+        weapon->useWeapon(); //added this to get sound to play
+        if (vehicle.shoot() <= 0) {
+            // Running out of ammo -> remove weapon from the vehicle
+            vehicle.removeWeapon();
         }
+    } else if (weapon->getType() == Weapon::WeaponType::TURBO) {
+        // Use turbo
+        weapon->useWeapon(getSimTime());
+    } else if (weapon->getType() == Weapon::WeaponType::MISSILE) {
+        // Use missile here
+        weapon->initializeControls(&vehicle, this);
+        weapon->useWeapon();
     }
-    // check AI collisions
-    for (auto& v : aivehicles) {
-        if (track.isWallHit(v->getShape())) {
-            v->getPhysics().handleCollision(track.getCrashedLine(v->getShape()), track, v->getShape());
-            v->damageVehicle(10);
-            collisionFlag = true;
+}
+
+void Race::checkCollisions() {
+    // The players are the first entities, then the bots.
+    std::vector<VehiclePhysics>& physics = registry->getPhysics();
+    std::vector<VehicleRegistry::Progress>& progress = registry->getProgress();
+    const std::size_t players = vehicles.size();
+    for (std::size_t e = 0; e < physics.size(); e++) {
+        Vehicle& v = registry->getVehicle(e);
+        bool isWallChecked = true;
+        if (e >= players) {
+            const AIVehicle& bot = *aivehicles[e - players];
+            // KINEMATIC bots stay on the racing line and only pass checkpoints.
+            if (!isDetailTick(bot)) {
+                continue;
+            }
+            isWallChecked = bot.getDetail() == AIVehicle::Detail::FULL;
+        }
+        const sf::RectangleShape& shape = v.getShape();
+        if (isWallChecked && track.isWallHit(shape)) {
+            physics[e].handleCollision(track.getCrashedLine(shape), track, shape);
+            v.damageVehicle(10); // Just testing. Not final.
+            publish(GameEvent::COLLISION, v.getID());
         }
         // Check checkpoint "collision"
-        if (track.isCheckpointHit(v->getShape(), v->visitedCheckPoints)) {
-            // v->visitedCheckPoints in an INTEGER value, which tells how many checkpoints are passed
+        if (track.isCheckpointHit(shape, progress[e].visitedCheckPoints)) {
+            // visitedCheckPoints in an INTEGER value, which tells how many checkpoints are passed
             // during this lap
-            v->lastCheckpoint = &(track.getCheckpoints()[v->visitedCheckPoints]);
-            // now lastCheckpoint points to the last passed checkpoint (sf::RectangleShape in Track-class)
-            v->visitedCheckPoints++; // Increase integer value by one
-            fixPlaces();
+            progress[e].visitedCheckPoints++; // Increase integer value by one
         }
     }
 }
 
 void Race::handleEvents(sf::Event &event) {
+    camera.handleEvents(event);
+    // Vehicles are controlled by the replay.
+    if (isReplaying()) {
+        return;
+    }
+    // In network play the other players are controlled on other computers.
+    if (localPlayer >= 0) {
+        if (localPlayer < static_cast<int>(vehicles.size())) {
+            vehicles[localPlayer]->handleEvents(event, Vehicle::EventKeys::LEFT);
+        }
+        return;
+    }
     // this part moves player controlled vehicle
     if (!isSplitScreen()) {
-        for (auto v : vehicles) {
-            // Test if vehicle is destroyed
-            if (!v->isDestroyed()) {
-                v->handleEvents(event, Vehicle::EventKeys::LEFT);
-            }
+        for (auto &v : vehicles) {
+            v->handleEvents(event, Vehicle::EventKeys::LEFT);
         }
     } else {
         // Control the first car with W, A, S and D.
@@ -326,80 +787,139 @@ void Race::handleEvents(sf::Event &event) {
             vehicles[1]->handleEvents(event, Vehicle::EventKeys::RIGHT);
         }
     }
-    camera.handleEvents(event);
 }
 
 void Race::handleAI() {
     // this one moves AI
-    for (auto v : aivehicles) {
-        v->moveAI(track);
+    for (auto &v : aivehicles) {
+        if (v->getDetail() == AIVehicle::Detail::FULL) {
+            v->moveAI(track);
+        }
     }
 }
 
+void Race::updateDetailLevels() {
+    // The players are the first entities.
+    const std::vector<VehiclePhysics>& physics = registry->getPhysics();
+    const std::size_t players = vehicles.size();
+    // Positions the cameras follow (see Game::gameLoop).
+    std::vector<Vector2D> focus;
+    for (std::size_t e = 0; e < players; e++) {
+        focus.push_back(physics[e].getPosition());
+    }
+    if (splitScreen && players < 2 && !aivehicles.empty()) {
+        focus.push_back(physics[players].getPosition());
+    }
+    for (std::size_t i = 0; i < aivehicles.size(); i++) {
+        AIVehicle* v = aivehicles[i].get();
+        const Vector2D position = physics[players + i].getPosition();
+        double nearest = std::numeric_limits<double>::max();
+        for (const Vector2D& f : focus) {
+            nearest = std::min(nearest, (position - f).getLengthSquared());
+        }
+        // Hysteresis, so that a bot at the limit doesn't switch on every tick.
+        if (v->getDetail() == AIVehicle::Detail::FULL && nearest > AI_LOD_FAR * AI_LOD_FAR) {
+            v->setDetail(AIVehicle::Detail::KINEMATIC, track);
+        }
+        else if (v->getDetail() == AIVehicle::Detail::KINEMATIC && nearest < AI_LOD_NEAR * AI_LOD_NEAR) {
+            v->setDetail(AIVehicle::Detail::FULL, track);
+        }
+    }
+}
+
+bool Race::isDetailTick(const AIVehicle& vehicle) const {
+    return vehicle.getDetail() == AIVehicle::Detail::FULL || (tick + vehicle.getID()) % AI_LOD_INTERVAL == 0;
+}
+
 void Race::update() {
     /*****
      NOTE! This function is called from a separate thread in Game class
-     about 300 times per sec.
+     TICK_RATE times per sec.
      ******/
     //camera.setViewToWindow(sf::RenderWindow &window)
-    for (auto v : vehicles) {
-        v->update();
-        if (v->isDestroyed()) {
-            v->getPhysics().stop();
+    // The players are the first entities, then the bots.
+    std::vector<VehiclePhysics>& physics = registry->getPhysics();
+    const std::vector<VehicleRegistry::Health>& health = registry->getHealth();
+    const std::size_t players = vehicles.size();
+    for (std::size_t e = 0; e < physics.size(); e++) {
+        if (e >= players) {
+            AIVehicle& v = *aivehicles[e - players];
+            if (v.getDetail() == AIVehicle::Detail::KINEMATIC) {
+                if (isStarted && health[e].hp != 0 && isDetailTick(v)) {
+                    v.moveKinematic(track, AI_LOD_INTERVAL * TICK_TIME);
+                }
+                if (health[e].hp == 0) {
+                    physics[e].stop();
+                }
+                continue;
+            }
         }
-    }
-
-    // update AIVehicles
-    for (auto v : aivehicles) {
-        v->update();
-        if (v->isDestroyed()) {
-            v->getPhysics().stop();
+        physics[e].updatePosition();
+        if (health[e].hp == 0) {
+            physics[e].stop();
         }
     }
+    // Move the shapes (the hitboxes) after the physics.
+    for (std::size_t e = 0; e < registry->size(); e++) {
+        registry->getVehicle(e).syncShape();
+    }
 }
 
 void Race::updateTexts() {
 
+    // Weapon icons move when weapons are picked up or used.
+    bool weaponsChanged = false;
+    GameEvent event;
+    while (events.poll(EventBus::HUD, event)) {
+        if (event.type == GameEvent::PICKUP || event.type == GameEvent::WEAPON_FIRED) {
+            weaponsChanged = true;
+        }
+    }
+    if (weaponsChanged) {
+        updateWeaponIcons();
+    }
+
+    // Texts are formatted again only if the value shown has changed.
     // Update the content of the clock text.
     if (isStarted) {
-        std::stringstream ss;
-        // Convert float to string. Use precision of two decimal digits.
-        ss << std::fixed << std::setprecision(2) << raceClock.getElapsedTime().asSeconds();
-        clockText.setString(ss.str());
+        double time = getRaceTime();
+        if (hud.isChanged(clockText, std::llround(time * 100))) {
+            std::stringstream ss;
+            // Convert float to string. Use precision of two decimal digits.
+            ss << std::fixed << std::setprecision(2) << time;
+            hud.setString(clockText, ss.str());
+        }
     }
 
     // Update also the laps text.
-    std::stringstream ss2;
-    ss2 << "Lap: " << lapsDriven;
-    // If race type is time trial, only driven laps are shown.
-    // e.g. Lap: 5 instead of Lap: 5/8
-    if (raceType != RaceType::TimeTrial) {
-        ss2 << "/" << totalLaps;
+    if (hud.isChanged(lapsText, lapsDriven)) {
+        std::stringstream ss;
+        ss << "Lap: " << lapsDriven;
+        // If race type is time trial, only driven laps are shown.
+        // e.g. Lap: 5 instead of Lap: 5/8
+        if (raceType != RaceType::TimeTrial) {
+            ss << "/" << totalLaps;
+        }
+        hud.setString(lapsText, ss.str());
     }
 
-    lapsText.setString(ss2.str());
-
-
     // Update player texts in the corner
-    ss2.str("");
     int playerCount = vehicles.size() + aivehicles.size();
-    for (unsigned i = 0; i != vehicles.size(); i++) {
-        ss2 << "Player " << vehicles[i]->getID() << ": HP: " << vehicles[i]->getHP()
-                << "  (" << vehicles[i]->getRacePlace() << "/" << playerCount << ")";
-        playerTexts[i].setString(ss2.str());
-        ss2.str("");
+    auto updateStatus = [&](std::size_t text, const char* name, const Vehicle& v) {
+        if (hud.isChanged(text, static_cast<long long>(v.getHP()) << 32 | static_cast<unsigned int>(v.getRacePlace()))) {
+            std::stringstream ss;
+            ss << name << v.getID() << ": HP: " << v.getHP()
+                    << "  (" << v.getRacePlace() << "/" << playerCount << ")";
+            hud.setString(text, ss.str());
+        }
+    };
+    for (std::size_t i = 0; i != playerTexts.size(); i++) {
+        updateStatus(playerTexts[i], "Player ", *vehicles[i]);
     }
-    ss2.str("");
-    for (unsigned i = 0; i != aivehicles.size(); i++) {
-        ss2 << "AI " << aivehicles[i]->getID() << ": HP: " << aivehicles[i]->getHP()
-                << "  (" << aivehicles[i]->getRacePlace() << "/" << playerCount << ")";
-        botTexts[i].setString(ss2.str());
-        ss2.str("");
+    for (std::size_t i = 0; i != botTexts.size(); i++) {
+        updateStatus(botTexts[i], "AI ", *aivehicles[i]);
     }
 
-
-
-
     /* Polymorphism...
      * In case of Race-class, this function does nothing
      * In case of TimeTrial-class, this function shows the last lap time.
@@ -438,98 +958,168 @@ void Race::handleCountdownEvents() {
         return;
     }
 	
-    double elapsedTime = raceClock.getElapsedTime().asSeconds();
+    // The race is started by step() when the countdown reaches zero.
+    double elapsedTime = getSimTime();
     if (elapsedTime < 1)
         countdownText.setString("3");
     else if (elapsedTime < 2)
         countdownText.setString("2");
     else if (elapsedTime < 3)
         countdownText.setString("1");
-    else if (elapsedTime < 4) {
-        countdownText.setString("");
-        startRace();
-    } else {
+    else {
         countdownText.setString("");
 	}
 	
 }
 
 void Race::handleWeaponEvents(sf::Event &event) {
+    if (isReplaying() || (event.type != sf::Event::KeyPressed && event.type != sf::Event::KeyReleased)) {
+        return;
+    }
+    // Vehicle 1 uses weapon with E and vehicle 2 with L.
+    std::shared_ptr<Vehicle> vehicle;
+    if (localPlayer >= 0) {
+        // Network play: only the local player, with E.
+        if (event.key.code != sf::Keyboard::E || localPlayer >= static_cast<int>(vehicles.size())) {
+            return;
+        }
+        vehicle = vehicles[localPlayer];
+    } else if (event.key.code == sf::Keyboard::E && vehicles.size() > 0) {
+        vehicle = vehicles[0];
+    } else if (event.key.code == sf::Keyboard::L && vehicles.size() > 1) {
+        vehicle = vehicles[1];
+    } else {
+        return;
+    }
     if (event.type == sf::Event::KeyPressed) {
+        vehicle->setInputControls(vehicle->getInputControls() | control::FIRE);
+    } else {
+        vehicle->setInputControls(vehicle->getInputControls() & ~control::FIRE);
+    }
+}
 
-        if (event.key.code == sf::Keyboard::E) {
-            // Vehicle 1 uses weapon
-            if (vehicles[0]->getWeapons().size() > 0) {
-                // Get reference to the FIRST weapon (unique_ptr).
-                // You can use the weapons in the same order they are picked from the track.
-                auto &weapon = vehicles[0]->getWeapons().front();
-
-                if (weapon->getType() == Weapon::WeaponType::GUN) {
-                    std::cout << "USING GUN!!!" << std::endl;
-                    weapon->useWeapon(); //added this to get sound to play
-                    if (vehicles[0]->shoot() <= 0) {
-                        // Running out of ammo -> remove weapon from the vehicle
-                        vehicles[0]->removeWeapon();
-                    }
-                } else if (weapon->getType() == Weapon::WeaponType::TURBO) {
-                    // Use turbo
-                    weapon->useWeapon(getRaceClock().getElapsedTime().asSeconds());
-                } else if (weapon->getType() == Weapon::WeaponType::MISSILE) {
-                    // Use missile here
-                    weapon->initializeControls(vehicles[0].get(), this);
-                    weapon->useWeapon();
-                }
-            }
-        } else if (event.key.code == sf::Keyboard::L) {
-            // Vehicle 2 uses weapon
-            if (vehicles.size() > 1) {
-                // Get reference to the FIRST weapon (unique_ptr)
-                if (vehicles[1]->getWeapons().size() > 0) {
-                    auto &weapon = vehicles[1]->getWeapons().front();
-                    if (weapon->getType() == Weapon::WeaponType::GUN) {
-                        weapon->useWeapon(); //added this to get sound to play
-                        if (vehicles[1]->shoot() <= 0) {
-                            vehicles[1]->removeWeapon();
-                        }
-                    } else if (weapon->getType() == Weapon::WeaponType::TURBO) {
-                        // Use turbo
-                        weapon->useWeapon(getRaceClock().getElapsedTime().asSeconds());
-
-                    } else if (weapon->getType() == Weapon::WeaponType::MISSILE) {
-                        weapon->initializeControls(vehicles[1].get(), this);
-                        weapon->useWeapon();
-                    }
+void Race::updateSounds(SoundHandler& soundHandler) {
+    soundHandler.setListener(camera.getCenter());
+
+    // Engines of all the running vehicles. The sound handler plays the closest ones.
+    std::vector<SoundHandler::EngineSource> engines;
+    auto addEngine = [&engines](Vehicle& v) {
+        if (!v.isDestroyed()) {
+            const Vector2D& position = v.getPhysics().getPosition();
+            engines.push_back({sf::Vector2f(position.x, position.y),
+                static_cast<float>(v.getPhysics().getVelocity().getLength())});
+        }
+    };
+    for (auto &v : vehicles) {
+        addEngine(*v);
+    }
+    for (auto &v : aivehicles) {
+        addEngine(*v);
+    }
+    soundHandler.updateEngines(engines);
+
+    for (auto &v : vehicles) {
+        for (auto &w : v->getWeapons()) {
+            w->updateSound(soundHandler); // turbo and missile sounds last while the weapon is used
+        }
+    }
+    // A vehicle touches a wall for several ticks. Play one collision sound per vehicle per frame.
+    std::vector<int> collided;
+    GameEvent event;
+    while (events.poll(EventBus::AUDIO, event)) {
+        Vehicle* v = getVehicleByID(event.vehicleID);
+        if (v == nullptr) {
+            continue;
+        }
+        sf::Vector2f position(v->getPhysics().getX(), v->getPhysics().getY());
+        switch (event.type) {
+            case GameEvent::COLLISION:
+                if (std::find(collided.begin(), collided.end(), event.vehicleID) == collided.end()) {
+                    collided.push_back(event.vehicleID);
+                    soundHandler.playRandomPitch(SoundType::COLLISION, 0.2f, position);
                 }
-            }
+                break;
+            case GameEvent::PICKUP:
+                soundHandler.playSound(SoundType::PICKUP, position);
+                break;
+            case GameEvent::DESTROYED:
+                soundHandler.playSound(SoundType::EXPLOSION, position);
+                break;
+            case GameEvent::WEAPON_FIRED:
+                if (event.value == Weapon::WeaponType::GUN) soundHandler.playSound(SoundType::GUNSHOT, position);
+                break;
+            default:
+                break;
         }
     }
+}
 
+void Race::findHits(const sf::FloatRect& bounds, int shooterID, std::vector<Vehicle*>& result) const {
+    unsigned int viewTick = tick;
+    std::size_t index = static_cast<std::size_t>(shooterID - 1);
+    if (shooterID >= 1 && index < viewTicks.size() && viewTicks[index] != 0) {
+        viewTick = std::min(viewTicks[index], tick);
+    }
+    hitboxHistory.findHits(bounds, viewTick, spatialIndex, result, shooterID);
 }
 
-void Race::updateSounds(SoundHandler& soundHandler) {
-    if (!soundHandler.isPlaying(SoundType::ENGINE) && !getVehicles()[0]->isDestroyed())
-        soundHandler.playAsLoop(SoundType::ENGINE);
-    if (soundHandler.isPlaying(SoundType::ENGINE) && getVehicles()[0]->isDestroyed())
-        soundHandler.stopSound(SoundType::ENGINE);
+void Race::setViewTick(int index, unsigned int viewTick) {
+    if (index < 0) {
+        return;
+    }
+    if (static_cast<std::size_t>(index) >= viewTicks.size()) {
+        viewTicks.resize(index + 1, 0);
+    }
+    viewTicks[index] = viewTick;
+}
 
-    soundHandler.revvingSound(SoundType::ENGINE, getVehicles()[0]->getPhysics().getVelocity().getLength() / 500);
+Vehicle* Race::getVehicleByID(int ID) const {
+    // IDs are given in initialize(): players first, then bots.
+    if (ID >= 1 && ID <= static_cast<int>(vehicles.size())) {
+        return vehicles[ID - 1].get();
+    }
+    ID -= vehicles.size();
+    if (ID >= 1 && ID <= static_cast<int>(aivehicles.size())) {
+        return aivehicles[ID - 1].get();
+    }
+    return nullptr;
+}
 
-    for (auto &v : vehicles) {
-        if (v->destroyedFlag) {
-            soundHandler.playSound(SoundType::EXPLOSION);
-            v->destroyedFlag = false;
+void Race::updateTelemetry() {
+    GameEvent event;
+    while (events.poll(EventBus::TELEMETRY, event)) {
+        if (event.type == GameEvent::LAP) {
+            lapEvents++;
         }
-        for (auto &w : v->getWeapons()) {
-            w->updateSound(soundHandler); //maybe these could've been flags as well...
+        else if (event.type == GameEvent::PICKUP) {
+            pickupEvents++;
+        }
+        else if (event.type == GameEvent::DESTROYED) {
+            destroyedEvents++;
         }
     }
-    if (pickedUpFlag) {
-        soundHandler.playSound(SoundType::PICKUP);
-        pickedUpFlag = false;
+    perfOverlay.setEventCounts(lapEvents, pickupEvents, destroyedEvents, events.getDropped());
+}
+
+void Race::publish(GameEvent::Type type, int vehicleID, int value) {
+    if (!publishing) {
+        return;
     }
-    if (collisionFlag) {
-        soundHandler.playRandomPitch(SoundType::COLLISION, 0.2f);
-        collisionFlag = false;
+    GameEvent event;
+    event.type = type;
+    event.vehicleID = vehicleID;
+    event.value = value;
+    event.tick = tick;
+    events.publish(event);
+}
+
+void Race::publishDestroyed() {
+    std::vector<VehicleRegistry::Health>& health = registry->getHealth();
+    for (std::size_t e = 0; e < health.size(); e++) {
+        if (health[e].destroyedFlag) {
+            publish(GameEvent::DESTROYED, static_cast<int>(e + 1));
+            health[e].destroyedFlag = false;
+        }
     }
 }
 
@@ -541,12 +1131,12 @@ void Race::updateTurbo() {
                 //Note: updateWeapon(...) does nothing if the weapon is not set as used with useWeapon().
                 //It also automatically sets used = false if the timer ran out.
 
-                if (weapon->updateWeapon(getRaceClock().getElapsedTime().asSeconds())) {
+                if (weapon->updateWeapon(getSimTime())) {
                     double cSpeed = v->getPhysics().getVelocity().getLength();
                     if (cSpeed > 1 && cSpeed < (MAX_SPEED * 1.2))
                         v->getPhysics().setVelocity(v->getPhysics().getVelocity() * 1.05); //go fast
 
-                    if (!weapon->updateWeapon(getRaceClock().getElapsedTime().asSeconds()))
+                    if (!weapon->updateWeapon(getSimTime()))
                         v->removeWeapon();
 
                 }
@@ -566,20 +1156,11 @@ void Race::updateBullets() {
             }
             b.update();
 
-            // Test if bullet hit with AI vehicles
-            for (auto &ai : aivehicles) {
-                if (ai->getShape().getGlobalBounds().intersects(b.getShape().getGlobalBounds())) {
-                    ai->damageVehicle(40);
-                }
-            }
-            // Test if bullet hits other vehicles
-            for (auto &v2 : vehicles) {
-                // Cannot hit the owner of the bullet
-                if (v2->getID() != v->getID()) {
-                    if (v2->getShape().getGlobalBounds().intersects(b.getShape().getGlobalBounds())) {
-                        v2->damageVehicle(40);
-                    }
-                }
+            // Test if bullet hits other vehicles. Cannot hit the owner of the bullet.
+            bulletHits.clear();
+            findHits(physmath::getGlobalBounds(b.getShape()), v->getID(), bulletHits);
+            for (Vehicle* target : bulletHits) {
+                target->damageVehicle(40);
             }
         }
         Bullet::outOfBounds(v->getBullets());
@@ -607,50 +1188,39 @@ void Race::updateMissiles() {
 }
 
 void Race::checkHits() {
-    // Test finish line hit.
-    for (auto v : vehicles) {
-        if (track.isOnFinishLine(v->getShape())) {
-            if (v->allCheckpointsPassed(track)) {
-                if (raceType == RaceType::TimeTrial) {
-                    raceClock.restart();
-                }
-                v->increaseLapCount();
-                // If the leader passes the finish line
-                // increase total laps count
-                std::cout << "Player place: " << v->getRacePlace() << std::endl;
-                if (v->getRacePlace() == 1) {
-                    lapsDriven++;
-                    if (lapsDriven > totalLaps && !isEnd) {
-                        endRace();
-                    }
-                }
-                v->visitedCheckPoints = 0;
-            }
+    // Test finish line hit. The players are the first entities, then the bots.
+    std::vector<VehicleRegistry::Progress>& progress = registry->getProgress();
+    const std::size_t players = vehicles.size();
+    for (std::size_t e = 0; e < progress.size(); e++) {
+        const bool isBot = e >= players;
+        if (isBot && !isDetailTick(*aivehicles[e - players])) {
+            continue;
         }
-    }
-    // Test finish line hit.
-    for (auto v : aivehicles) {
-        if (track.isOnFinishLine(v->getShape())) {
-            if (v->allCheckpointsPassed(track)) {
-                v->increaseLapCount();
-                // If the leader passes the finish line
-                // increase total laps count
-                std::cout << "Bot place: " << v->getRacePlace() << std::endl;
-                if (v->getRacePlace() == 1) {
-                    lapsDriven++;
-                }
-                if (lapsDriven > totalLaps && !isEnd) {
-                    endRace();
-                }
-                v->visitedCheckPoints = 0;
-            }
+        Vehicle& v = registry->getVehicle(e);
+        if (!track.isOnFinishLine(v.getShape()) || !v.allCheckpointsPassed(track)) {
+            continue;
+        }
+        if (!isBot && raceType == RaceType::TimeTrial) {
+            restartRaceClock();
+        }
+        progress[e].laps++;
+        publish(GameEvent::LAP, v.getID(), progress[e].laps);
+        // If the leader passes the finish line
+        // increase total laps count
+        if (progress[e].racePlace == 1) {
+            lapsDriven++;
         }
+        // A bot ends the race even when it isn't the leader.
+        if ((isBot || progress[e].racePlace == 1) && lapsDriven > totalLaps && !isEnd) {
+            endRace();
+        }
+        progress[e].visitedCheckPoints = 0;
     }
 
     // Test obstacle and weapon hits
-    for (auto v : vehicles) {
+    for (auto &v : vehicles) {
         if (track.isOilSplatHit(v->getShape())) {
-            int num = Weapon::getRandomNumber(0, 1);
+            int num = Weapon::getRandomNumber(0, 1, track.getRandomEngine());
             if (num == 0) {
                 v->getPhysics().setAngularVelocity(100);
             } else {
@@ -661,7 +1231,6 @@ void Race::checkHits() {
         }
         int index = track.handleWeaponHit(v->getShape());
         if (index != -1) {
-            std::cout << "WEAPON HIT!" << std::endl;
             // Move weapon (unique_ptr) from track to vehicle.
             // std::move is used to move the ownership.
             // Create temporary variable for weapon
@@ -669,40 +1238,42 @@ void Race::checkHits() {
             // Pick weapon if the vehicle has not this type of weapon yet.
             // i.e. a vehicle can have only 1 weapon of each type.
             if (!v->hasWeapon(w->getType())) {
-                pickedUpFlag = true; //flag so that sound will play
+                publish(GameEvent::PICKUP, v->getID(), w->getType());
                 v->addWeapon(track.pickWeapon(index));
                 // If picked weapon is Gun, add ammunition
                 if (v->getWeapons()[v->getWeapons().size() - 1]->getType() == Weapon::WeaponType::GUN) {
                     v->addBullets(20); // number of bullets to be added
                 }
             }
-            updateWeaponIcons();
-
         }
     }
 
 }
 
-void Race::fixPlaces() {
-    // Sort racePlaces vector with std::sort and lambda.
-    std::sort(racePlaces.begin(), racePlaces.end(), [](const std::shared_ptr<Vehicle> v1, const std::shared_ptr<Vehicle> v2)
-            -> bool { // This lambda body defines, how the items are sorted.
-                if (v1->getLaps() > v2->getLaps()) {
-                    return true;
-                } else if (v1->getLaps() < v2->getLaps()) {
-                    return false;
-                } else { // Laps are equal. Compare visited checkpoints (int).
-                    if (v1->visitedCheckPoints >= v2->visitedCheckPoints) {
-                        return true;
-                    }
-                }
-                return false;
-            });
+void Race::updateStandings() {
+    // Progress is continuous, so the order changes only a little on every tick.
+    const double gatesPerLap = track.getCheckpoints().size() + 1;
+    const std::vector<VehiclePhysics>& physics = registry->getPhysics();
+    std::vector<VehicleRegistry::Progress>& progress = registry->getProgress();
+    for (std::size_t e = 0; e < progress.size(); e++) {
+        progress[e].distance = progress[e].laps * gatesPerLap
+                + track.getLapProgress(progress[e].visitedCheckPoints, physics[e].getPosition());
+    }
+    // Insertion sort: O(n) for an almost sorted vector. Equal progress keeps the old order.
+    std::vector<std::size_t>& standings = registry->getStandings();
+    for (std::size_t i = 1; i < standings.size(); i++) {
+        std::size_t e = standings[i];
+        std::size_t j = i;
+        for (; j > 0 && progress[standings[j - 1]].distance < progress[e].distance; j--) {
+            standings[j] = standings[j - 1];
+        }
+        standings[j] = e;
+    }
 
-    // Now racePlaces vector is sorted. Set race places to vehicles.
+    // Now the standings are sorted. Set race places to vehicles.
     int i = 1;
-    for (auto v : racePlaces) {
-        v->setRacePlace(i);
+    for (std::size_t e : standings) {
+        progress[e].racePlace = i;
         i++;
     }
 }
@@ -712,10 +1283,10 @@ void Race::endRace() {
     isEnd = true;
     isStarted = false;
     // Stop all vehicles.
-    for (auto v : vehicles) {
+    for (auto &v : vehicles) {
         v->getPhysics().brake();
     }
-    for (auto v : aivehicles) {
+    for (auto &v : aivehicles) {
         v->getPhysics().brake();
     }
     updateWinnerText();
@@ -723,7 +1294,7 @@ void Race::endRace() {
 
 void Race::updateWinnerText() {
     // Get winner ID from the vehicle.
-    const int winnerID = racePlaces[0]->getID();
+    const int winnerID = static_cast<int>(registry->getStandings()[0] + 1);
     std::stringstream ss;
     ss << "WINNER: Player " << winnerID;
     winnerText.setString(ss.str());
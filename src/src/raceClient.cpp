@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <iomanip>
+#include <iostream>
+
+#include "raceClient.hpp"
+#include "constants.hpp"
+
+namespace {
+    // A spectator tells it's still there this often.
+    const float KEEP_ALIVE_INTERVAL = 1; // seconds
+}
+
+bool RaceClient::connect(const sf::IpAddress& address, unsigned short port, sf::Time timeout)
+{
+    return join(address, port, timeout, net::HELLO);
+}
+
+bool RaceClient::spectate(const sf::IpAddress& address, unsigned short port, sf::Time timeout)
+{
+    return join(address, port, timeout, net::SPECTATE);
+}
+
+void RaceClient::beginRequest(net::MessageType request)
+{
+    net::beginMessage(packet, request);
+    if (request == net::SPECTATE) {
+        packet << static_cast<sf::Uint8>(connected ? 1 : 0);
+    }
+}
+
+bool RaceClient::join(const sf::IpAddress& address, unsigned short port, sf::Time timeout, net::MessageType request)
+{
+    if (address == sf::IpAddress::None) {
+        std::cerr << "Unknown server address." << std::endl;
+        return false;
+    }
+    if (socket.bind(sf::Socket::AnyPort) != sf::Socket::Done) {
+        std::cerr << "Cannot open a UDP socket." << std::endl;
+        return false;
+    }
+    socket.setBlocking(false);
+    serverAddress = address;
+    serverPort = port;
+
+    sf::Clock clock;
+    sf::Clock resendClock;
+    beginRequest(request);
+    send(packet);
+    while (clock.getElapsedTime() < timeout) {
+        sf::IpAddress sender;
+        unsigned short senderPort;
+        while (socket.receive(packet, sender, senderPort) == sf::Socket::Done) {
+            net::MessageType type;
+            if (sender != serverAddress || senderPort != serverPort || !net::readHeader(packet, type)) {
+                continue;
+            }
+            if (type == net::BYE) {
+                std::cerr << "The server is full or the race is over." << std::endl;
+                return false;
+            }
+            sf::Uint8 index;
+            if (type == net::WELCOME && packet >> index >> setup) {
+                slot = index;
+                connected = true;
+                lastHeard.restart();
+                keepAliveClock.restart();
+                if (request == net::SPECTATE) {
+                    // Tell that WELCOME has arrived.
+                    beginRequest(request);
+                    send(packet);
+                }
+                return true;
+            }
+        }
+        // The request or WELCOME may have been lost.
+        if (resendClock.getElapsedTime() > sf::milliseconds(500)) {
+            beginRequest(request);
+            send(packet);
+            resendClock.restart();
+        }
+        sf::sleep(sf::milliseconds(10));
+    }
+    std::cerr << "No answer from " << address << ":" << port << std::endl;
+    return false;
+}
+
+sf::Uint32 RaceClient::sendInput(Controls controls)
+{
+    if (!connected) {
+        return 0;
+    }
+    inputSequence++;
+    net::beginMessage(packet, net::INPUT);
+    auto toUint16 = [](float value) { return static_cast<sf::Uint16>(std::max(0.0f, std::min(65535.0f, value))); };
+    packet << inputSequence << controls << ackTick << codec.getAckBits(ackTick) << toUint16(viewSize.x) << toUint16(viewSize.y);
+    send(packet);
+    return inputSequence;
+}
+
+bool RaceClient::receive()
+{
+    if (!connected) {
+        return false;
+    }
+    bool newSnapshot = false;
+    sf::IpAddress sender;
+    unsigned short senderPort;
+    while (socket.receive(packet, sender, senderPort) == sf::Socket::Done) {
+        net::MessageType type;
+        if (sender != serverAddress || senderPort != serverPort || !net::readHeader(packet, type)) {
+            continue;
+        }
+        lastHeard.restart();
+        bytesReceived += packet.getDataSize();
+        if (type == net::BYE) {
+            connected = false;
+            return newSnapshot;
+        }
+        if (type != net::SNAPSHOT && type != net::KEYFRAME) {
+            continue; // e.g. a WELCOME sent again
+        }
+        if (!codec.decode(packet, received)) {
+            continue;
+        }
+        snapshotCount++;
+        // Datagrams can arrive out of order.
+        if (snapshotCount == 1 || received.tick > snapshot.tick) {
+            std::swap(snapshot, received);
+            ackTick = snapshot.tick;
+            newSnapshot = true;
+        }
+    }
+    if (lastHeard.getElapsedTime().asSeconds() > net::TIMEOUT) {
+        std::cerr << "Lost connection to the server." << std::endl;
+        connected = false;
+    }
+    else if (isSpectator() && keepAliveClock.getElapsedTime().asSeconds() >= KEEP_ALIVE_INTERVAL) {
+        beginRequest(net::SPECTATE);
+        send(packet);
+        keepAliveClock.restart();
+    }
+    return newSnapshot;
+}
+
+void RaceClient::disconnect()
+{
+    if (!connected) {
+        return;
+    }
+    net::beginMessage(packet, net::BYE);
+    send(packet);
+    connected = false;
+}
+
+void RaceClient::send(sf::Packet& message)
+{
+    socket.send(message, serverAddress, serverPort);
+}
+
+bool parseServerAddress(const std::string& text, std::string& host, unsigned short& port)
+{
+    std::size_t colon = text.rfind(':');
+    if (colon == std::string::npos) {
+        host = text;
+        port = net::DEFAULT_PORT;
+        return true;
+    }
+    host = text.substr(0, colon);
+    char* end = nullptr;
+    long value = std::strtol(text.c_str() + colon + 1, &end, 10);
+    if (*end != '\0' || value <= 0 || value > 65535) {
+        return false;
+    }
+    port = static_cast<unsigned short>(value);
+    return true;
+}
+
+int runHeadlessClient(const std::string& host, unsigned short port, bool spectate)
+{
+    RaceClient client;
+    if (spectate ? !client.spectate(sf::IpAddress(host), port) : !client.connect(sf::IpAddress(host), port)) {
+        return 1;
+    }
+    int id = client.getSlot() + 1; // players have the first IDs
+    if (spectate) {
+        id = 1; // follow the first player
+        std::cout << "Watching " << host << ":" << port << " on " << client.getSetup().xmlfile << std::endl;
+    }
+    else {
+        std::cout << "Joined " << host << ":" << port << " as player " << id << " on "
+                  << client.getSetup().xmlfile << std::endl;
+    }
+
+    sf::Clock tickClock;
+    sf::Clock reportClock;
+    double lag = 0;
+    unsigned int reportedSnapshots = 0;
+    std::size_t reportedBytes = 0;
+    sf::Int64 reportedMicros = 0;
+    std::cout << std::fixed << std::setprecision(1);
+    while (client.isConnected()) {
+        lag += tickClock.restart().asSeconds();
+        while (lag >= TICK_TIME) {
+            if (!spectate) {
+                client.sendInput(control::ACCELERATE);
+            }
+            lag -= TICK_TIME;
+        }
+        client.receive();
+
+        if (reportClock.getElapsedTime() >= sf::seconds(1)) {
+            double seconds = reportClock.restart().asSeconds();
+            const net::Snapshot& snapshot = client.getSnapshot();
+            unsigned int snapshots = client.getSnapshotCount() - reportedSnapshots;
+            sf::Int64 micros = client.getStats().micros - reportedMicros;
+            std::cout << "tick " << snapshot.tick
+                      << ": " << snapshots / seconds << " snapshots/s, "
+                      << (client.getBytesReceived() - reportedBytes) * 8 / seconds / 1000 << " kbit/s, decode "
+                      << (snapshots > 0 ? static_cast<double>(micros) / snapshots : 0.0) << " us";
+            for (const net::VehicleState& v : snapshot.vehicles) {
+                if (v.id == id) {
+                    std::cout << ", position (" << v.x << ", " << v.y << "), place " << int(v.place)
+                              << ", laps " << int(v.laps) << ", HP " << v.hp;
+                }
+            }
+            std::cout << std::endl;
+            reportedSnapshots = client.getSnapshotCount();
+            reportedBytes = client.getBytesReceived();
+            reportedMicros = client.getStats().micros;
+        }
+        sf::sleep(sf::milliseconds(1));
+    }
+    std::cout << "The server has left." << std::endl;
+    return 0;
+}
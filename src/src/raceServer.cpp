@@ -0,0 +1,519 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include "raceServer.hpp"
+#include "constants.hpp"
+#include "xmlParser.hpp"
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace {
+    // Snapshots are still sent this long after the race has ended, so that the clients
+    // see the winner before the server leaves.
+    const double END_DELAY = 3; // seconds
+
+    // Interval of the bandwidth report.
+    const float REPORT_INTERVAL = 5; // seconds
+
+    // Serialises the output of the races of a RaceHost.
+    std::mutex logMutex;
+
+    // Resident memory of the process (bytes), 0 if it's not known on this platform.
+    std::size_t getResidentMemory()
+    {
+#ifdef __linux__
+        std::ifstream statm("/proc/self/statm");
+        std::size_t pages = 0;
+        std::size_t residentPages = 0;
+        if (statm >> pages >> residentPages) {
+            return residentPages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        }
+#endif
+        return 0;
+    }
+
+    double toKilobytes(std::size_t after, std::size_t before)
+    {
+        return (static_cast<double>(after) - static_cast<double>(before)) / 1024;
+    }
+}
+
+RaceServer::RaceServer(const RaceSetup& raceSetup, unsigned short serverPort, const std::string& logName) :
+setup(raceSetup), port(serverPort), name(logName), clients(raceSetup.players),
+spectators(net::MAX_SERVER_SPECTATORS)
+{
+    race = Race::create(setup);
+    race->addVehicles(setup);
+    race->setSeed(setup.seed);
+    race->initialize();
+}
+
+bool RaceServer::start()
+{
+    if (socket.bind(port) != sf::Socket::Done) {
+        std::ostringstream message;
+        message << "Cannot listen on UDP port " << port;
+        log(message.str(), std::cerr);
+        return false;
+    }
+    socket.setBlocking(false);
+    std::ostringstream message;
+    message << "Race server on UDP port " << port << ": " << setup.xmlfile << ", "
+            << setup.players << " players, " << setup.bots << " bots" << std::endl
+            << "Waiting for " << setup.players << " players...";
+    log(message.str());
+    return true;
+}
+
+bool RaceServer::update()
+{
+    receive();
+    checkTimeouts();
+
+    if (!running) {
+        if (connectedCount() == setup.players) {
+            running = true;
+            stepClock.restart();
+            reportClock.restart();
+            log("All players joined, starting the race.");
+        }
+        return true;
+    }
+    if (connectedCount() == 0) {
+        log("All players have left.");
+        return false;
+    }
+
+    // Same fixed time step as Game::updateVehicles().
+    lag += stepClock.restart().asSeconds();
+    if (lag > 0.25) {
+        lag = 0.25;
+    }
+    while (lag >= TICK_TIME) {
+        applyInputs();
+        race->step();
+        if (race->getTick() % net::SNAPSHOT_INTERVAL == 0) {
+            sendSnapshots();
+        }
+        lag -= TICK_TIME;
+    }
+    if (race->isEnd && endTime < 0) {
+        endTime = race->getSimTime();
+    }
+    if (endTime >= 0 && race->getSimTime() - endTime >= END_DELAY) {
+        return false;
+    }
+    if (reportClock.getElapsedTime().asSeconds() >= REPORT_INTERVAL) {
+        reportBandwidth();
+    }
+    return true;
+}
+
+void RaceServer::finish()
+{
+    for (Client& client : clients) {
+        if (client.connected) {
+            sendBye(client.address, client.port);
+        }
+    }
+    net::beginMessage(packet, net::BYE);
+    spectators.broadcast(socket, packet);
+    printResults();
+}
+
+int RaceServer::run()
+{
+    if (!start()) {
+        return 1;
+    }
+    while (update()) {
+        sf::sleep(sf::milliseconds(1));
+    }
+    finish();
+    return 0;
+}
+
+void RaceServer::log(const std::string& message, std::ostream& stream) const
+{
+    // The races of a RaceHost print from several threads. Whole messages don't mix.
+    std::lock_guard<std::mutex> lock(logMutex);
+    std::istringstream lines(message);
+    std::string line;
+    while (std::getline(lines, line)) {
+        stream << name << line << std::endl;
+    }
+}
+
+void RaceServer::receive()
+{
+    sf::IpAddress address;
+    unsigned short senderPort;
+    while (socket.receive(packet, address, senderPort) == sf::Socket::Done) {
+        net::MessageType type;
+        if (!net::readHeader(packet, type)) {
+            continue; // not ours
+        }
+        switch (type) {
+            case net::HELLO:
+                handleHello(address, senderPort);
+                break;
+            case net::INPUT:
+                handleInput(packet, address, senderPort);
+                break;
+            case net::SPECTATE:
+                handleSpectate(packet, address, senderPort);
+                break;
+            case net::BYE: {
+                spectators.remove(address, senderPort);
+                if (spectators.getCount() == 0) {
+                    spectatorStream.reset();
+                }
+                int slot = findClient(address, senderPort);
+                if (slot >= 0) {
+                    log("Player " + std::to_string(slot + 1) + " left.");
+                    clients[slot].connected = false;
+                    race->getVehicles()[slot]->setInputControls(0);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+void RaceServer::handleHello(const sf::IpAddress& address, unsigned short senderPort)
+{
+    // A client sends HELLO until WELCOME arrives, so it may already have a slot.
+    int slot = findClient(address, senderPort);
+    if (slot < 0) {
+        for (std::size_t i = 0; i < clients.size(); i++) {
+            if (!clients[i].connected) {
+                slot = static_cast<int>(i);
+                break;
+            }
+        }
+        if (slot < 0 || race->isEnd) {
+            sendBye(address, senderPort);
+            return;
+        }
+        Client& client = clients[slot];
+        client.connected = true;
+        client.address = address;
+        client.port = senderPort;
+        client.inputSequence = 0;
+        client.inputs.clear();
+        client.ackTick = 0;
+        client.ackBits = 0;
+        client.viewSize = sf::Vector2f(WIDTH, HEIGHT);
+        client.interest.reset();
+        client.codec = net::SnapshotCodec();
+        client.reportedStats = net::CodecStats();
+        std::ostringstream message;
+        message << "Player " << slot + 1 << " joined from " << address << ":" << senderPort;
+        log(message.str());
+    }
+    Client& client = clients[slot];
+    client.lastHeard.restart();
+    net::beginMessage(packet, net::WELCOME);
+    packet << static_cast<sf::Uint8>(slot) << setup;
+    send(packet, client);
+}
+
+void RaceServer::handleInput(sf::Packet& message, const sf::IpAddress& address, unsigned short senderPort)
+{
+    int slot = findClient(address, senderPort);
+    sf::Uint32 sequence;
+    Controls controls;
+    sf::Uint32 ackTick;
+    sf::Uint32 ackBits;
+    sf::Uint16 viewWidth;
+    sf::Uint16 viewHeight;
+    if (slot < 0 || !(message >> sequence >> controls >> ackTick >> ackBits >> viewWidth >> viewHeight)) {
+        return;
+    }
+    Client& client = clients[slot];
+    client.lastHeard.restart();
+    if (ackTick >= client.ackTick) {
+        client.ackTick = ackTick;
+        client.ackBits = ackBits;
+    }
+    client.viewSize = sf::Vector2f(viewWidth, viewHeight);
+    // Datagrams can arrive out of order. An input older than the applied one is too late.
+    if (sequence <= client.inputSequence) {
+        return;
+    }
+    if (!running) {
+        // Nothing is simulated yet, so only the latest input matters.
+        client.inputSequence = sequence;
+        race->getVehicles()[slot]->setInputControls(controls);
+        return;
+    }
+    client.inputs[sequence] = QueuedInput{controls, ackTick};
+    if (client.inputs.size() > net::MAX_QUEUED_INPUTS) {
+        client.inputs.erase(client.inputs.begin());
+    }
+}
+
+void RaceServer::applyInputs()
+{
+    for (std::size_t i = 0; i < clients.size(); i++) {
+        Client& client = clients[i];
+        if (!client.connected || client.inputs.empty()) {
+            continue;
+        }
+        auto next = client.inputs.begin();
+        client.inputSequence = next->first;
+        race->getVehicles()[i]->setInputControls(next->second.controls);
+        // The player shot at what it saw in the snapshot viewTick (see Race::findHits).
+        race->setViewTick(static_cast<int>(i), next->second.viewTick);
+        client.inputs.erase(next);
+    }
+}
+
+void RaceServer::handleSpectate(sf::Packet& message, const sf::IpAddress& address, unsigned short senderPort)
+{
+    sf::Uint8 welcomed = 0;
+    message >> welcomed;
+    bool added = false;
+    if (!spectators.handleSpectate(address, senderPort, added)) {
+        sendBye(address, senderPort);
+        return;
+    }
+    if (added) {
+        std::ostringstream text;
+        text << "Spectator joined from " << address << ":" << senderPort;
+        log(text.str());
+    }
+    if (added || welcomed == 0) {
+        net::beginMessage(packet, net::WELCOME);
+        packet << net::SPECTATOR_SLOT << setup;
+        socket.send(packet, address, senderPort);
+        // A spectator joining in the middle of the stream can decode the next deltas
+        // with the latest keyframe.
+        const sf::Packet& keyframe = spectatorStream.getKeyframe();
+        if (keyframe.getDataSize() > 0) {
+            socket.send(keyframe.getData(), keyframe.getDataSize(), address, senderPort);
+        }
+    }
+}
+
+int RaceServer::findClient(const sf::IpAddress& address, unsigned short senderPort) const
+{
+    for (std::size_t i = 0; i < clients.size(); i++) {
+        if (clients[i].connected && clients[i].address == address && clients[i].port == senderPort) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void RaceServer::checkTimeouts()
+{
+    for (std::size_t i = 0; i < clients.size(); i++) {
+        Client& client = clients[i];
+        if (client.connected && client.lastHeard.getElapsedTime().asSeconds() > net::TIMEOUT) {
+            log("Player " + std::to_string(i + 1) + " timed out.");
+            client.connected = false;
+            // The vehicle stays in the race but nobody drives it.
+            race->getVehicles()[i]->setInputControls(0);
+        }
+    }
+    if (spectators.removeSilent() > 0 && spectators.getCount() == 0) {
+        // Nobody has the keyframe any more.
+        spectatorStream.reset();
+    }
+}
+
+void RaceServer::sendSnapshots()
+{
+    race->writeSnapshot(snapshot);
+    if (spectators.getCount() > 0) {
+        snapshot.inputAck = 0;
+        spectatorStream.encode(snapshot);
+        spectators.broadcast(socket, spectatorStream.getMessage());
+    }
+    for (std::size_t i = 0; i < clients.size(); i++) {
+        Client& client = clients[i];
+        if (!client.connected) {
+            continue;
+        }
+        snapshot.inputAck = client.inputSequence;
+        sf::Uint8 ownID = static_cast<sf::Uint8>(race->getVehicles()[i]->getID());
+        client.interest.select(snapshot, ownID, client.viewSize, relevant);
+        net::beginMessage(packet, net::SNAPSHOT);
+        client.codec.encode(relevant, client.ackTick, client.ackBits, packet);
+        send(packet, client);
+    }
+}
+
+void RaceServer::send(sf::Packet& message, const Client& client)
+{
+    // A full send buffer drops the datagram, like the network would.
+    socket.send(message, client.address, client.port);
+}
+
+void RaceServer::sendBye(const sf::IpAddress& address, unsigned short senderPort)
+{
+    net::beginMessage(packet, net::BYE);
+    socket.send(packet, address, senderPort);
+}
+
+int RaceServer::connectedCount() const
+{
+    int count = 0;
+    for (const Client& client : clients) {
+        if (client.connected) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void RaceServer::reportBandwidth()
+{
+    float seconds = reportClock.restart().asSeconds();
+    std::ostringstream message;
+    for (std::size_t i = 0; i < clients.size(); i++) {
+        Client& client = clients[i];
+        const net::CodecStats& stats = client.codec.getStats();
+        unsigned int snapshots = stats.snapshots - client.reportedStats.snapshots;
+        if (!client.connected || snapshots == 0) {
+            continue;
+        }
+        std::size_t bytes = stats.bytes - client.reportedStats.bytes;
+        sf::Int64 micros = stats.micros - client.reportedStats.micros;
+        message << std::fixed << std::setprecision(1)
+                << "Player " << i + 1 << ": " << bytes * 8 / 1000.0 / seconds << " kbit/s, "
+                << static_cast<double>(bytes) / snapshots << " bytes/snapshot, encode "
+                << static_cast<double>(micros) / snapshots << " us" << std::endl;
+        client.reportedStats = stats;
+    }
+    log(message.str());
+}
+
+void RaceServer::printResults() const
+{
+    std::ostringstream message;
+    message << std::fixed << std::setprecision(2)
+            << "Race ended after " << race->getSimTime() << " s (" << race->getTick() << " ticks)" << std::endl;
+    auto printVehicle = [&message](const char* type, Vehicle& v) {
+        message << type << " " << v.getID() << ": place " << v.getRacePlace() << ", laps " << v.getLaps()
+                << ", HP " << v.getHP() << std::endl;
+    };
+    for (auto &v : race->getVehicles()) {
+        printVehicle("Player", *v);
+    }
+    for (auto &v : race->getAIVehicles()) {
+        printVehicle("AI", *v);
+    }
+    log(message.str());
+}
+
+int runRaceServer(const RaceSetup& setup, unsigned short port)
+{
+    std::unique_ptr<RaceServer> server;
+    try {
+        server = std::make_unique<RaceServer>(setup, port);
+    }
+    catch (XMLException &e) {
+        std::cerr << "Error occured while reading xml file." << std::endl << e.what() << std::endl;
+        return 1;
+    }
+    return server->run();
+}
+
+RaceHost::RaceHost(const std::vector<RaceSetup>& setups, unsigned short firstPort, unsigned int threads) :
+pool(threads)
+{
+    std::size_t startMemory = getResidentMemory();
+    for (const RaceSetup& setup : setups) {
+        std::shared_ptr<const TrackData> track = TrackData::load(setup.xmlfile);
+        if (std::find(tracks.begin(), tracks.end(), track) == tracks.end()) {
+            tracks.push_back(track);
+        }
+    }
+    std::size_t trackMemory = getResidentMemory();
+    std::size_t firstRaceMemory = trackMemory;
+    for (std::size_t i = 0; i < setups.size(); i++) {
+        std::string name = "Race " + std::to_string(i + 1) + ": ";
+        unsigned short port = static_cast<unsigned short>(firstPort + i);
+        servers.push_back(std::make_unique<RaceServer>(setups[i], port, name));
+        if (i == 0) {
+            firstRaceMemory = getResidentMemory();
+        }
+    }
+    std::size_t endMemory = getResidentMemory();
+
+    if (endMemory == 0) {
+        return;
+    }
+    std::cout << std::fixed << std::setprecision(1)
+              << "Memory: " << toKilobytes(trackMemory, startMemory) << " kB for " << tracks.size()
+              << " shared track(s), " << toKilobytes(firstRaceMemory, trackMemory) << " kB for the first race";
+    if (servers.size() > 1) {
+        std::cout << ", " << toKilobytes(endMemory, firstRaceMemory) / (servers.size() - 1)
+                  << " kB per extra race";
+    }
+    std::cout << std::endl;
+}
+
+int RaceHost::run()
+{
+    for (auto& server : servers) {
+        if (!server->start()) {
+            return 1;
+        }
+    }
+    std::cout << "Hosting " << servers.size() << " races on " << pool.getThreadCount() << " threads." << std::endl;
+
+    // Servers which have finished are skipped. Each element is written by one task only.
+    std::vector<char> active(servers.size(), 1);
+    std::size_t activeCount = servers.size();
+    sf::Clock reportClock;
+    sf::Clock roundClock;
+    double busySeconds = 0;
+    while (activeCount > 0) {
+        roundClock.restart();
+        pool.run(servers.size(), [this, &active](std::size_t i) {
+            if (active[i] && !servers[i]->update()) {
+                servers[i]->finish();
+                active[i] = 0;
+            }
+        });
+        busySeconds += roundClock.getElapsedTime().asSeconds();
+        activeCount = std::count(active.begin(), active.end(), 1);
+
+        float seconds = reportClock.getElapsedTime().asSeconds();
+        if (seconds >= REPORT_INTERVAL) {
+            std::ostringstream message;
+            message << std::fixed << std::setprecision(1) << activeCount << " races running, "
+                    << 100 * busySeconds / seconds << " % of the time updating";
+            std::lock_guard<std::mutex> lock(logMutex);
+            std::cout << message.str() << std::endl;
+            reportClock.restart();
+            busySeconds = 0;
+        }
+        sf::sleep(sf::milliseconds(1));
+    }
+    return 0;
+}
+
+int runRaceHost(const std::vector<RaceSetup>& setups, unsigned short firstPort, unsigned int threads)
+{
+    std::unique_ptr<RaceHost> host;
+    try {
+        host = std::make_unique<RaceHost>(setups, firstPort, threads);
+    }
+    catch (XMLException &e) {
+        std::cerr << "Error occured while reading xml file." << std::endl << e.what() << std::endl;
+        return 1;
+    }
+    return host->run();
+}
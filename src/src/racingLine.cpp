@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <cmath>
+
+#include "racingLine.hpp"
+#include "constants.hpp"
+
+constexpr float RacingLine::SPACING;
+
+namespace {
+    // Samples searched behind and ahead of the hint in findNearest().
+    const std::size_t SEARCH_BEHIND = 8;
+    const std::size_t SEARCH_AHEAD = 48;
+    // Curvature is measured over +-3 samples to filter out the noise of resampling.
+    const std::size_t CURVATURE_SPAN = 3;
+
+    // Point of the centripetal Catmull-Rom segment p1 -> p2 (Barry and Goldman's pyramidal form).
+    // t goes from 0 (p1) to 1 (p2).
+    Vector2D catmullRom(const Vector2D& p0, const Vector2D& p1, const Vector2D& p2, const Vector2D& p3, double t)
+    {
+        // Knot intervals are the square roots of the distances (centripetal parametrization).
+        double d01 = std::max(std::sqrt((p1 - p0).getLength()), 1e-4);
+        double d12 = std::max(std::sqrt((p2 - p1).getLength()), 1e-4);
+        double d23 = std::max(std::sqrt((p3 - p2).getLength()), 1e-4);
+        double t0 = 0, t1 = d01, t2 = t1 + d12, t3 = t2 + d23;
+        double u = t1 + t * d12;
+
+        Vector2D a1 = p0 * ((t1 - u) / (t1 - t0)) + p1 * ((u - t0) / (t1 - t0));
+        Vector2D a2 = p1 * ((t2 - u) / (t2 - t1)) + p2 * ((u - t1) / (t2 - t1));
+        Vector2D a3 = p2 * ((t3 - u) / (t3 - t2)) + p3 * ((u - t2) / (t3 - t2));
+        Vector2D b1 = a1 * ((t2 - u) / (t2 - t0)) + a2 * ((u - t0) / (t2 - t0));
+        Vector2D b2 = a2 * ((t3 - u) / (t3 - t1)) + a3 * ((u - t1) / (t3 - t1));
+        return b1 * ((t2 - u) / (t2 - t1)) + b2 * ((u - t1) / (t2 - t1));
+    }
+}
+
+void RacingLine::build(const std::vector<structures::Point>& controlPoints)
+{
+    samples.clear();
+    length = 0;
+
+    // Duplicate points would make a zero length segment.
+    std::vector<Vector2D> points;
+    for (const structures::Point& p : controlPoints) {
+        Vector2D point(p);
+        if (points.empty() || (point - points.back()).getLength() > 1) {
+            points.push_back(point);
+        }
+    }
+    if (points.size() > 2 && (points.front() - points.back()).getLength() <= 1) {
+        points.pop_back();
+    }
+    if (points.size() < 2) {
+        return;
+    }
+
+    // Evaluate the closed spline densely, then resample to equal distances.
+    std::size_t n = points.size();
+    std::vector<structures::Point> dense;
+    for (std::size_t i = 0; i < n; i++) {
+        const Vector2D& p0 = points[(i + n - 1) % n];
+        const Vector2D& p1 = points[i];
+        const Vector2D& p2 = points[(i + 1) % n];
+        const Vector2D& p3 = points[(i + 2) % n];
+        int steps = std::max(8, static_cast<int>((p2 - p1).getLength() / 4));
+        for (int step = 0; step < steps; step++) {
+            dense.push_back(structures::Point(catmullRom(p0, p1, p2, p3, double(step) / steps)));
+        }
+    }
+    resample(dense);
+    computeCurvature();
+    computeSpeeds();
+}
+
+void RacingLine::resample(const std::vector<structures::Point>& dense)
+{
+    // Walk along the closed polyline and put a sample every SPACING px.
+    float walked = 0;     // distance along the polyline
+    float nextSample = 0; // distance of the next sample
+    for (std::size_t i = 0; i < dense.size(); i++) {
+        const structures::Point& a = dense[i];
+        const structures::Point& b = dense[(i + 1) % dense.size()];
+        float segment = (b - a).getLength();
+        while (nextSample <= walked + segment) {
+            float t = segment > 0 ? (nextSample - walked) / segment : 0;
+            Sample sample;
+            sample.position = a + (b - a) * t;
+            sample.distance = nextSample;
+            sample.curvature = 0;
+            sample.speed = 0;
+            samples.push_back(sample);
+            nextSample += SPACING;
+        }
+        walked += segment;
+    }
+    length = walked;
+    // The last sample may be at the same place as the first one.
+    if (samples.size() > 1 && length - samples.back().distance < SPACING / 2) {
+        samples.pop_back();
+    }
+}
+
+void RacingLine::computeCurvature()
+{
+    std::size_t n = samples.size();
+    if (n < 2 * CURVATURE_SPAN + 1) {
+        return;
+    }
+    for (std::size_t i = 0; i < n; i++) {
+        Vector2D previous(samples[(i + n - CURVATURE_SPAN) % n].position);
+        Vector2D current(samples[i].position);
+        Vector2D next(samples[(i + CURVATURE_SPAN) % n].position);
+        // Curvature of the circle through three points: 4 * area / (a * b * c)
+        Vector2D a = current - previous;
+        Vector2D b = next - current;
+        Vector2D c = next - previous;
+        double lengths = a.getLength() * b.getLength() * c.getLength();
+        samples[i].curvature = lengths > 0 ? static_cast<float>(2 * std::abs(Vector2D::determinant(a, b)) / lengths) : 0;
+    }
+}
+
+void RacingLine::computeSpeeds()
+{
+    // Turn rate limit: speed = angular velocity * turn radius.
+    const double turnRate = AI_TURN_MARGIN * Vector2D::deg2rad(AI_ANG_VEL);
+    for (Sample& sample : samples) {
+        double speed = AI_MAX_SPEED;
+        if (sample.curvature > 0) {
+            speed = std::min(speed, turnRate / sample.curvature);
+        }
+        sample.speed = static_cast<float>(speed);
+    }
+    // Braking limit: v^2 = v_next^2 + 2 * a * s. Go backwards twice around the loop,
+    // so that a turn right after the first sample also slows down the end of the loop.
+    std::size_t n = samples.size();
+    for (std::size_t k = 0; k < 2 * n; k++) {
+        std::size_t i = (2 * n - 1 - k) % n;
+        float next = samples[(i + 1) % n].speed;
+        float reachable = static_cast<float>(std::sqrt(next * next + 2 * AI_BRAKE * SPACING));
+        samples[i].speed = std::min(samples[i].speed, reachable);
+    }
+}
+
+std::size_t RacingLine::findNearest(const structures::Point& position) const
+{
+    std::size_t nearest = 0;
+    float best = -1;
+    for (std::size_t i = 0; i < samples.size(); i++) {
+        float distance = (samples[i].position - position).getLengthSquared();
+        if (best < 0 || distance < best) {
+            best = distance;
+            nearest = i;
+        }
+    }
+    return nearest;
+}
+
+std::size_t RacingLine::findNearest(const structures::Point& position, std::size_t hint) const
+{
+    std::size_t n = samples.size();
+    if (n <= SEARCH_BEHIND + SEARCH_AHEAD) {
+        return findNearest(position);
+    }
+    std::size_t nearest = hint % n;
+    float best = (samples[nearest].position - position).getLengthSquared();
+    for (std::size_t k = 0; k <= SEARCH_BEHIND + SEARCH_AHEAD; k++) {
+        std::size_t i = (hint + n - SEARCH_BEHIND + k) % n;
+        float distance = (samples[i].position - position).getLengthSquared();
+        if (distance < best) {
+            best = distance;
+            nearest = i;
+        }
+    }
+    return nearest;
+}
+
+std::size_t RacingLine::advance(std::size_t index, float distance) const
+{
+    if (samples.empty()) {
+        return 0;
+    }
+    std::size_t steps = static_cast<std::size_t>(std::max(0.0f, std::ceil(distance / SPACING)));
+    return (index + steps) % samples.size();
+}
@@ -0,0 +1,338 @@
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+
+#include "replay.hpp"
+#include "constants.hpp"
+#include "xmlParser.hpp"
+
+namespace {
+    const sf::Uint32 MAGIC = 0x4D4D5250; // "MMRP"
+    // Increase when the file format or the simulation changes so that old replays
+    // would not play the same race anymore.
+#ifdef FIXED_POINT_PHYSICS
+    // The fixed-point physics plays a race differently (see physicsMath.hpp).
+    const sf::Uint8 VERSION = 3 | 0x80;
+#else
+    const sf::Uint8 VERSION = 3;
+#endif
+}
+
+void Replay::startRecording(const RaceSetup& raceSetup)
+{
+    setup = raceSetup;
+    data.clear();
+    tickCount = 0;
+    runControls.clear();
+    runLength = 0;
+    checks.clear();
+}
+
+void Replay::record(const std::vector<Controls>& controls)
+{
+    // Continue the current run if nothing has changed.
+    if (runLength > 0 && controls == runControls) {
+        runLength++;
+    }
+    else {
+        flushRun();
+        runControls = controls;
+        runLength = 1;
+    }
+    tickCount++;
+}
+
+bool Replay::play(std::vector<Controls>& controls)
+{
+    if (ticksPlayed >= tickCount) {
+        controls.assign(setup.players, 0);
+        return false;
+    }
+    // Start the next run.
+    if (runLength == 0) {
+        std::size_t players = setup.players;
+        if (!readVarint(runLength) || runLength == 0 || readPos + players > data.size()) {
+            std::cerr << "Replay data is corrupted at tick " << ticksPlayed << std::endl;
+            ticksPlayed = tickCount;
+            controls.assign(setup.players, 0);
+            return false;
+        }
+        runControls.assign(data.begin() + readPos, data.begin() + readPos + players);
+        readPos += players;
+    }
+    runLength--;
+    ticksPlayed++;
+    controls = runControls;
+    return true;
+}
+
+void Replay::recordCheck(const StateHash& hash)
+{
+    Check check;
+    check.tick = hash.tick;
+    check.total = hash.total;
+    for (sf::Uint64 component : hash.components) {
+        check.components.push_back(static_cast<sf::Uint32>(component));
+    }
+    checks.push_back(check);
+}
+
+bool Replay::check(const StateHash& hash, int& component)
+{
+    component = -1;
+    // Checks are in tick order. Skip the ones which will never be compared.
+    while (nextCheck < checks.size() && checks[nextCheck].tick < hash.tick) {
+        nextCheck++;
+    }
+    if (diverged || nextCheck >= checks.size() || checks[nextCheck].tick != hash.tick) {
+        return true;
+    }
+    const Check& recorded = checks[nextCheck++];
+    if (recorded.total == hash.total) {
+        checksPassed++;
+        return true;
+    }
+    diverged = true;
+    for (std::size_t i = 0; i < recorded.components.size() && i < hash.components.size(); i++) {
+        if (recorded.components[i] != static_cast<sf::Uint32>(hash.components[i])) {
+            component = static_cast<int>(i);
+            break;
+        }
+    }
+    return false;
+}
+
+void Replay::flushRun()
+{
+    if (runLength == 0) {
+        return;
+    }
+    writeVarint(runLength);
+    data.insert(data.end(), runControls.begin(), runControls.end());
+    runLength = 0;
+}
+
+void Replay::writeVarint(unsigned int value)
+{
+    // 7 bits per byte, the highest bit tells that more bytes follow.
+    while (value >= 0x80) {
+        data.push_back(static_cast<sf::Uint8>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<sf::Uint8>(value));
+}
+
+bool Replay::readVarint(unsigned int& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 32 && readPos < data.size(); shift += 7) {
+        sf::Uint8 byte = data[readPos++];
+        value |= static_cast<unsigned int>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Replay::save(const std::string& filename)
+{
+    flushRun();
+
+    sf::Packet packet;
+    packet << MAGIC << VERSION << static_cast<sf::Uint16>(TICK_RATE);
+    packet << setup.xmlfile << static_cast<sf::Uint8>(setup.raceType) << static_cast<sf::Uint32>(setup.seed)
+           << static_cast<sf::Uint8>(setup.players) << static_cast<sf::Uint8>(setup.bots)
+           << static_cast<sf::Uint16>(setup.vehicleWidth) << static_cast<sf::Uint16>(setup.vehicleHeight)
+           << setup.vehicleImage << setup.backgroundImage;
+    packet << static_cast<sf::Uint32>(tickCount) << static_cast<sf::Uint32>(data.size());
+    packet.append(data.data(), data.size());
+    std::size_t componentCount = checks.empty() ? 0 : checks.front().components.size();
+    packet << static_cast<sf::Uint32>(checks.size()) << static_cast<sf::Uint16>(componentCount);
+    for (const Check& check : checks) {
+        packet << check.tick << check.total;
+        for (std::size_t i = 0; i < componentCount; i++) {
+            packet << (i < check.components.size() ? check.components[i] : 0);
+        }
+    }
+
+    std::ofstream out(filename, std::ofstream::binary);
+    if (!out) {
+        std::cerr << "Cannot write replay " << filename << std::endl;
+        return false;
+    }
+    out.write(static_cast<const char*>(packet.getData()), packet.getDataSize());
+    return out.good();
+}
+
+bool Replay::load(const std::string& filename)
+{
+    std::ifstream in(filename, std::ifstream::binary);
+    if (!in) {
+        std::cerr << "Cannot open replay " << filename << std::endl;
+        return false;
+    }
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    sf::Packet packet;
+    packet.append(bytes.data(), bytes.size());
+
+    sf::Uint32 magic = 0;
+    sf::Uint8 version = 0;
+    sf::Uint16 tickRate = 0;
+    if (!(packet >> magic >> version >> tickRate) || magic != MAGIC) {
+        std::cerr << filename << " is not a replay file." << std::endl;
+        return false;
+    }
+    if (version != VERSION || tickRate != TICK_RATE) {
+        std::cerr << filename << " was recorded with another version of the game." << std::endl;
+        return false;
+    }
+
+    RaceSetup loaded;
+    sf::Uint8 raceType, players, bots;
+    sf::Uint32 seed, ticks, size;
+    sf::Uint16 width, height;
+    packet >> loaded.xmlfile >> raceType >> seed >> players >> bots >> width >> height
+           >> loaded.vehicleImage >> loaded.backgroundImage >> ticks >> size;
+    if (!packet || size > bytes.size()) {
+        std::cerr << "Replay " << filename << " is corrupted." << std::endl;
+        return false;
+    }
+    std::vector<sf::Uint8> loadedData(size);
+    for (sf::Uint8& byte : loadedData) {
+        packet >> byte;
+    }
+    sf::Uint32 checkCount = 0;
+    sf::Uint16 componentCount = 0;
+    packet >> checkCount >> componentCount;
+    if (!packet || static_cast<std::size_t>(checkCount) * (12 + 4 * componentCount) > bytes.size()) {
+        std::cerr << "Replay " << filename << " is corrupted." << std::endl;
+        return false;
+    }
+    std::vector<Check> loadedChecks(checkCount);
+    for (Check& check : loadedChecks) {
+        packet >> check.tick >> check.total;
+        check.components.resize(componentCount);
+        for (sf::Uint32& component : check.components) {
+            packet >> component;
+        }
+    }
+    if (!packet) {
+        std::cerr << "Replay " << filename << " is corrupted." << std::endl;
+        return false;
+    }
+
+    loaded.raceType = raceType;
+    loaded.seed = seed;
+    loaded.players = players;
+    loaded.bots = bots;
+    loaded.vehicleWidth = width;
+    loaded.vehicleHeight = height;
+    setup = loaded;
+    data.swap(loadedData);
+    tickCount = ticks;
+    checks.swap(loadedChecks);
+
+    // Rewind
+    runControls.clear();
+    runLength = 0;
+    readPos = 0;
+    ticksPlayed = 0;
+    nextCheck = 0;
+    checksPassed = 0;
+    diverged = false;
+    return true;
+}
+
+// static
+std::string Replay::newFilePath()
+{
+    // The replays directory is next to the images and xml directories.
+    // The relative path depends on the directory where the executable is run.
+    std::string dir;
+    if (std::ifstream("../replays/README.md")) {
+        dir = "../replays/";
+    }
+    else if (std::ifstream("../../replays/README.md")) {
+        dir = "../../replays/";
+    }
+    char name[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(name, sizeof(name), "replay_%Y%m%d_%H%M%S.mmr", std::localtime(&now));
+    return dir + name;
+}
+
+int runHeadlessReplay(const std::string& filename, double speed)
+{
+    Replay replay;
+    if (!replay.load(filename)) {
+        return 1;
+    }
+    const RaceSetup& setup = replay.getSetup();
+    std::unique_ptr<Race> race;
+    try {
+        race = Race::create(setup);
+    }
+    catch (XMLException &e) {
+        std::cerr << "Error occured while reading xml file." << std::endl << e.what() << std::endl;
+        return 1;
+    }
+    race->addVehicles(setup);
+    race->setSeed(setup.seed);
+    race->playFrom(&replay);
+    race->initialize();
+
+    sf::Clock clock;
+    while (!replay.isFinished()) {
+        race->step();
+        // Sleep if we are ahead of the requested speed.
+        if (speed > 0) {
+            sf::Time ahead = sf::seconds(race->getSimTime() / speed) - clock.getElapsedTime();
+            if (ahead > sf::Time::Zero) {
+                sf::sleep(ahead);
+            }
+        }
+    }
+    double wallTime = clock.getElapsedTime().asSeconds();
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Replay " << filename << ": " << replay.getTickCount() << " ticks, "
+              << race->getSimTime() << " s simulated in " << wallTime << " s";
+    if (wallTime > 0) {
+        std::cout << " (" << race->getSimTime() / wallTime << "x real time)";
+    }
+    std::cout << std::endl;
+
+    // Final state of the race. The same replay must always print the same numbers.
+    std::cout << std::setprecision(6);
+    auto printVehicle = [](const char* name, Vehicle& v) {
+        std::cout << name << " " << v.getID() << ": place " << v.getRacePlace() << ", laps " << v.getLaps()
+                  << ", checkpoints " << v.getVisitedCheckPoints() << ", HP " << v.getHP()
+                  << ", position (" << v.getPhysics().getX() << ", " << v.getPhysics().getY() << ")" << std::endl;
+    };
+    for (auto &v : race->getVehicles()) {
+        printVehicle("Player", *v);
+    }
+    for (auto &v : race->getAIVehicles()) {
+        printVehicle("AI", *v);
+    }
+
+    // The state hash of every tick costs this much of the tick time.
+    const int ROUNDS = 1000;
+    StateHash hash;
+    sf::Clock hashClock;
+    for (int i = 0; i < ROUNDS; i++) {
+        race->hashState(hash);
+    }
+    double hashMicros = hashClock.getElapsedTime().asMicroseconds() / static_cast<double>(ROUNDS);
+    std::cout << std::setprecision(2) << "State checks passed: " << replay.getChecksPassed()
+              << ", state hash " << hashMicros << " us per tick";
+    if (speed <= 0 && replay.getTickCount() > 0) {
+        double tickMicros = wallTime * 1e6 / replay.getTickCount();
+        std::cout << " (" << 100 * hashMicros / tickMicros << " % of a tick)";
+    }
+    std::cout << std::endl;
+    return 0;
+}
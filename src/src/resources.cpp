@@ -0,0 +1,50 @@
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "resources.hpp"
+
+namespace {
+    std::mutex mutex;
+
+    // Loaded resources by name. A null pointer marks a file that could not be loaded,
+    // so that it's not tried again.
+    template <typename Resource>
+    std::map<std::string, std::unique_ptr<Resource>>& getCache()
+    {
+        static std::map<std::string, std::unique_ptr<Resource>> cache;
+        return cache;
+    }
+
+    template <typename Resource>
+    const Resource* load(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& cache = getCache<Resource>();
+        auto it = cache.find(name);
+        if (it != cache.end()) {
+            return it->second.get();
+        }
+        std::unique_ptr<Resource> resource(new Resource());
+        if (!resource->loadFromFile("../images/" + name)) {
+            if (!resource->loadFromFile("../../images/" + name)) {
+                resource.reset();
+            }
+        }
+        const Resource* result = resource.get();
+        cache[name] = std::move(resource);
+        return result;
+    }
+}
+
+namespace resources {
+    const sf::Texture* getTexture(const std::string& name)
+    {
+        return load<sf::Texture>(name);
+    }
+
+    const sf::Font* getFont(const std::string& name)
+    {
+        return load<sf::Font>(name);
+    }
+}
@@ -0,0 +1,87 @@
+#include <algorithm>
+
+#include "rollback.hpp"
+
+const unsigned int Rollback::MAX_ROLLBACK;
+const unsigned int Rollback::INPUT_BUFFER;
+
+Rollback::Rollback(Race& race) :
+race(race), players(race.getVehicles().size()), inputs(INPUT_BUFFER), states(MAX_ROLLBACK),
+firstTick(race.getTick() + 1)
+{
+}
+
+bool Rollback::addInput(int player, unsigned int tick, Controls controls)
+{
+    unsigned int next = race.getTick() + 1;
+    unsigned int oldest = next > MAX_ROLLBACK ? std::max(firstTick, next - MAX_ROLLBACK) : firstTick;
+    if (player < 0 || static_cast<std::size_t>(player) >= players
+        || tick < oldest || tick >= next + INPUT_BUFFER - MAX_ROLLBACK) {
+        return false;
+    }
+    Inputs& slot = getInputs(tick);
+    // A simulated tick holds the input it was simulated with.
+    if (tick < next && slot.controls[player] != controls && (rollbackTick == 0 || tick < rollbackTick)) {
+        rollbackTick = tick;
+    }
+    slot.controls[player] = controls;
+    slot.confirmed[player] = true;
+    return true;
+}
+
+unsigned int Rollback::advance()
+{
+    unsigned int next = race.getTick() + 1;
+    unsigned int resimulated = 0;
+    if (rollbackTick != 0) {
+        StateBuffer& state = states[rollbackTick % MAX_ROLLBACK];
+        state.rewind();
+        race.loadState(state);
+        race.setPublishing(false);
+        for (unsigned int tick = rollbackTick; tick < next; tick++) {
+            simulate(tick);
+            resimulated++;
+        }
+        race.setPublishing(true);
+        rollbackTick = 0;
+    }
+    simulate(next);
+    return resimulated;
+}
+
+Rollback::Inputs& Rollback::getInputs(unsigned int tick)
+{
+    Inputs& slot = inputs[tick % INPUT_BUFFER];
+    if (slot.tick != tick) {
+        slot.tick = tick;
+        slot.controls.assign(players, 0);
+        slot.confirmed.assign(players, false);
+    }
+    return slot;
+}
+
+Controls Rollback::predict(int player, unsigned int tick) const
+{
+    for (unsigned int back = 0; back < INPUT_BUFFER && back < tick; back++) {
+        const Inputs& slot = inputs[(tick - back) % INPUT_BUFFER];
+        if (slot.tick == tick - back && slot.confirmed[player]) {
+            return slot.controls[player];
+        }
+    }
+    return 0;
+}
+
+void Rollback::simulate(unsigned int tick)
+{
+    StateBuffer& state = states[tick % MAX_ROLLBACK];
+    state.clear();
+    race.saveState(state);
+    Inputs& slot = getInputs(tick);
+    for (std::size_t i = 0; i < players; i++) {
+        if (!slot.confirmed[i]) {
+            slot.controls[i] = predict(static_cast<int>(i), tick);
+        }
+        race.getVehicles()[i]->setInputControls(slot.controls[i]);
+    }
+    race.step();
+}
@@ -0,0 +1,6 @@
+#include "settings.hpp"
+
+namespace settings {
+    bool headless = false;
+    int bots = -1;
+}
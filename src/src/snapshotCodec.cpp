@@ -0,0 +1,513 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "snapshotCodec.hpp"
+#include "constants.hpp"
+
+namespace {
+    // Fixed point scales of the vehicle state.
+    const int POSITION_SCALE = 8;  // 1/8 px
+    const int VELOCITY_SCALE = 1;  // px/s, only used for prediction
+    const int ROTATION_BITS = 12;  // 0.09 degrees
+
+    // Bullets, missiles and pickups are stored as 16-bit pixels around the origin.
+    const int COORDINATE_OFFSET = 32768;
+
+    sf::Int32 toFixed(float value, int scale)
+    {
+        return static_cast<sf::Int32>(std::lround(value * scale));
+    }
+
+    sf::Uint16 toCoordinate(float value)
+    {
+        long pixel = std::lround(value) + COORDINATE_OFFSET;
+        return static_cast<sf::Uint16>(std::max(0L, std::min(65535L, pixel)));
+    }
+
+    float fromCoordinate(sf::Uint16 value)
+    {
+        return static_cast<float>(static_cast<int>(value) - COORDINATE_OFFSET);
+    }
+
+    // Angle in degrees to 1/(2^bits) turns.
+    sf::Uint32 toAngle(float degrees, int bits)
+    {
+        float turns = std::fmod(degrees, 360.0f) / 360.0f;
+        if (turns < 0) {
+            turns += 1;
+        }
+        return static_cast<sf::Uint32>(std::lround(turns * (1 << bits))) & ((1u << bits) - 1);
+    }
+
+    float fromAngle(sf::Uint32 value, int bits)
+    {
+        return value * 360.0f / (1 << bits);
+    }
+
+    // Shortest turn from angle base to angle, both of ROTATION_BITS.
+    sf::Int32 angleDelta(sf::Uint16 angle, sf::Uint16 base)
+    {
+        const int half = 1 << (ROTATION_BITS - 1);
+        return ((angle - base + half) & ((1 << ROTATION_BITS) - 1)) - half;
+    }
+
+    // Position (1/8 px) after ticks with velocity (px/s). Integer math, so that
+    // the server and the client predict exactly the same position.
+    sf::Int32 predict(sf::Int32 position, sf::Int32 velocity, sf::Int32 ticks)
+    {
+        sf::Int64 distance = static_cast<sf::Int64>(velocity) * ticks * POSITION_SCALE
+                             / (VELOCITY_SCALE * TICK_RATE);
+        return position + static_cast<sf::Int32>(distance);
+    }
+}
+
+namespace net {
+
+    SnapshotCodec::SnapshotCodec() : history(HISTORY_SIZE)
+    {
+        std::fill(ackedTicks, ackedTicks + 256, 0);
+    }
+
+    void SnapshotCodec::encode(const Snapshot& snapshot, sf::Uint32 ackTick, sf::Uint32 ackBits, sf::Packet& packet)
+    {
+        sf::Clock clock;
+        acknowledge(ackTick, ackBits);
+        encodeAgainst(snapshot, ackTick, packet);
+        stats.micros += clock.getElapsedTime().asMicroseconds();
+    }
+
+    void SnapshotCodec::encodeBroadcast(const Snapshot& snapshot, sf::Uint32 baseTick, sf::Packet& packet)
+    {
+        // Nothing is acknowledged, so findAcknowledged() never gives another baseline.
+        sf::Clock clock;
+        encodeAgainst(snapshot, baseTick, packet);
+        stats.micros += clock.getElapsedTime().asMicroseconds();
+    }
+
+    void SnapshotCodec::encodeAgainst(const Snapshot& snapshot, sf::Uint32 baseTick, sf::Packet& packet)
+    {
+        quantize(snapshot, current);
+
+        const QuantizedState* base = nullptr;
+        if (baseTick != 0 && baseTick < snapshot.tick && snapshot.tick - baseTick <= 255) {
+            base = findBaseline(baseTick);
+        }
+
+        writer.clear();
+        writer.write(snapshot.tick, 32);
+        writer.write(base != nullptr ? snapshot.tick - baseTick : 0, 8);
+        writer.write(snapshot.inputAck, 32);
+        write(current, base != nullptr ? *base : empty);
+        remember(current);
+
+        const std::vector<sf::Uint8>& data = writer.getData();
+        packet << static_cast<sf::Uint16>(data.size());
+        packet.append(data.data(), data.size());
+
+        stats.snapshots++;
+        stats.bytes += packet.getDataSize();
+    }
+
+    bool SnapshotCodec::decode(sf::Packet& packet, Snapshot& snapshot)
+    {
+        sf::Clock clock;
+        std::size_t messageSize = packet.getDataSize();
+        sf::Uint16 size = 0;
+        if (!(packet >> size)) {
+            return false;
+        }
+        buffer.resize(size);
+        for (sf::Uint8& byte : buffer) {
+            packet >> byte;
+        }
+        if (!packet) {
+            return false;
+        }
+
+        BitReader reader(buffer.data(), buffer.size());
+        sf::Uint32 tick = reader.read(32);
+        sf::Uint32 baseDistance = reader.read(8);
+        sf::Uint32 inputAck = reader.read(32);
+        const QuantizedState* base = &empty;
+        if (baseDistance != 0) {
+            base = findBaseline(tick - baseDistance);
+            if (base == nullptr) {
+                return false; // too old, wait for a snapshot against a newer acknowledgement
+            }
+        }
+        current.tick = tick;
+        if (!read(reader, current, *base) || reader.isOverflowed()) {
+            return false;
+        }
+        remember(current);
+
+        dequantize(current, snapshot);
+        snapshot.inputAck = inputAck;
+
+        stats.snapshots++;
+        stats.bytes += messageSize;
+        stats.micros += clock.getElapsedTime().asMicroseconds();
+        return true;
+    }
+
+    // static
+    void SnapshotCodec::quantize(const Snapshot& snapshot, QuantizedState& state)
+    {
+        state.valid = true;
+        state.tick = snapshot.tick;
+        state.clockStartTick = snapshot.clockStartTick;
+        state.started = snapshot.started;
+        state.ended = snapshot.ended;
+        state.lapsDriven = snapshot.lapsDriven;
+
+        state.vehicles.resize(std::min<std::size_t>(snapshot.vehicles.size(), 255));
+        for (std::size_t i = 0; i < state.vehicles.size(); i++) {
+            const VehicleState& v = snapshot.vehicles[i];
+            QuantizedVehicle& q = state.vehicles[i];
+            q.x = toFixed(v.x, POSITION_SCALE);
+            q.y = toFixed(v.y, POSITION_SCALE);
+            q.vx = toFixed(v.vx, VELOCITY_SCALE);
+            q.vy = toFixed(v.vy, VELOCITY_SCALE);
+            q.rotation = static_cast<sf::Uint16>(toAngle(v.rotation, ROTATION_BITS));
+            q.id = v.id;
+            q.hp = static_cast<sf::Uint8>(std::max(0, std::min(255, static_cast<int>(v.hp))));
+            q.laps = v.laps;
+            q.checkpoints = v.checkpoints;
+            q.place = v.place;
+            std::copy(v.weapons, v.weapons + MAX_WEAPONS, q.weapons);
+        }
+
+        state.projectiles.resize(std::min<std::size_t>(snapshot.projectiles.size(), 255));
+        for (std::size_t i = 0; i < state.projectiles.size(); i++) {
+            const ProjectileState& p = snapshot.projectiles[i];
+            state.projectiles[i] = {p.type, p.owner, toCoordinate(p.x), toCoordinate(p.y),
+                                    static_cast<sf::Uint8>(toAngle(p.rotation, 8))};
+        }
+
+        state.pickups.resize(std::min<std::size_t>(snapshot.pickups.size(), 15));
+        for (std::size_t i = 0; i < state.pickups.size(); i++) {
+            const PickupState& p = snapshot.pickups[i];
+            state.pickups[i] = {p.type, toCoordinate(p.x), toCoordinate(p.y)};
+        }
+    }
+
+    // static
+    void SnapshotCodec::dequantize(const QuantizedState& state, Snapshot& snapshot)
+    {
+        snapshot.tick = state.tick;
+        snapshot.clockStartTick = state.clockStartTick;
+        snapshot.started = state.started;
+        snapshot.ended = state.ended;
+        snapshot.lapsDriven = state.lapsDriven;
+
+        snapshot.vehicles.resize(state.vehicles.size());
+        for (std::size_t i = 0; i < state.vehicles.size(); i++) {
+            const QuantizedVehicle& q = state.vehicles[i];
+            VehicleState& v = snapshot.vehicles[i];
+            v.id = q.id;
+            v.x = static_cast<float>(q.x) / POSITION_SCALE;
+            v.y = static_cast<float>(q.y) / POSITION_SCALE;
+            v.rotation = fromAngle(q.rotation, ROTATION_BITS);
+            v.vx = static_cast<float>(q.vx) / VELOCITY_SCALE;
+            v.vy = static_cast<float>(q.vy) / VELOCITY_SCALE;
+            v.hp = q.hp;
+            v.laps = q.laps;
+            v.checkpoints = q.checkpoints;
+            v.place = q.place;
+            std::copy(q.weapons, q.weapons + MAX_WEAPONS, v.weapons);
+        }
+
+        snapshot.projectiles.resize(state.projectiles.size());
+        for (std::size_t i = 0; i < state.projectiles.size(); i++) {
+            const QuantizedProjectile& q = state.projectiles[i];
+            snapshot.projectiles[i] = {q.type, q.owner, fromCoordinate(q.x), fromCoordinate(q.y),
+                                       fromAngle(q.rotation, 8)};
+        }
+
+        snapshot.pickups.resize(state.pickups.size());
+        for (std::size_t i = 0; i < state.pickups.size(); i++) {
+            const QuantizedPickup& q = state.pickups[i];
+            snapshot.pickups[i] = {q.type, fromCoordinate(q.x), fromCoordinate(q.y)};
+        }
+    }
+
+    void SnapshotCodec::write(const QuantizedState& state, const QuantizedState& base)
+    {
+        writer.writeBool(state.started);
+        writer.writeBool(state.ended);
+        writer.writeBool(state.clockStartTick != base.clockStartTick);
+        if (state.clockStartTick != base.clockStartTick) {
+            writer.write(state.clockStartTick, 32);
+        }
+        writer.writeBool(state.lapsDriven != base.lapsDriven);
+        if (state.lapsDriven != base.lapsDriven) {
+            writer.write(state.lapsDriven, 8);
+        }
+
+        // Not every vehicle is in every snapshot (see InterestFilter), so the baseline
+        // of a vehicle is found by ID. The ID is sent as the gap to the previous one.
+        // A vehicle missing from the baseline is compared with the latest acknowledged
+        // snapshot that has it. Its distance (in snapshots) is sent, 0 if there is none.
+        indexVehicles(base);
+        const QuantizedVehicle none;
+        int previousID = 0;
+        writer.write(static_cast<sf::Uint32>(state.vehicles.size()), 8);
+        for (const QuantizedVehicle& v : state.vehicles) {
+            writeDelta(v.id - previousID - 1);
+            previousID = v.id;
+            int index = baseIndex[v.id];
+            const QuantizedVehicle* older = nullptr;
+            sf::Uint32 baseTick = base.tick;
+            writer.writeBool(index >= 0);
+            if (index < 0) {
+                const QuantizedState* olderState = findAcknowledged(v.id, state.tick);
+                sf::Uint32 distance = 0;
+                if (olderState != nullptr) {
+                    older = findVehicle(*olderState, v.id);
+                    baseTick = olderState->tick;
+                    distance = (state.tick - baseTick) / SNAPSHOT_INTERVAL;
+                }
+                writer.write(distance, DISTANCE_BITS);
+            }
+            const QuantizedVehicle& b = index >= 0 ? base.vehicles[index] : older != nullptr ? *older : none;
+            sf::Int32 ticks = &b != &none ? static_cast<sf::Int32>(state.tick - baseTick) : 0;
+            sf::Int32 x = predict(b.x, b.vx, ticks);
+            sf::Int32 y = predict(b.y, b.vy, ticks);
+            bool moved = v.x != x || v.y != y || v.rotation != b.rotation || v.vx != b.vx || v.vy != b.vy;
+            bool other = v.hp != b.hp || v.laps != b.laps || v.checkpoints != b.checkpoints
+                         || v.place != b.place || !std::equal(v.weapons, v.weapons + MAX_WEAPONS, b.weapons);
+            // An unchanged vehicle takes one bit after its ID.
+            writer.writeBool(moved || other);
+            if (!moved && !other) {
+                continue;
+            }
+            writer.writeBool(moved);
+            if (moved) {
+                writeDelta(v.x - x);
+                writeDelta(v.y - y);
+                writeDelta(angleDelta(v.rotation, b.rotation));
+                writeDelta(v.vx - b.vx);
+                writeDelta(v.vy - b.vy);
+            }
+            writer.writeBool(other);
+            if (other) {
+                writer.write(v.hp, 8);
+                writer.write(v.laps, 8);
+                writer.write(v.checkpoints, 8);
+                writer.write(v.place, 8);
+                for (sf::Uint8 weapon : v.weapons) {
+                    writer.write(weapon, 2);
+                }
+            }
+        }
+
+        writer.write(static_cast<sf::Uint32>(state.projectiles.size()), 8);
+        for (const QuantizedProjectile& p : state.projectiles) {
+            writer.write(p.type, 1);
+            writer.write(p.owner, 8);
+            writer.write(p.x, 16);
+            writer.write(p.y, 16);
+            writer.write(p.rotation, 8);
+        }
+
+        // Pickups change only when a weapon is picked up or spawned.
+        bool pickupsChanged = state.pickups != base.pickups;
+        writer.writeBool(pickupsChanged);
+        if (pickupsChanged) {
+            writer.write(static_cast<sf::Uint32>(state.pickups.size()), 4);
+            for (const QuantizedPickup& p : state.pickups) {
+                writer.write(p.type, 2);
+                writer.write(p.x, 16);
+                writer.write(p.y, 16);
+            }
+        }
+    }
+
+    bool SnapshotCodec::read(BitReader& reader, QuantizedState& state, const QuantizedState& base)
+    {
+        state.valid = true;
+        state.started = reader.readBool();
+        state.ended = reader.readBool();
+        state.clockStartTick = reader.readBool() ? reader.read(32) : base.clockStartTick;
+        state.lapsDriven = reader.readBool() ? static_cast<sf::Uint8>(reader.read(8)) : base.lapsDriven;
+
+        indexVehicles(base);
+        const QuantizedVehicle none;
+        int previousID = 0;
+        state.vehicles.resize(reader.read(8));
+        for (QuantizedVehicle& v : state.vehicles) {
+            sf::Uint8 id = static_cast<sf::Uint8>(previousID + 1 + readDelta(reader));
+            previousID = id;
+            int index = reader.readBool() ? baseIndex[id] : -1;
+            const QuantizedVehicle* older = nullptr;
+            sf::Uint32 baseTick = base.tick;
+            if (index < 0) {
+                sf::Uint32 distance = reader.read(DISTANCE_BITS);
+                if (distance != 0) {
+                    baseTick = state.tick - distance * SNAPSHOT_INTERVAL;
+                    const QuantizedState* olderState = findBaseline(baseTick);
+                    older = olderState != nullptr ? findVehicle(*olderState, id) : nullptr;
+                    if (older == nullptr) {
+                        return false; // the baseline has been overwritten
+                    }
+                }
+            }
+            const QuantizedVehicle& b = index >= 0 ? base.vehicles[index] : older != nullptr ? *older : none;
+            sf::Int32 ticks = &b != &none ? static_cast<sf::Int32>(state.tick - baseTick) : 0;
+            v = b;
+            v.id = id;
+            v.x = predict(b.x, b.vx, ticks);
+            v.y = predict(b.y, b.vy, ticks);
+            if (!reader.readBool()) {
+                continue; // unchanged
+            }
+            if (reader.readBool()) {
+                v.x += readDelta(reader);
+                v.y += readDelta(reader);
+                v.rotation = static_cast<sf::Uint16>((b.rotation + readDelta(reader)) & ((1 << ROTATION_BITS) - 1));
+                v.vx = b.vx + readDelta(reader);
+                v.vy = b.vy + readDelta(reader);
+            }
+            if (reader.readBool()) {
+                v.hp = static_cast<sf::Uint8>(reader.read(8));
+                v.laps = static_cast<sf::Uint8>(reader.read(8));
+                v.checkpoints = static_cast<sf::Uint8>(reader.read(8));
+                v.place = static_cast<sf::Uint8>(reader.read(8));
+                for (sf::Uint8& weapon : v.weapons) {
+                    weapon = static_cast<sf::Uint8>(reader.read(2));
+                }
+            }
+        }
+
+        state.projectiles.resize(reader.read(8));
+        for (QuantizedProjectile& p : state.projectiles) {
+            p.type = static_cast<sf::Uint8>(reader.read(1));
+            p.owner = static_cast<sf::Uint8>(reader.read(8));
+            p.x = static_cast<sf::Uint16>(reader.read(16));
+            p.y = static_cast<sf::Uint16>(reader.read(16));
+            p.rotation = static_cast<sf::Uint8>(reader.read(8));
+        }
+
+        if (reader.readBool()) {
+            state.pickups.resize(reader.read(4));
+            for (QuantizedPickup& p : state.pickups) {
+                p.type = static_cast<sf::Uint8>(reader.read(2));
+                p.x = static_cast<sf::Uint16>(reader.read(16));
+                p.y = static_cast<sf::Uint16>(reader.read(16));
+            }
+        }
+        else {
+            state.pickups = base.pickups;
+        }
+        return true;
+    }
+
+    void SnapshotCodec::writeDelta(sf::Int32 delta)
+    {
+        // Zigzag: small negative and positive numbers both become small unsigned numbers.
+        sf::Uint32 value = (static_cast<sf::Uint32>(delta) << 1) ^ static_cast<sf::Uint32>(delta >> 31);
+        if (value == 0) {
+            writer.write(0, 2);
+        }
+        else if (value < (1u << 5)) {
+            writer.write(1, 2);
+            writer.write(value, 5);
+        }
+        else if (value < (1u << 8)) {
+            writer.write(2, 2);
+            writer.write(value, 8);
+        }
+        else {
+            writer.write(3, 2);
+            writer.write(value, 32);
+        }
+    }
+
+    // static
+    sf::Int32 SnapshotCodec::readDelta(BitReader& reader)
+    {
+        static const int BITS[4] = {0, 5, 8, 32};
+        int bits = BITS[reader.read(2)];
+        sf::Uint32 value = bits > 0 ? reader.read(bits) : 0;
+        return static_cast<sf::Int32>(value >> 1) ^ -static_cast<sf::Int32>(value & 1);
+    }
+
+    sf::Uint32 SnapshotCodec::getAckBits(sf::Uint32 ackTick) const
+    {
+        sf::Uint32 bits = 0;
+        for (sf::Uint32 n = 0; n < 32; n++) {
+            sf::Uint32 distance = (n + 1) * SNAPSHOT_INTERVAL;
+            if (distance < ackTick && findBaseline(ackTick - distance) != nullptr) {
+                bits |= 1u << n;
+            }
+        }
+        return bits;
+    }
+
+    void SnapshotCodec::acknowledge(sf::Uint32 ackTick, sf::Uint32 ackBits)
+    {
+        auto mark = [this](sf::Uint32 tick) {
+            QuantizedState& state = history[(tick / SNAPSHOT_INTERVAL) % HISTORY_SIZE];
+            if (!state.valid || state.tick != tick || state.acked) {
+                return;
+            }
+            state.acked = true;
+            for (const QuantizedVehicle& v : state.vehicles) {
+                ackedTicks[v.id] = std::max(ackedTicks[v.id], tick);
+            }
+        };
+        mark(ackTick);
+        for (sf::Uint32 n = 0; n < 32; n++) {
+            sf::Uint32 distance = (n + 1) * SNAPSHOT_INTERVAL;
+            if ((ackBits & (1u << n)) != 0 && distance < ackTick) {
+                mark(ackTick - distance);
+            }
+        }
+    }
+
+    const SnapshotCodec::QuantizedState* SnapshotCodec::findAcknowledged(sf::Uint8 id, sf::Uint32 tick) const
+    {
+        sf::Uint32 ackedTick = ackedTicks[id];
+        // The client must still have it: HISTORY_SIZE snapshots are kept, and a few newer
+        // ones may have arrived before this one.
+        if (ackedTick == 0 || ackedTick >= tick
+            || (tick - ackedTick) / SNAPSHOT_INTERVAL >= std::min<sf::Uint32>(HISTORY_SIZE - 8, 1 << DISTANCE_BITS)) {
+            return nullptr;
+        }
+        return findBaseline(ackedTick);
+    }
+
+    // static
+    const SnapshotCodec::QuantizedVehicle* SnapshotCodec::findVehicle(const QuantizedState& state, sf::Uint8 id)
+    {
+        for (const QuantizedVehicle& v : state.vehicles) {
+            if (v.id == id) {
+                return &v;
+            }
+        }
+        return nullptr;
+    }
+
+    void SnapshotCodec::indexVehicles(const QuantizedState& base)
+    {
+        std::fill(baseIndex, baseIndex + 256, -1);
+        for (std::size_t i = 0; i < base.vehicles.size(); i++) {
+            baseIndex[base.vehicles[i].id] = static_cast<int>(i);
+        }
+    }
+
+    const SnapshotCodec::QuantizedState* SnapshotCodec::findBaseline(sf::Uint32 tick) const
+    {
+        const QuantizedState& state = history[(tick / SNAPSHOT_INTERVAL) % HISTORY_SIZE];
+        return state.valid && state.tick == tick ? &state : nullptr;
+    }
+
+    void SnapshotCodec::remember(const QuantizedState& state)
+    {
+        // Assignment reuses the memory of the old vectors.
+        QuantizedState& entry = history[(state.tick / SNAPSHOT_INTERVAL) % HISTORY_SIZE];
+        entry = state;
+        entry.acked = false;
+    }
+}
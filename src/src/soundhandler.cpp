@@ -1,7 +1,36 @@
+#include <cmath>
+
 #include "soundhandler.hpp"
+#include "settings.hpp"
+
+constexpr float SoundHandler::HEARING_DISTANCE;
+
+namespace {
+	// When all voices are busy, a sound with a higher priority replaces one with a lower priority.
+	int getPriority(SoundType ID)
+	{
+		switch (ID) {
+			case SoundType::BUTTON: return 5;
+			case SoundType::EXPLOSION: return 4;
+			case SoundType::PICKUP: return 3;
+			case SoundType::TURBO: return 3;
+			case SoundType::ROCKET: return 3;
+			case SoundType::GUNSHOT: return 2;
+			default: return 1;
+		}
+	}
+}
 
 SoundHandler::SoundHandler()
 {
+	// Without a window there is nothing to hear. Don't open the audio device at all.
+	nullOutput = settings::headless;
+	if (nullOutput) {
+		return;
+	}
+	voices.resize(VOICE_COUNT);
+	engines.resize(ENGINE_VOICES);
+
 	// Immediately load everything. This might take a while on slower machines...
 	initSound(SoundType::ENGINE, "Dismal_racket.wav");
 	initSound(SoundType::TURBO, "Turbo.wav");
@@ -12,84 +41,217 @@ SoundHandler::SoundHandler()
 	initSound(SoundType::PICKUP, "Pickup.wav");
 	initSound(SoundType::BUTTON, "Button.wav");
 
-	getSound(SoundType::COLLISION).setVolume(35.0f); //this sounds very loud
+	volumes[SoundType::COLLISION] = 35.0f; //this sounds very loud
+
+	for (sf::Sound& engine : engines) {
+		engine.setBuffer(*soundBuffers[SoundType::ENGINE]);
+		engine.setLoop(true);
+	}
 }
 
 void SoundHandler::initSound(SoundType ID, const std::string& filename)
 {
+	if (nullOutput) {
+		return;
+	}
 	std::unique_ptr < sf::SoundBuffer> buffer(new sf::SoundBuffer());
 	if (!buffer->loadFromFile("../sound/" + filename))
 	{
 		if (!buffer->loadFromFile("../../sound/" + filename))
 			std::cout << "SoundHandler::initSound - Couldn't find " << filename << std::endl;
 	}
-	soundBuffers.insert(std::make_pair( ID, std::move(buffer) ));
-
-	sf::Sound sound;
-	sound.setBuffer(*soundBuffers[ID]);
-	sounds.insert(std::make_pair(ID, sound));
+	soundBuffers[ID] = std::move(buffer);
+	volumes[ID] = 100.0f;
 }
 
 ///Returns false if sound hasn't been added.
 bool SoundHandler::isSound(SoundType ID)
 {
-	auto found = sounds.find(ID);
-	return (found != sounds.end());
+	auto found = soundBuffers.find(ID);
+	return (found != soundBuffers.end());
 
 }
 
-sf::Sound& SoundHandler::getSound(SoundType ID)
+void SoundHandler::playSound(SoundType ID)
 {
-	return sounds[ID];
+	play(ID, listener, 1);
 }
-	
-void SoundHandler::playSound(SoundType ID)
+
+void SoundHandler::playSound(SoundType ID, const sf::Vector2f& position)
 {
-	sounds[ID].play();
+	play(ID, position, 1);
 }
 
 void SoundHandler::playRandomPitch(SoundType ID, float modifier)
 {
-	//Getting truly numbers here isn't critical, so rand() will suffice.
-	//The formula below will give a random float between 0 and 1.
-	sounds[ID].setPitch(1 + modifier * ((static_cast <float> (rand()) / static_cast <float> (RAND_MAX)))); 
-	sounds[ID].play();
+	playRandomPitch(ID, modifier, listener);
+}
+
+void SoundHandler::playRandomPitch(SoundType ID, float modifier, const sf::Vector2f& position)
+{
+	play(ID, position, 1 + modifier * std::uniform_real_distribution<float>(0, 1)(pitchRandom));
+}
+
+void SoundHandler::play(SoundType ID, const sf::Vector2f& position, float pitch)
+{
+	if (!isSound(ID)) {
+		return;
+	}
+	float volume = volumes[ID] * getAttenuation(position);
+	if (volume <= 0) {
+		return; // out of hearing distance
+	}
+	Voice* voice = allocate(getPriority(ID), volume);
+	if (voice == nullptr) {
+		return;
+	}
+	voice->sound.stop();
+	voice->sound.setBuffer(*soundBuffers[ID]);
+	voice->sound.setPitch(pitch);
+	place(voice->sound, volume, position);
+	voice->type = ID;
+	voice->priority = getPriority(ID);
+	voice->sound.play();
+}
+
+SoundHandler::Voice* SoundHandler::allocate(int priority, float volume)
+{
+	Voice* weakest = nullptr;
+	for (Voice& voice : voices) {
+		if (voice.sound.getStatus() != sf::Sound::Status::Playing) {
+			return &voice;
+		}
+		if (weakest == nullptr || voice.priority < weakest->priority
+				|| (voice.priority == weakest->priority && voice.sound.getVolume() < weakest->sound.getVolume())) {
+			weakest = &voice;
+		}
+	}
+	if (weakest == nullptr || weakest->priority > priority
+			|| (weakest->priority == priority && weakest->sound.getVolume() >= volume)) {
+		return nullptr;
+	}
+	return weakest;
+}
+
+float SoundHandler::getAttenuation(const sf::Vector2f& position) const
+{
+	sf::Vector2f d = position - listener;
+	float distance = std::sqrt(d.x * d.x + d.y * d.y);
+	if (distance >= HEARING_DISTANCE) {
+		return 0;
+	}
+	// Quadratic falloff sounds more natural than linear.
+	float share = 1 - distance / HEARING_DISTANCE;
+	return share * share;
 }
 
-void SoundHandler::playAsLoop(SoundType ID)
+void SoundHandler::place(sf::Sound& sound, float volume, const sf::Vector2f& position) const
 {
-	sounds[ID].setLoop(true);
-	sounds[ID].play();
+	// The volume is attenuated here, OpenAL only pans the sound left or right.
+	// (Panning works for mono sounds only.)
+	float pan = std::max(-1.0f, std::min(1.0f, (position.x - listener.x) / HEARING_DISTANCE));
+	sound.setRelativeToListener(true);
+	sound.setAttenuation(0);
+	sound.setPosition(pan, 0, -1);
+	sound.setVolume(volume);
 }
 
 void SoundHandler::stopSound(SoundType ID)
 {
-	sounds[ID].stop();
+	for (Voice& voice : voices) {
+		if (voice.type == ID) {
+			voice.sound.stop();
+		}
+	}
+	if (ID == SoundType::ENGINE) {
+		for (sf::Sound& engine : engines) {
+			engine.stop();
+		}
+	}
 }
 
-void SoundHandler::stopAllSound(SoundType ID)
+void SoundHandler::stopAllSound()
 {
-	for (auto i : sounds)
-		i.second.stop();
+	for (Voice& voice : voices)
+		voice.sound.stop();
+	for (sf::Sound& engine : engines)
+		engine.stop();
 }
 
-void SoundHandler::pauseAllSound(SoundType ID)
+void SoundHandler::pauseAllSound()
 {
-	for (auto i : sounds)
-		i.second.pause();
+	for (Voice& voice : voices)
+		voice.sound.pause();
+	for (sf::Sound& engine : engines)
+		engine.pause();
 }
 
 bool SoundHandler::isPlaying(SoundType ID)
 {
-	return (sounds[ID].getStatus() == sf::Sound::Status::Playing);
+	for (const Voice& voice : voices) {
+		if (voice.type == ID && voice.sound.getStatus() == sf::Sound::Status::Playing) {
+			return true;
+		}
+	}
+	if (ID == SoundType::ENGINE) {
+		for (const sf::Sound& engine : engines) {
+			if (engine.getStatus() == sf::Sound::Status::Playing) {
+				return true;
+			}
+		}
+	}
+	return false;
 }
 
-void SoundHandler::revvingSound(SoundType ID, float pitch)
+void SoundHandler::updateEngines(std::vector<EngineSource>& sources)
 {
-	while (pitch > 1)
-	{
-		pitch -= 0.6f;
+	if (engines.empty()) {
+		return;
+	}
+	auto distance = [this](const EngineSource& source) {
+		sf::Vector2f d = source.position - listener;
+		return d.x * d.x + d.y * d.y;
+	};
+	// Only the closest engines matter, the rest are not sorted.
+	std::size_t heard = std::min(engines.size(), sources.size());
+	std::partial_sort(sources.begin(), sources.begin() + heard, sources.end(),
+		[&distance](const EngineSource& a, const EngineSource& b) { return distance(a) < distance(b); });
+
+	for (std::size_t i = 0; i < engines.size(); i++) {
+		float volume = i < heard ? volumes[SoundType::ENGINE] * getAttenuation(sources[i].position) : 0;
+		if (volume <= 0) {
+			if (engines[i].getStatus() == sf::Sound::Status::Playing) {
+				engines[i].stop();
+			}
+			continue;
+		}
+		// Engine revving. Lower values of pitch (speed/700) indicate longer gearing,
+		// higher values (speed/300) indicate short gearing.
+		float pitch = sources[i].speed / 500;
+		while (pitch > 1)
+		{
+			pitch -= 0.6f;
+		}
+		engines[i].setPitch(1 + pitch);
+		place(engines[i], volume, sources[i].position);
+		if (engines[i].getStatus() != sf::Sound::Status::Playing) {
+			engines[i].play();
+		}
 	}
-	sounds[ID].setPitch(1 + pitch);
 }
 
+std::size_t SoundHandler::getActiveVoices() const
+{
+	std::size_t count = 0;
+	for (const Voice& voice : voices) {
+		if (voice.sound.getStatus() == sf::Sound::Status::Playing) {
+			count++;
+		}
+	}
+	for (const sf::Sound& engine : engines) {
+		if (engine.getStatus() == sf::Sound::Status::Playing) {
+			count++;
+		}
+	}
+	return count;
+}
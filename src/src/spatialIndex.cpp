@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cmath>
+
+#include "spatialIndex.hpp"
+#include "vehicle.hpp"
+
+constexpr double SpatialIndex::CELL_SIZE;
+
+namespace {
+    // Cell coordinates are offset to make them positive in the key.
+    const long long CELL_OFFSET = 1LL << 31;
+}
+
+void SpatialIndex::build(const VehicleRegistry& registry)
+{
+    const std::vector<Vector2D>& centers = registry.getCenters();
+    entries.resize(centers.size());
+    for (std::size_t e = 0; e < centers.size(); e++) {
+        entries[e].position = centers[e];
+        entries[e].cell = getCell(centers[e]);
+        entries[e].vehicle = &registry.getVehicle(e);
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.cell < b.cell;
+    });
+}
+
+unsigned long long SpatialIndex::getCell(const Vector2D& position)
+{
+    return getCell(static_cast<long long>(std::floor(position.x / CELL_SIZE)),
+            static_cast<long long>(std::floor(position.y / CELL_SIZE)));
+}
+
+unsigned long long SpatialIndex::getCell(long long x, long long y)
+{
+    return (static_cast<unsigned long long>(y + CELL_OFFSET) << 32) | static_cast<unsigned long long>(x + CELL_OFFSET);
+}
+
+void SpatialIndex::query(const Vector2D& position, double radius, int excludeID,
+        std::vector<const Entry*>& found) const
+{
+    if (entries.empty() || radius < 0) {
+        return;
+    }
+    long long x0 = static_cast<long long>(std::floor((position.x - radius) / CELL_SIZE));
+    long long x1 = static_cast<long long>(std::floor((position.x + radius) / CELL_SIZE));
+    long long y0 = static_cast<long long>(std::floor((position.y - radius) / CELL_SIZE));
+    long long y1 = static_cast<long long>(std::floor((position.y + radius) / CELL_SIZE));
+    auto byCell = [](const Entry& entry, unsigned long long cell) { return entry.cell < cell; };
+
+    for (long long y = y0; y <= y1; y++) {
+        // The cells of a row are next to each other in the sorted entries.
+        auto it = std::lower_bound(entries.begin(), entries.end(), getCell(x0, y), byCell);
+        unsigned long long last = getCell(x1, y);
+        for (; it != entries.end() && it->cell <= last; ++it) {
+            if (it->vehicle->getID() == excludeID || it->vehicle->isDestroyed()) {
+                continue;
+            }
+            if ((it->position - position).getLengthSquared() <= radius * radius) {
+                found.push_back(&*it);
+            }
+        }
+    }
+    std::sort(found.begin(), found.end(), [&position](const Entry* a, const Entry* b) {
+        double da = (a->position - position).getLengthSquared();
+        double db = (b->position - position).getLengthSquared();
+        return da < db || (da == db && a->vehicle->getID() < b->vehicle->getID());
+    });
+}
+
+Vehicle* SpatialIndex::findNearest(const Vector2D& position, double radius, int excludeID) const
+{
+    std::vector<const Entry*> found;
+    query(position, radius, excludeID, found);
+    return found.empty() ? nullptr : found.front()->vehicle;
+}
+
+void SpatialIndex::findNearest(const Vector2D& position, std::size_t k, double radius,
+        std::vector<Vehicle*>& result, int excludeID) const
+{
+    std::vector<const Entry*> found;
+    query(position, radius, excludeID, found);
+    for (std::size_t i = 0; i < found.size() && i < k; i++) {
+        result.push_back(found[i]->vehicle);
+    }
+}
+
+void SpatialIndex::findWithinRadius(const Vector2D& position, double radius,
+        std::vector<Vehicle*>& result, int excludeID) const
+{
+    findNearest(position, entries.size(), radius, result, excludeID);
+}
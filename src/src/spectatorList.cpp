@@ -0,0 +1,77 @@
+#include "spectatorList.hpp"
+
+namespace net {
+
+    SpectatorList::SpectatorList(std::size_t listCapacity) : capacity(listCapacity)
+    {
+        spectators.reserve(capacity);
+        indexes.reserve(capacity);
+    }
+
+    bool SpectatorList::handleSpectate(const sf::IpAddress& address, unsigned short port, bool& added)
+    {
+        sf::Uint64 key = getKey(address, port);
+        auto it = indexes.find(key);
+        if (it != indexes.end()) {
+            spectators[it->second].lastHeard = clock.getElapsedTime();
+            added = false;
+            return true;
+        }
+        added = false;
+        if (spectators.size() >= capacity) {
+            return false;
+        }
+        indexes[key] = spectators.size();
+        spectators.push_back({address, port, clock.getElapsedTime()});
+        added = true;
+        return true;
+    }
+
+    void SpectatorList::remove(const sf::IpAddress& address, unsigned short port)
+    {
+        auto it = indexes.find(getKey(address, port));
+        if (it == indexes.end()) {
+            return;
+        }
+        // Move the last spectator to the hole.
+        std::size_t index = it->second;
+        indexes.erase(it);
+        if (index + 1 < spectators.size()) {
+            spectators[index] = spectators.back();
+            indexes[getKey(spectators[index].address, spectators[index].port)] = index;
+        }
+        spectators.pop_back();
+    }
+
+    std::size_t SpectatorList::removeSilent()
+    {
+        sf::Time now = clock.getElapsedTime();
+        std::size_t removed = 0;
+        for (std::size_t i = 0; i < spectators.size(); ) {
+            if ((now - spectators[i].lastHeard).asSeconds() > TIMEOUT) {
+                // The last one takes its place, so check the same index again.
+                remove(spectators[i].address, spectators[i].port);
+                removed++;
+            }
+            else {
+                i++;
+            }
+        }
+        return removed;
+    }
+
+    void SpectatorList::broadcast(sf::UdpSocket& socket, const void* data, std::size_t size)
+    {
+        sf::Clock sendClock;
+        for (const Spectator& spectator : spectators) {
+            // A full send buffer drops the datagram, like the network would.
+            if (socket.send(data, size, spectator.address, spectator.port) != sf::Socket::Done) {
+                stats.dropped++;
+            }
+        }
+        stats.messages++;
+        stats.sends += spectators.size();
+        stats.bytes += spectators.size() * size;
+        stats.micros += sendClock.getElapsedTime().asMicroseconds();
+    }
+}
@@ -0,0 +1,187 @@
+#include <iomanip>
+#include <iostream>
+
+#include "spectatorRelay.hpp"
+
+namespace {
+    // SPECTATE is sent this often until the server answers, and then as a keep-alive.
+    const float RETRY_INTERVAL = 0.5f; // seconds
+    const float KEEP_ALIVE_INTERVAL = 1; // seconds
+
+    // Interval of the report.
+    const float REPORT_INTERVAL = 5; // seconds
+}
+
+const std::size_t SpectatorRelay::DEFAULT_MAX_SPECTATORS;
+
+SpectatorRelay::SpectatorRelay(const sf::IpAddress& server, unsigned short serverUdpPort, unsigned short relayPort,
+                               std::size_t maxSpectators) :
+serverAddress(server), serverPort(serverUdpPort), port(relayPort), spectators(maxSpectators),
+buffer(sf::UdpSocket::MaxDatagramSize)
+{
+
+}
+
+bool SpectatorRelay::start()
+{
+    if (socket.bind(port) != sf::Socket::Done) {
+        std::cerr << "Cannot listen on UDP port " << port << std::endl;
+        return false;
+    }
+    socket.setBlocking(false);
+    std::cout << "Relay on UDP port " << port << " for the race of " << serverAddress << ":" << serverPort
+              << ", at most " << spectators.getCapacity() << " spectators" << std::endl;
+    lastHeard.restart();
+    reportClock.restart();
+    reportedCpu = std::clock();
+    subscribe();
+    return true;
+}
+
+bool SpectatorRelay::update()
+{
+    std::size_t size = 0;
+    sf::IpAddress sender;
+    unsigned short senderPort;
+    while (socket.receive(buffer.data(), buffer.size(), size, sender, senderPort) == sf::Socket::Done) {
+        net::MessageType type;
+        if (!net::readHeader(buffer.data(), size, type)) {
+            continue; // not ours
+        }
+        if (sender == serverAddress && senderPort == serverPort) {
+            handleServerMessage(type, size);
+        }
+        else if (type == net::SPECTATE) {
+            handleSpectate(sender, senderPort, size);
+        }
+        else if (type == net::BYE) {
+            spectators.remove(sender, senderPort);
+        }
+    }
+    if (serverLeft) {
+        std::cout << "The server has left." << std::endl;
+        return false;
+    }
+    if (lastHeard.getElapsedTime().asSeconds() > net::TIMEOUT) {
+        std::cout << (welcome.empty() ? "No answer from the server." : "Lost connection to the server.") << std::endl;
+        return false;
+    }
+
+    float interval = welcome.empty() ? RETRY_INTERVAL : KEEP_ALIVE_INTERVAL;
+    if (subscribeClock.getElapsedTime().asSeconds() >= interval) {
+        subscribe();
+        spectators.removeSilent();
+    }
+    if (reportClock.getElapsedTime().asSeconds() >= REPORT_INTERVAL) {
+        report();
+    }
+    return true;
+}
+
+void SpectatorRelay::handleServerMessage(net::MessageType type, std::size_t size)
+{
+    lastHeard.restart();
+    switch (type) {
+        case net::WELCOME:
+            if (welcome.empty()) {
+                std::cout << "Subscribed to the race." << std::endl;
+            }
+            welcome.assign(buffer.begin(), buffer.begin() + size);
+            break;
+        case net::KEYFRAME:
+            keyframe.assign(buffer.begin(), buffer.begin() + size);
+            spectators.broadcast(socket, buffer.data(), size);
+            break;
+        case net::SNAPSHOT:
+            spectators.broadcast(socket, buffer.data(), size);
+            break;
+        case net::BYE:
+            // The race is over, or the server is full of spectators.
+            spectators.broadcast(socket, buffer.data(), size);
+            serverLeft = true;
+            break;
+        default:
+            break;
+    }
+}
+
+void SpectatorRelay::handleSpectate(const sf::IpAddress& address, unsigned short senderPort, std::size_t size)
+{
+    bool welcomed = size > net::HEADER_SIZE && buffer[net::HEADER_SIZE] != 0;
+    bool added = false;
+    if (!spectators.handleSpectate(address, senderPort, added)) {
+        net::beginMessage(packet, net::BYE);
+        socket.send(packet, address, senderPort);
+        return;
+    }
+    // Without the WELCOME of the server, the spectator asks again later.
+    if ((added || !welcomed) && !welcome.empty()) {
+        socket.send(welcome.data(), welcome.size(), address, senderPort);
+        if (!keyframe.empty()) {
+            socket.send(keyframe.data(), keyframe.size(), address, senderPort);
+        }
+    }
+}
+
+void SpectatorRelay::subscribe()
+{
+    net::beginMessage(packet, net::SPECTATE);
+    packet << static_cast<sf::Uint8>(welcome.empty() ? 0 : 1);
+    socket.send(packet, serverAddress, serverPort);
+    subscribeClock.restart();
+}
+
+void SpectatorRelay::report()
+{
+    float seconds = reportClock.restart().asSeconds();
+    std::clock_t cpu = std::clock();
+    const net::BroadcastStats& stats = spectators.getStats();
+    std::size_t sends = stats.sends - reportedStats.sends;
+    sf::Int64 micros = stats.micros - reportedStats.micros;
+    std::cout << std::fixed << std::setprecision(1)
+              << spectators.getCount() << " spectators: "
+              << (stats.messages - reportedStats.messages) / seconds << " messages/s, "
+              << (stats.bytes - reportedStats.bytes) * 8 / 1000.0 / seconds << " kbit/s, send "
+              << std::setprecision(2) << (sends > 0 ? static_cast<double>(micros) / sends : 0.0)
+              << " us per spectator, " << std::setprecision(1)
+              << 100.0 * (cpu - reportedCpu) / CLOCKS_PER_SEC / seconds << " % CPU";
+    if (stats.dropped > reportedStats.dropped) {
+        std::cout << ", " << stats.dropped - reportedStats.dropped << " dropped";
+    }
+    std::cout << std::endl;
+    reportedStats = stats;
+    reportedCpu = cpu;
+}
+
+void SpectatorRelay::finish()
+{
+    net::beginMessage(packet, net::BYE);
+    if (!serverLeft) {
+        spectators.broadcast(socket, packet);
+    }
+    socket.send(packet, serverAddress, serverPort);
+}
+
+int SpectatorRelay::run()
+{
+    if (!start()) {
+        return 1;
+    }
+    while (update()) {
+        sf::sleep(sf::milliseconds(1));
+    }
+    finish();
+    return 0;
+}
+
+int runSpectatorRelay(const std::string& host, unsigned short serverPort, unsigned short port,
+                      std::size_t maxSpectators)
+{
+    sf::IpAddress address(host);
+    if (address == sf::IpAddress::None) {
+        std::cerr << "Unknown server address." << std::endl;
+        return 1;
+    }
+    SpectatorRelay relay(address, serverPort, port, maxSpectators);
+    return relay.run();
+}
@@ -0,0 +1,38 @@
+#include "spectatorStream.hpp"
+
+namespace net {
+
+    SpectatorStream::SpectatorStream() : latest(&keyframe)
+    {
+
+    }
+
+    void SpectatorStream::encode(const Snapshot& snapshot)
+    {
+        // The base distance of a delta is sent in 8 bits (ticks).
+        bool keyframeDue = keyframe.getDataSize() == 0 || sinceKeyframe + 1 >= KEYFRAME_INTERVAL
+                           || snapshot.tick <= keyframeTick || snapshot.tick - keyframeTick > 255;
+        if (keyframeDue) {
+            beginMessage(keyframe, KEYFRAME);
+            codec.encodeBroadcast(snapshot, 0, keyframe);
+            keyframeTick = snapshot.tick;
+            sinceKeyframe = 0;
+            latest = &keyframe;
+        }
+        else {
+            beginMessage(delta, SNAPSHOT);
+            codec.encodeBroadcast(snapshot, keyframeTick, delta);
+            sinceKeyframe++;
+            latest = &delta;
+        }
+    }
+
+    void SpectatorStream::reset()
+    {
+        keyframe.clear();
+        delta.clear();
+        latest = &keyframe;
+        keyframeTick = 0;
+        sinceKeyframe = 0;
+    }
+}
@@ -25,4 +25,5 @@ void SplitScreen::initViewDivider()
 void SplitScreen::drawViewDivider(sf::RenderWindow& window)
 {
     window.draw(viewDivider);
+    PerfOverlay::countDraw(viewDivider);
 }
@@ -0,0 +1,30 @@
+#include "stateHash.hpp"
+
+// static
+std::string StateHash::getComponentName(std::size_t component)
+{
+    switch (component) {
+        case RACE:
+            return "race";
+        case TRACK:
+            return "track";
+        case RANDOM_ENGINE:
+            return "random engine";
+        default:
+            return "vehicle " + std::to_string(component - FIRST_VEHICLE + 1);
+    }
+}
+
+void StateHasher::addBytes(const void* data, std::size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    std::size_t i = 0;
+    for (; i + sizeof(sf::Uint64) <= size; i += sizeof(sf::Uint64)) {
+        sf::Uint64 word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        add(word);
+    }
+    sf::Uint64 rest = 0;
+    std::memcpy(&rest, bytes + i, size - i);
+    add(rest);
+}
@@ -0,0 +1,68 @@
+#include <algorithm>
+
+#include "threadPool.hpp"
+
+ThreadPool::ThreadPool(unsigned int threads)
+{
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (unsigned int i = 1; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    batchStarted.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(std::size_t count, const std::function<void(std::size_t)>& batchTask)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    task = &batchTask;
+    taskCount = count;
+    nextTask = 0;
+    batch++;
+    batchStarted.notify_all();
+    runTasks(lock);
+    batchDone.wait(lock, [this] { return nextTask >= taskCount && runningTasks == 0; });
+    task = nullptr;
+}
+
+void ThreadPool::work()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    unsigned int seenBatch = batch;
+    while (true) {
+        batchStarted.wait(lock, [this, seenBatch] { return batch != seenBatch || stopping; });
+        if (stopping) {
+            break;
+        }
+        seenBatch = batch;
+        runTasks(lock);
+    }
+}
+
+void ThreadPool::runTasks(std::unique_lock<std::mutex>& lock)
+{
+    while (nextTask < taskCount) {
+        std::size_t index = nextTask++;
+        runningTasks++;
+        // The other threads take tasks while this one runs.
+        lock.unlock();
+        (*task)(index);
+        lock.lock();
+        runningTasks--;
+    }
+    if (runningTasks == 0) {
+        batchDone.notify_all();
+    }
+}
@@ -1,4 +1,5 @@
 #include <SFML/System.hpp>
+#include <cmath>
 #include <sstream>
 #include <iomanip>
 #include <fstream>
@@ -7,15 +8,25 @@
 #include "timeTrial.hpp"
 #include "constants.hpp"
 
-TimeTrial::TimeTrial(std::string& xmlfile) : Race(xmlfile), saveThread(&TimeTrial::saveLastLap, this)
+namespace {
+    // Time trial has a single player. The key leaves room for named profiles.
+    const std::string PLAYER_NAME = "Player 1";
+}
+
+TimeTrial::TimeTrial(std::string& xmlfile) : Race(xmlfile), lapDatabase(writer)
 {
     // Call Race() constructor
-    // Construct the thread object
     createLapTimeText();
     raceType = RaceType::TimeTrial;
-    defineFilePath();
-    getBestLapTime();
-    
+    defineFilePath(xmlfile);
+    double best = lapDatabase.getBestLapTime(trackName, PLAYER_NAME);
+    if (best >= 0) {
+        bestLapTime = best;
+    }
+    // Decode the ghost now, so nothing is loaded during the race.
+    if (!ghostPath.empty()) {
+        ghost.load(ghostPath, ghostLapTime);
+    }
 }
 
 TimeTrial::~TimeTrial()
@@ -38,87 +49,58 @@ void TimeTrial::addVehicle(std::shared_ptr<Vehicle> vehicle) {
     vehicles.push_back(vehicle);
 }
 
-void TimeTrial::defineFilePath()
+void TimeTrial::initialize()
 {
-    // laps.txt should be in the same directory as xml files.
-    // If laps.txt doesn't exist, it will be created in saveLastLap().
-    std::string path = "../xml/Map1.xml";
-    std::ifstream in(path);
-    if (in) {
-        filepath = "../xml/laps.txt";
-    }
-    else {
-        path = "../../xml/Map1.xml";
-        in.open(path);
-        if (in.good()) {
-            filepath = "../../xml/laps.txt";
-        }
-        else { // Not found. Lap are not saved and the best lap is not loaded.
-            filepath = "";
-        }
+    Race::initialize();
+    if (vehicles.empty()) {
+        return;
     }
-    
+    // The ghost looks like the player's vehicle, but it's translucent.
+    const sf::RectangleShape& shape = vehicles[0]->getShape();
+    ghostShape.setSize(shape.getSize());
+    ghostShape.setOrigin(shape.getOrigin());
+    ghostShape.setTexture(shape.getTexture());
+    ghostShape.setFillColor(sf::Color(255, 255, 255, 90));
 }
 
-void TimeTrial::saveLastLap()
+void TimeTrial::defineFilePath(const std::string& xmlfile)
 {
-    
-    std::ofstream out(filepath, std::ofstream::app);
-    if (!out) {
-        out.clear();
-        out.open(filepath); // create file if it doesn't exist
-        if (!out) {
-            std::cout << "Failed to open file laps.txt" << std::endl;
-            return;
-        }
-    }
-    
-    out << lastLapTime << std::endl;
-
-    
-}
-
-void TimeTrial::getBestLapTime()
-{
-    std::ifstream in(filepath);
+    // laps.db should be in the same directory as xml files.
+    // If laps.db doesn't exist, it will be created when the first lap is saved.
+    // One ghost per track, e.g. Map1.xml -> ghost_Map1.bin
+    trackName = xmlfile.substr(0, xmlfile.rfind(".xml"));
+    std::string dir = "../xml/";
+    std::ifstream in(dir + xmlfile);
     if (!in) {
-        std::cout << "Failed to open laps.txt." << std::endl;
-        return;
-    }
-    std::vector<double> lapTimes;
-    std::string buffer;
-    while (std::getline(in, buffer)) {
-        try {
-            lapTimes.push_back(std::stod(buffer)); //stod converts string to double
-        }
-        // Cannot convert string to int. Continue to the next i
-        catch (std::invalid_argument &e) {
-            std::cerr << "Invalid laps.txt file." << std::endl
-            << e.what() << std::endl;
-        }
-    }
-    // Get the smallest value (best lap time)
-    if (lapTimes.size() > 0) {
-        auto it = std::min_element(lapTimes.begin(), lapTimes.end());
-        if (it != lapTimes.end()) {
-            bestLapTime = *it;
+        dir = "../../xml/";
+        in.open(dir + xmlfile);
+        if (!in.good()) { // Not found. Lap are not saved and the best lap is not loaded.
+            ghostPath = "";
+            return;
         }
     }
+    lapDatabase.open(dir + "laps.db");
+    ghostPath = dir + "ghost_" + trackName + ".bin";
 }
 
 void TimeTrial::update() {
     //camera.setViewToWindow(sf::RenderWindow &window)
-    for (auto v : vehicles) {
+    for (auto &v : vehicles) {
         v->update();
         if (v->isDestroyed()) {
             v->getPhysics().stop();
         }
     }
     
+    // Record the trajectory of this lap for the ghost.
+    if (isStarted && !vehicles.empty()) {
+        const VehiclePhysics& physics = vehicles[0]->getPhysics();
+        currentLap.addSample(physics.getX(), physics.getY(), physics.getRotation());
+    }
+    
     // Test obstacle and weapon hits
-    for (auto v : vehicles) {
+    for (auto &v : vehicles) {
         if (track.isOilSplatHit(v->getShape())) {
-            std::cout << "OILSPLAT!!!!!!!!!!!!!!!!!!!!!!!!!!!!!"<<std::endl;
             v->getPhysics().setAngularVelocity(100);
             // Allow sliding until the driver releases throttle
             v->getPhysics().lockedVelocity = false;
@@ -129,25 +111,21 @@ void TimeTrial::update() {
 
 void TimeTrial::createLapTimeText()
 {
-    lapTimeText.setFont(textFont);
-    lapTimeText.setCharacterSize(32);
-#ifdef _WIN32
-    lapTimeText.setFillColor(TEXT_COLOR);
-#else
-    lapTimeText.setColor(TEXT_COLOR);
-#endif
-    lapTimeText.setString("Placeholder text");
-    lapTimeText.setPosition(WIDTH / 2, HEIGHT - 70);
+    lapTimeText = hud.addText(32, sf::Vector2f(WIDTH / 2, HEIGHT - 70), TEXT_COLOR);
 }
 
 void TimeTrial::updateLapTimeText()
 {
+    // The times change only when a lap is finished. Both are below 1000 s when shown.
+    long long key = std::llround(lastLapTime * 100) * 1000000 + std::llround(bestLapTime * 100);
+    if (!hud.isChanged(lapTimeText, key)) {
+        return;
+    }
     std::stringstream ss;
     ss << "Last lap: ";
     if (lastLapTime < 1000) {
         // Use two digits precision.
         ss << std::fixed << std::setprecision(2) << lastLapTime << " s";
-        lapTimeText.setString(ss.str());
     }
     else {
         ss << "-";
@@ -159,13 +137,21 @@ void TimeTrial::updateLapTimeText()
     else {
         ss << "-";
     }
-    lapTimeText.setString(ss.str());
+    hud.setString(lapTimeText, ss.str());
 }
 
-void TimeTrial::drawTimeTrialObjects(sf::RenderWindow& window)
+void TimeTrial::drawGhost(sf::RenderWindow& window)
 {
-    // Draw the latest lap time
-    window.draw(lapTimeText);
+    // The ghost is on the same tick of its lap as the player.
+    if (!isStarted || ghost.empty() || currentLap.size() >= ghost.size()) {
+        return;
+    }
+    float x, y, rotation;
+    ghost.getPose(currentLap.size(), x, y, rotation);
+    ghostShape.setPosition(x, y);
+    ghostShape.setRotation(rotation);
+    window.draw(ghostShape);
+    PerfOverlay::countDraw(ghostShape);
 }
 
 void TimeTrial::checkHits()
@@ -177,19 +163,41 @@ void TimeTrial::checkHits()
     auto &vehicle = vehicles[0]; // local alias
     if (track.isOnFinishLine(vehicle->getShape())) {
         if (vehicle->allCheckpointsPassed(track)) {
-            lastLapTime = raceClock.restart().asSeconds();
+            lastLapTime = restartRaceClock();
             if (lastLapTime < bestLapTime) {
                 bestLapTime = lastLapTime;
             }
+            // A faster lap replaces the ghost. Swapping doesn't copy anything.
+            bool ghostChanged = false;
+            if (lastLapTime < ghostLapTime && !currentLap.empty()) {
+                ghost.swap(currentLap);
+                ghostLapTime = lastLapTime;
+                ghostChanged = true;
+            }
+            currentLap.clear();
             vehicle->increaseLapCount();
             lapsDriven++;
-            vehicle->visitedCheckPoints = 0;
-            saveThread.launch();
+            vehicle->setVisitedCheckPoints(0);
+            // Laps driven in a replay are not new lap times.
+            if (!isReplaying()) {
+                lapDatabase.addLap(trackName, PLAYER_NAME, lastLapTime);
+                if (ghostChanged && !ghostPath.empty()) {
+                    // The writer gets its own copy, the ghost may be replaced before it's saved.
+                    Ghost saved = ghost;
+                    std::string path = ghostPath;
+                    double time = ghostLapTime;
+                    writer.push([saved, path, time] {
+                        if (!saved.save(path, time)) {
+                            std::cout << "Failed to save ghost " << path << std::endl;
+                        }
+                    });
+                }
+            }
         }
     }
     // Test oil splat hit.
     if (track.isOilSplatHit(vehicle->getShape())) {
-        int num = Weapon::getRandomNumber(0, 1);
+        int num = Weapon::getRandomNumber(0, 1, track.getRandomEngine());
         if (num == 0) {
             vehicle->getPhysics().setAngularVelocity(100);
         }
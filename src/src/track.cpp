@@ -1,103 +1,44 @@
+#include <algorithm>
 #include <iterator>
 #include <iostream>
 #include <cstdlib> 
 #include <limits>   
+#include <utility>
 
 #include "track.hpp"
 #include "polygon.hpp"
-#include "xmlParser.hpp"
+#include "physicsMath.hpp"
 #include "obstacle.hpp"
 #include "gun.hpp"
 #include "missileLauncher.hpp"
 #include "turbo.hpp"
+#include "perfOverlay.hpp"
+#include "constants.hpp"
 
 
-Track::Track(const std::string &xmlfile) {
-
-    XMLParser parser(xmlfile);
-
-    // define spawn points
-    for (int i = 0; i < 4; i++) {
-        structures::Point spawn = {100.0f, 100 + i * 50.0f};
-        spawnPoints.push_back(spawn);
-    }
-    
-    // load textures
-    textureFinish.setRepeated(true);
-    //std::string filename = parser.getFinishTextureName(); not implemented
-    std::string filename = "finish.jpg";
-    std::string filepath = "../images/" + filename;
-
-    if (!textureFinish.loadFromFile(filepath)) {
-        filepath = "../../images/" + filename;
-        if (!textureFinish.loadFromFile(filepath)) {
-            std::cout << "Error loading texture for finish line!" << std::endl;
-            finishLine.setFillColor(sf::Color(0, 0, 255));
-        }
-    }
-    // Get finishLine rectangle from the xml parser.
-    finishLine = parser.getTrackFinishLine();
-    finishLine.setTexture(&textureFinish);
+Track::Track(const std::string &xmlfile) : Track(TrackData::load(xmlfile)) {
+}
 
+Track::Track(std::shared_ptr<const TrackData> trackData) : data(std::move(trackData)) {
     // Create 3 oilsplats
     obstacles.insert(obstacles.begin(), 3, Obstacle("notexture"));
-    
-    // Load oil textures
-    if (!textureOil.loadFromFile("../images/oilsplat.png")) {
-        if (!textureOil.loadFromFile("../../images/oilsplat.png")) {
-            std::cout << "Error loading texture for oil!" << std::endl;
-        }
-    }
     // Set textures
     for (auto& o : obstacles) {
-        o.getShape().setTexture(&textureOil);
+        o.getShape().setTexture(&data->getOilTexture());
     }
 
-    // Define wall texture.
-    sf::Color color(255, 255, 255);
-    textureWall.setSmooth(true);
-    textureWall.setRepeated(true);
-    std::string wallTextureName = parser.getWallTextureName();
-    std::string texturePath = "../images/" + wallTextureName;
-    if (!textureWall.loadFromFile(texturePath)) {
-        texturePath = "../../images/" + wallTextureName;
-        if (!textureWall.loadFromFile(texturePath)) {
-            std::cout << "Error loading texture for walls!" << std::endl;
-            color.r = 200;
-            color.g = 30;
-            color.b = 70;
-        }
-    }
-
-    // Get walls from the xml parser.
-    walls = parser.getTrackWalls();
-    
-    for (unsigned int i = 0; i < walls.size(); i++) {
-        walls[i].setTextureRect(sf::IntRect(0, 0, walls[i].getSize().x * 10, 470));
-        walls[i].setTexture(&textureWall);
-        walls[i].setFillColor(color);
-    }
-
-    // Get checkpoints from the xml parser.
-    checkPoints = parser.getTrackCheckpoints();
-
-    // define possible spawn points for weapons.
-    weaponPoints = parser.getTrackSpawnpoints();
-    
-    for (Obstacle &o : obstacles) {
-        o.setSpawnPoint(weaponPoints);
-    }
-
-    // Testing to add weapons
-    
+    // Race sets the actual seed.
+    setSeed(std::mt19937::default_seed);
 }
 
 void Track::drawTrack(sf::RenderWindow &window) {
     // draw finish line
-    window.draw(finishLine);
+    window.draw(getFinishLine());
+    PerfOverlay::countDraw(getFinishLine());
     // draw walls
-    for (sf::RectangleShape wall : walls) {
+    for (const sf::RectangleShape& wall : getWalls()) {
         window.draw(wall);
+        PerfOverlay::countDraw(wall);
     }
    
     // Draw obstacles.
@@ -110,12 +51,60 @@ void Track::drawTrack(sf::RenderWindow &window) {
     for (auto &weapon : weapons) {
         weapon->drawWeapon(window);
     }
-    
+}
+
+void Track::update() {
     // Spawn a new weapon
-    if (spawnClock.getElapsedTime().asSeconds() > nextSpawnTime) {
+    spawnTime += TICK_TIME;
+    if (spawnTime > nextSpawnTime) {
         spawnWeapon();
-        spawnClock.restart();
-		nextSpawnTime = Weapon::getRandomNumber(6, 15);
+        spawnTime = 0.0;
+		nextSpawnTime = Weapon::getRandomNumber(6, 15, rng);
+    }
+}
+
+void Track::saveState(StateBuffer& state) const {
+    Weapon::saveWeapons(weapons, state);
+    state.write(reservedSpawnpoints.size());
+    for (int index : reservedSpawnpoints) {
+        state.write(index);
+    }
+    state.write(spawnTime);
+    state.write(rng);
+    state.write(missilesSpawned);
+    state.write(nextSpawnTime);
+}
+
+void Track::loadState(StateBuffer& state) {
+    Weapon::loadWeapons(weapons, state);
+    std::size_t count;
+    state.read(count);
+    reservedSpawnpoints.resize(count);
+    for (int& index : reservedSpawnpoints) {
+        state.read(index);
+    }
+    state.read(spawnTime);
+    state.read(rng);
+    state.read(missilesSpawned);
+    state.read(nextSpawnTime);
+}
+
+void Track::hashState(StateHasher& hasher) const {
+    hasher.add(weapons.size());
+    for (auto &w : weapons) {
+        w->hashState(hasher);
+        hasher.addDouble(w->getShape().getPosition().x);
+        hasher.addDouble(w->getShape().getPosition().y);
+    }
+    hasher.addDouble(spawnTime);
+    hasher.add(missilesSpawned);
+    hasher.add(nextSpawnTime);
+}
+
+void Track::setSeed(unsigned int seed) {
+    rng.seed(seed);
+    for (Obstacle &o : obstacles) {
+        o.setSpawnPoint(getWeaponPoints(), rng);
     }
 }
 
@@ -135,7 +124,7 @@ int Track::handleWeaponHit(const sf::RectangleShape &vehicleShape) {
     // Called from Race::update()
     int i = 0;
     for (auto &weapon : weapons) {
-        if (weapon->getShape().getGlobalBounds().intersects(vehicleShape.getGlobalBounds())) {
+        if (physmath::getGlobalBounds(weapon->getShape()).intersects(physmath::getGlobalBounds(vehicleShape))) {
             return i;
         }
         i++;
@@ -166,7 +155,7 @@ std::unique_ptr<Weapon> Track::pickWeapon(const int index) {
 
 bool Track::isOnFinishLine(const sf::Shape &shape) const {
     Polygon poly1(shape);
-    Polygon poly2(finishLine);
+    Polygon poly2(getFinishLine());
     return poly1.intersects(poly2);
 }
 
@@ -182,12 +171,12 @@ bool Track::isCheckpointHit(const sf::RectangleShape &rect, const int &index) co
 
 bool Track::isWallHit(const sf::Shape &shape) const {
     Polygon poly1(shape);
-    for (sf::RectangleShape wall : walls) {
+    for (const sf::RectangleShape& wall : getWalls()) {
         Polygon poly2(wall);
         // Test first with bounding boxes. It is redundant to call poly.intersect
         // if even bounding boxes don't collide. This approach reduces CPU load a lot,
         // because calling poly.intersect is a heavy process. 
-        if (shape.getGlobalBounds().intersects(wall.getGlobalBounds())) {
+        if (physmath::getGlobalBounds(shape).intersects(physmath::getGlobalBounds(wall))) {
             if (poly1.intersects(poly2)) {
                 return true;
             }
@@ -196,50 +185,28 @@ bool Track::isWallHit(const sf::Shape &shape) const {
     return false;
 }
 
-void Track::setFinishLine(const sf::RectangleShape& finishLine) {
-    this->finishLine = finishLine;
-    this->finishLine.setTexture(&textureFinish);
-}
-
-void Track::setWalls(const std::vector<sf::RectangleShape>& newWalls) {
-    walls.clear();
-    for (unsigned int i = 0; i < newWalls.size(); i++) {
-        sf::RectangleShape shape(newWalls[i]);
-        walls.push_back(shape);
-    }
-}
-
-void Track::setSpawnpoints(const std::vector<structures::Point> &newPoints) {
-    spawnPoints.clear();
-    for (unsigned int i = 0; i < newPoints.size(); i++) {
-        structures::Point point = {newPoints[i].x, newPoints[i].y};
-        spawnPoints.push_back(point);
-    }
-}
-
-void Track::setCheckpoints(const std::vector<sf::RectangleShape> &newCheckpoints) {
-    checkPoints.clear();
-    for (unsigned int i = 0; i < newCheckpoints.size(); i++) {
-        sf::RectangleShape shape = newCheckpoints[i];
-        checkPoints.push_back(shape);
+double Track::getLapProgress(unsigned int visitedCheckPoints, const Vector2D& position) const {
+    double passed = visitedCheckPoints;
+    const std::vector<double>& gateDistances = data->getGateDistances();
+    if (visitedCheckPoints >= gateDistances.size() || gateDistances[visitedCheckPoints] <= 0) {
+        return passed;
     }
-}
-
-void Track::setWeaponPoints(const std::vector<structures::Point> &newPoints) {
-    weaponPoints.clear();
-    for (unsigned int i = 0; i < newPoints.size(); i++) {
-        structures::Point point = {newPoints[i].x, newPoints[i].y};
-        weaponPoints.push_back(point);
+    double distance = data->getFlowField().getDistance(visitedCheckPoints, position);
+    if (distance < 0) {
+        return passed; // off the grid
     }
+    // Stays below the next whole number until the gate is really crossed.
+    double share = 1 - distance / gateDistances[visitedCheckPoints];
+    return passed + std::min(std::max(share, 0.0), 0.999);
 }
 
 const sf::RectangleShape& Track::getFinishLine() const {
-    return finishLine;
+    return data->getFinishLine();
 }
 
 const Line Track::getCrashedLine(const sf::Shape &shape) {
     Polygon poly1(shape);
-    for (sf::RectangleShape wall : walls) {
+    for (const sf::RectangleShape& wall : getWalls()) {
         Polygon poly2(wall);
         if (poly1.intersects(poly2)) {
             const Line ptr = poly1.getCrashedLine(poly2);
@@ -248,30 +215,30 @@ const Line Track::getCrashedLine(const sf::Shape &shape) {
     }
     // Failed to determine line --> return line with NaN-points.
     // Error handling must be performed where function is called.
-    structures::Point point = {std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN()};
+    structures::Point point = {std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::quiet_NaN()};
     Line line(point, point);
     return line;
 }
 
 const std::vector<sf::RectangleShape>& Track::getWalls() const {
-    return walls;
+    return data->getWalls();
 }
 
 const std::vector<structures::Point>& Track::getSpawnpoints() const {
-    return spawnPoints;
+    return data->getSpawnpoints();
 }
 
 const std::vector<sf::RectangleShape>& Track::getCheckpoints() const {
-    return checkPoints;
+    return data->getCheckpoints();
 }
 
 const std::vector<structures::Point>& Track::getWeaponPoints() const {
-    return weaponPoints;
+    return data->getWeaponPoints();
 }
 
 void Track::addWeapon(std::unique_ptr<Weapon> weapon) {
     // set spawn position
-    weapon->setSpawnPoint(weaponPoints, reservedSpawnpoints);
+    weapon->setSpawnPoint(getWeaponPoints(), reservedSpawnpoints, rng);
     // Use std::move because unique_ptr cannot be copied.
     // The ownership of the weapon is moved to Track.
     weapons.push_back(std::move(weapon));
@@ -288,7 +255,7 @@ void Track::spawnWeapon() {
     }
     // By taking numbers from wider range and we can
     // change the propabilities for weapons that spawning.
-    int num = Weapon::getRandomNumber(0, 100);
+    int num = Weapon::getRandomNumber(0, 100, rng);
     if (num <= 30) {
         addWeapon(std::make_unique<Gun>());
     }
@@ -300,7 +267,7 @@ void Track::spawnWeapon() {
         addWeapon(std::make_unique<Turbo>());
     } else {
         // if two missiles were already spawned -> spawn turbo
-        num = Weapon::getRandomNumber(0, 1);
+        num = Weapon::getRandomNumber(0, 1, rng);
         if(num == 1)
             addWeapon(std::make_unique<Gun>());
         else
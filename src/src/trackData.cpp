@@ -0,0 +1,152 @@
+#include <iostream>
+#include <map>
+#include <mutex>
+
+#include "trackData.hpp"
+#include "physicsMath.hpp"
+#include "xmlParser.hpp"
+#include "settings.hpp"
+
+namespace {
+    std::mutex mutex;
+
+    // Loaded tracks by file name. A track is freed when the last race on it is destroyed.
+    std::map<std::string, std::weak_ptr<const TrackData>> cache;
+}
+
+TrackData::TrackData(const std::string& xmlfile)
+{
+    XMLParser parser(xmlfile);
+
+    // define spawn points
+    for (int i = 0; i < 4; i++) {
+        structures::Point spawn = {100.0f, 100 + i * 50.0f};
+        spawnPoints.push_back(spawn);
+    }
+
+    // load textures
+    textureFinish.setRepeated(true);
+    //std::string filename = parser.getFinishTextureName(); not implemented
+    std::string filename = "finish.jpg";
+    std::string filepath = "../images/" + filename;
+
+    if (!settings::headless && !textureFinish.loadFromFile(filepath)) {
+        filepath = "../../images/" + filename;
+        if (!textureFinish.loadFromFile(filepath)) {
+            std::cout << "Error loading texture for finish line!" << std::endl;
+            finishLine.setFillColor(sf::Color(0, 0, 255));
+        }
+    }
+    // Get finishLine rectangle from the xml parser.
+    finishLine = parser.getTrackFinishLine();
+    finishLine.setTexture(&textureFinish);
+
+    // Load oil textures
+    if (!settings::headless && !textureOil.loadFromFile("../images/oilsplat.png")) {
+        if (!textureOil.loadFromFile("../../images/oilsplat.png")) {
+            std::cout << "Error loading texture for oil!" << std::endl;
+        }
+    }
+
+    // Define wall texture.
+    sf::Color color(255, 255, 255);
+    textureWall.setSmooth(true);
+    textureWall.setRepeated(true);
+    std::string wallTextureName = parser.getWallTextureName();
+    std::string texturePath = "../images/" + wallTextureName;
+    if (!settings::headless && !textureWall.loadFromFile(texturePath)) {
+        texturePath = "../../images/" + wallTextureName;
+        if (!textureWall.loadFromFile(texturePath)) {
+            std::cout << "Error loading texture for walls!" << std::endl;
+            color.r = 200;
+            color.g = 30;
+            color.b = 70;
+        }
+    }
+
+    // Get walls from the xml parser.
+    walls = parser.getTrackWalls();
+
+    for (unsigned int i = 0; i < walls.size(); i++) {
+        walls[i].setTextureRect(sf::IntRect(0, 0, walls[i].getSize().x * 10, 470));
+        walls[i].setTexture(&textureWall);
+        walls[i].setFillColor(color);
+    }
+
+    // Get checkpoints from the xml parser.
+    checkPoints = parser.getTrackCheckpoints();
+    buildNavigation();
+
+    // define possible spawn points for weapons.
+    weaponPoints = parser.getTrackSpawnpoints();
+}
+
+// static
+std::shared_ptr<const TrackData> TrackData::load(const std::string& xmlfile)
+{
+    // Loading holds the lock, so that races created at the same time in different
+    // threads don't read the same file twice.
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const TrackData> data = cache[xmlfile].lock();
+    if (!data) {
+        data = std::make_shared<const TrackData>(xmlfile);
+        cache[xmlfile] = data;
+    }
+    return data;
+}
+
+void TrackData::setFinishLine(const sf::RectangleShape& newFinishLine)
+{
+    finishLine = newFinishLine;
+    finishLine.setTexture(&textureFinish);
+    buildNavigation();
+}
+
+void TrackData::setWalls(const std::vector<sf::RectangleShape>& newWalls)
+{
+    walls = newWalls;
+    buildNavigation();
+}
+
+void TrackData::setSpawnpoints(const std::vector<structures::Point>& newPoints)
+{
+    spawnPoints = newPoints;
+}
+
+void TrackData::setCheckpoints(const std::vector<sf::RectangleShape>& newCheckpoints)
+{
+    checkPoints = newCheckpoints;
+    buildNavigation();
+}
+
+void TrackData::setWeaponPoints(const std::vector<structures::Point>& newPoints)
+{
+    weaponPoints = newPoints;
+}
+
+void TrackData::buildNavigation()
+{
+    // Vehicles cross the finish line and then the checkpoints in order.
+    std::vector<structures::Point> points;
+    auto addMiddlePoint = [&points](const sf::RectangleShape& rect) {
+        points.push_back(physmath::transformPoint(rect, rect.getSize() / 2.f));
+    };
+    addMiddlePoint(finishLine);
+    for (const sf::RectangleShape& checkpoint : checkPoints) {
+        addMiddlePoint(checkpoint);
+    }
+    racingLine.build(points);
+
+    // Flow field targets: the checkpoints in order and then the finish line.
+    std::vector<sf::RectangleShape> targets = checkPoints;
+    targets.push_back(finishLine);
+    flowField.build(walls, targets);
+
+    // The gate before checkpoint 0 is the finish line.
+    gateDistances.clear();
+    for (std::size_t i = 0; i < flowField.getTargetCount(); i++) {
+        std::size_t previous = (i + targets.size() - 1) % targets.size();
+        structures::Point middle = physmath::transformPoint(targets[previous], targets[previous].getSize() / 2.f);
+        gateDistances.push_back(flowField.getDistance(i, Vector2D(middle)));
+    }
+}
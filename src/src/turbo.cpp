@@ -1,8 +1,9 @@
 #include "turbo.hpp"
+#include "settings.hpp"
 
 Turbo::Turbo(): Weapon("turbo.png")
 {
-	if (!weaponTexture.loadFromFile("../images/turbo.png")) {
+	if (!settings::headless && !weaponTexture.loadFromFile("../images/turbo.png")) {
 		if (!weaponTexture.loadFromFile("../../images/turbo.png")) {
 			std::cerr << "Cannot load turbo icon texture" << std::endl;
 		}
@@ -1,44 +1,44 @@
-#include <sstream>
-
 #include "vehicle.hpp"
 #include "constants.hpp"
+#include "perfOverlay.hpp"
+#include "resources.hpp"
+#include "settings.hpp"
+
 
 
+namespace {
+    // A new vehicle has full HP and hasn't driven anything yet.
+    const VehicleRegistry::Health NEW_HEALTH = {150, false};
+    const VehicleRegistry::Progress NEW_PROGRESS = {0, 0, -1, 0};
+}
 
 Vehicle::Vehicle(const int& width, const int& height)
-: physics({width, height}), shape(sf::Vector2f(width, height))
+: shape(sf::Vector2f(width, height)), registry(std::make_shared<VehicleRegistry>())
 {
+    entity = registry->add(this, VehiclePhysics(width, height), NEW_HEALTH, NEW_PROGRESS);
     // Initialize both physics and shape with same width and height
-    createStatusText();
     // Origin is the center point of the car. The car is rotated about that point.
     shape.setOrigin(width / 2, height / 2);
 }
 
 Vehicle::Vehicle(const int& width, const int& height, const std::string& textureName)
-: physics({width, height}), shape(sf::Vector2f(width, height))
+: shape(sf::Vector2f(width, height)), registry(std::make_shared<VehicleRegistry>())
 {
+    entity = registry->add(this, VehiclePhysics(width, height), NEW_HEALTH, NEW_PROGRESS);
     // Initialize both physics and shape with same width and height
-    createStatusText();
     // Origin is the center point of the car. The car is rotated about that point.
     shape.setOrigin(width / 2, height / 2);
     
-    std::string PATH = "../images/" + textureName;
-    
-    if (!vehicleTexture.loadFromFile(PATH)) {
-        PATH = "../../images/" + textureName;
-        if (!vehicleTexture.loadFromFile(PATH)) {
-            std::cerr << "Cannot load vehicle texture " << textureName << std::endl;
-            shape.setFillColor(sf::Color(102, 102, 255));
-        }
+    // Textures are not needed without a window.
+    if (settings::headless) {
+        return;
     }
-    if (!explosionTexture.loadFromFile("../images/boom4.png")) {
-        if (!explosionTexture.loadFromFile("../../images/boom4.png")) {
-            std::cerr << "Cannot load explosion texture. " << textureName << std::endl;
-            //shape.setFillColor(sf::Color(255, 50, 50));
-        }
+    const sf::Texture* vehicleTexture = resources::getTexture(textureName);
+    if (vehicleTexture == nullptr) {
+        std::cerr << "Cannot load vehicle texture " << textureName << std::endl;
+        shape.setFillColor(sf::Color(102, 102, 255));
     }
-    explosionSprite.setTexture(explosionTexture);
-    shape.setTexture(&vehicleTexture);
+    shape.setTexture(vehicleTexture);
     
 }
 
@@ -48,17 +48,19 @@ Vehicle::~Vehicle()
     
 }
 
-VehiclePhysics& Vehicle::getPhysics()
-{
-    return physics;
-}
-
 
 sf::RectangleShape& Vehicle::getShape()
 {
     return shape;
 }
 
+void Vehicle::moveTo(const std::shared_ptr<VehicleRegistry>& target)
+{
+    std::size_t newEntity = target->add(this, getPhysics(), getHealth(), getProgress());
+    registry = target;
+    entity = newEntity;
+}
+
 std::vector<std::unique_ptr<Weapon>>& Vehicle::getWeapons()
 {
     return weapons;
@@ -69,11 +71,6 @@ std::deque<Bullet>& Vehicle::getBullets()
     return bullets;
 }
 
-sf::Sprite& Vehicle::getExplosionSprite()
-{
-    return explosionSprite;
-}
-
 void Vehicle::addWeapon(std::unique_ptr<Weapon> weapon)
 {
     // Move ownership of the weapon to the weapons container
@@ -105,7 +102,7 @@ void Vehicle::removeBullet()
 
 void Vehicle::update()
 {
-    physics.updatePosition();
+    getPhysics().updatePosition();
     sync();
 }
 
@@ -115,7 +112,7 @@ int Vehicle::shoot()
     for (Bullet &bullet : bullets) {
         count++;
         if (!bullet.isFlying) {
-            bullet.launch(physics);
+            bullet.launch(getPhysics());
             break;
         }
     }
@@ -133,156 +130,187 @@ bool Vehicle::hasWeapon(Weapon::WeaponType type)
 }
 
 
-const int& Vehicle::getHP() const
-{
-    return HP;
-}
-
 bool Vehicle::isDestroyed() const
 {
-    return HP == 0;
+    return getHealth().hp == 0;
 }
 
 const int& Vehicle::damageVehicle(const int &amount)
 {
-    HP -= amount;
-    if (HP <= 0) {
-        HP = 0;
-		destroyedFlag = true; //for sound
+    VehicleRegistry::Health& health = getHealth();
+    if (health.hp > 0 && health.hp <= amount) {
+        health.destroyedFlag = true; // Race publishes GameEvent::DESTROYED
     }
-    return HP;
+    health.hp -= amount;
+    if (health.hp <= 0) {
+        health.hp = 0;
+    }
+    return health.hp;
 }
 void Vehicle::drawVehicle(sf::RenderWindow &window)
 {
     window.draw(shape);
+    PerfOverlay::countDraw(shape);
 }
 
-void Vehicle::drawText(sf::RenderWindow& window)
+void Vehicle::handleEvents(sf::Event& event, EventKeys keys)
 {
-    std::stringstream ss;
-    ss << getPhysics(); // Utilize overloaded << operator of Vector2D class
-    statusText.setString(ss.str());
-    window.draw(statusText);
+    if (event.type != sf::Event::KeyPressed && event.type != sf::Event::KeyReleased) {
+        return;
+    }
+    Controls bit = 0;
+    // Control with the keys W, A, S, D and R.
+    if (keys == EventKeys::LEFT) {
+        switch (event.key.code) {
+            case sf::Keyboard::W: bit = control::ACCELERATE; break;
+            case sf::Keyboard::S: bit = control::BRAKE; break;
+            case sf::Keyboard::R: bit = control::REVERSE; break;
+            case sf::Keyboard::D: bit = control::RIGHT; break;
+            case sf::Keyboard::A: bit = control::LEFT; break;
+            default: break;
+        }
+    }
+    // Control with the keys up, down, right and left.
+    else if (keys == EventKeys::RIGHT) {
+        switch (event.key.code) {
+            case sf::Keyboard::Up: bit = control::ACCELERATE; break;
+            case sf::Keyboard::Down: bit = control::BRAKE; break;
+            case sf::Keyboard::Right: bit = control::RIGHT; break;
+            case sf::Keyboard::Left: bit = control::LEFT; break;
+            default: break;
+        }
+    }
+    // The key is held down until it's released.
+    if (event.type == sf::Event::KeyPressed) {
+        inputControls |= bit;
+    }
+    else {
+        inputControls &= ~bit;
+    }
 }
 
-void Vehicle::createStatusText()
+Controls Vehicle::applyControls(Controls newControls)
 {
-    // Relative path to font directory depends on building environment
-    // i.e. in which directory the executable is run.
+    VehiclePhysics& physics = getPhysics();
+    Controls pressed = newControls & ~controls;
+    Controls released = controls & ~newControls;
+    controls = newControls;
     
-    // Try this directory first
-    if (!textFont.loadFromFile("../../images/fonts/open-sans/OpenSans-Regular.ttf"))
-    {
-        // If not found, try this directory
-        if (!textFont.loadFromFile("../images/fonts/open-sans/OpenSans-Regular.ttf")) {
-            std::cout << "Failed to load fonts." << std::endl;
-            // Continue executing without fonts and text
-        }
+    // Accelerate while the throttle is held. Braking interrupts accelerating
+    // until the brake is released.
+    if ((newControls & control::ACCELERATE) && !(newControls & control::BRAKE) && !isAccelerating) {
+        physics.accelerate();
+        isAccelerating = true;
+    }
+    // Heavy brake
+    if (pressed & control::BRAKE) {
+        physics.brake(true);
+        isAccelerating = false;
+    }
+    // Stop accelerating and use light brakes (simulate friction)
+    if (released & control::ACCELERATE) {
+        physics.brake(false); // false = light braking
+        isAccelerating = false;
+    }
+    if (pressed & control::REVERSE) {
+        physics.reverse();
     }
     
-    statusText.setFont(textFont);
-    statusText.setString("[0.0, 0.0]");
-    statusText.setCharacterSize(16);
-#ifdef _WIN32
-    statusText.setFillColor(sf::Color::Blue);
-#else
-    statusText.setColor(sf::Color::Blue);
-#endif
-    statusText.setPosition(WIDTH - 170, 10); // Upper right corner of the window
+    // Turn right or left. The latest pressed key wins.
+    if (pressed & control::RIGHT) {
+        physics.setAngularVelocity(ANG_VEL);
+    }
+    else if (pressed & control::LEFT) {
+        physics.setAngularVelocity(-ANG_VEL);
+    }
+    // When the key is released, keep turning if the other key is still held.
+    if ((released & control::RIGHT) && physics.getAngularVelocity() > 0) {
+        physics.setAngularVelocity((newControls & control::LEFT) ? -ANG_VEL : 0);
+    }
+    if ((released & control::LEFT) && physics.getAngularVelocity() < 0) {
+        physics.setAngularVelocity((newControls & control::RIGHT) ? ANG_VEL : 0);
+    }
+    return pressed;
 }
 
-void Vehicle::handleEvents(sf::Event& event, EventKeys keys)
+
+void Vehicle::setRemoteState(const Vector2D& position, double rotation, const Vector2D& velocity,
+                             int hp, int lapCount, unsigned int checkpoints)
 {
-    // Control with the keys W, A, S and D.
-    if (keys == EventKeys::LEFT) {
-        if (event.type == sf::Event::KeyPressed) {
-            
-            // Accelerate
-            if (event.key.code == sf::Keyboard::W && !isAccelerating) {
-                physics.accelerate();
-                isAccelerating = true;
-            }
-            
-            // Heavy brake
-            else if (event.key.code == sf::Keyboard::S) {
-                physics.brake(true);
-                isAccelerating = false;
-            }
-            else if (event.key.code == sf::Keyboard::R) {
-                physics.reverse();
-            }
-            
-            // Turn right
-            else if (event.key.code == sf::Keyboard::D)
-                physics.setAngularVelocity(ANG_VEL);
-            // Turn left
-            else if (event.key.code == sf::Keyboard::A)
-                physics.setAngularVelocity(-ANG_VEL);
-            
-            
-        }
-        else if (event.type == sf::Event::KeyReleased) {
-            
-            // Stop accelerating and use light brakes (simulate friction)
-            if (event.key.code == sf::Keyboard::W) {
-                physics.brake(false); // false = light braking
-                isAccelerating = false;
-            }
-            else if (event.key.code == sf::Keyboard::D) {
-                if (physics.getAngularVelocity() > 0)
-                    physics.setAngularVelocity(0);
-            }
-            else if (event.key.code == sf::Keyboard::A) {
-                if (physics.getAngularVelocity() < 0)
-                    physics.setAngularVelocity(0);
-            }
-        }
+    getPhysics().setState(position, rotation, velocity);
+    setRemoteStatus(hp, lapCount, checkpoints);
+    sync();
+}
+
+void Vehicle::saveState(StateBuffer& state) const
+{
+    state.write(isAccelerating);
+    state.write(inputControls);
+    state.write(controls);
+    Weapon::saveWeapons(weapons, state);
+    state.write(bullets.size());
+    for (const Bullet& b : bullets) {
+        b.saveState(state);
     }
-    // Control with the keys up, down, right and left.
-    else if (keys == EventKeys::RIGHT) {
-        if (event.type == sf::Event::KeyPressed) {
-            
-            // Accelerate
-            if (event.key.code == sf::Keyboard::Up && !isAccelerating) {
-                physics.accelerate();
-                isAccelerating = true;
-            }
-            
-            // Heavy brake
-            else if (event.key.code == sf::Keyboard::Down) {
-                physics.brake(true);
-                isAccelerating = false;
-            }
-            
-            // Turn right
-            else if (event.key.code == sf::Keyboard::Right)
-                physics.setAngularVelocity(ANG_VEL);
-            // Turn left
-            else if (event.key.code == sf::Keyboard::Left)
-                physics.setAngularVelocity(-ANG_VEL);
-        }
-        else if (event.type == sf::Event::KeyReleased) {
-            
-            // Stop accelerating and use light brakes (simulate friction)
-            if (event.key.code == sf::Keyboard::Up) {
-                physics.brake(false); // false = light braking
-                isAccelerating = false;
-            }
-            else if (event.key.code == sf::Keyboard::Right) {
-                if (physics.getAngularVelocity() > 0)
-                    physics.setAngularVelocity(0);
-            }
-            else if (event.key.code == sf::Keyboard::Left) {
-                if (physics.getAngularVelocity() < 0)
-                    physics.setAngularVelocity(0);
-            }
-        }
+}
+
+void Vehicle::loadState(StateBuffer& state)
+{
+    state.read(isAccelerating);
+    state.read(inputControls);
+    state.read(controls);
+    Weapon::loadWeapons(weapons, state);
+    std::size_t bulletCount;
+    state.read(bulletCount);
+    bullets.resize(bulletCount, Bullet(30, 10));
+    for (Bullet& b : bullets) {
+        b.loadState(state);
     }
+    sync();
 }
 
+void Vehicle::hashState(StateHasher& hasher) const
+{
+    const VehiclePhysics& physics = getPhysics();
+    const VehicleRegistry::Progress& progress = getProgress();
+    hasher.add(physics.getPosition());
+    hasher.add(physics.getVelocity());
+    hasher.add(physics.getAcceleration());
+    hasher.addDouble(physics.getRotation());
+    hasher.addDouble(physics.getAngularVelocity());
+    hasher.add(getHealth().hp);
+    hasher.add(controls);
+    hasher.add(progress.racePlace);
+    hasher.add(progress.laps);
+    hasher.add(progress.visitedCheckPoints);
+    hasher.add(weapons.size());
+    for (auto &w : weapons) {
+        w->hashState(hasher);
+    }
+    hasher.add(bullets.size());
+    for (const Bullet& b : bullets) {
+        b.hashState(hasher);
+    }
+}
+
+void Vehicle::setRemoteStatus(int hp, int lapCount, unsigned int checkpoints)
+{
+    getHealth().hp = hp;
+    getProgress().laps = lapCount;
+    getProgress().visitedCheckPoints = checkpoints;
+}
+
+void Vehicle::restoreLocalState(const LocalState& state)
+{
+    getPhysics() = state.physics;
+    controls = state.controls;
+    isAccelerating = state.isAccelerating;
+    sync();
+}
 
 void Vehicle::sync()
 {
+    const VehiclePhysics& physics = getPhysics();
     shape.setPosition(physics.getPosition().getX(), physics.getPosition().getY());
     shape.setRotation(physics.getRotation());
 }
@@ -301,26 +329,18 @@ void Vehicle::drawVector(sf::RenderWindow& window)
     line[0].color = sf::Color(130, 75, 210);
     line[1].color = sf::Color(130, 75, 210);
     window.draw(line, 2, sf::Lines);
-}
-
-void Vehicle::updateTextPosition(const sf::Vector2f& centerPoint)
-{
-    
-    int xPos = centerPoint.x + WIDTH / 4 + 100;
-    int yPos = centerPoint.y - HEIGHT / 4 - 200;
-    statusText.setPosition(xPos, yPos);
-   
+    PerfOverlay::countDraw(2);
 }
 
 bool Vehicle::allCheckpointsPassed(const Track& track) const
 {
-    return visitedCheckPoints >= track.getCheckpoints().size();
+    return getProgress().visitedCheckPoints >= track.getCheckpoints().size();
 }
 
 void Vehicle::setRacePlace(const int p)
 {
     if (p >= 0) {
-        racePlace = p;
+        getProgress().racePlace = p;
     }
 }
 
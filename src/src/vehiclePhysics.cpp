@@ -9,8 +9,8 @@ VehiclePhysics::VehiclePhysics(const int& width, const int &height) : width(widt
 
 void VehiclePhysics::move(const double& x1, const double& y1) {
     
-    position.x += x1;
-    position.y += y1;
+    position.x += Real(x1);
+    position.y += Real(y1);
     reset();
 }
 
@@ -19,34 +19,49 @@ void VehiclePhysics::reset() {
     pos_x0 = position.x;
     pos_y0 = position.y;
     rot0 = rotation;
-    vel0 = getVelocity();
+    vel0 = velocity;
     angVel0 = angularVelocity;
     atTopSpeed = false;
-    // Note that you don't have restart the clock manually, because it's restarted here
-    clock.restart();
+    // Note that you don't have restart the time manually, because it's restarted here
+    elapsedTime = 0;
 }
 
 void VehiclePhysics::setAcceleration(const Vector2D& acc) {
     
+    changeAcceleration(Vector(acc));
+}
+
+void VehiclePhysics::changeAcceleration(const Vector& acc) {
+    
     acceleration = acc;
     reset();
 }
 
 void VehiclePhysics::setVelocity(const Vector2D& vel) {
     
+    changeVelocity(Vector(vel));
+}
+
+void VehiclePhysics::changeVelocity(const Vector& vel) {
+    
     velocity = vel;
     reset();
 }
 
 void VehiclePhysics::setAngularVelocity(const double& angVel) {
     
+    changeAngularVelocity(Real(angVel));
+}
+
+void VehiclePhysics::changeAngularVelocity(Real angVel) {
+    
     angularVelocity = angVel;
     reset();
 }
 
 void VehiclePhysics::setAngularAcceleration(const double& angAcc) {
     
-    angularAcceleration = angAcc;
+    angularAcceleration = Real(angAcc);
     reset();
 }
 
@@ -61,8 +76,7 @@ void VehiclePhysics::stop() {
 
 const double VehiclePhysics::getSlidingAngle() const {
     
-    Vector2D noseDirection = Vector2D::getUnitVector(rotation);
-    return Vector2D::angleBetween(noseDirection, velocity);
+    return physmath::toDouble(Vector::angleBetween(getHeadingVector(), velocity));
 }
 
 /*
@@ -72,9 +86,9 @@ const double VehiclePhysics::getSlidingAngle() const {
 void VehiclePhysics::flipVelocity(const char& axis) {
     
     if (axis == 'x') {
-        setVelocity({getVelocity().x, -getVelocity().y});
+        changeVelocity({velocity.x, -velocity.y});
     } else if (axis == 'y') {
-        setVelocity({-getVelocity().x * 0.6, getVelocity().y * 0.6});
+        changeVelocity({-velocity.x * Real(0.6), velocity.y * Real(0.6)});
     } else
         return;
 }
@@ -86,14 +100,14 @@ void VehiclePhysics::brake(bool fullBrake) {
         return;
 
     // unit vector is reverse (minus sign) relative to velocity vector
-    Vector2D unit_vector = -(velocity.getUnitVector());
+    Vector unit_vector = -(velocity.getUnitVector());
     // Braking is 3 times faster than acceleration.
-    Vector2D brake_vector = unit_vector * ACC * 0.5;
+    Vector brake_vector = unit_vector * Real(ACC) * Real(0.5);
 
     if (fullBrake) {
         brake_vector = brake_vector * 6;
     }
-    setAcceleration(brake_vector);
+    changeAcceleration(brake_vector);
 
     isBraking = true;
 }
@@ -104,35 +118,33 @@ void VehiclePhysics::reverse() {
     if (movingState == MovingState::FORWARD)
         return;
 
-    Vector2D unitVector = Vector2D::getUnitVector(rotation);
-    setAcceleration(-unitVector * 50);
+    changeAcceleration(-getHeadingVector() * 50);
     movingState = MovingState::BACKWARD;
 }
 
 void VehiclePhysics::rotate(double degs) {
     
     // Use setRotation or setAngularVelocity instead.
-    double elapsedTime = clock.getElapsedTime().asSeconds();
-    if ((elapsedTime - rotateTime > 0) && (elapsedTime - rotateTime < 0.05))
+    if ((elapsedTime - rotateTime > 0) && (elapsedTime - rotateTime < Real(0.05)))
         return;
 
     bool isBrakingBefore = isBraking;
     //Vector2D oldAcc = getAcceleration();
 
-    rotation += degs;
+    rotation += Real(degs);
 
     // Maintain current speed (direction changes of course)
-    Vector2D unitVector = Vector2D::getUnitVector(rotation);
-    double scalarSpeed = getVelocity().getLength();
-    setVelocity(unitVector * scalarSpeed);
+    const Vector& unitVector = getHeadingVector();
+    Real scalarSpeed = velocity.getLength();
+    changeVelocity(unitVector * scalarSpeed);
 
     // Maintain current acceleration (direction changes)
-    double scalarAcc = getAcceleration().getLength();
+    Real scalarAcc = acceleration.getLength();
     if (isBrakingBefore) {
-        setAcceleration(-unitVector * scalarAcc);
+        changeAcceleration(-unitVector * scalarAcc);
         isBraking = true;
     } else {
-        setAcceleration(unitVector * scalarAcc);
+        changeAcceleration(unitVector * scalarAcc);
     }
 
     rotateTime = elapsedTime;
@@ -143,20 +155,41 @@ void VehiclePhysics::setRotation(double degs) {
     if (lockedVelocity) {
         return;
     }
-    rotation = degs;
+    rotation = Real(degs);
+    reset();
+}
+
+void VehiclePhysics::setState(const Vector2D& pos, double degs, const Vector2D& vel) {
+    
+    position = Vector(pos);
+    rotation = Real(degs);
+    velocity = Vector(vel);
+    acceleration = {0, 0};
+    angularVelocity = 0;
+    angularAcceleration = 0;
+    isBraking = false;
+    lockedVelocity = true;
+    reset();
+}
+
+void VehiclePhysics::correctState(const Vector2D& pos, double degs, const Vector2D& vel) {
+    
+    position = Vector(pos);
+    rotation = Real(degs);
+    velocity = Vector(vel);
     reset();
 }
 
 void VehiclePhysics::accelerate() {
     
-    Vector2D unit_vector = Vector2D::getUnitVector(rotation);
+    const Vector& unit_vector = getHeadingVector();
     if (isMissile) {
-        setAcceleration(unit_vector * MISSILE_ACC);
+        changeAcceleration(unit_vector * Real(MISSILE_ACC));
     } else {
-        setAcceleration(unit_vector * ACC);
+        changeAcceleration(unit_vector * Real(ACC));
     }
-    if (collisionClock.getElapsedTime().asSeconds() > 0.3) {
-        setVelocity(unit_vector * getVelocity().getLength());
+    if (collisionTime > Real(0.3)) {
+        changeVelocity(unit_vector * velocity.getLength());
         lockedVelocity = true;
     }
     isBraking = false;
@@ -171,7 +204,7 @@ void VehiclePhysics::handleCollision(const Line &line, const Track& track, sf::R
 		return;
 	}
 
-    Vector2D oldVelocity = velocity;
+    Vector oldVelocity = velocity;
     // If velocity is (almost) zero.
     if (velocity.getLength() < 1) {
         if (angularVelocity > 0)
@@ -186,21 +219,21 @@ void VehiclePhysics::handleCollision(const Line &line, const Track& track, sf::R
     // After collision, the velocity is not locked to correspond
     // the nose direction. This state takes few seconds. See fixDirections() function.
     lockedVelocity = false;
-    Vector2D startPoint(line.getStart().x, line.getStart().y);
-    Vector2D endPoint(line.getEnd().x, line.getEnd().y);
+    Vector startPoint(line.getStart());
+    Vector endPoint(line.getEnd());
     // Line vector is parallel to the collided line.
-    Vector2D lineVector = endPoint - startPoint;
+    Vector lineVector = endPoint - startPoint;
 
     // Calculate the new velocity. See Vector2D class.
     if (velocity.getLength() > 1)
         velocity.mirror(lineVector);
     // Reduce the amount of speed by 50%.
-    velocity = velocity * ELASTIC_COEFF;
+    velocity = velocity * Real(ELASTIC_COEFF);
 
     // Move the vehicle a few units towards the normal of the collided line
     // to avoid oscilation and getting inside the collided wall.
-    Vector2D normalVector = Vector2D::getMirrorNormal(oldVelocity, lineVector);
-    Vector2D moveVector = normalVector.getUnitVector() * 8;
+    Vector normalVector = Vector::getMirrorNormal(oldVelocity, lineVector);
+    Vector moveVector = normalVector.getUnitVector() * 8;
     if (oldVelocity.getLength() > 500)
         moveVector = moveVector * 2;
 
@@ -210,8 +243,9 @@ void VehiclePhysics::handleCollision(const Line &line, const Track& track, sf::R
     else
         rotation += 5;
 
-    Vector2D oldPosition = position; // Save old position before moving.
-    move(moveVector.getX(), moveVector.getY());
+    Vector oldPosition = position; // Save old position before moving.
+    position += moveVector;
+    reset();
 
     // Adjust shape position to correspond physics position.
     shape.setPosition(getX(), getY());
@@ -227,76 +261,81 @@ void VehiclePhysics::handleCollision(const Line &line, const Track& track, sf::R
     }
 
     reset();
-    collisionClock.restart();
+    collisionTime = 0;
 }
 
 void VehiclePhysics::fixDirections() {
     
-    if (resetClock.getElapsedTime().asSeconds() < 0.1) {
+    if (fixTime < Real(0.1)) {
         return;
     }
     // Fix velocity direction.
     if (lockedVelocity)
-        velocity = Vector2D::getUnitVector(rotation) * velocity.getLength();
+        velocity = getHeadingVector() * velocity.getLength();
 
     // Fix acceleration direction.
-    Vector2D unitVectorRot = Vector2D::getUnitVector(rotation);
-    double currAccScalar = getAcceleration().getLength();
+    const Vector& unitVectorRot = getHeadingVector();
+    Real currAccScalar = acceleration.getLength();
     if (isBraking) {
-        Vector2D unitVectorVel = getVelocity().getUnitVector();
+        Vector unitVectorVel = velocity.getUnitVector();
         // Set direction of braking to correspond the direction of velocity instead of rotation
-        setAcceleration(-unitVectorVel * currAccScalar);
+        changeAcceleration(-unitVectorVel * currAccScalar);
     } else
-        setAcceleration(unitVectorRot * currAccScalar);
-    resetClock.restart();
+        changeAcceleration(unitVectorRot * currAccScalar);
+    fixTime = 0;
 }
 
-void VehiclePhysics::updateAngle(double &time) {
+void VehiclePhysics::updateAngle(Real &time) {
     
     // Rotation velocity depends on angular acceleration and time.
     angularVelocity = angVel0 + angularAcceleration * time;
     // Rotation depends on angular acceleration and time.
-    rotation = rot0 + angVel0 * time + 0.5 * angularAcceleration * (time * time);
+    rotation = rot0 + angVel0 * time + Real(0.5) * angularAcceleration * (time * time);
     fixDirections();
 }
 
 void VehiclePhysics::updatePosition() {
     
+    // Advance the simulation time by one tick.
+    elapsedTime += Real(TICK_TIME);
+    collisionTime += Real(TICK_TIME);
+    fixTime += Real(TICK_TIME);
+
     // Position depends on elapsed time
-    double time = clock.getElapsedTime().asSeconds();
+    Real time = elapsedTime;
 
     // Aliases
-    double& x = position.x;
-    double& y = position.y;
+    Real& x = position.x;
+    Real& y = position.y;
 
     // v = v0 + a * t
     velocity.x = vel0.x + acceleration.x * time;
     velocity.y = vel0.y + acceleration.y * time;
 
     // s = s0 + v0 * t + 0.5 * a * t^2
-    x = pos_x0 + vel0.x * time + 0.5 * acceleration.x * (time * time);
-    y = pos_y0 + vel0.y * time + 0.5 * acceleration.y * (time * time);
+    x = pos_x0 + vel0.x * time + Real(0.5) * acceleration.x * (time * time);
+    y = pos_y0 + vel0.y * time + Real(0.5) * acceleration.y * (time * time);
 
     updateAngle(time);
 
     /// Vehicle is braking and its speed approaches zero.
     if (isBraking && velocity.getLength() < 30) {
-        setAcceleration({0, 0});
-        setVelocity({0, 0});
-        setAngularVelocity(0);
+        changeAcceleration({0, 0});
+        changeVelocity({0, 0});
+        changeAngularVelocity(0);
         isBraking = false;
     }
 
     // If speed reaches MAX_SPEED
-    if (isMissile && velocity.getLength() > MISSILE_SPEED){
-        setAcceleration({0, 0});
-        velocity.x *= 0.98;
-        velocity.y *= 0.98;
+    if (isMissile && velocity.getLength() > Real(MISSILE_SPEED)){
+        changeAcceleration({0, 0});
+        velocity.x *= Real(0.98);
+        velocity.y *= Real(0.98);
     }
-    else if (!isMissile && velocity.getLength() > MAX_SPEED) {
-        setAcceleration({0, 0});
-        velocity.x *= 0.98;
-        velocity.y *= 0.98;
+    else if (!isMissile && velocity.getLength() > Real(MAX_SPEED)) {
+        changeAcceleration({0, 0});
+        velocity.x *= Real(0.98);
+        velocity.y *= Real(0.98);
     }
 }
 
@@ -0,0 +1,60 @@
+#include "vehicleRegistry.hpp"
+#include "aivehicle.hpp"
+
+std::size_t VehicleRegistry::add(Vehicle* vehicle, const VehiclePhysics& vehiclePhysics,
+        const Health& vehicleHealth, const Progress& vehicleProgress)
+{
+    std::size_t entity = objects.size();
+    objects.push_back(vehicle);
+    physics.push_back(vehiclePhysics);
+    health.push_back(vehicleHealth);
+    progress.push_back(vehicleProgress);
+    centers.push_back(Vector2D(0, 0));
+    bounds.push_back(sf::FloatRect());
+    standings.push_back(entity);
+    return entity;
+}
+
+void VehicleRegistry::gather()
+{
+    for (std::size_t e = 0; e < objects.size(); e++) {
+        const sf::RectangleShape& shape = objects[e]->getShape();
+        centers[e] = Vector2D(AIVehicle::getMiddlePoint(shape));
+        bounds[e] = physmath::getGlobalBounds(shape);
+    }
+}
+
+void VehicleRegistry::saveState(StateBuffer& state) const
+{
+    for (const VehiclePhysics& p : physics) {
+        state.write(p);
+    }
+    // The fields one by one, so that the padding isn't saved.
+    for (const Health& h : health) {
+        state.write(h.hp);
+        state.write(h.destroyedFlag);
+    }
+    for (const Progress& p : progress) {
+        state.write(p.laps);
+        state.write(p.visitedCheckPoints);
+        state.write(p.racePlace);
+        state.write(p.distance);
+    }
+}
+
+void VehicleRegistry::loadState(StateBuffer& state)
+{
+    for (VehiclePhysics& p : physics) {
+        state.read(p);
+    }
+    for (Health& h : health) {
+        state.read(h.hp);
+        state.read(h.destroyedFlag);
+    }
+    for (Progress& p : progress) {
+        state.read(p.laps);
+        state.read(p.visitedCheckPoints);
+        state.read(p.racePlace);
+        state.read(p.distance);
+    }
+}
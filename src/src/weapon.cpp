@@ -1,12 +1,17 @@
 #include <random>
 
 #include "weapon.hpp"
+#include "gun.hpp"
+#include "turbo.hpp"
+#include "missileLauncher.hpp"
+#include "perfOverlay.hpp"
+#include "settings.hpp"
 
 Weapon::Weapon(const std::string& textureName) : shape(sf::Vector2f(50, 50))
 {
     // Load texture
     std::string filepath = "../images/" + textureName;
-    if (!weaponTexture.loadFromFile(filepath)) {
+    if (!settings::headless && !weaponTexture.loadFromFile(filepath)) {
         filepath = "../../images/" + textureName;
         if (!weaponTexture.loadFromFile(filepath)) {
 			// Failed to load
@@ -32,37 +37,81 @@ Weapon::Weapon(const Weapon& weapon)
     
 }
 
-void Weapon::setSpawnPoint(const std::vector<structures::Point>& points, std::vector<int>& reserved)
+void Weapon::setSpawnPoint(const std::vector<structures::Point>& points, std::vector<int>& reserved,
+                           std::mt19937& rng)
 {
-    auto index = Weapon::getRandomNumber(0, points.size() - 1);
+    auto index = Weapon::getRandomNumber(0, points.size() - 1, rng);
 	int count = 0;
 	// Check if index is in reserved list.
 	while (std::find(reserved.begin(), reserved.end(), index) != reserved.end()) {
-		index = Weapon::getRandomNumber(0, points.size() - 1);
+		index = Weapon::getRandomNumber(0, points.size() - 1, rng);
 		count++;
 		// Prevent infinity loop (if all indexes are reserved for some reason)
 		if (count > 20) {
 			break;
 		}
 	}
-	std::cout << "COUNT: " << count << std::endl;
     auto p = points[index];
     shape.setPosition(p.x, p.y);
 	reserved.push_back(index);
 }
 
-/*
-void Weapon::useWeapon(float startTime)
+void Weapon::saveState(StateBuffer& state) const
 {
-	std::cout << "A weapon was used" << std::endl;
-	if (!isUsing)
-	{
-		isUsing = true;
-		timer = startTime;
-	}
+    // The position is on the track for pickups and on the HUD for the weapons of a vehicle.
+    state.write(shape.getPosition());
+    state.write(shape.getScale());
+    state.write(isUsing);
+    state.write(isUsed);
+    state.write(timer);
+}
+
+void Weapon::loadState(StateBuffer& state)
+{
+    sf::Vector2f position;
+    sf::Vector2f scale;
+    state.read(position);
+    state.read(scale);
+    shape.setPosition(position);
+    shape.setScale(scale);
+    state.read(isUsing);
+    state.read(isUsed);
+    state.read(timer);
+}
+
+void Weapon::hashState(StateHasher& hasher) const
+{
+    hasher.add(type);
+    hasher.add(isUsing);
+    hasher.add(isUsed);
+    hasher.addDouble(timer);
+}
+
+// static
+void Weapon::saveWeapons(const std::vector<std::unique_ptr<Weapon>>& weapons, StateBuffer& state)
+{
+    state.write(weapons.size());
+    for (auto &w : weapons) {
+        state.write(w->getType());
+        w->saveState(state);
+    }
+}
+
+// static
+void Weapon::loadWeapons(std::vector<std::unique_ptr<Weapon>>& weapons, StateBuffer& state)
+{
+    std::size_t count;
+    state.read(count);
+    weapons.resize(count);
+    for (auto &w : weapons) {
+        WeaponType savedType;
+        state.read(savedType);
+        if (!w || w->getType() != savedType) {
+            w = Weapon::create(savedType);
+        }
+        w->loadState(state);
+    }
 }
-*/
- 
 
 bool Weapon::updateWeapon(float elapsedTime)
 {
@@ -85,6 +134,7 @@ sf::RectangleShape& Weapon::getShape()
 void Weapon::drawWeapon(sf::RenderWindow& window) const
 {
     window.draw(shape);
+    PerfOverlay::countDraw(shape);
 }
 
 void Weapon::setType(const Weapon::WeaponType pType)
@@ -97,14 +147,30 @@ Weapon::WeaponType Weapon::getType() const
     return type;
 }
 
+// static
+std::unique_ptr<Weapon> Weapon::create(WeaponType type)
+{
+    switch (type) {
+        case GUN:
+            return std::make_unique<Gun>();
+        case TURBO:
+            return std::make_unique<Turbo>();
+        case MISSILE:
+            return std::make_unique<MissileLauncher>();
+        default:
+            return nullptr;
+    }
+}
+
 // static
 // Get random number between low and hight (including them)
-int Weapon::getRandomNumber(int low, int high) {
+int Weapon::getRandomNumber(int low, int high, std::mt19937& rng) {
     
-    std::random_device rd; // Init seed
-    std::mt19937 rng(rd()); // random-number engine used (Mersenne-Twister in this case)
-    std::uniform_int_distribution<int> uni(low, high);
-    return uni(rng);
+    // std::uniform_int_distribution is not used, because its algorithm depends on
+    // the standard library and replays must give the same numbers everywhere.
+    // The output of std::mt19937 is fixed by the standard.
+    unsigned int range = high - low + 1;
+    return low + static_cast<int>(rng() % range);
 }
 
 
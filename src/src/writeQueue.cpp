@@ -0,0 +1,54 @@
+#include "writeQueue.hpp"
+
+WriteQueue::WriteQueue() : thread(&WriteQueue::run, this)
+{
+
+}
+
+WriteQueue::~WriteQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAdded.notify_one();
+    thread.join();
+}
+
+void WriteQueue::push(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    jobAdded.notify_one();
+}
+
+void WriteQueue::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    jobsDone.wait(lock, [this] { return jobs.empty() && !busy; });
+}
+
+void WriteQueue::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        jobAdded.wait(lock, [this] { return !jobs.empty() || stopping; });
+        if (jobs.empty()) {
+            // Stopping and nothing left to write.
+            break;
+        }
+        std::function<void()> job = std::move(jobs.front());
+        jobs.pop_front();
+        busy = true;
+        // Don't block push() while writing.
+        lock.unlock();
+        job();
+        lock.lock();
+        busy = false;
+        if (jobs.empty()) {
+            jobsDone.notify_all();
+        }
+    }
+}